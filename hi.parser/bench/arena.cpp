@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "hi.parser/html5.h"
+#include "legacy.h"
+
+#include <memory>
+#include <vector>
+
+using namespace hi;
+using hi::bench::legacy::Handle;
+
+namespace
+{
+
+constexpr std::size_t kNodes = 100000;
+constexpr std::size_t kFanout = 8;
+
+// Builds a complete kFanout-ary tree of `nodes` elements below `root`,
+// creating children with `make` and linking them with operator<<.
+template <typename Node, typename Make>
+void s_buildTree(Node& root, std::size_t nodes, Make&& make) {
+  std::vector<Node> level{root};
+  std::size_t built = 1;
+  while (built < nodes) {
+    std::vector<Node> next;
+    next.reserve(level.size() * kFanout);
+    for (auto& parent : level) {
+      for (std::size_t i = 0; i < kFanout && built < nodes; ++i, ++built) {
+        Node child = make(i % 2 ? Tag::Global::Li : Tag::Global::Div);
+        parent << child;
+        next.push_back(std::move(child));
+      }
+    }
+    level = std::move(next);
+  }
+}
+
+} // namespace
+
+
+HI_BENCHMARK(arena) {
+  state.run("legacy shared_ptr tree: build+destroy", kNodes, [] {
+    Handle root(Tag::Global::Body);
+    s_buildTree(root, kNodes, [](Tag::Global tag) { return Handle(tag); });
+  });
+
+  state.run("Tag per-element document: build+destroy", kNodes, [] {
+    Tag root(Tag::Global::Body);
+    s_buildTree(root, kNodes, [](Tag::Global tag) { return Tag(tag); });
+  });
+
+  state.run("DOM::createElement: build+destroy", kNodes, [] {
+    DOM dom;
+    s_buildTree(dom.body, kNodes, [&dom](Tag::Global tag) {
+      return dom.createElement(static_cast<Tag::Native>(tag));
+    });
+  });
+
+  // Teardown alone: trees are built up front, one is released per repetition.
+  std::vector<std::unique_ptr<Handle>> legacy_trees;
+  std::vector<std::unique_ptr<DOM>> doms;
+  for (std::size_t i = 0; i < state.repetitions(); ++i) {
+    legacy_trees.push_back(std::make_unique<Handle>(Tag::Global::Body));
+    s_buildTree(*legacy_trees.back(), kNodes, [](Tag::Global tag) { return Handle(tag); });
+    doms.push_back(std::make_unique<DOM>());
+    DOM& dom = *doms.back();
+    s_buildTree(dom.body, kNodes, [&dom](Tag::Global tag) {
+      return dom.createElement(static_cast<Tag::Native>(tag));
+    });
+  }
+  state.run("legacy shared_ptr tree: destroy", kNodes, [&] { legacy_trees.pop_back(); });
+  state.run("DOM::createElement: destroy", kNodes, [&] { doms.pop_back(); });
+}
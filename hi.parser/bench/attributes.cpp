@@ -0,0 +1,149 @@
+#include "bench.h"
+#include "legacy.h"
+#include "hi.parser/parser.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+constexpr std::size_t kStorageElements = 1 << 20;
+
+// Bytes handed out by glibc malloc; nullopt elsewhere. Allocators that
+// replace it, such as ASan's, leave the count where it was.
+std::optional<int64_t> s_heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  const struct mallinfo2 info = mallinfo2();
+  return static_cast<int64_t>(info.uordblks + info.hblkhd);
+#else
+  return std::nullopt;
+#endif
+}
+
+// Heap growth between two readings, less `excluded`, per element; "n/a"
+// without readings or when the heap did not grow past `excluded`.
+std::string s_perElement(std::optional<int64_t> before, std::optional<int64_t> after, int64_t excluded, std::size_t elements) {
+  if (!before || !after || elements == 0)
+    return "n/a";
+  const int64_t bytes = *after - *before - excluded;
+  if (bytes <= 0)
+    return "n/a";
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.1f", double(bytes) / double(elements));
+  return text;
+}
+
+// Elements with 0, 1, 2, 3 and 6 attributes in roughly the proportions of
+// the article corpus.
+std::string s_storagePage(std::size_t elements) {
+  static constexpr const char* kElements[] = {
+    "<li></li>", "<li></li>", "<b></b>", "<i></i>",
+    "<p class=x></p>", "<span id=s></span>", "<p class=y></p>",
+    "<a href=/x class=l></a>", "<div class=a id=b></div>",
+    "<img src=a.png alt=b width=1>", "<input type=text name=q value=v id=q class=c required>",
+  };
+  std::string page = "<ul>";
+  for (std::size_t i = 0; i < elements; ++i)
+    page += kElements[i % std::size(kElements)];
+  return page + "</ul>";
+}
+
+} // namespace
+
+
+HI_BENCHMARK(attributes) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+
+  std::size_t elements = 0, attributes = 0;
+  {
+    const auto before_legacy = s_heapInUse();
+    auto legacy = bench::legacy::buildTree(page, &elements, &attributes);
+    const auto after_legacy = s_heapInUse();
+
+    HTML5Parser parser;
+    DOM dom = parser.parse(page);
+    const auto after_dom = s_heapInUse();
+
+    const auto source = static_cast<int64_t>(page.size());
+    std::printf("%-12s %zu elements, %zu attributes\n", "attributes", elements, attributes);
+    std::printf("%-12s legacy string maps: %s heap bytes/element\n", "attributes",
+      s_perElement(before_legacy, after_legacy, 0, elements).c_str());
+    std::printf("%-12s arena + retained source: %s heap bytes/element (%s excluding the %zu byte source copy)\n", "attributes",
+      s_perElement(after_legacy, after_dom, 0, elements).c_str(), s_perElement(after_legacy, after_dom, source, elements).c_str(), page.size());
+  }
+
+  state.run("legacy string-map tree from tokens", page.size(), [&] {
+    auto legacy = bench::legacy::buildTree(page);
+    bench::State::doNotOptimize(legacy);
+  }, "B");
+
+  state.run("parse with zero-copy attributes", page.size(), [&] {
+    HTML5Parser parser;
+    DOM dom = parser.parse(page);
+    bench::State::doNotOptimize(dom);
+  }, "B");
+}
+
+
+HI_BENCHMARK(attribute_storage) {
+  const std::string page = s_storagePage(kStorageElements);
+  std::printf("%-18s sizeof(HTML5Element) = %zu, sizeof(Attribute) = %zu\n", "attribute_storage",
+    sizeof(detail::HTML5Element), sizeof(detail::Attribute));
+  // The same page as a tree with a string map per element, the layout
+  // this storage replaced, for the ratio between the two.
+  {
+    const auto before = s_heapInUse();
+    auto legacy = bench::legacy::buildTree(page);
+    std::printf("%-18s %zu elements: %s heap bytes/element with string maps\n", "attribute_storage", kStorageElements,
+      s_perElement(before, s_heapInUse(), 0, kStorageElements).c_str());
+  }
+  {
+    const auto before = s_heapInUse();
+    HTML5Parser parser;
+    DOM dom = parser.parse(page);
+    std::printf("%-18s %zu elements: %s heap bytes/element excluding the source copy\n", "attribute_storage", kStorageElements,
+      s_perElement(before, s_heapInUse(), static_cast<int64_t>(page.size()), kStorageElements).c_str());
+  }
+
+  // Lookups and updates on one element with n attributes, by name and by
+  // a key resolved up front.
+  for (std::size_t count : {1, 3, 8, 32}) {
+    Tag tag(Tag::s_getType("div"));
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < count; ++i) {
+      names.push_back("data-a" + std::to_string(i));
+      tag.setAttr(names.back(), "value");
+    }
+    constexpr std::size_t kLookups = 1 << 20;
+    const std::string label = std::to_string(count) + " attributes";
+    state.run("getAttr, " + label, kLookups, [&] {
+      std::size_t total = 0;
+      for (std::size_t i = 0; i < kLookups; ++i)
+        total += tag.getAttr(names[i % count]).size();
+      bench::State::doNotOptimize(total);
+    }, "lookups");
+    std::vector<Tag::AttrKey> keys;
+    for (const std::string& name : names)
+      keys.push_back(tag.getAttrKey(name));
+    state.run("getAttr by key, " + label, kLookups, [&] {
+      std::size_t total = 0;
+      for (std::size_t i = 0; i < kLookups; ++i)
+        total += tag.getAttr(keys[i % count]).size();
+      bench::State::doNotOptimize(total);
+    }, "lookups");
+    state.run("setAttr, " + label, kLookups, [&] {
+      for (std::size_t i = 0; i < kLookups; ++i)
+        tag.setAttr(names[i % count], "v");
+    }, "updates");
+  }
+}
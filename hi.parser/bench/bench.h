@@ -0,0 +1,88 @@
+#ifndef HI_BENCH_H
+#define HI_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hi {
+namespace bench {
+
+
+// One timed scenario, as written to the JSON report.
+struct Result
+{
+  std::string benchmark;
+  std::string scenario;
+  std::size_t items;
+  std::string unit;
+  double best;    // seconds
+  double median;  // seconds
+}; // struct Result
+
+
+// Times one scenario of a benchmark. Each call to run() executes the body
+// `repetitions` times, prints the fastest and the median repetition and
+// adds them to `results`.
+class State
+{
+  std::string name_;
+  std::size_t repetitions_;
+  std::size_t max_nodes_;
+  std::vector<Result>& results_;
+
+public:
+  State(std::string name, std::size_t repetitions, std::size_t max_nodes, std::vector<Result>& results)
+    : name_(std::move(name)), repetitions_(repetitions), max_nodes_(max_nodes), results_(results)
+  {}
+
+  std::size_t repetitions() const noexcept { return repetitions_; }
+  // Largest generated document benchmarks should build (-n).
+  std::size_t maxNodes() const noexcept { return max_nodes_; }
+
+  // `items` is the amount of work one repetition does, counted in `unit`.
+  template <typename F>
+  void run(std::string_view label, std::size_t items, F&& body, std::string_view unit = "items") {
+    std::vector<double> samples;
+    samples.reserve(repetitions_);
+    for (std::size_t i = 0; i < repetitions_; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      body();
+      auto stop = std::chrono::steady_clock::now();
+      samples.push_back(std::chrono::duration<double>(stop - start).count());
+    }
+    report(label, items, unit, samples);
+  }
+
+  // Keeps the compiler from discarding a computed value.
+  template <typename T>
+  static void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+private:
+  void report(std::string_view label, std::size_t items, std::string_view unit, std::vector<double>& samples);
+}; // class State
+
+
+using BenchmarkFn = void (*)(State&);
+
+// Reads a file from bench/corpus.
+std::string readCorpus(std::string_view name);
+// Grows an HTML page to at least `size` bytes by repeating the contents of its <body>.
+std::string inflatePage(const std::string& page, std::size_t size);
+
+bool registerBenchmark(const char* name, BenchmarkFn fn);
+
+} // namespace bench
+} // namespace hi
+
+#define HI_BENCHMARK(name)                                                       \
+  static void hi_bench_##name(::hi::bench::State&);                              \
+  static const bool hi_bench_registered_##name =                                 \
+    ::hi::bench::registerBenchmark(#name, &hi_bench_##name);                     \
+  static void hi_bench_##name(::hi::bench::State& state)
+
+#endif // HI_BENCH_H
@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kRenders = 200;
+
+bool s_isChrome(const Tag::Element& element) {
+  const auto type = element.getType();
+  if (!std::holds_alternative<Tag::Native>(type))
+    return false;
+  switch (static_cast<Tag::Global>(std::get<Tag::Native>(type))) {
+    case Tag::Global::Header: case Tag::Global::Nav: case Tag::Global::Footer: case Tag::Global::Aside:
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // namespace
+
+
+// Renders the article page repeatedly while one attribute inside <main>
+// changes between renders, as a page with per-request content would.
+HI_BENCHMARK(cache) {
+  const std::string page = bench::readCorpus("article.html");
+  HTML5Parser parser;
+
+  const char* const labels[] = {"uncached", "header/nav/aside/footer cached", "chrome + <head> cached"};
+  for (int mode = 0; mode < 3; ++mode) {
+    DOM dom = parser.parse(page);
+    Tag::Element* dynamic = nullptr;
+    for (auto& element : dom.body.depthFirst()) {
+      if (dynamic == nullptr && element.getType() == std::variant<Tag::Native, Tag::Custom>(static_cast<Tag::Native>(Tag::Global::Main)))
+        dynamic = &element;
+      if (mode >= 1 && s_isChrome(element))
+        element.setCacheable(true);
+    }
+    if (mode == 2)
+      dom.head.setCacheable();
+    const std::size_t size = dom.toString().size();
+
+    std::string buffer;
+    state.run(std::string("render, ") + labels[mode], size * kRenders, [&] {
+      for (std::size_t i = 0; i < kRenders; ++i) {
+        dynamic->setAttrView(static_cast<detail::Attribute::Key>(Tag::Global::Class), i % 2 ? "a" : "b");
+        buffer.clear();
+        StringSink sink(buffer);
+        Serializer serializer(sink);
+        serializer.write(dom);
+        serializer.flush();
+      }
+      bench::State::doNotOptimize(buffer);
+    }, "B");
+  }
+}
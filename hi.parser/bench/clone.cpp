@@ -0,0 +1,123 @@
+#include "bench.h"
+#include "hi.parser/memory.h"
+#include "hi.parser/overlay.h"
+#include "hi.parser/parser.h"
+
+#include <cstdio>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kLayoutSize = 1 << 20;
+constexpr std::size_t kRequests = 100;
+
+// What a request fills in: the title, the heading and the time of the page.
+void s_fill(Tag& title, Tag& heading, Tag& time, std::size_t request) {
+  const std::string text = "Request " + std::to_string(request);
+  title.setText(text);
+  heading.setText(text);
+  time.setAttr("datetime", "2024-01-01");
+}
+
+// The first element with the name in the layout.
+OverlayDOM::Index s_find(const FrozenDOM& frozen, std::string_view name) {
+  const auto types = frozen.getTypes();
+  for (OverlayDOM::Index i = 0; i < types.size(); ++i) {
+    if (types[i] != Tag::Element::kText && types[i] != Tag::Element::kComment && frozen.getName(types[i]) == name)
+      return i;
+  }
+  return OverlayDOM::kNone;
+}
+
+} // namespace
+
+
+// A page per request from a layout of 1 MiB: parsing the layout again
+// against copying a parsed one (DOM::copyTree) and copying an overlay of a
+// frozen one (OverlayDOM), each followed by the same three edits.
+HI_BENCHMARK(clone) {
+  const std::string layout_html = bench::inflatePage(bench::readCorpus("article.html"), kLayoutSize);
+  HTML5Parser parser;
+
+  MemoryTracker::setEnabled(true);
+  const DOM layout = parser.parse(layout_html);
+  MemoryTracker::setEnabled(false);
+  const Tag title = layout.getElementsByTagName("title").front();
+  const Tag heading = layout.getElementsByTagName("h1").front();
+  const Tag time = layout.getElementsByTagName("time").front();
+
+  state.run("parse 1 MiB layout per request", layout_html.size() * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      DOM page = parser.parse(layout_html);
+      Tag page_title = page.getElementsByTagName("title").front();
+      Tag page_heading = page.getElementsByTagName("h1").front();
+      Tag page_time = page.getElementsByTagName("time").front();
+      s_fill(page_title, page_heading, page_time, i);
+      bench::State::doNotOptimize(page);
+    }
+  }, "B");
+
+  state.run("copy 1 MiB layout per request", layout_html.size() * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      DOM page = layout.copyTree();
+      Tag page_title = *page.findCopy(title);
+      Tag page_heading = *page.findCopy(heading);
+      Tag page_time = *page.findCopy(time);
+      s_fill(page_title, page_heading, page_time, i);
+      bench::State::doNotOptimize(page);
+    }
+  }, "B");
+
+  const OverlayDOM frozen_layout{FrozenDOM(layout)};
+  const FrozenDOM& frozen = frozen_layout.getLayout();
+  const auto overlay_title = s_find(frozen, "title");
+  const auto overlay_heading = s_find(frozen, "h1");
+  const auto overlay_time = s_find(frozen, "time");
+  const auto fillOverlay = [&](OverlayDOM& page, std::size_t request) {
+    const std::string text = "Request " + std::to_string(request);
+    page.setText(overlay_title, text);
+    page.setText(overlay_heading, text);
+    page.setAttr(overlay_time, "datetime", "2024-01-01");
+  };
+
+  state.run("overlay of 1 MiB layout per request", layout_html.size() * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      OverlayDOM page = frozen_layout;
+      fillOverlay(page, i);
+      bench::State::doNotOptimize(page);
+    }
+  }, "B");
+
+  std::string html;
+  state.run("copy, fill and render per request", layout_html.size() * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      DOM page = layout.copyTree();
+      Tag page_title = *page.findCopy(title);
+      Tag page_heading = *page.findCopy(heading);
+      Tag page_time = *page.findCopy(time);
+      s_fill(page_title, page_heading, page_time, i);
+      html = page.toString();
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  state.run("overlay, fill and render per request", layout_html.size() * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      OverlayDOM page = frozen_layout;
+      fillOverlay(page, i);
+      html = page.toString();
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  // What one request keeps alive either way.
+  MemoryTracker::setEnabled(true);
+  const DOM copy = layout.copyTree();
+  MemoryTracker::setEnabled(false);
+  const MemoryUsage parsed_usage = layout.getMemoryUsage();
+  const MemoryUsage copy_usage = copy.getMemoryUsage();
+  std::printf("%-12s %zu bytes live, %zu reserved per parsed page\n", "clone", parsed_usage.getLiveBytes(), parsed_usage.reserved_bytes);
+  std::printf("%-12s %zu bytes live, %zu reserved per copied page\n", "clone", copy_usage.getLiveBytes(), copy_usage.reserved_bytes);
+}
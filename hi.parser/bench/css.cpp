@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "CSS.h"
+
+#include <map>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 1 << 20;
+
+// A stylesheet as it is usually parsed first: copied strings for the
+// selector and for every property and value. Ignores comments and quotes.
+struct StringStylesheet {
+  struct Rule {
+    std::string selector;
+    std::vector<std::pair<std::string, std::string>> declarations;
+  };
+  std::vector<Rule> rules;
+
+  static std::string trim(std::string_view text) {
+    const std::size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos)
+      return {};
+    return std::string(text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1));
+  }
+
+  explicit StringStylesheet(std::string_view text) {
+    std::size_t i = 0;
+    while ((i = text.find_first_not_of(" \t\r\n}", i)) != std::string_view::npos) {
+      const std::size_t open = text.find_first_of("{;", i);
+      if (open == std::string_view::npos)
+        break;
+      if (text[open] == ';' || text[i] == '@') {
+        i = open + 1;
+        continue;
+      }
+      const std::size_t close = std::min(text.find('}', open), text.size());
+      Rule rule{trim(text.substr(i, open - i)), {}};
+      std::string_view body = text.substr(open + 1, close - open - 1);
+      while (!body.empty()) {
+        const std::size_t end = std::min(body.find(';'), body.size());
+        const std::string_view declaration = body.substr(0, end);
+        if (const std::size_t colon = declaration.find(':'); colon != std::string_view::npos)
+          rule.declarations.emplace_back(trim(declaration.substr(0, colon)), trim(declaration.substr(colon + 1)));
+        body.remove_prefix(std::min(end + 1, body.size()));
+      }
+      rules.push_back(std::move(rule));
+      i = close + 1;
+    }
+  }
+
+  std::size_t memoryUsage() const {
+    std::size_t bytes = sizeof(*this) + rules.capacity() * sizeof(Rule);
+    for (const Rule& rule : rules) {
+      bytes += rule.selector.capacity() > 15 ? rule.selector.capacity() + 1 : 0;
+      bytes += rule.declarations.capacity() * sizeof(rule.declarations[0]);
+      for (const auto& [name, value] : rule.declarations)
+        bytes += (name.capacity() > 15 ? name.capacity() + 1 : 0) + (value.capacity() > 15 ? value.capacity() + 1 : 0);
+    }
+    return bytes;
+  }
+};
+
+} // namespace
+
+
+// Parses a ~1 MB stylesheet: a site theme repeated the way bundles
+// concatenate component styles. Also reports the bytes kept per rule.
+HI_BENCHMARK(css) {
+  const std::string theme = bench::readCorpus("site.css");
+  std::string sheet;
+  sheet.reserve(kCorpusSize + theme.size());
+  while (sheet.size() < kCorpusSize)
+    sheet += theme;
+
+  const hiweb::CSS css(sheet);
+  const StringStylesheet strings(sheet);
+  std::printf("%-12s %zu rules, %zu bytes retained per rule (strings: %zu)\n", "css", css.getRules().size(),
+    css.getMemoryUsage() / css.getRules().size(), strings.memoryUsage() / strings.rules.size());
+
+  state.run("string copies", sheet.size(), [&] {
+    bench::State::doNotOptimize(StringStylesheet(sheet));
+  }, "B");
+
+  state.run("hiweb::CSS", sheet.size(), [&] {
+    bench::State::doNotOptimize(hiweb::CSS(sheet));
+  }, "B");
+
+  state.run("hiweb::CSSTokenizer only", sheet.size(), [&] {
+    hiweb::CSSTokenizer tokenizer(sheet);
+    hiweb::CSSTokenizer::Token token;
+    std::size_t tokens = 0;
+    while (tokenizer.next(token))
+      ++tokens;
+    bench::State::doNotOptimize(tokens);
+  }, "B");
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "hi.parser/diff.h"
+#include "hi.parser/frozen.h"
+#include "hi.parser/parser.h"
+
+#include <cstdio>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+
+// The small update of a page between two pushes: a few links change class,
+// a few paragraphs come and go, and one section moves to the end.
+void s_edit(DOM& dom) {
+  const std::vector<Tag> links = dom.getElementsByTagName("a");
+  for (std::size_t i = 0; i < links.size(); i += links.size() / 10 + 1) {
+    Tag link = links[i];
+    link.setAttr("class", "visited");
+  }
+  const std::vector<Tag> paragraphs = dom.getElementsByTagName("p");
+  for (std::size_t i = 0; i < 5 && i < paragraphs.size(); ++i) {
+    const Tag& paragraph = paragraphs[paragraphs.size() * (2 * i + 1) / 10];
+    Tag::Element* element = &*paragraph.depthFirst().begin();
+    Tag note = dom.body.createElement("p");
+    note.setAttr("class", "note");
+    element->getParent()->insertChild(&*note.depthFirst().begin(), element->getIndex());
+    const Tag& removed = paragraphs[paragraphs.size() * (2 * i + 1) / 10 + 1];
+    Tag::Element* gone = &*removed.depthFirst().begin();
+    gone->getParent()->removeChild(gone);
+  }
+  const std::vector<Tag> sections = dom.getElementsByTagName("section");
+  if (!sections.empty()) {
+    Tag body = dom.body;
+    body << sections.front();
+  }
+}
+
+} // namespace
+
+
+// Pushing an update of a large page: the edit script against the whole
+// page serialized again.
+HI_BENCHMARK(diff) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  const DOM before = parser.parse(page);
+  DOM after = parser.parse(page);
+  s_edit(after);
+  const FrozenDOM frozen(after);
+  const std::size_t nodes = frozen.size();
+
+  TreeDiff differ;
+  const EditScript script = differ.diff(before, after);
+  DOM patched = FrozenDOM(before).toDOM();
+  script.apply(patched);
+  std::printf("%-12s %zu edits, %zu bytes of JSON for a %zu byte page; patched copy %s\n", "diff",
+    script.size(), script.toJSON().size(), after.toString().size(), patched.toString() == after.toString() ? "matches" : "DIFFERS");
+
+  state.run("serialize the whole page", nodes, [&] {
+    bench::State::doNotOptimize(after.toString());
+  }, "nodes");
+
+  state.run("diff, small edits", nodes, [&] {
+    bench::State::doNotOptimize(differ.diff(before, after));
+  }, "nodes");
+
+  state.run("diff, no edits", nodes, [&] {
+    bench::State::doNotOptimize(differ.diff(before, before));
+  }, "nodes");
+
+  state.run("diff, to JSON", nodes, [&] {
+    bench::State::doNotOptimize(differ.diff(before, after).toJSON());
+  }, "nodes");
+}
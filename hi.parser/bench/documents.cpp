@@ -0,0 +1,156 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/selector.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kMinNodes = 1000;
+constexpr std::size_t kLookups = 1 << 20;
+constexpr std::size_t kMaxFanout = 8;
+constexpr std::size_t kClasses = 16;
+constexpr std::size_t kIdEvery = 16;
+constexpr std::size_t kTextEvery = 4;
+
+constexpr Tag::Global kTypes[] = {
+  Tag::Global::Div, Tag::Global::Article, Tag::Global::Span, Tag::Global::A, Tag::Global::Li,
+  Tag::Global::Ul, Tag::Global::Section, Tag::Global::Em, Tag::Global::Td, Tag::Global::Tr,
+};
+
+// Names as markup spells them: mostly known, some in upper case, some custom.
+constexpr std::string_view kNames[] = {
+  "div", "p", "span", "a", "li", "ul", "section", "table", "td", "tr",
+  "DIV", "Span", "TABLE", "my-widget", "x-card", "app-root",
+};
+
+// xorshift32 with a fixed seed, so that every run generates the same documents.
+class Random
+{
+  uint32_t state_ = 0x2545F491u;
+
+public:
+  uint32_t next() noexcept {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+}; // class Random
+
+std::string s_sizeName(std::size_t nodes) {
+  return nodes >= 1000000 ? std::to_string(nodes / 1000000) + "M" : std::to_string(nodes / 1000) + "K";
+}
+
+// Builds `nodes` elements below `root` breadth first, every parent taking 1 to
+// kMaxFanout children, and returns them in creation order. The vector never
+// grows past its reservation, so `parent` stays valid.
+std::vector<Tag> s_buildTree(Tag& root, std::size_t nodes) {
+  Random random;
+  std::vector<Tag> elements;
+  elements.reserve(nodes);
+  Tag* parent = &root;
+  for (std::size_t next = 0; elements.size() < nodes; parent = &elements[next++]) {
+    const std::size_t children = 1 + random.next() % kMaxFanout;
+    for (std::size_t i = 0; i < children && elements.size() < nodes; ++i) {
+      elements.push_back(parent->createElement(static_cast<Tag::Native>(kTypes[random.next() % std::size(kTypes)])));
+      *parent << elements.back();
+    }
+  }
+  return elements;
+}
+
+// The document the other scenarios run on: the tree plus a class on every
+// element, an id on every kIdEvery-th and text in every kTextEvery-th.
+std::vector<Tag> s_buildDocument(DOM& dom, std::size_t nodes) {
+  std::vector<Tag> elements = s_buildTree(dom.body, nodes);
+  std::string value;
+  for (std::size_t i = 0; i < elements.size(); ++i) {
+    value.assign("c").append(std::to_string(i % kClasses));
+    elements[i].setAttr(Tag::Global::Class, value);
+    if (i % kIdEvery == 0)
+      elements[i].setAttr(Tag::Global::Id, value.assign("n").append(std::to_string(i)));
+    if (i % kTextEvery == 0)
+      elements[i].addText("Lorem ipsum & dolor");
+  }
+  return elements;
+}
+
+} // namespace
+
+
+// Micro benchmarks on their own and macro benchmarks over generated documents
+// of 1K nodes up to maxNodes() (-n) by factors of ten.
+HI_BENCHMARK(documents) {
+  {
+    detail::Interner names;
+    state.run("tag-name lookup, mixed names", kLookups, [&] {
+      std::size_t customs = 0;
+      for (std::size_t i = 0; i < kLookups; ++i)
+        customs += std::holds_alternative<Tag::Custom>(Tag::s_getType(kNames[i % std::size(kNames)], names));
+      bench::State::doNotOptimize(customs);
+    }, "lookups");
+  }
+
+  HTML5Parser parser;
+  for (std::size_t nodes = kMinNodes; nodes <= state.maxNodes(); nodes *= 10) {
+    const std::string size = s_sizeName(nodes);
+
+    state.run("build " + size + " nodes with operator<<", nodes, [&] {
+      DOM dom;
+      bench::State::doNotOptimize(s_buildTree(dom.body, nodes));
+    }, "nodes");
+
+    // The document goes before parsing, which at 10M nodes needs its memory.
+    std::string html;
+    {
+      DOM dom;
+      std::vector<Tag> elements = s_buildDocument(dom, nodes);
+      const Tag::AttrKey title = Tag::Global::Title;
+      const Tag::AttrKey custom = dom.body.getAttrKey("data-row");
+      state.run("setAttr by key, " + size + " nodes", nodes * 2, [&] {
+        for (Tag& element : elements) {
+          element.setAttr(title, "t");
+          element.setAttr(custom, "r");
+        }
+      }, "attrs");
+      state.run("getAttr by key, " + size + " nodes", nodes * 2, [&] {
+        std::size_t length = 0;
+        for (const Tag& element : elements)
+          length += element.getAttr(title).size() + element.getAttr(custom).size();
+        bench::State::doNotOptimize(length);
+      }, "attrs");
+      state.run("getAttr by name, " + size + " nodes", nodes * 2, [&] {
+        std::size_t length = 0;
+        for (const Tag& element : elements)
+          length += element.getAttr("class").size() + element.getAttr("data-row").size();
+        bench::State::doNotOptimize(length);
+      }, "attrs");
+
+      html = dom.toString();
+      state.run("DOM::toString, " + size + " nodes", html.size(), [&] {
+        bench::State::doNotOptimize(dom.toString());
+      }, "B");
+      state.run("Tag::toString of <body>, " + size + " nodes", html.size(), [&] {
+        bench::State::doNotOptimize(dom.body.toString());
+      }, "B");
+
+      for (const char* text : {"section > span.c3", "ul li a", "#n16"}) {
+        const Selector selector(text);
+        state.run("querySelectorAll(\"" + std::string(text) + "\"), " + size, nodes, [&] {
+          bench::State::doNotOptimize(selector.querySelectorAll(dom));
+        }, "nodes");
+      }
+    }
+
+    state.run("parse " + size + " node document", html.size(), [&] {
+      DOM parsed = parser.parse(html);
+      bench::State::doNotOptimize(parsed);
+    }, "B");
+  }
+}
@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "hi.parser/escape.h"
+#include "hi.parser/simd.h"
+
+#include <string>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kTextSize = 4 << 20;
+
+std::string s_repeat(std::string_view piece) {
+  std::string text;
+  text.reserve(kTextSize + piece.size());
+  while (text.size() < kTextSize)
+    text += piece;
+  return text;
+}
+
+} // namespace
+
+
+HI_BENCHMARK(escape) {
+  // Prose without markup characters, prose with one every 16 bytes, and
+  // text made of nothing but references.
+  const std::string plain = s_repeat("Fish and chips, ");
+  const std::string special = s_repeat("Fish & chips <3 ");
+  const std::string entities = s_repeat("&amp;&lt;&notin;&#x1F600;&copy;&NotNestedGreaterGreater;");
+  const std::string decoded_plain = s_repeat("Fish and chips, ");
+  const std::string decoded_special = s_repeat("Fish &amp; chips &lt;3 &copy; ");
+  std::string out(kTextSize * 2 * detail::kMaxEscapeGrowth, '\0');
+  std::string decoded;
+
+  const detail::simd::Level detected = detail::simd::detectLevel();
+  for (auto level : {detail::simd::Level::Scalar, detail::simd::Level::SSE42, detail::simd::Level::AVX2}) {
+    if (static_cast<int>(level) > static_cast<int>(detected))
+      continue;
+    detail::simd::setLevel(level);
+    const std::string name = detail::simd::levelName(level);
+
+    state.run("escape 4 MiB text, nothing escaped, " + name, plain.size(), [&] {
+      bench::State::doNotOptimize(detail::escape(plain, out.data(), detail::EscapeMode::Text));
+    }, "B");
+    state.run("escape 4 MiB text, 1 in 8 bytes escaped, " + name, special.size(), [&] {
+      bench::State::doNotOptimize(detail::escape(special, out.data(), detail::EscapeMode::Text));
+    }, "B");
+    state.run("escape 4 MiB attribute value, 1 in 8 escaped, " + name, special.size(), [&] {
+      bench::State::doNotOptimize(detail::escape(special, out.data(), detail::EscapeMode::Attribute));
+    }, "B");
+
+    state.run("unescape 4 MiB text without references, " + name, decoded_plain.size(), [&] {
+      bench::State::doNotOptimize(detail::unescape(decoded_plain, decoded));
+    }, "B");
+    state.run("unescape 4 MiB text, 3 references per 30 B, " + name, decoded_special.size(), [&] {
+      bench::State::doNotOptimize(detail::unescape(decoded_special, decoded));
+    }, "B");
+  }
+  detail::simd::setLevel(detected);
+
+  state.run("unescape 4 MiB of references", entities.size(), [&] {
+    bench::State::doNotOptimize(detail::unescape(entities, decoded));
+  }, "B");
+}
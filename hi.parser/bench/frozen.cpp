@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "hi.parser/frozen.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+#include <cstdio>
+#include <filesystem>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 16 << 20;
+
+const auto kClass = static_cast<detail::Attribute::Key>(Tag::Global::Class);
+
+} // namespace
+
+
+HI_BENCHMARK(frozen) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  const DOM dom = parser.parse(page);
+  const FrozenDOM frozen(dom);
+  const std::size_t nodes = frozen.size();
+  const std::size_t bytes = dom.toString().size();
+
+  state.run("pointer tree: depth-first, count class attributes", nodes, [&] {
+    std::size_t count = 0;
+    for (const Tag* root : {&dom.head, &dom.body}) {
+      for (const auto& element : root->depthFirst()) {
+        for (const auto& attribute : element.getAllAttrs())
+          count += attribute.key == kClass;
+      }
+    }
+    bench::State::doNotOptimize(count);
+  }, "nodes");
+
+  state.run("frozen: linear scan, count class attributes", nodes, [&] {
+    std::size_t count = 0;
+    for (FrozenDOM::Index i = 0; i < frozen.size(); ++i) {
+      for (const auto& attribute : frozen.getAttrs(i))
+        count += attribute.key == kClass;
+    }
+    bench::State::doNotOptimize(count);
+  }, "nodes");
+
+  state.run("pointer tree: count <a> elements", nodes, [&] {
+    std::size_t count = 0;
+    for (const auto& element : dom.body.depthFirst())
+      count += element.getType() == std::variant<Tag::Native, Tag::Custom>(static_cast<Tag::Native>(Tag::Global::A));
+    bench::State::doNotOptimize(count);
+  }, "nodes");
+
+  state.run("frozen: count <a> elements", nodes, [&] {
+    std::size_t count = 0;
+    for (auto type : frozen.getTypes())
+      count += type == static_cast<FrozenDOM::Key>(Tag::Global::A);
+    bench::State::doNotOptimize(count);
+  }, "nodes");
+
+  std::string buffer;
+  state.run("pointer tree: serialize", bytes, [&] {
+    buffer.clear();
+    StringSink sink(buffer);
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+  }, "B");
+
+  state.run("frozen: serialize", bytes, [&] {
+    buffer.clear();
+    StringSink sink(buffer);
+    Serializer serializer(sink);
+    serializer.write(frozen);
+    serializer.flush();
+  }, "B");
+
+  state.run("freeze DOM", nodes, [&] {
+    bench::State::doNotOptimize(FrozenDOM(dom));
+  }, "nodes");
+
+  state.run("thaw to DOM", nodes, [&] {
+    bench::State::doNotOptimize(frozen.toDOM());
+  }, "nodes");
+
+  // Startup from a snapshot: map the file and read from it, against parsing
+  // the page again.
+  const std::string path = (std::filesystem::temp_directory_path() / "hi_parser_bench.frozen").string();
+  frozen.save(path);
+  std::printf("%-12s snapshot: %zu bytes for a %zu byte page\n", "frozen", std::size_t(std::filesystem::file_size(path)), page.size());
+
+  state.run("startup: parse page", page.size(), [&] {
+    HTML5Parser startup;
+    bench::State::doNotOptimize(startup.parse(page));
+  }, "B");
+
+  state.run("startup: map snapshot, count <a> elements", nodes, [&] {
+    const FrozenDOM loaded = FrozenDOM::s_load(path);
+    std::size_t count = 0;
+    for (auto type : loaded.getTypes())
+      count += type == static_cast<FrozenDOM::Key>(Tag::Global::A);
+    bench::State::doNotOptimize(count);
+  }, "nodes");
+
+  state.run("startup: map snapshot, validate", nodes, [&] {
+    bench::State::doNotOptimize(FrozenDOM::s_load(path).isValid());
+  }, "nodes");
+
+  state.run("startup: map snapshot, thaw to DOM", nodes, [&] {
+    bench::State::doNotOptimize(FrozenDOM::s_load(path).toDOM());
+  }, "nodes");
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,91 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+
+Tag::Element* s_walkById(const DOM& dom, std::string_view id) {
+  for (const Tag& root : {dom.head, dom.body}) {
+    for (auto& element : root.depthFirst()) {
+      if (element.hasAttr("id") && element.getAttr("id") == id)
+        return &element;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+
+// The lookups of a templating post-processing pass over a large page: by
+// id, by class and by type, once with tree walks and once through the
+// document's index, and the same pass while it keeps setting attributes.
+HI_BENCHMARK(index) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  const DOM walked = parser.parse(page);
+  const DOM indexed = parser.parse(page);
+
+  // Ids repeat with the inflated body, and the first copy is found early;
+  // look up an id added at the end of the page and one that is missing.
+  const std::vector<std::string> ids = {"copyright-note", "missing"};
+  Tag note = walked.body.createElement("p");
+  note.setAttr("id", "copyright-note");
+  Tag body = walked.body;
+  body << note;
+  Tag indexed_note = indexed.body.createElement("p");
+  indexed_note.setAttr("id", "copyright-note");
+  Tag indexed_body = indexed.body;
+  indexed_body << indexed_note;
+
+  state.run("getElementById, tree walks", ids.size(), [&] {
+    std::size_t found = 0;
+    for (const std::string& id : ids)
+      found += s_walkById(walked, id) != nullptr;
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("parse", page.size(), [&] {
+    bench::State::doNotOptimize(parser.parse(page));
+  }, "B");
+
+  state.run("parse, build the index", page.size(), [&] {
+    const DOM fresh = parser.parse(page);
+    bench::State::doNotOptimize(fresh.getElementById("main"));
+  }, "B");
+
+  state.run("getElementById, index", ids.size(), [&] {
+    std::size_t found = 0;
+    for (const std::string& id : ids)
+      found += indexed.getElementById(id).has_value();
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("getElementsByClassName, tree walk", 1, [&] {
+    std::size_t found = 0;
+    for (const Tag& root : {walked.head, walked.body}) {
+      for (auto& element : root.depthFirst())
+        found += element.hasAttr("class") && element.getAttr("class").find("nav__link") != std::string_view::npos;
+    }
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("getElementsByClassName, index", 1, [&] {
+    bench::State::doNotOptimize(indexed.getElementsByClassName("nav__link"));
+  }, "lookups");
+
+  state.run("getElementsByTagName(\"table\"), index", 1, [&] {
+    bench::State::doNotOptimize(indexed.getElementsByTagName("table"));
+  }, "lookups");
+
+  // Each lookup is followed by a change the index has to follow.
+  std::size_t round = 0;
+  state.run("getElementById + setAttr(class), index", 1, [&] {
+    if (auto tag = indexed.getElementById("copyright-note"))
+      tag->setAttr("class", ++round % 2 ? "card is-active" : "card");
+  }, "lookups");
+}
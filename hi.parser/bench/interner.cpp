@@ -0,0 +1,110 @@
+#include "bench.h"
+#include "hi.parser/interner.h"
+#include "hi.parser/parser.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kNames = 4096;
+constexpr std::size_t kLookups = 1 << 20;
+
+// The registry Tag used before: two unsynchronised maps, here behind one
+// mutex so it can at least be shared between threads.
+class LockedMap
+{
+  std::mutex mutex_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::unordered_map<uint32_t, std::string> names_;
+
+public:
+  uint32_t intern(const std::string& name) {
+    std::lock_guard lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end())
+      return it->second;
+    const auto id = static_cast<uint32_t>(ids_.size());
+    names_[id] = name;
+    ids_[name] = id;
+    return id;
+  }
+}; // class LockedMap
+
+template <typename F>
+void s_onThreads(std::size_t threads, F&& body) {
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t)
+    workers.emplace_back([&body, t] { body(t); });
+  for (auto& worker : workers)
+    worker.join();
+}
+
+} // namespace
+
+
+HI_BENCHMARK(interner) {
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < kNames; ++i)
+    names.push_back("x-widget-" + std::to_string(i));
+
+  LockedMap locked;
+  detail::Interner interner;
+  for (const auto& name : names) {
+    locked.intern(name);
+    interner.intern(name);
+  }
+
+  const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= hardware * 2; threads *= 2) {
+    const std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+    state.run("mutex + unordered_map intern (hit)" + suffix, kLookups, [&] {
+      s_onThreads(threads, [&](std::size_t t) {
+        uint32_t sum = 0;
+        for (std::size_t i = t; i < kLookups; i += threads)
+          sum += locked.intern(names[i % kNames]);
+        bench::State::doNotOptimize(sum);
+      });
+    }, "lookups");
+
+    state.run("Interner::intern (hit)" + suffix, kLookups, [&] {
+      s_onThreads(threads, [&](std::size_t t) {
+        uint32_t sum = 0;
+        for (std::size_t i = t; i < kLookups; i += threads)
+          sum += interner.intern(names[i % kNames]);
+        bench::State::doNotOptimize(sum);
+      });
+    }, "lookups");
+  }
+
+  state.run("Interner::intern, 64k new names", 1 << 16, [&] {
+    detail::Interner fresh;
+    std::string name;
+    for (uint32_t i = 0; i < (1 << 16); ++i) {
+      name.assign(1, 'n');
+      fresh.intern(name += std::to_string(i));
+    }
+    bench::State::doNotOptimize(fresh.size());
+  }, "names");
+
+  const std::string page = "<html><body><app-shell><x-card class=a data-role=b>"
+                           "<x-title>t</x-title><x-body><p>p</p></x-body></x-card></app-shell></body></html>";
+  constexpr std::size_t kPages = 2000;
+  state.run("parse custom-tag pages, global registry", kPages, [&] {
+    HTML5Parser parser;
+    for (std::size_t i = 0; i < kPages; ++i)
+      bench::State::doNotOptimize(parser.parse(page, nullptr));
+  }, "pages");
+  state.run("parse custom-tag pages, per-document registry", kPages, [&] {
+    HTML5Parser parser;
+    for (std::size_t i = 0; i < kPages; ++i)
+      bench::State::doNotOptimize(parser.parse(page, std::make_shared<detail::Interner>()));
+  }, "pages");
+}
@@ -0,0 +1,98 @@
+#ifndef HI_BENCH_LEGACY_H
+#define HI_BENCH_LEGACY_H
+
+#include <memory>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "hi.parser/html5.h"
+#include "hi.parser/tokenizer.h"
+
+namespace hi {
+namespace bench {
+namespace legacy {
+
+
+// Storage layout of HTML5Element before the arena: one shared_ptr allocation
+// per element, children held by shared_ptr and an attribute map per node.
+struct Element {
+  std::variant<Tag::Native, Tag::Custom> type;
+  std::unordered_map<std::string, std::string> attributes;
+  std::vector<std::shared_ptr<Element>> children;
+  Element* parent = nullptr;
+
+  explicit Element(std::variant<Tag::Native, Tag::Custom> t) : type(t) {}
+};
+
+struct Handle {
+  std::shared_ptr<Element> element;
+
+  explicit Handle(std::variant<Tag::Native, Tag::Custom> tag) : element(std::make_shared<Element>(tag)) {}
+  explicit Handle(Tag::Global tag) : Handle(static_cast<Tag::Native>(tag)) {}
+
+  Handle& operator<<(const Handle& child) {
+    child.element->parent = element.get();
+    element->children.push_back(child.element);
+    return *this;
+  }
+};
+
+// Builds a legacy tree from the same token stream HTML5Parser sees.
+inline Handle buildTree(std::string_view page, std::size_t* elements = nullptr, std::size_t* attributes = nullptr) {
+  Handle root(Tag::Global::Body);
+  std::vector<Element*> open{root.element.get()};
+  detail::Tokenizer tokenizer(page);
+  detail::Token token;
+  while (tokenizer.next(token)) {
+    if (token.kind == detail::Token::Kind::StartTag) {
+      Handle child(Tag::s_getType(std::string(token.data)));
+      for (const auto& attribute : *token.attributes)
+        child.element->attributes.emplace(std::string(attribute.name), std::string(attribute.value));
+      if (elements)
+        ++*elements;
+      if (attributes)
+        *attributes += token.attributes->size();
+      child.element->parent = open.back();
+      open.back()->children.push_back(child.element);
+      if (!token.self_closing && !Tag::s_isVoid(child.element->type))
+        open.push_back(child.element.get());
+    } else if (token.kind == detail::Token::Kind::EndTag && open.size() > 1) {
+      open.pop_back();
+    }
+  }
+  return root;
+}
+
+// The pre-streaming Tag::s_toString: one ostringstream, a fresh indent string
+// and name per element, and copies of the children and attributes.
+inline std::string toString(std::shared_ptr<Element> element, const std::string& indent = "  ") {
+  std::ostringstream html;
+  std::stack<std::pair<std::shared_ptr<Element>, int>> stack;
+  stack.push({std::move(element), 0});
+  while (!stack.empty()) {
+    auto [current, level] = std::move(stack.top());
+    stack.pop();
+
+    std::string name = Tag::s_getName(current->type);
+    std::string current_indent(level * indent.length(), ' ');
+    html << current_indent << "<" << name << " ";
+    for (const auto& [key, value] : std::unordered_map<std::string, std::string>(current->attributes))
+      html << key << "=\"" << value << "\" ";
+    html << ">\n";
+
+    const auto children = current->children;
+    for (auto it = children.rbegin(); it != children.rend(); ++it)
+      stack.push({*it, level + 1});
+    html << current_indent << "</" << name << ">\n";
+  }
+  return html.str();
+}
+
+} // namespace legacy
+} // namespace bench
+} // namespace hi
+#endif // HI_BENCH_LEGACY_H
@@ -0,0 +1,184 @@
+#include "bench.h"
+#include "hi.parser/simd.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace hi {
+namespace bench {
+
+namespace
+{
+
+struct Benchmark {
+  const char* name;
+  BenchmarkFn fn;
+};
+
+std::vector<Benchmark>& s_registry() {
+  static std::vector<Benchmark> registry;
+  return registry;
+}
+
+void s_writeString(std::FILE* file, std::string_view text) {
+  std::fputc('"', file);
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      std::fprintf(file, "\\%c", c);
+    else if (static_cast<unsigned char>(c) < 0x20)
+      std::fprintf(file, "\\u%04x", c);
+    else
+      std::fputc(c, file);
+  }
+  std::fputc('"', file);
+}
+
+// One object per run: the settings that make it reproducible and every
+// result, times in seconds and throughput in items per second.
+void s_writeJSON(const char* path, std::size_t repetitions, std::size_t max_nodes, const std::vector<Result>& results) {
+  std::FILE* file = std::fopen(path, "w");
+  if (file == nullptr)
+    throw std::runtime_error(std::string("Cannot write ") + path);
+  std::fprintf(file, "{\n  \"context\": {\"repetitions\": %zu, \"max_nodes\": %zu, \"simd\": ", repetitions, max_nodes);
+  s_writeString(file, detail::simd::levelName(detail::simd::getLevel()));
+  std::fprintf(file, ", \"compiler\": ");
+  s_writeString(file, __VERSION__);
+#ifdef NDEBUG
+  std::fprintf(file, ", \"assertions\": false},\n");
+#else
+  std::fprintf(file, ", \"assertions\": true},\n");
+#endif
+  std::fprintf(file, "  \"results\": [");
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    std::fprintf(file, "%s\n    {\"benchmark\": ", i == 0 ? "" : ",");
+    s_writeString(file, result.benchmark);
+    std::fprintf(file, ", \"scenario\": ");
+    s_writeString(file, result.scenario);
+    std::fprintf(file, ", \"items\": %zu, \"unit\": ", result.items);
+    s_writeString(file, result.unit);
+    std::fprintf(file, ", \"best\": %.9g, \"median\": %.9g, \"throughput\": %.6g}",
+      result.best, result.median, static_cast<double>(result.items) / result.best);
+  }
+  std::fprintf(file, "\n  ]\n}\n");
+  if (std::fclose(file) != 0)
+    throw std::runtime_error(std::string("Cannot write ") + path);
+}
+
+} // namespace
+
+bool registerBenchmark(const char* name, BenchmarkFn fn) {
+  s_registry().push_back({name, fn});
+  return true;
+}
+
+std::string readCorpus(std::string_view name) {
+  std::string path = std::string(HI_BENCH_CORPUS_DIR) + "/" + std::string(name);
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Cannot open corpus file " + path);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+std::string inflatePage(const std::string& page, std::size_t size) {
+  std::size_t open = page.find("<body");
+  std::size_t body_start = page.find('>', open) + 1;
+  std::size_t body_end = page.rfind("</body>");
+  if (open == std::string::npos || body_end == std::string::npos)
+    return page;
+
+  std::string body = page.substr(body_start, body_end - body_start);
+  std::string result = page.substr(0, body_start);
+  result.reserve(size + page.size());
+  while (result.size() + body.size() < size)
+    result += body;
+  result += page.substr(body_start);
+  return result;
+}
+
+void State::report(std::string_view label, std::size_t items, std::string_view unit, std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  double best = samples.front();
+  double median = samples[samples.size() / 2];
+  results_.push_back({name_, std::string(label), items, std::string(unit), best, median});
+  // Times in ms and rates in millions per second round scenarios that take
+  // microseconds, or do a single lookup per repetition, down to zero; both
+  // get the largest prefix that keeps them at 1 or more instead.
+  static constexpr const char* kTimeUnits[] = {"s", "ms", "us", "ns"};
+  static constexpr const char* kRatePrefixes[] = {"", "k", "M", "G"};
+  const auto timeUnit = [](double seconds) {
+    std::size_t i = 0;
+    while (i + 1 < std::size(kTimeUnits) && seconds < 1.0) {
+      seconds *= 1e3;
+      ++i;
+    }
+    return std::pair(seconds, kTimeUnits[i]);
+  };
+  auto [best_time, best_unit] = timeUnit(best);
+  auto [median_time, median_unit] = timeUnit(median);
+  double rate = items / best;
+  std::size_t prefix = 0;
+  while (prefix + 1 < std::size(kRatePrefixes) && rate >= 1e3) {
+    rate /= 1e3;
+    ++prefix;
+  }
+  std::printf("%-12s %-44.*s %12.3f %-2s %12.3f %-2s %12.2f %s%.*s/s\n",
+    name_.c_str(), static_cast<int>(label.size()), label.data(),
+    best_time, best_unit, median_time, median_unit, rate, kRatePrefixes[prefix],
+    static_cast<int>(unit.size()), unit.data());
+}
+
+} // namespace bench
+} // namespace hi
+
+// Usage: HiParserBench [-r repetitions] [-n max_nodes] [--json path] [filter...]
+// A benchmark runs when its name contains any of the filters (or none are
+// given). Generated documents go up to max_nodes elements (default 10M);
+// --json also writes the results to `path`.
+int main(int argc, char** argv) {
+  using namespace hi::bench;
+
+  std::size_t repetitions = 5;
+  std::size_t max_nodes = 10'000'000;
+  const char* json = nullptr;
+  std::vector<const char*> filters;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      max_nodes = std::max(1ll, std::atoll(argv[++i]));
+    else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      json = argv[++i];
+    else
+      filters.push_back(argv[i]);
+  }
+
+  std::vector<Result> results;
+  auto registry = s_registry();
+  std::sort(registry.begin(), registry.end(), [](const Benchmark& a, const Benchmark& b) {
+    return std::strcmp(a.name, b.name) < 0;
+  });
+
+  std::printf("%-12s %-44s %15s %15s %20s\n", "benchmark", "scenario", "best", "median", "throughput");
+  for (const auto& benchmark : registry) {
+    bool selected = filters.empty() || std::any_of(filters.begin(), filters.end(), [&](const char* f) {
+      return std::strstr(benchmark.name, f) != nullptr;
+    });
+    if (!selected)
+      continue;
+    State state(benchmark.name, repetitions, max_nodes, results);
+    benchmark.fn(state);
+  }
+  if (json != nullptr)
+    s_writeJSON(json, repetitions, max_nodes, results);
+  return 0;
+}
@@ -0,0 +1,37 @@
+#include "bench.h"
+#include "hi.parser/memory.h"
+#include "hi.parser/parser.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 16 << 20;
+
+} // namespace
+
+
+HI_BENCHMARK(memory) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+
+  for (const bool tracked : {false, true}) {
+    MemoryTracker::setEnabled(tracked);
+    state.run(tracked ? "parse 16 MiB corpus, memory tracked" : "parse 16 MiB corpus, untracked", page.size(), [&] {
+      DOM dom = parser.parse(page);
+      bench::State::doNotOptimize(dom);
+    }, "B");
+  }
+
+  // What the parsed corpus costs, by category.
+  const DOM dom = parser.parse(page);
+  MemoryTracker::setEnabled(false);
+  const MemoryUsage usage = dom.getMemoryUsage();
+  std::printf("%-12s %zu bytes live, %zu reserved, %zu per element\n", "corpus", usage.getLiveBytes(), usage.reserved_bytes,
+    usage.getLiveBytes() / std::max<std::size_t>(usage[MemoryCategory::Elements].live_objects, 1));
+  std::fputs(usage.toString().c_str(), stdout);
+}
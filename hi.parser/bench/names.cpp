@@ -0,0 +1,97 @@
+#include "bench.h"
+#include "hi.parser/html5.h"
+#include "hi.parser/perfect_hash.h"
+#include "hi.parser/tokenizer.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+// The lookup Tag used before the perfect hash: a heap key per call and a
+// std::unordered_map probe, with a lowercased copy for mixed-case input.
+const std::unordered_map<std::string, Tag::Native>& s_legacyMap() {
+  static const auto map = [] {
+    std::unordered_map<std::string, Tag::Native> map;
+    for (std::size_t i = 0; i < htmlTags.size(); ++i)
+      map.emplace(htmlTags[i], static_cast<Tag::Native>(i));
+    return map;
+  }();
+  return map;
+}
+
+// Every tag and attribute name of the corpus, in document order.
+std::vector<std::string> s_collectNames(const std::string& page) {
+  std::vector<std::string> names;
+  detail::Tokenizer tokenizer(page);
+  detail::Token token;
+  while (tokenizer.next(token)) {
+    if (token.kind != detail::Token::Kind::StartTag && token.kind != detail::Token::Kind::EndTag)
+      continue;
+    names.emplace_back(token.data);
+    if (token.attributes != nullptr) {
+      for (const auto& attribute : *token.attributes)
+        names.emplace_back(attribute.name);
+    }
+  }
+  return names;
+}
+
+} // namespace
+
+
+HI_BENCHMARK(names) {
+  const std::vector<std::string> names = s_collectNames(bench::readCorpus("article.html"));
+  std::vector<std::string> upper = names;
+  for (auto& name : upper) {
+    for (char& c : name)
+      c = static_cast<char>(c >= 'a' && c <= 'z' ? c - 32 : c);
+  }
+  constexpr std::size_t kRounds = 200;
+  const std::size_t lookups = names.size() * kRounds;
+
+  state.run("unordered_map<std::string>", lookups, [&] {
+    std::size_t found = 0;
+    for (std::size_t round = 0; round < kRounds; ++round) {
+      for (const auto& name : names)
+        found += s_legacyMap().count(std::string(name.data(), name.size()));
+    }
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("unordered_map<std::string>, upper case", lookups, [&] {
+    std::size_t found = 0;
+    std::string lower;
+    for (std::size_t round = 0; round < kRounds; ++round) {
+      for (const auto& name : upper) {
+        lower.assign(name);
+        for (char& c : lower)
+          c = detail::toLowerAscii(c);
+        found += s_legacyMap().count(lower);
+      }
+    }
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("Tag::s_findNative", lookups, [&] {
+    std::size_t found = 0;
+    for (std::size_t round = 0; round < kRounds; ++round) {
+      for (const auto& name : names)
+        found += Tag::s_findNative(name).has_value();
+    }
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+
+  state.run("Tag::s_findNative, upper case", lookups, [&] {
+    std::size_t found = 0;
+    for (std::size_t round = 0; round < kRounds; ++round) {
+      for (const auto& name : upper)
+        found += Tag::s_findNative(name).has_value();
+    }
+    bench::State::doNotOptimize(found);
+  }, "lookups");
+}
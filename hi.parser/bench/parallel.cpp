@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+#include "hi.parser/thread_pool.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <thread>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 16 << 20;
+
+} // namespace
+
+
+// Serializes a large page on pools of 1, 2, 4, ... threads up to twice the
+// hardware threads; beyond the core count the extra threads only add overhead.
+HI_BENCHMARK(parallel) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  const DOM dom = parser.parse(page);
+  const std::size_t size = dom.toString().size();
+
+  std::string buffer;
+  state.run("sequential, StringSink", size, [&] {
+    buffer.clear();
+    StringSink sink(buffer);
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+    bench::State::doNotOptimize(buffer);
+  }, "B");
+
+  const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  int fd = ::open("/dev/null", O_WRONLY);
+  for (std::size_t threads = 1; threads <= 2 * cores || threads <= 4; threads *= 2) {
+    ThreadPool pool(threads);
+    const std::string suffix = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+    state.run("parallel, StringSink, " + suffix, size, [&] {
+      buffer.clear();
+      StringSink sink(buffer);
+      Serializer serializer(sink);
+      serializer.write(dom, pool);
+      serializer.flush();
+      bench::State::doNotOptimize(buffer);
+    }, "B");
+    state.run("parallel, FdSink (writev) to /dev/null, " + suffix, size, [&] {
+      FdSink sink(fd);
+      Serializer serializer(sink);
+      serializer.write(dom, pool);
+      serializer.flush();
+    }, "B");
+  }
+  ::close(fd);
+}
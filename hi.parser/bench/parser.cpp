@@ -0,0 +1,42 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/simd.h"
+#include "hi.parser/tokenizer.h"
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 16 << 20;
+
+} // namespace
+
+
+HI_BENCHMARK(parser) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  const detail::simd::Level detected = detail::simd::detectLevel();
+
+  for (auto level : {detail::simd::Level::Scalar, detail::simd::Level::SSE42, detail::simd::Level::AVX2}) {
+    if (static_cast<int>(level) > static_cast<int>(detected))
+      continue;
+    detail::simd::setLevel(level);
+    const std::string name = detail::simd::levelName(level);
+
+    state.run("tokenize 16 MiB corpus, " + name, page.size(), [&] {
+      detail::Tokenizer tokenizer(page);
+      detail::Token token;
+      std::size_t count = 0;
+      while (tokenizer.next(token))
+        ++count;
+      bench::State::doNotOptimize(count);
+    }, "B");
+
+    state.run("parse 16 MiB corpus to DOM, " + name, page.size(), [&] {
+      HTML5Parser parser;
+      DOM dom = parser.parse(page);
+      bench::State::doNotOptimize(dom);
+    }, "B");
+  }
+  detail::simd::setLevel(detected);
+}
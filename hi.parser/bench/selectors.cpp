@@ -0,0 +1,204 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/selector.h"
+
+#include <set>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+
+// Selector matching as it is usually written first: selectors kept as
+// strings, names compared as strings and attributes looked up by name.
+// Handles type, .class and #id compounds joined by descendant or child
+// combinators.
+struct StringSelector {
+  struct Compound {
+    std::string type;
+    std::string id;
+    std::vector<std::string> classes;
+    bool child = false;  // joined to the compound on its left by '>'
+  };
+  std::vector<Compound> compounds;  // left to right
+
+  explicit StringSelector(std::string_view text) {
+    bool child = false;
+    std::size_t i = 0;
+    while (i < text.size()) {
+      if (text[i] == ' ') {
+        ++i;
+        continue;
+      }
+      if (text[i] == '>') {
+        child = true;
+        ++i;
+        continue;
+      }
+      Compound compound;
+      compound.child = child;
+      child = false;
+      std::string* target = &compound.type;
+      for (; i < text.size() && text[i] != ' '; ++i) {
+        if (text[i] == '.') {
+          compound.classes.emplace_back();
+          target = &compound.classes.back();
+        } else if (text[i] == '#') {
+          target = &compound.id;
+        } else {
+          *target += text[i];
+        }
+      }
+      compounds.push_back(std::move(compound));
+    }
+  }
+
+  static bool matchCompound(const Compound& compound, const Tag::Element& element) {
+    if (!compound.type.empty() && Tag::s_getName(element.getType(), element.getDocument()->getNames()) != compound.type)
+      return false;
+    if (!compound.id.empty() && (!element.hasAttr("id") || element.getAttr("id") != compound.id))
+      return false;
+    for (const std::string& name : compound.classes) {
+      if (!element.hasAttr("class"))
+        return false;
+      std::string classes(" ");
+      classes.append(element.getAttr("class")).append(" ");
+      if (classes.find(" " + name + " ") == std::string::npos)
+        return false;
+    }
+    return true;
+  }
+
+  bool matchFrom(std::size_t i, const Tag::Element& element) const {
+    if (!matchCompound(compounds[i], element))
+      return false;
+    if (i == 0)
+      return true;
+    if (compounds[i].child)
+      return element.getParent() != nullptr && matchFrom(i - 1, *element.getParent());
+    for (const Tag::Element* ancestor = element.getParent(); ancestor != nullptr; ancestor = ancestor->getParent()) {
+      if (matchFrom(i - 1, *ancestor))
+        return true;
+    }
+    return false;
+  }
+
+  bool matches(const Tag::Element& element) const { return matchFrom(compounds.size() - 1, element); }
+};
+
+} // namespace
+
+
+// Runs every rule of a few hundred as a querySelectorAll over a large page:
+// rules built from the classes the page uses, in the shapes stylesheets use.
+HI_BENCHMARK(selectors) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  const DOM dom = parser.parse(page);
+
+  std::set<std::string> classes;
+  std::size_t elements = 0;
+  for (const Tag& root : {dom.head, dom.body}) {
+    for (const auto& element : root.depthFirst()) {
+      ++elements;
+      if (!element.hasAttr("class"))
+        continue;
+      std::string_view list = element.getAttr("class");
+      while (!list.empty()) {
+        const std::size_t end = std::min(list.find(' '), list.size());
+        if (end != 0)
+          classes.emplace(list.substr(0, end));
+        list.remove_prefix(std::min(end + 1, list.size()));
+      }
+    }
+  }
+
+  std::vector<std::string> simple;
+  for (const std::string& name : classes) {
+    simple.push_back("." + name);
+    simple.push_back("main ." + name);
+    simple.push_back("section ." + name);
+    simple.push_back("div > ." + name);
+    simple.push_back("article li." + name);
+  }
+  simple.insert(simple.end(), {"a", "li", "ul > li", "nav ul li a", "table tr td", "#main", "header .container"});
+  std::vector<std::string> rich = simple;
+  for (const std::string& name : classes) {
+    rich.push_back("li." + name + ":nth-child(2n+1)");
+    rich.push_back("[class~=" + name + "] + *");
+    rich.push_back("section ." + name + " ~ p");
+  }
+  rich.insert(rich.end(), {"a[href^='/docs']", "img[loading=lazy]", "[aria-current=page]", "tr:nth-child(even) > td", "a[href$='.png']"});
+
+  std::vector<Selector> compiled_simple, compiled_rich;
+  for (const std::string& text : simple)
+    compiled_simple.emplace_back(text, dom.getNames());
+  for (const std::string& text : rich)
+    compiled_rich.emplace_back(text, dom.getNames());
+  std::vector<StringSelector> strings;
+  for (const std::string& text : simple)
+    strings.emplace_back(text);
+
+  state.run("compile " + std::to_string(rich.size()) + " selectors", rich.size(), [&] {
+    for (const std::string& text : rich)
+      bench::State::doNotOptimize(Selector(text, dom.getNames()));
+  }, "selectors");
+
+  state.run("string compares, " + std::to_string(simple.size()) + " rules", elements * simple.size(), [&] {
+    std::size_t found = 0;
+    for (const StringSelector& selector : strings) {
+      for (const Tag& root : {dom.head, dom.body}) {
+        for (const auto& element : root.depthFirst())
+          found += selector.matches(element);
+      }
+    }
+    bench::State::doNotOptimize(found);
+  }, "checks");
+
+  state.run("compiled, same " + std::to_string(simple.size()) + " rules", elements * simple.size(), [&] {
+    std::size_t found = 0;
+    for (const Selector& selector : compiled_simple)
+      found += selector.querySelectorAll(dom).size();
+    bench::State::doNotOptimize(found);
+  }, "checks");
+
+  state.run("compiled, " + std::to_string(rich.size()) + " rules with attributes/siblings", elements * rich.size(), [&] {
+    std::size_t found = 0;
+    for (const Selector& selector : compiled_rich)
+      found += selector.querySelectorAll(dom).size();
+    bench::State::doNotOptimize(found);
+  }, "checks");
+
+  // The same rules tested per element during a single walk, as a style
+  // engine does; a walk per rule costs more than the tests themselves.
+  state.run("compiled, " + std::to_string(rich.size()) + " rules, one walk", elements * rich.size(), [&] {
+    std::size_t found = 0;
+    for (const Tag& root : {dom.head, dom.body}) {
+      for (const auto& element : root.depthFirst()) {
+        for (const Selector& selector : compiled_rich)
+          found += selector.matches(element);
+      }
+    }
+    bench::State::doNotOptimize(found);
+  }, "checks");
+
+  // The same walk keeping an ancestor Bloom filter: rules whose ancestor
+  // compounds name a type, id or class no parent has are rejected without
+  // climbing the parent chain.
+  state.run("compiled, " + std::to_string(rich.size()) + " rules, one walk, filter", elements * rich.size(), [&] {
+    std::size_t found = 0;
+    SelectorFilter filter;
+    for (const Tag& root : {dom.head, dom.body}) {
+      for (const auto& element : root.depthFirst()) {
+        filter.setParentsOf(element);
+        for (const Selector& selector : compiled_rich)
+          found += selector.matches(element, filter);
+        if (!element.getChildren().empty())
+          filter.pushParent(element);
+      }
+    }
+    bench::State::doNotOptimize(found);
+  }, "checks");
+}
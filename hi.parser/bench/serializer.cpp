@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "legacy.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+
+} // namespace
+
+
+HI_BENCHMARK(serializer) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  const auto legacy = bench::legacy::buildTree(page);
+  HTML5Parser parser;
+  const DOM dom = parser.parse(page);
+  const std::size_t size = dom.toString().size();
+
+  state.run("legacy ostringstream s_toString", size, [&] {
+    bench::State::doNotOptimize(bench::legacy::toString(legacy.element));
+  }, "B");
+
+  state.run("DOM::toString", size, [&] {
+    bench::State::doNotOptimize(dom.toString());
+  }, "B");
+
+  std::string buffer;
+  state.run("Serializer, reused StringSink", size, [&] {
+    buffer.clear();
+    StringSink sink(buffer);
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+    bench::State::doNotOptimize(buffer);
+  }, "B");
+
+  state.run("Serializer, 16 KiB CallbackSink chunks", size, [&] {
+    std::size_t chunks = 0;
+    CallbackSink sink([&](std::string_view chunk) { chunks += chunk.size(); });
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+    bench::State::doNotOptimize(chunks);
+  }, "B");
+
+  int fd = ::open("/dev/null", O_WRONLY);
+  state.run("Serializer, FdSink to /dev/null", size, [&] {
+    FdSink sink(fd);
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+  }, "B");
+  ::close(fd);
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/style.h"
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kRows = 2000;
+constexpr std::size_t kItems = 5000;
+
+// A page heavy on lists and tables, as catalogs, dashboards and archives
+// are: the article followed by a data table and a long list.
+std::string s_listTablePage() {
+  std::string page = bench::readCorpus("article.html");
+  std::string extra = "<section class=\"report\"><table class=\"table table--striped\"><thead><tr><th>Name</th><th>Size</th><th>Owner</th><th>Status</th></tr></thead><tbody>";
+  for (std::size_t i = 0; i < kRows; ++i) {
+    extra += "<tr class=\"row\"><td class=\"cell\"><a class=\"cell__link\" href=\"/f/" + std::to_string(i) + "\">file-" + std::to_string(i) + "</a></td>";
+    extra += "<td class=\"cell cell--num\">" + std::to_string(i * 37 % 4096) + " KB</td><td class=\"cell\"><span class=\"user\">owner</span></td>";
+    extra += std::string("<td class=\"cell\"><span class=\"badge ") + (i % 3 == 0 ? "badge--ok" : "badge--warn") + "\">state</span></td></tr>";
+  }
+  extra += "</tbody></table><ul class=\"archive\">";
+  for (std::size_t i = 0; i < kItems; ++i)
+    extra += "<li class=\"archive__item\"><a href=\"/p/" + std::to_string(i) + "\">Post " + std::to_string(i) + "</a> <time class=\"archive__date\">2024-01-01</time></li>";
+  extra += "</ul></section>";
+  page.insert(page.rfind("</body>"), extra);
+  return page;
+}
+
+constexpr std::string_view kReportStyles = R"(
+.report { margin: 2rem 0; }
+.table thead th { font-weight: 600; text-align: left; border-bottom: 2px solid var(--border); }
+.row:hover { background: var(--surface-2); }
+.cell { padding: .375rem .75rem; white-space: nowrap; }
+.cell--num { text-align: right; font-variant-numeric: tabular-nums; }
+.cell__link { color: inherit; font-weight: 600; }
+.user { color: var(--muted); }
+.badge { display: inline-block; padding: 0 .5rem; border-radius: 999px; font-size: .75rem; }
+.badge--ok { background: #dcfce7; color: #166534; }
+.badge--warn { background: #fef9c3; color: #854d0e; }
+.archive { columns: 2; list-style: none; padding: 0; }
+.archive__item { margin: .25rem 0; break-inside: avoid; }
+.archive__item a { color: var(--accent); }
+.archive__date { margin-left: .5rem; color: var(--muted); font-size: .875rem; }
+)";
+
+} // namespace
+
+
+// Cascades the site theme over a page with a 2000-row table and a
+// 5000-item list, with and without style sharing, and reports the styles
+// each keeps.
+HI_BENCHMARK(style) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(s_listTablePage());
+  const hiweb::CSS theme(bench::readCorpus("site.css"));
+  const hiweb::CSS report{std::string(kReportStyles)};
+  StyleResolver resolver;
+  resolver.addStylesheet(theme);
+  resolver.addStylesheet(report);
+
+  for (bool share : {false, true}) {
+    const Styles styles = resolver.resolve(dom, {share});
+    std::printf("%-12s sharing %-3s: %zu elements, %zu styles, %zu shared, %zu KB of styles\n", "style", share ? "on" : "off",
+      styles.size(), styles.getStyleCount(), styles.getSharedCount(), styles.getMemoryUsage() / 1024);
+  }
+
+  const std::size_t elements = resolver.resolve(dom).size();
+  state.run("cascade, no sharing", elements, [&] {
+    bench::State::doNotOptimize(resolver.resolve(dom, {false}));
+  }, "elements");
+
+  state.run("cascade, sharing", elements, [&] {
+    bench::State::doNotOptimize(resolver.resolve(dom));
+  }, "elements");
+}
@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/template.h"
+
+#include <string>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kRequests = 1000;
+
+// The page of a request: what the holes get, set on a tree of the article.
+void s_fill(const DOM& page, std::span<const std::string_view> values) {
+  page.getElementsByTagName("title").front().setText(values[0]);
+  page.getElementsByTagName("h1").front().setText(values[1]);
+  page.getElementsByTagName("time").front().setAttr("datetime", values[2]);
+}
+
+} // namespace
+
+
+// The article page with its title, heading and date filled in per request:
+// building the page as a DOM and serializing it against rendering the
+// compiled page.
+HI_BENCHMARK(template) {
+  const std::string article = bench::readCorpus("article.html");
+  HTML5Parser parser;
+
+  const DOM layout = parser.parse(article);
+  const std::string_view holes[] = {"{{title}}", "{{heading}}", "{{date}}"};
+  s_fill(layout, holes);
+  const Template page(layout);
+  const std::string_view values[] = {"Request & response", "Rendering <fast>", "2024-01-01"};
+  const std::size_t size = page.render(values).size();
+
+  std::string html;
+  state.run("parse, fill and serialize the article", size * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      const DOM dom = parser.parse(article);
+      s_fill(dom, values);
+      html = dom.toString();
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  state.run("copy, fill and serialize the article", size * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      const DOM dom = layout.copyTree();
+      s_fill(dom, values);
+      html = dom.toString();
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  state.run("render the compiled article", size * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      html.clear();
+      page.render(values, html);
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  state.run("render compiled article through Serializer", size * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      html.clear();
+      StringSink sink(html);
+      Serializer serializer(sink);
+      serializer.write(page, values);
+      serializer.flush();
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+
+  // Values of 64 KiB each: the render cost follows them, not the page.
+  const std::string large(64 << 10, 'x');
+  const std::string_view large_values[] = {large, large, large};
+  const std::size_t large_size = page.render(large_values).size();
+  state.run("render the compiled article, 3 x 64 KiB values", large_size * kRequests, [&] {
+    for (std::size_t i = 0; i < kRequests; ++i) {
+      html.clear();
+      page.render(large_values, html);
+    }
+    bench::State::doNotOptimize(html);
+  }, "B");
+}
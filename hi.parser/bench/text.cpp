@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+#include <cstdio>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 16 << 20;
+constexpr std::size_t kEdits = 4096;
+constexpr std::size_t kEditSize = 256;
+
+} // namespace
+
+
+HI_BENCHMARK(text) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  HTML5Parser parser;
+  {
+    DOM dom = parser.parse(page);
+    std::size_t nodes = 0, bytes = 0;
+    for (const Tag& root : {dom.head, dom.body}) {
+      for (const Tag::Element& node : root.depthFirst()) {
+        if (node.isText()) {
+          ++nodes;
+          bytes += node.getTextSize();
+        }
+      }
+    }
+    std::printf("%-12s %zu text nodes, %zu bytes of text in a %zu byte page\n", "corpus", nodes, bytes, page.size());
+  }
+
+  state.run("parse 16 MiB corpus with text nodes", page.size(), [&] {
+    DOM dom = parser.parse(page);
+    bench::State::doNotOptimize(dom);
+  }, "B");
+
+  // Escaping: plain prose against prose with a markup character every 16 bytes.
+  for (const bool special : {false, true}) {
+    std::string text;
+    while (text.size() < kCorpusSize / 4)
+      text += special ? "Fish & chips <3 " : "Fish and chips, ";
+    DOM dom;
+    dom.body.addText(text);
+    std::string out;
+    StringSink sink(out);
+    Serializer serializer(sink);
+    state.run(special ? "serialize 4 MiB text, 1 in 8 bytes escaped" : "serialize 4 MiB text, nothing escaped", text.size(), [&] {
+      out.clear();
+      serializer.write(dom.body, {"", ""});
+      serializer.flush();
+      bench::State::doNotOptimize(out);
+    }, "B");
+  }
+
+  // Edits of a long text node against a contiguous copy of it, which is
+  // what storing text as one arena slice costs per edit.
+  const std::string piece(kEditSize, 'x');
+  state.run("append 4096 x 256 B to a text node (rope)", kEdits, [&] {
+    DOM dom;
+    Tag text = dom.createText("");
+    for (std::size_t i = 0; i < kEdits; ++i)
+      text.appendText(piece);
+    bench::State::doNotOptimize(text);
+  }, "edits");
+  state.run("insert 4096 x 256 B mid-text (rope)", kEdits, [&] {
+    DOM dom;
+    Tag text = dom.createText(std::string(1 << 20, 'y'));
+    for (std::size_t i = 0; i < kEdits; ++i)
+      text.insertText((i * 7919) % (1 << 20), piece);
+    bench::State::doNotOptimize(text);
+  }, "edits");
+  state.run("insert 4096 x 256 B mid-text (copy per edit)", kEdits, [&] {
+    std::string text(1 << 20, 'y');
+    for (std::size_t i = 0; i < kEdits; ++i) {
+      std::string copy;
+      copy.reserve(text.size() + piece.size());
+      const std::size_t position = (i * 7919) % (1 << 20);
+      copy.append(text, 0, position).append(piece).append(text, position);
+      text.swap(copy);
+    }
+    bench::State::doNotOptimize(text);
+  }, "edits");
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "legacy.h"
+#include "hi.parser/parser.h"
+
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+constexpr std::size_t kCorpusSize = 4 << 20;
+
+using Element = detail::HTML5Element;
+
+// What getChildren() used to cost: a fresh vector per visited element.
+std::size_t s_countCopying(const Element* element) {
+  std::size_t count = 1;
+  const auto span = element->getChildren();
+  const std::vector<Element*> children(span.begin(), span.end());
+  for (const Element* child : children)
+    count += s_countCopying(child);
+  return count;
+}
+
+std::size_t s_countSpan(const Element* element) {
+  std::size_t count = 1;
+  for (const Element* child : element->getChildren())
+    count += s_countSpan(child);
+  return count;
+}
+
+std::size_t s_countLegacy(const std::shared_ptr<bench::legacy::Element>& element) {
+  std::size_t count = 1;
+  const auto children = element->children;
+  for (const auto& child : children)
+    count += s_countLegacy(child);
+  return count;
+}
+
+} // namespace
+
+
+HI_BENCHMARK(traversal) {
+  const std::string page = bench::inflatePage(bench::readCorpus("article.html"), kCorpusSize);
+  const auto legacy = bench::legacy::buildTree(page);
+  HTML5Parser parser;
+  const DOM dom = parser.parse(page);
+  const Tag& body = dom.body;
+  const std::size_t elements = s_countSpan(&*body.depthFirst().begin());
+
+  state.run("legacy, shared_ptr children copied", elements, [&] {
+    bench::State::doNotOptimize(s_countLegacy(legacy.element));
+  }, "elements");
+
+  state.run("recursive, children copied", elements, [&] {
+    bench::State::doNotOptimize(s_countCopying(&*body.depthFirst().begin()));
+  }, "elements");
+
+  state.run("recursive, children span", elements, [&] {
+    bench::State::doNotOptimize(s_countSpan(&*body.depthFirst().begin()));
+  }, "elements");
+
+  state.run("Tag::depthFirst", elements, [&] {
+    std::size_t count = 0;
+    for (const Element& element : body.depthFirst())
+      count += element.getChildren().size() + 1;
+    bench::State::doNotOptimize(count);
+  }, "elements");
+
+  state.run("Tag::breadthFirst", elements, [&] {
+    std::size_t count = 0;
+    for (const Element& element : body.breadthFirst())
+      count += element.getChildren().size() + 1;
+    bench::State::doNotOptimize(count);
+  }, "elements");
+}
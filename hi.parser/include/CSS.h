@@ -1,29 +1,196 @@
 #ifndef HIWEB_CSS_H
 #define HIWEB_CSS_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/interner.h"
 
 namespace hiweb
 {
 
 
-class CSS
+// Known property names; a property's id is its index here.
+static constexpr std::array<std::string_view, 199> cssProperties = {{
+    "align-content", "align-items", "align-self", "animation", "animation-delay", "animation-direction",
+    "animation-duration", "animation-fill-mode", "animation-iteration-count", "animation-name",
+    "animation-play-state", "animation-timing-function", "appearance", "aspect-ratio", "backdrop-filter",
+    "backface-visibility", "background", "background-attachment", "background-blend-mode", "background-clip",
+    "background-color", "background-image", "background-origin", "background-position", "background-repeat",
+    "background-size", "border", "border-bottom", "border-bottom-color", "border-bottom-left-radius",
+    "border-bottom-right-radius", "border-bottom-style", "border-bottom-width", "border-collapse", "border-color",
+    "border-image", "border-left", "border-left-color", "border-left-style", "border-left-width", "border-radius",
+    "border-right", "border-right-color", "border-right-style", "border-right-width", "border-spacing",
+    "border-style", "border-top", "border-top-color", "border-top-left-radius", "border-top-right-radius",
+    "border-top-style", "border-top-width", "border-width", "bottom", "box-shadow", "box-sizing", "break-inside",
+    "caption-side", "caret-color", "clear", "clip", "clip-path", "color", "column-count", "column-gap",
+    "columns", "contain", "content", "counter-increment", "counter-reset", "cursor", "direction", "display",
+    "empty-cells", "fill", "filter", "flex", "flex-basis", "flex-direction", "flex-flow", "flex-grow",
+    "flex-shrink", "flex-wrap", "float", "font", "font-display", "font-family", "font-feature-settings",
+    "font-size", "font-stretch", "font-style", "font-variant", "font-variant-numeric", "font-weight", "gap",
+    "grid", "grid-area", "grid-auto-columns", "grid-auto-flow", "grid-auto-rows", "grid-column",
+    "grid-column-end", "grid-column-start", "grid-gap", "grid-row", "grid-row-end", "grid-row-start",
+    "grid-template", "grid-template-areas", "grid-template-columns", "grid-template-rows", "height", "hyphens",
+    "inset", "isolation", "justify-content", "justify-items", "justify-self", "left", "letter-spacing",
+    "line-height", "list-style", "list-style-image", "list-style-position", "list-style-type", "margin",
+    "margin-bottom", "margin-left", "margin-right", "margin-top", "mask", "max-height", "max-width",
+    "min-height", "min-width", "mix-blend-mode", "object-fit", "object-position", "opacity", "order",
+    "outline", "outline-color", "outline-offset", "outline-style", "outline-width", "overflow",
+    "overflow-wrap", "overflow-x", "overflow-y", "padding", "padding-bottom", "padding-left", "padding-right",
+    "padding-top", "perspective", "place-items", "pointer-events", "position", "quotes", "resize", "right",
+    "row-gap", "scroll-behavior", "src", "stroke", "stroke-width", "tab-size", "table-layout", "text-align",
+    "text-decoration", "text-decoration-color", "text-decoration-line", "text-indent", "text-overflow",
+    "text-rendering", "text-shadow", "text-transform", "top", "touch-action", "transform", "transform-origin",
+    "transition", "transition-delay", "transition-duration", "transition-property",
+    "transition-timing-function", "unicode-range", "user-select", "vertical-align", "visibility",
+    "white-space", "width", "will-change", "word-break", "word-spacing", "word-wrap", "writing-mode", "z-index"
+}};
+
+
+// A run of the stylesheet source, by offset so it survives moves of the owner.
+struct CSSSlice
 {
-public:
-    CSS();
-    ~CSS();
-    
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct CSSDeclaration
+{
+    using PropertyId = uint32_t;
+
+    PropertyId property : 31;   // index in cssProperties or CSS::kCustomBase + interned id
+    PropertyId important : 1;
+    CSSSlice value;             // as written, without "!important"
 };
 
+// A style rule: the selector text and a range of the stylesheet's declarations.
 class CSSRule
 {
+    CSSSlice selector_;
+    uint32_t first_;
+    uint32_t count_;
+    uint32_t group_;
+
 public:
-    CSSRule();
-    ~CSSRule();
+    CSSRule(CSSSlice selector, uint32_t first, uint32_t count, uint32_t group) noexcept
+        : selector_(selector), first_(first), count_(count), group_(group)
+    {}
+
+    CSSSlice getSelector() const noexcept { return selector_; }
+    uint32_t getFirstDeclaration() const noexcept { return first_; }
+    uint32_t getDeclarationCount() const noexcept { return count_; }
+    // Innermost enclosing at-rule (@media, @supports, ...), or CSS::kNone.
+    uint32_t getGroup() const noexcept { return group_; }
+
+    friend class CSS;
+}; // class CSSRule
+
+// An at-rule. Grouping ones (@media, @supports, @keyframes, ...) enclose
+// rules; @font-face, @page and the like own one rule holding their
+// declarations; statements (@import, @charset, ...) have neither.
+struct CSSAtRule
+{
+    CSSSlice name;      // without '@'
+    CSSSlice prelude;
+    uint32_t parent;    // enclosing at-rule or CSS::kNone
 };
 
 
+// Splits a stylesheet into runs that end in ';', '{' or '}' without copying.
+// Strings, comments, escapes and parenthesized groups (url(), var(), ...)
+// are skipped as a whole, so their contents never end a run; bulk text is
+// scanned with hi::detail::simd::CharScanner.
+class CSSTokenizer
+{
+    const char* begin_;
+    const char* cursor_;
+    const char* end_;
+
+public:
+    struct Token {
+        std::string_view text;  // trimmed; leading comments dropped
+        char end = '\0';        // ';', '{', '}' or '\0' at the end of the input
+    };
+
+    explicit CSSTokenizer(std::string_view input) noexcept;
+
+    // Fills `token` with the next run; returns false once the input is exhausted.
+    bool next(Token& token) noexcept;
+    // Skips the rest of a block whose '{' was just read, nested blocks included.
+    void skipBlock() noexcept;
+
+    std::size_t offset() const noexcept { return static_cast<std::size_t>(cursor_ - begin_); }
+
+private:
+    void skipSpacesAndComments() noexcept;
+    const char* skipString(const char* p) const noexcept;
+    const char* skipComment(const char* p) const noexcept;
+    const char* skipParens(const char* p) const noexcept;
+}; // class CSSTokenizer
+
+
+// A parsed stylesheet. It owns the source, and every selector, value and
+// at-rule prelude is a slice of it, so a rule costs 20 bytes and a
+// declaration 12 on top of the source. Property names are interned to small
+// ids: known ones to their index in cssProperties, any other (vendor
+// prefixed, custom "--x") to kCustomBase + its id in the name registry.
+// Parsing never fails; like browsers it drops what it cannot read.
+class CSS
+{
+public:
+    using PropertyId = CSSDeclaration::PropertyId;
+    static constexpr PropertyId kCustomBase = 512;
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+private:
+    std::string source_;
+    std::vector<CSSRule> rules_;
+    std::vector<CSSDeclaration> declarations_;
+    std::vector<CSSAtRule> at_rules_;
+    hi::detail::Interner* names_;
+
+public:
+    // Parses `source` in one pass; custom property names are interned in `names`.
+    explicit CSS(std::string source, hi::detail::Interner& names = hi::detail::Interner::global());
+    // Parses a declaration list, such as a style attribute, into one rule
+    // with an empty selector.
+    static CSS s_fromDeclarations(std::string declarations, hi::detail::Interner& names = hi::detail::Interner::global());
+
+    std::span<const CSSRule> getRules() const noexcept { return rules_; }
+    std::span<const CSSAtRule> getAtRules() const noexcept { return at_rules_; }
+    std::span<const CSSDeclaration> getDeclarations(const CSSRule& rule) const noexcept {
+        return std::span<const CSSDeclaration>(declarations_).subspan(rule.first_, rule.count_);
+    }
+
+    std::string_view getText(CSSSlice slice) const noexcept { return {source_.data() + slice.offset, slice.size}; }
+    std::string_view getSelector(const CSSRule& rule) const noexcept { return getText(rule.selector_); }
+    std::string_view getValue(const CSSDeclaration& declaration) const noexcept { return getText(declaration.value); }
+    std::string_view getPropertyName(PropertyId property) const;
+    hi::detail::Interner& getNames() const noexcept { return *names_; }
+    const std::string& getSource() const noexcept { return source_; }
+
+    // Bytes held by the stylesheet: source, rules, declarations, at-rules.
+    std::size_t getMemoryUsage() const noexcept;
+
+    // Known names match case-insensitively; others must have been interned.
+    static std::optional<PropertyId> s_findProperty(std::string_view name, const hi::detail::Interner& names = hi::detail::Interner::global());
+    static PropertyId s_getProperty(std::string_view name, hi::detail::Interner& names = hi::detail::Interner::global());
+
+private:
+    void parse();
+    void parseDeclarations(CSSTokenizer& tokenizer, CSSSlice selector, uint32_t group);
+    void addDeclaration(std::string_view text);
+    CSSSlice slice(std::string_view text) const noexcept;
+}; // class CSS
+
+
 
 } // namespace hiweb
 
-#endif //HIWEB_CSS_H
\ No newline at end of file
+#endif //HIWEB_CSS_H
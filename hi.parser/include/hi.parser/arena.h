@@ -0,0 +1,156 @@
+#ifndef HI_ARENA_H
+#define HI_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace hi {
+namespace detail {
+
+
+// Bump allocator with a single owner lifetime. Memory is handed out from
+// geometrically growing blocks and released all at once when the arena dies.
+// Objects created through make() that are not trivially destructible are
+// destroyed (in reverse order of creation) right before the blocks are freed.
+class Arena
+{
+public:
+  static constexpr std::size_t kDefaultBlockSize = 4096;
+  static constexpr std::size_t kMaxBlockSize = std::size_t(1) << 20;
+
+private:
+  struct Block {
+    Block* prev;
+    std::size_t size;
+  };
+
+  struct Finalizer {
+    void (*destroy)(void*);
+    void* object;
+    Finalizer* next;
+  };
+
+  char* cursor_;
+  char* end_;
+  Block* blocks_;
+  Finalizer* finalizers_;
+  std::size_t next_block_size_;
+  std::size_t capacity_;
+
+public:
+  explicit Arena(std::size_t block_size = kDefaultBlockSize) noexcept;
+  // Starts out in caller-owned storage that must outlive the arena.
+  Arena(void* initial_buffer, std::size_t initial_size, std::size_t block_size = kDefaultBlockSize) noexcept;
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+    auto current = reinterpret_cast<std::uintptr_t>(cursor_);
+    auto aligned = (current + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    if (aligned + size <= reinterpret_cast<std::uintptr_t>(end_) && cursor_ != nullptr) {
+      cursor_ = reinterpret_cast<char*>(aligned + size);
+      return reinterpret_cast<void*>(aligned);
+    }
+    return allocateSlow(size, align);
+  }
+
+  template <typename T>
+  T* allocateArray(std::size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>, "Arena arrays hold trivially copyable values only");
+    return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      registerFinalizer([](void* p) { static_cast<T*>(p)->~T(); }, object);
+    }
+    return object;
+  }
+
+  // Bytes reserved from the system allocator (inline storage excluded).
+  std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+  void* allocateSlow(std::size_t size, std::size_t align);
+  void registerFinalizer(void (*destroy)(void*), void* object);
+}; // class Arena
+
+
+// Growable array whose storage lives in an Arena. It does not remember the
+// arena, so every growing call takes it explicitly; old storage is simply
+// abandoned to the arena on reallocation.
+template <typename T>
+class ArenaVector
+{
+  static_assert(std::is_trivially_copyable_v<T>, "ArenaVector holds trivially copyable values only");
+
+  T* data_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t capacity_ = 0;
+
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  void push_back(Arena& arena, T value) {
+    if (size_ == capacity_)
+      reserve(arena, capacity_ == 0 ? 4 : capacity_ * 2);
+    data_[size_++] = value;
+  }
+
+  void reserve(Arena& arena, uint32_t capacity) {
+    if (capacity <= capacity_)
+      return;
+    T* data = arena.allocateArray<T>(capacity);
+    if (size_ != 0)
+      std::memcpy(data, data_, sizeof(T) * size_);
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  iterator insert(Arena& arena, const_iterator it, T value) {
+    auto index = static_cast<uint32_t>(it - data_);
+    if (size_ == capacity_)
+      reserve(arena, capacity_ == 0 ? 4 : capacity_ * 2);
+    std::memmove(data_ + index + 1, data_ + index, sizeof(T) * (size_ - index));
+    data_[index] = value;
+    ++size_;
+    return data_ + index;
+  }
+
+  iterator erase(const_iterator it) noexcept {
+    auto index = static_cast<uint32_t>(it - data_);
+    std::memmove(data_ + index, data_ + index + 1, sizeof(T) * (size_ - index - 1));
+    --size_;
+    return data_ + index;
+  }
+
+  void clear() noexcept { size_ = 0; }
+
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  std::size_t capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  T& operator[](std::size_t i) noexcept { return data_[i]; }
+  const T& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+  iterator begin() noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+}; // class ArenaVector
+
+} // namespace detail
+} // namespace hi
+#endif // HI_ARENA_H
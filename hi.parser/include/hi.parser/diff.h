@@ -0,0 +1,140 @@
+#ifndef HI_DIFF_H
+#define HI_DIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hi.parser/frozen.h"
+#include "hi.parser/html5.h"
+
+namespace hi {
+
+
+// One step of an edit script. Elements are addressed by path: the child
+// positions leading to them from the root, in the tree as it stands when
+// the step is applied. The path of a root is empty; in scripts made from
+// DOMs it has one step, 0 for <head> and 1 for <body>.
+struct Edit
+{
+  enum class Op : uint8_t {
+    Insert,       // `subtree` becomes child `index` of `path`
+    Remove,       // `path` and its subtree go away
+    Move,         // `path` becomes child `index` of `to`
+    SetAttr,      // attribute `name` of `path` becomes `value`
+    RemoveAttr,   // attribute `name` of `path` goes away
+    SetType,      // `path` becomes an element named `name`
+    SetText,      // the text or comment node `path` gets the content `value`
+  };
+
+  Op op;
+  std::vector<uint32_t> path;
+  // Move: the new parent, in the tree with the moved element taken out.
+  std::vector<uint32_t> to;
+  uint32_t index = 0;
+  std::string name;
+  std::string value;
+  std::shared_ptr<const FrozenDOM> subtree;
+}; // struct Edit
+
+
+// Edits that turn one tree into another, as made by TreeDiff.
+class EditScript
+{
+  std::vector<Edit> edits_;
+  bool document_ = false;   // paths start with the DOM root
+
+public:
+  std::span<const Edit> getEdits() const noexcept { return edits_; }
+  std::size_t size() const noexcept { return edits_.size(); }
+  bool empty() const noexcept { return edits_.empty(); }
+
+  // Patches the tree in place. Throws exception::Error when a path does
+  // not lead to an element, which means the tree is not the one the script
+  // was made from.
+  void apply(Tag& root) const;
+  void apply(DOM& dom) const;
+
+  // JSON array of the edits for clients that patch their own copy:
+  //   {"op":"insert","path":[1,0],"index":2,"html":"<li>...</li>"}
+  //   {"op":"move","path":[1,4],"to":[1,0],"index":0}
+  //   {"op":"setAttr","path":[1,0,2],"name":"class","value":"active"}
+  //   {"op":"setText","path":[1,0,2,0],"value":"Sold out"}
+  std::string toJSON() const;
+
+  friend class TreeDiff;
+
+private:
+  void applyTo(Tag::Element& root, std::span<const uint32_t> path, const Edit& edit, const Tag& owner) const;
+}; // class EditScript
+
+
+// Computes edit scripts between trees. Elements are matched first by id
+// (unique ids of the same type in both trees, wherever they are), then
+// children of matched parents in order by type. Matched elements keep
+// their subtrees and get attribute edits and moves; the others are
+// inserted or removed whole.
+//
+// Text and comment nodes match like elements of their own types; matched
+// ones whose content differs get a SetText edit.
+//
+// The script is made top-down over the new tree: once an element is in
+// place its children are put in their final order, so every path is
+// computed against a mirror of the tree the client holds at that step.
+// Children that keep their relative order stay where they are (a longest
+// increasing run) and only the others move. Unchanged subtrees cost a few
+// hash lookups per element; each edit costs a pass over the siblings
+// involved, which keeps typical edits near-linear.
+class TreeDiff
+{
+public:
+  using Element = detail::HTML5Element;
+
+private:
+  static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+  // An element of the old tree, or one the script inserts.
+  struct Node {
+    const Element* element;     // nullptr for inserted ones
+    const Element* target;      // the element of the new tree it became
+    uint32_t parent;
+    uint32_t position;          // in the parent's children
+    std::vector<uint32_t> children;
+  };
+
+  std::vector<Node> nodes_;
+  std::unordered_map<std::string_view, uint32_t> old_ids_;  // unique ids; kNone for repeated ones
+  std::unordered_map<const Element*, uint32_t> matches_;    // new element -> node
+  std::shared_ptr<detail::Document> document_;              // of the new tree
+  bool same_names_ = false;
+  std::vector<std::string_view> chunks_;                    // scratch of sameText()
+
+public:
+  EditScript diff(const Tag& from, const Tag& to);
+  // <head> and <body> are compared separately, nothing moves between them.
+  EditScript diff(const DOM& from, const DOM& to);
+
+private:
+  void diffRoots(const Element& from, const Element& to, const std::vector<uint32_t>& prefix, EditScript& script);
+  void mirror(const Element& root);
+  void match(const Element& to);
+  void matchChildren(const Element& parent);
+  void setMatch(uint32_t node, const Element& target);
+  void place(const Element& root, const std::vector<uint32_t>& prefix, EditScript& script);
+  void placeChildren(uint32_t node, const Element& target, const std::vector<uint32_t>& prefix, EditScript& script);
+  void removeUnmatched(const std::vector<uint32_t>& prefix, EditScript& script);
+  void diffAttrs(uint32_t node, const Element& target, const std::vector<uint32_t>& prefix, EditScript& script);
+  bool sameType(const Element& left, const Element& right) const;
+  bool sameText(const Element& left, const Element& right);
+  std::vector<uint32_t> pathOf(uint32_t node, const std::vector<uint32_t>& prefix) const;
+  void detach(uint32_t node);
+  void attach(uint32_t node, uint32_t parent, uint32_t position);
+}; // class TreeDiff
+
+} // namespace hi
+#endif // HI_DIFF_H
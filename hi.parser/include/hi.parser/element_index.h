@@ -0,0 +1,88 @@
+#ifndef HI_ELEMENT_INDEX_H
+#define HI_ELEMENT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hi.parser/html5.h"
+
+namespace hi {
+namespace detail {
+
+
+// Elements of a document by id, by class and by type. It covers the
+// elements connected to the document's roots, up to the next root below
+// (see HTML5Element::isRoot), and HTML5Element keeps it up
+// to date as children are added and removed and as ids, classes and types
+// change; elements it holds are marked, so that a mutation finds the index
+// without a walk to the root. Lists are kept in document order while
+// elements are added in that order; anything else marks them for sorting on
+// the next lookup.
+//
+// Keys view attribute values, which live in the arenas of the document and
+// of the documents it adopted for as long as the index does.
+class ElementIndex
+{
+public:
+  using Element = HTML5Element;
+  using Key = Attribute::Key;
+
+private:
+  struct List {
+    std::vector<Element*> elements;
+    bool sorted = true;
+    bool compacted = false;  // while remove() runs, once the list was compacted
+  };
+
+  const Document* document_;
+  std::unordered_map<std::string_view, List> ids_;
+  std::unordered_map<std::string_view, List> classes_;
+  std::unordered_map<Key, List> types_;
+
+public:
+  // Indexes the elements connected to the roots of `document`.
+  explicit ElementIndex(const Document& document);
+
+  // Adds or removes `root` and its subtree, less the roots of documents
+  // moved into it, which stay in the index of their own.
+  void add(Element& root);
+  void remove(Element& root);
+  // Removes each of `roots` with its subtree.
+  void remove(std::span<Element* const> roots);
+  // Clears the marks of what remove() would take out, for an index that
+  // goes away with its document.
+  static void s_unmark(Element& root) noexcept;
+  // Called around changes of one element's id or class attribute or type.
+  void addAttr(Element& element, Key key, std::string_view value);
+  void removeAttr(Element& element, Key key, std::string_view value);
+  void changeType(Element& element, Key from, Key to);
+
+  // The first element in document order with the id, or nullptr.
+  Element* getElementById(std::string_view id);
+  // Elements with every class of the whitespace-separated list, in
+  // document order.
+  std::vector<Element*> getElementsByClassName(std::string_view names);
+  std::span<Element* const> getElementsByTagName(Key type);
+
+  // Whether `left` comes before `right` in document order.
+  bool isBefore(const Element* left, const Element* right) const noexcept;
+
+  static Key s_getKey(const Element& element) noexcept;
+
+private:
+  void addElement(Element& element);
+  void insert(List& list, Element* element);
+  template <typename Map, typename Name>
+  void erase(Map& lists, const Name& name, Element* element);
+  template <typename Map, typename Name>
+  void compact(Map& lists, const Name& name, std::vector<List*>& compacted);
+  std::span<Element* const> sorted(List& list);
+}; // class ElementIndex
+
+} // namespace detail
+} // namespace hi
+#endif // HI_ELEMENT_INDEX_H
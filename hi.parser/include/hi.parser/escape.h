@@ -0,0 +1,46 @@
+#ifndef HI_ESCAPE_H
+#define HI_ESCAPE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace hi {
+namespace detail {
+
+
+// What escape() replaces: text needs &, < and >; attribute values, which
+// the serializer always double-quotes, also " and '.
+enum class EscapeMode : unsigned char {
+  Text,
+  Attribute,
+};
+
+// Longest replacement ("&quot;"): escape() writes at most this many bytes
+// per input byte.
+constexpr std::size_t kMaxEscapeGrowth = 6;
+
+// Writes `text` escaped to `out`, which must have room for
+// kMaxEscapeGrowth * text.size() bytes, and returns the end of the output.
+// The vector kernels (see simd::getLevel) store every 32-byte (AVX2) or
+// 16-byte (SSE) block as it is and only go back over the blocks that
+// contain a byte to replace, so text without any costs a load and a store
+// per block.
+char* escape(std::string_view text, char* out, EscapeMode mode) noexcept;
+std::string escape(std::string_view text, EscapeMode mode = EscapeMode::Text);
+
+// Decodes character references the way the HTML5 tokenizer does: numeric
+// ones (with the windows-1252 fixups for 0x80-0x9F) and named ones by the
+// longest match in the full table of named references, legacy names
+// without ';' included. In attribute values a legacy name followed by '='
+// or an alphanumeric stays as written. Returns `text` itself when it has no
+// '&', else a view of `out`. Runs without '&' are found a vector at a time.
+std::string_view unescape(std::string_view text, std::string& out, bool attribute = false);
+
+// Length of the longest named reference at the start of `name` (the bytes
+// after '&'), or 0; `value` receives its UTF-8 expansion.
+std::size_t matchNamedEntity(std::string_view name, std::string_view& value) noexcept;
+
+} // namespace detail
+} // namespace hi
+#endif // HI_ESCAPE_H
@@ -0,0 +1,166 @@
+#ifndef HI_FROZEN_H
+#define HI_FROZEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/html5.h"
+
+namespace hi {
+
+class OutputSink;
+
+
+// Immutable structure-of-arrays copy of an element tree for read-heavy work
+// (queries, serialization, styling). Nodes are numbered in document order, so
+// a subtree is a contiguous index range, and every per-node property lives in
+// its own contiguous array:
+//
+//   types, parents, first children, next siblings   one uint32_t per node
+//   attribute ranges                                 n + 1 offsets into the attributes
+//   text ranges                                      one string range per node, empty for elements
+//   attributes                                       {key, value range}
+//   custom names                                     one string range per name
+//   strings                                          attribute values, names, text
+//
+// Types and attribute keys use the Attribute::Key encoding, text and comment
+// nodes the types HTML5Element::kText and kComment; custom ids index
+// the frozen copy's own name table, so it does not depend on any Interner.
+// All arrays sit in one buffer and refer to each other by offset only, which
+// keeps the layout valid wherever the buffer is placed.
+//
+// That also makes the buffer a file format. A snapshot is a 64-byte header
+// (magic, format version, byte order, the Layout counts) followed by the
+// buffer as is; s_load() maps one read-only and uses it in place, so a large
+// template costs a page fault per page touched instead of a parse. Loading
+// checks the header and the size only; isValid() checks every index and
+// range for snapshots that may have been corrupted or tampered with.
+class FrozenDOM
+{
+public:
+  using Index = uint32_t;
+  using Key = detail::Attribute::Key;
+  static constexpr Index kNone = 0xFFFFFFFFu;
+
+  struct Range {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  struct Attribute {
+    Key key;
+    Range value;
+  };
+
+  // Element counts of a frozen tree; they fix where each array starts in the buffer.
+  struct Layout {
+    uint32_t nodes = 0;
+    uint32_t attributes = 0;
+    uint32_t names = 0;
+    uint32_t string_bytes = 0;
+    bool document = false;  // frozen from a DOM: roots are <head> and <body>
+
+    std::size_t typesOffset() const noexcept { return 0; }
+    std::size_t parentsOffset() const noexcept { return typesOffset() + nodes * sizeof(uint32_t); }
+    std::size_t firstChildrenOffset() const noexcept { return parentsOffset() + nodes * sizeof(uint32_t); }
+    std::size_t nextSiblingsOffset() const noexcept { return firstChildrenOffset() + nodes * sizeof(uint32_t); }
+    std::size_t attributeRangesOffset() const noexcept { return nextSiblingsOffset() + nodes * sizeof(uint32_t); }
+    std::size_t textRangesOffset() const noexcept { return attributeRangesOffset() + (nodes + 1) * sizeof(uint32_t); }
+    std::size_t attributesOffset() const noexcept { return textRangesOffset() + nodes * sizeof(Range); }
+    std::size_t namesOffset() const noexcept { return attributesOffset() + attributes * sizeof(Attribute); }
+    std::size_t stringsOffset() const noexcept { return namesOffset() + names * sizeof(Range); }
+    std::size_t size() const noexcept { return stringsOffset() + string_bytes; }
+  }; // struct Layout
+
+private:
+  Layout layout_;
+  std::shared_ptr<const void> storage_;
+  const std::byte* data_;
+
+public:
+  // Freezes `root` and its subtree; `root` becomes node 0.
+  explicit FrozenDOM(const Tag& root);
+  // Freezes a whole document; <head> is node 0, <body> is its next sibling.
+  explicit FrozenDOM(const DOM& dom);
+  // Uses a buffer laid out as `layout` describes. `storage` keeps it alive.
+  FrozenDOM(const Layout& layout, std::shared_ptr<const void> storage, const std::byte* data) noexcept;
+
+  static constexpr uint32_t kSnapshotVersion = 2;
+  static constexpr std::size_t kSnapshotHeaderSize = 64;
+
+  // Writes the snapshot: header, then buffer.
+  void write(OutputSink& sink) const;
+  void save(const std::string& path) const;
+  // Uses the snapshot in `bytes` without copying it, unless it is not
+  // aligned for the arrays; `storage` keeps the bytes alive. Throws
+  // exception::InvalidSnapshot on a bad header or size.
+  static FrozenDOM s_fromSnapshot(std::span<const std::byte> bytes, std::shared_ptr<const void> storage);
+  // Maps a snapshot file read-only (reads it where there is no mmap).
+  static FrozenDOM s_load(const std::string& path);
+  // Whether every node, attribute and string reference is in bounds and
+  // the parent, child and sibling links describe one tree (two for a
+  // document) in document order.
+  bool isValid() const noexcept;
+
+  // Rebuilds a mutable tree in a new document; custom names are interned in
+  // `names` (the global registry by default).
+  Tag toTag(Index root = 0, std::shared_ptr<detail::Interner> names = nullptr) const;
+  // Rebuilds the subtree as a detached element of the document `owner`
+  // belongs to, as owner.createElement() would.
+  Tag toTag(Index root, const Tag& owner) const;
+  DOM toDOM(std::shared_ptr<detail::Interner> names = nullptr) const;
+
+  const Layout& getLayout() const noexcept { return layout_; }
+  std::span<const std::byte> getBuffer() const noexcept { return {data_, layout_.size()}; }
+
+  std::size_t size() const noexcept { return layout_.nodes; }
+  bool isDocument() const noexcept { return layout_.document; }
+
+  std::span<const Key> getTypes() const noexcept { return array<Key>(layout_.typesOffset(), layout_.nodes); }
+  std::span<const Index> getParents() const noexcept { return array<Index>(layout_.parentsOffset(), layout_.nodes); }
+  std::span<const Index> getFirstChildren() const noexcept { return array<Index>(layout_.firstChildrenOffset(), layout_.nodes); }
+  std::span<const Index> getNextSiblings() const noexcept { return array<Index>(layout_.nextSiblingsOffset(), layout_.nodes); }
+  std::span<const Range> getTextRanges() const noexcept { return array<Range>(layout_.textRangesOffset(), layout_.nodes); }
+
+  std::span<const Attribute> getAttrs(Index node) const noexcept {
+    auto ranges = array<uint32_t>(layout_.attributeRangesOffset(), layout_.nodes + 1);
+    return array<Attribute>(layout_.attributesOffset(), layout_.attributes).subspan(ranges[node], ranges[node + 1] - ranges[node]);
+  }
+
+  std::string_view getString(Range range) const noexcept {
+    return {reinterpret_cast<const char*>(data_ + layout_.stringsOffset() + range.offset), range.size};
+  }
+  // Name of a tag or attribute key.
+  std::string_view getName(Key key) const noexcept;
+  std::string_view getText(Index node) const noexcept { return getString(getTextRanges()[node]); }
+
+  std::string toString() const;
+
+private:
+  template <typename T>
+  std::span<const T> array(std::size_t offset, std::size_t count) const noexcept {
+    return {reinterpret_cast<const T*>(data_ + offset), count};
+  }
+
+  // Shared state of turning frozen nodes back into elements of one document.
+  struct Thaw {
+    const FrozenDOM& frozen;
+    detail::Document& document;
+    std::string_view strings;             // the string blob, retained by the document
+    std::vector<Tag::Custom> customs;     // local name index -> id in the document's registry
+
+    // Creates the subtree of `root`; `into`, when given, stands in for the root element.
+    Tag::Element* build(Index root, Tag::Element* into) const;
+  };
+
+  void build(std::initializer_list<const Tag::Element*> roots, bool document);
+  Thaw prepareThaw(detail::Document& document) const;
+}; // class FrozenDOM
+
+} // namespace hi
+#endif // HI_FROZEN_H
@@ -7,6 +7,7 @@
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
 #include <variant>
 #include <algorithm>
@@ -15,10 +16,42 @@
 #include <string_view>
 #include <array>
 #include <utility>
+#include <span>
+#include <iterator>
+#include <atomic>
+#include <mutex>
+
+#include "hi.parser/arena.h"
+#include "hi.parser/interner.h"
+#include "hi.parser/memory.h"
+#include "hi.parser/rope.h"
 
 namespace hi {
+
+class Serializer;
+
 namespace detail {
 
+class Document;
+class ElementIndex;
+
+
+// An attribute as an element stores it: the interned name and a view of the
+// value. The value points into the parsed source retained by the document or,
+// once set through setAttr(), into a copy in the document arena.
+struct Attribute
+{
+  // Native ids of known names (see Tag::s_getAttrKey) or kCustomBase + custom id.
+  using Key = uint32_t;
+  static constexpr Key kCustomBase = 256;
+
+  Key key;
+  uint32_t size;
+  const char* data;
+
+  std::string_view value() const noexcept { return {data, size}; }
+}; // struct Attribute
+
 
 class HTML5Element
 {
@@ -26,35 +59,364 @@ public:
   using Custom = uint32_t;
   using Native = unsigned char;
 
+  // Attributes past the first live in an arena array; past
+  // kIndexedAttrs the array is followed by a hash table of their slots.
+  static constexpr std::size_t kMaxAttrs = UINT16_MAX;
+  static constexpr std::size_t kIndexedAttrs = 16;
+
+  // Native types past the named ones for text and comment nodes, which
+  // have content instead of attributes and children.
+  static constexpr Native kText = 254;
+  static constexpr Native kComment = 255;
+  // Editing a view copies the result into the arena up to this size and
+  // moves longer content into a rope of the document.
+  static constexpr std::size_t kMaxCopiedText = 64;
+
 private:
-  std::variant<Native, Custom> type_;
-  std::unordered_map<std::string, std::string> attributes_;
-  std::vector<std::shared_ptr<HTML5Element>> children_;
+  // Content of a text or comment node: a view while `rope` is 0, else
+  // rope `rope - 1` of the document.
+  struct Text {
+    const char* data;
+    uint32_t size;
+    uint32_t rope;
+  };
+
   HTML5Element* parent_;
+  Document* document_;
+  ArenaVector<HTML5Element*> children_;
+  // The first attribute is stored inline. The other fields take 48 of the
+  // element's 64 bytes, which leaves room for one Attribute: that covers
+  // the 65% of the article corpus's elements with at most one, while the
+  // 2 to 4 of another 31% go to an arena array of the exact size.
+  union {
+    Attribute attr_;     // attr_capacity_ == 0
+    Attribute* attrs_;   // attr_capacity_ > 0
+    Text text_;          // text and comment nodes
+  };
+  uint16_t attr_count_;
+  uint16_t attr_capacity_;
+  Attribute::Key type_;  // Native, or Attribute::kCustomBase + Custom
+  uint32_t index_ : 29;  // position in parent_->children_
+  // 0 outside any index; 1 or 2 in the index of its own document or of
+  // another one, which findIndex() has to look up through the root.
+  uint32_t indexed_ : 2;
+  uint32_t root_ : 1;  // see isRoot()
+  // Below kInCache, 0: not cacheable, 1: cacheable without cached bytes, n:
+  // slot n - 2 of the document's serialized subtrees. kInCache is set on the
+  // elements of every subtree whose bytes were cached, so invalidate() can
+  // stop at the first element without it. Filled in by serializers, which
+  // may run on several threads, hence mutable and atomic; slots change under
+  // the lock of the document's serialized subtrees.
+  static constexpr uint32_t kInCache = 0x80000000u;
+  mutable std::atomic<uint32_t> cache_;
 
 public:
-  HTML5Element(std::variant<Native, Custom> type);
-  HTML5Element(Native native);
-  HTML5Element(Custom custom);
+  HTML5Element(Document* document, std::variant<Native, Custom> type);
 
-  void addChild(std::shared_ptr<HTML5Element> child);
-  std::vector<std::shared_ptr<HTML5Element>> getChildren() const;
-  void removeChild(std::shared_ptr<HTML5Element> child);
+  void addChild(HTML5Element* child);
+  // Inserts before the child at `position`; past the end it appends.
+  void insertChild(HTML5Element* child, std::size_t position);
+  std::span<HTML5Element* const> getChildren() const noexcept;
+  void removeChild(HTML5Element* child);
   void clearChildren();
 
-  void setType(std::variant<Native, Custom> type) noexcept;
+  HTML5Element* getNextSibling() const noexcept;
+  HTML5Element* getPreviousSibling() const noexcept;
+  // Position among the parent's children; 0 without a parent.
+  std::size_t getIndex() const noexcept;
+
+  void setType(std::variant<Native, Custom> type);
   std::variant<Native, Custom> getType() const noexcept;
+  // The type as an attribute-style key: Native, or kCustomBase + Custom.
+  Attribute::Key getTypeKey() const noexcept { return type_; }
 
   void setParent(HTML5Element* parent);
   HTML5Element* getParent() const;
+  Document* getDocument() const noexcept;
+  // Forgets the parent without touching it, for parents whose document is
+  // being destroyed.
+  void orphan() noexcept { parent_ = nullptr; index_ = 0; }
+
+  // Copies the value into the document arena.
+  void setAttr(std::string_view key, std::string_view value);
+  void setAttr(Attribute::Key key, std::string_view value);
+  // Stores the view as is; the value must live as long as the document.
+  void setAttrView(Attribute::Key key, std::string_view value);
+  void reserveAttrs(std::size_t count);
+  std::string_view getAttr(std::string_view key) const;
+  std::string_view getAttr(Attribute::Key key) const;
+  bool hasAttr(std::string_view key) const noexcept;
+  bool hasAttr(Attribute::Key key) const noexcept;
+  void removeAttr(std::string_view key);
+  void removeAttr(Attribute::Key key);
+  // nullptr when the element has no such attribute.
+  const Attribute* findAttr(std::string_view key) const noexcept;
+  const Attribute* findAttr(Attribute::Key key) const noexcept { return findAttrSlot(key); }
+  std::span<const Attribute> getAllAttrs() const noexcept;
+
+  // One of the roots (<head> and <body>) of its document. Elements belong
+  // to the index of the nearest root above them, even when the root was
+  // moved under another element.
+  bool isRoot() const noexcept { return root_ != 0; }
+  bool isText() const noexcept { return type_ == kText; }
+  bool isComment() const noexcept { return type_ == kComment; }
+  bool isElement() const noexcept { return type_ != kText && type_ != kComment; }
+
+  // Content of text and comment nodes, unescaped; the others throw
+  // exception::InvalidTag. setTextView stores the view as is, which must
+  // live as long as the document, setText copies into the arena. Edits
+  // work on views until the content outgrows kMaxCopiedText, then on a rope.
+  void setTextView(std::string_view text);
+  void setText(std::string_view text);
+  void appendText(std::string_view text);
+  void insertText(std::size_t position, std::string_view text);
+  void eraseText(std::size_t position, std::size_t count);
+  std::size_t getTextSize() const noexcept;
+  std::string getText() const;
+  // Calls `fn` with the content in one or more pieces.
+  template <typename Fn>
+  void forEachTextChunk(Fn&& fn) const;
+
+  // A cacheable element keeps the bytes the serializer produced for its
+  // subtree and replays them while nothing below it changes. Every mutation
+  // drops the cached bytes of the element and all of its ancestors; while no
+  // cached bytes cover the element, that costs nothing.
+  void setCacheable(bool cacheable);
+  bool isCacheable() const noexcept;
+  void invalidate() noexcept;
+
+  // A detached copy of this subtree owned by `document`. Attribute values
+  // and text stay views of the bytes they point to, so `document` must keep
+  // the documents of the copied elements alive; ropes and serialized bytes
+  // are copied, as they belong to the document that edits them.
+  HTML5Element* copyTree(Document& document) const;
 
-  void setAttr(const std::string& key, const std::string& value);
-  std::string getAttr(const std::string& key) const;
-  bool hasAttr(const std::string& key) const noexcept;
-  void removeAttr(const std::string& key);
-  std::unordered_map<std::string, std::string> getAllAttrs() const;
+private:
+  // Throws exception::InvalidTag unless `child` can go under this element.
+  void checkChild(const HTML5Element* child) const;
+  // Makes the detached subtree part of `document`, whose registry differs.
+  void rehome(Document& document);
+  HTML5Element* copyNode(Document& document) const;
+  Attribute* findAttrSlot(Attribute::Key key) const noexcept;
+  Attribute* getAttrData() const noexcept;
+  uint16_t* getAttrTable() const noexcept;
+  void growAttrs(std::size_t capacity);
+  void indexAttrs() noexcept;
+  void indexAttr(std::size_t position) noexcept;
+  void checkText() const;
+  Rope* getRope() const noexcept;
+  uint32_t getCache() const noexcept { return cache_.load(std::memory_order_relaxed) & ~kInCache; }
+  void setCache(uint32_t cache) const noexcept;
+  // Sets kInCache on the subtree, whose bytes were just cached.
+  void markCached() const noexcept;
+  // The index of the document this element is connected to, if it has one.
+  ElementIndex* findIndex() const noexcept;
+
+  friend class Document;
+  friend class ElementIndex;
+  friend class hi::Serializer;
 }; // class HTML5Element
 
+
+// Pre-order walk over a subtree, starting with its root. It keeps no stack:
+// siblings are found through the parent's child array, so it allocates
+// nothing. Changing the structure of the subtree invalidates it.
+class DepthFirstIterator
+{
+  HTML5Element* root_ = nullptr;
+  HTML5Element* current_ = nullptr;
+
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = HTML5Element;
+  using difference_type = std::ptrdiff_t;
+  using pointer = HTML5Element*;
+  using reference = HTML5Element&;
+
+  DepthFirstIterator() = default;
+  explicit DepthFirstIterator(HTML5Element* root) noexcept : root_(root), current_(root) {}
+
+  reference operator*() const noexcept { return *current_; }
+  pointer operator->() const noexcept { return current_; }
+  DepthFirstIterator& operator++() noexcept;
+  DepthFirstIterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+  bool operator==(const DepthFirstIterator& other) const noexcept { return current_ == other.current_; }
+}; // class DepthFirstIterator
+
+// Level-order walk over a subtree, starting with its root. It keeps the
+// nodes of the current level and gathers the next one from their children
+// when the level is done, so a whole traversal is O(nodes). The two level
+// buffers are reused from level to level: once they have grown to the widest
+// level, it allocates nothing. Changing the structure of the subtree
+// invalidates it.
+class BreadthFirstIterator
+{
+  HTML5Element* current_ = nullptr;
+  std::vector<HTML5Element*> level_;  // empty on the root's level
+  std::vector<HTML5Element*> next_;
+  std::size_t position_ = 0;
+  std::size_t depth_ = 0;
+
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = HTML5Element;
+  using difference_type = std::ptrdiff_t;
+  using pointer = HTML5Element*;
+  using reference = HTML5Element&;
+
+  BreadthFirstIterator() = default;
+  explicit BreadthFirstIterator(HTML5Element* root) noexcept : current_(root) {}
+
+  reference operator*() const noexcept { return *current_; }
+  pointer operator->() const noexcept { return current_; }
+  BreadthFirstIterator& operator++();
+  BreadthFirstIterator operator++(int) { auto copy = *this; ++*this; return copy; }
+  bool operator==(const BreadthFirstIterator& other) const noexcept { return current_ == other.current_; }
+
+  std::size_t getDepth() const noexcept { return depth_; }
+}; // class BreadthFirstIterator
+
+template <typename Iterator>
+class ElementRange
+{
+  Iterator begin_;
+
+public:
+  explicit ElementRange(Iterator begin) noexcept : begin_(begin) {}
+  Iterator begin() const noexcept { return begin_; }
+  Iterator end() const noexcept { return Iterator(); }
+}; // class ElementRange
+
+
+// Owns every element of one document. Elements are bump-allocated from the
+// arena and live exactly as long as the document; removing a child only
+// unlinks it. Documents that had elements grafted into this one via
+// Tag::operator<< are kept alive by it, and elements of other documents
+// still attached to one of its elements lose that parent when it dies.
+// Documents are made by s_create() and owned by a group, which handles to
+// them share (see adopt()).
+class Document
+{
+public:
+  // Room for one element and four child pointers, which is all most
+  // standalone Tags ever hold.
+  static constexpr std::size_t kInlineSize = 96;
+  // First heap block of a standalone Tag's document; later ones double.
+  static constexpr std::size_t kStandaloneBlockSize = 256;
+
+  // Serialized bytes of a cacheable element and the settings they were made with.
+  struct SerializedSubtree {
+    std::string bytes;
+    std::string indent;
+    std::string newline;
+    std::size_t level = 0;
+    bool show_children = true;
+    bool show_attrs = true;
+  };
+
+private:
+  // State a document only needs once it adopts another one, gets roots,
+  // caches subtrees or edits text. A standalone Tag rarely does any of it,
+  // so it lives out of line and is created on first use.
+  struct Extras {
+    // Elements of other documents attached to elements of this one.
+    std::unordered_set<HTML5Element*> grafted;
+    std::vector<HTML5Element*> roots;  // <head> and <body> of a DOM
+    // Entries are shared so that a serializer can replay one after the lock
+    // is released, while another thread replaces it.
+    std::vector<std::shared_ptr<const SerializedSubtree>> serialized;
+    std::vector<uint32_t> free_serialized;
+    std::mutex serialized_mutex;
+    std::vector<Rope> ropes;
+    std::vector<uint32_t> free_ropes;
+  };
+
+  // Documents whose lifetimes were tied together, and what they adopted.
+  struct Group;
+
+  alignas(std::max_align_t) char inline_block_[kInlineSize];
+  Arena arena_;
+  Group* group_ = nullptr;  // the group that owns this document
+  // Owned. Serializers may be the first to need the extras and run on
+  // several threads, so it is published with a compare-exchange.
+  mutable std::atomic<Extras*> extras_{nullptr};
+  std::shared_ptr<Interner> own_names_;
+  std::unique_ptr<ElementIndex> index_;
+  std::unique_ptr<MemoryAccount> memory_;  // while MemoryTracker was enabled at construction
+
+  Document(std::size_t block_size, std::shared_ptr<Interner> names);
+
+public:
+  // Custom names are interned in `names` when given, else in Interner::global().
+  static std::shared_ptr<Document> s_create(std::size_t block_size = Arena::kDefaultBlockSize, std::shared_ptr<Interner> names = nullptr);
+  ~Document();
+
+  Document(const Document&) = delete;
+  Document& operator=(const Document&) = delete;
+
+  HTML5Element* createElement(std::variant<HTML5Element::Native, HTML5Element::Custom> type);
+  // Copies bytes into the arena, e.g. the source a document was parsed from.
+  std::string_view retain(std::string_view bytes);
+  // Keeps `other` alive as long as this document. When `other` already
+  // keeps this one alive, the groups on the way back here are merged into
+  // this document's instead: their documents live until none of them is
+  // used any more, and nothing keeps itself alive.
+  void adopt(Document& other);
+  // Called by HTML5Element when it takes or gives up a child of another
+  // document.
+  void addGrafted(HTML5Element* element);
+  void removeGrafted(HTML5Element* element) noexcept;
+  Arena& getArena() noexcept;
+  Interner& getNames() const noexcept;
+  // The registry given at construction; null for the global one.
+  const std::shared_ptr<Interner>& getOwnNames() const noexcept { return own_names_; }
+  // Null unless the document is tracked (see MemoryTracker).
+  MemoryAccount* getMemoryAccount() const noexcept { return memory_.get(); }
+  // The tracked counters, the arena's reserved bytes and the names of a
+  // registry of the document's own.
+  MemoryUsage getMemoryUsage() const;
+
+  void addRoot(HTML5Element* root);
+  std::span<HTML5Element* const> getRoots() const noexcept {
+    const Extras* extras = extras_.load(std::memory_order_acquire);
+    return extras ? std::span<HTML5Element* const>(extras->roots) : std::span<HTML5Element* const>();
+  }
+  // The element at the position of `original` in a document whose roots
+  // were copied from those of `original`'s document and which adopted it;
+  // null if the position no longer exists. Follows child positions down
+  // from the root, so it costs O(depth).
+  HTML5Element* findCopy(const HTML5Element& original) const;
+  // Built from the roots on first use, then kept up to date by every
+  // mutation of the elements connected to them.
+  ElementIndex& getIndex();
+  ElementIndex* findIndex() const noexcept { return index_.get(); }
+
+  // Bytes cached for elements of this document. Serializers on several
+  // threads may look them up and store them at once; dropping them is part
+  // of mutating the element, which must not run alongside.
+  std::shared_ptr<const SerializedSubtree> findSerialized(const HTML5Element& element) const;
+  // Replaces whatever `element` had cached.
+  void storeSerialized(const HTML5Element& element, SerializedSubtree subtree);
+  void dropSerialized(const HTML5Element& element) noexcept;
+
+  // Content of edited text nodes that outgrew a view.
+  uint32_t createRope(std::string_view text);
+  Rope& getRope(uint32_t slot) noexcept { return extras_.load(std::memory_order_acquire)->ropes[slot]; }
+  void dropRope(uint32_t slot) noexcept;
+
+private:
+  Extras& getExtras() const;
+}; // class Document
+
+template <typename Fn>
+void HTML5Element::forEachTextChunk(Fn&& fn) const {
+  checkText();
+  if (text_.rope != 0)
+    document_->getRope(text_.rope - 1).forEachChunk(fn);
+  else
+    fn(std::string_view(text_.data, text_.size));
+}
+
 struct EnumRangeChecker {
     template<typename T, typename... Enums>
     constexpr static bool inRange(T value) {
@@ -75,6 +437,10 @@ struct is_string_literal<const char(&)[N]> : std::true_type {};
 
 
 
+// Lightweight handle to an element. Copies share the element; the element
+// itself is owned by the document it was created in. Tags constructed on
+// their own start a small private document, while createElement() places the
+// new element next to an existing one, which is what large trees should use.
 class Tag
 {
 public:
@@ -84,54 +450,131 @@ public:
   enum class Global : Native;
   enum class Event : Native;
 
-private:
-  std::shared_ptr<Element> element_;
+  // An attribute name resolved once: known names are their Global or Event
+  // id, any other name an id interned in the document's names (see
+  // getAttrKey()). Access by key compares integers where access by name
+  // looks the name up on every call.
+  class AttrKey
+  {
+    detail::Attribute::Key key_;
 
-  static const std::unordered_map<std::string, Native> kNativeMap;
-  static const std::unordered_map<Native, std::string> kNativeMapInverse;
-  static std::unordered_map<std::string, Custom> s_custom_map_;
-  static std::unordered_map<Custom, std::string> s_custom_inverse_map_;
+  public:
+    constexpr AttrKey(Global name) noexcept : key_(static_cast<Native>(name)) {}
+    constexpr AttrKey(Event name) noexcept : key_(static_cast<Native>(name)) {}
+    constexpr explicit AttrKey(detail::Attribute::Key key) noexcept : key_(key) {}
+
+    constexpr detail::Attribute::Key get() const noexcept { return key_; }
+    constexpr bool operator==(const AttrKey&) const noexcept = default;
+  }; // class AttrKey
+
+private:
+  std::shared_ptr<detail::Document> document_;
+  Element* element_;
 
 public:
-  // 
-  template <typename T, std::enable_if_t<detail::is_string_literal<T>::value, int> = 0>
-  consteval Tag(T tag) { return Tag(s_getType(tag)); }
+  template <typename T, std::enable_if_t<std::is_constructible_v<std::string_view, T>, int> = 0>
+  Tag(T tag) : Tag(s_getType(std::string_view(tag))) {}
 
-  template <typename T, std::enable_if_t<!detail::is_string_literal<T>::value && std::is_constructible_v<std::string, T>, int> = 0>
-  Tag(T tag) : Tag(s_getType(std::string(tag))) {}
-  
-  constexpr Tag(std::variant<Native, Custom> tag) : element_(tag) {}
-  constexpr Tag(Tag::Global tag) : Tag(static_cast<Native>(tag)) {}
-  constexpr Tag(Tag::Event tag) : Tag(static_cast<Native>(tag)) {}
+  Tag(std::variant<Native, Custom> tag);
+  Tag(Tag::Global tag) : Tag(static_cast<Native>(tag)) {}
+  Tag(Tag::Event tag) : Tag(static_cast<Native>(tag)) {}
 
   Tag& operator<<(const Tag& child);
+  // Like operator<<, but before the child at `position`.
+  Tag& insertChild(const Tag& child, std::size_t position);
+  // Detaches `child` with its subtree if it is a child of this element;
+  // anything else is left alone. The child stays in its document and can
+  // be added again.
+  Tag& removeChild(const Tag& child);
+
+  // Creates a detached element owned by the same document as this one.
+  Tag createElement(std::variant<Native, Custom> tag) const;
+  template <typename T, std::enable_if_t<std::is_constructible_v<std::string_view, T>, int> = 0>
+  Tag createElement(T tag) const { return createElement(s_getType(std::string_view(tag), document_->getNames())); }
+
+  void setAttr(std::string_view key, std::string_view value);
+  std::string_view getAttr(std::string_view key) const;
+  bool hasAttr(std::string_view key) const noexcept;
+  void removeAttr(std::string_view key);
+  void setAttr(AttrKey key, std::string_view value);
+  std::string_view getAttr(AttrKey key) const;
+  bool hasAttr(AttrKey key) const noexcept;
+  void removeAttr(AttrKey key);
+  // The key of `name` in this element's document; custom names are
+  // interned.
+  AttrKey getAttrKey(std::string_view name) const;
+
+  // Text and comment nodes in the document of this tag; addText appends
+  // one as the last child, created in the element's document like
+  // setText's. Content is stored unescaped, the serializer escapes it.
+  Tag createText(std::string_view text) const;
+  Tag createComment(std::string_view text) const;
+  Tag& addText(std::string_view text);
+  bool isText() const noexcept;
+  bool isComment() const noexcept;
+  // The content of a text or comment node; for an element, the content of
+  // the text nodes below it in document order.
+  std::string getText() const;
+  // Replaces the content of a text or comment node, or the children of an
+  // element with one text node.
+  void setText(std::string_view text);
+  // Edit text and comment nodes in O(log n) once they are long (see
+  // HTML5Element::setText); elements throw exception::InvalidTag.
+  void appendText(std::string_view text);
+  void insertText(std::size_t position, std::string_view text);
+  void eraseText(std::size_t position, std::size_t count);
+
+  std::span<Element* const> getChildren() const noexcept;
+  // See HTML5Element::setCacheable: for headers, navs and other subtrees
+  // that are serialized over and over without changes.
+  void setCacheable(bool cacheable = true);
+  // Subtree walks including this element. The depth-first one does not
+  // allocate; the breadth-first one keeps the nodes of a level.
+  detail::ElementRange<detail::DepthFirstIterator> depthFirst() const noexcept;
+  detail::ElementRange<detail::BreadthFirstIterator> breadthFirst() const;
+
+  std::string toString(const std::string& indent = "  ", bool show_children = true, bool show_attrs = true) const;
+  std::variant<Native, Custom> getType() const noexcept;
+  std::string getName() const;
 
-  inline std::string toString(const std::string& indent = "  ", bool show_children = true, bool show_attrs = true) const;
-  constexpr std::variant<Native, Custom> getType() const noexcept;
-  constexpr std::string getName() const;
-
-  constexpr bool isCustom() const noexcept;
+  bool isCustom() const noexcept;
 
-  static constexpr std::variant<Native, Custom> s_getType(const std::string& tag_name) noexcept;
-  static constexpr Custom s_getTypeCustom(const std::string& custom_name) noexcept;
-  static constexpr Native s_getTypeNative(const std::string& custom_name);
+  // Known names resolve case-insensitively through a compile-time perfect
+  // hash; anything else is interned as a custom name in `names`, by default
+  // the registry shared by all documents.
+  static std::variant<Native, Custom> s_getType(std::string_view tag_name, detail::Interner& names = detail::Interner::global());
+  static Custom s_getTypeCustom(std::string_view custom_name, detail::Interner& names = detail::Interner::global());
+  static Native s_getTypeNative(std::string_view native_name);
+  static std::optional<Native> s_findNative(std::string_view name) noexcept;
   
-  static constexpr std::string s_getName(std::variant<Native, Custom> tag);
-  static constexpr std::string s_getName(Native tag);
-  static constexpr std::string s_getName(Custom tag);
+  // Text and comment nodes are named "#text" and "#comment".
+  static std::string s_getName(std::variant<Native, Custom> tag, const detail::Interner& names = detail::Interner::global());
+  static std::string s_getName(Native tag);
+  static std::string s_getName(Custom tag, const detail::Interner& names = detail::Interner::global());
 
-  friend class HTML5Element;
+  // Whether elements of this type never have an end tag (<br>, <img>, ...).
+  static bool s_isVoid(std::variant<Native, Custom> tag) noexcept;
 
-private:
-  static constexpr const std::array<std::pair<std::string_view, detail::HTML5Element::Native>, 174> s_createNativeMap() noexcept;
-  static constexpr const std::array<std::pair<detail::HTML5Element::Native, std::string_view>, 174> s_createNativeMapInverse() noexcept;
+  // Attribute names share the tag registries: known names map to their
+  // Native id, any other name is interned as a custom one.
+  static detail::Attribute::Key s_getAttrKey(std::string_view name, detail::Interner& names = detail::Interner::global());
+  static std::optional<detail::Attribute::Key> s_findAttrKey(std::string_view name, const detail::Interner& names = detail::Interner::global()) noexcept;
+  static std::string_view s_getAttrName(detail::Attribute::Key key, const detail::Interner& names = detail::Interner::global());
 
-  static std::string s_toString(
-    std::shared_ptr<Element> element, 
-    const std::string& indent = "  ", 
-    bool show_children = true, 
-    bool show_attrs = true);
+  friend class HTML5Element;
+  friend class HTML5Parser;
+  friend class Serializer;
+  friend class FrozenDOM;
+  friend class EditScript;
+  friend class TreeDiff;
+  friend class Selector;
+  friend class Styles;
+  friend struct DOM;
 
+private:
+  Tag(std::shared_ptr<detail::Document> document, std::variant<Native, Custom> tag);
+  Tag(std::shared_ptr<detail::Document> document, Element* element) noexcept;
+  static void s_checkGraft(const Tag& parent, const Tag& child);
 }; // class Tag
 
 
@@ -374,13 +817,64 @@ static constexpr std::array<std::string_view, 174> htmlTags = {{
 
 
 
+// A document with its own arena; every element created through it (or
+// through createElement() on one of its tags) is freed in one go with it.
 struct DOM {
   Tag head;
   Tag body;
 
-  DOM() : head("head"), body("body") {}
+  DOM();
+  // A document whose custom names live in `names` instead of the global
+  // registry, e.g. one registry per rendering thread or per page.
+  explicit DOM(std::shared_ptr<detail::Interner> names);
+
+  // The registry custom names of this document are interned in.
+  detail::Interner& getNames() const noexcept { return head.document_->getNames(); }
+
+  Tag createElement(std::variant<Tag::Native, Tag::Custom> tag) const;
+  template <typename T, std::enable_if_t<std::is_constructible_v<std::string_view, T>, int> = 0>
+  Tag createElement(T tag) const { return head.createElement(tag); }
+  Tag createText(std::string_view text) const { return head.createText(text); }
+  Tag createComment(std::string_view text) const { return head.createComment(text); }
+
+  // Lookups through an index of the document, built on the first one and
+  // updated by later mutations; results are in document order.
+  std::optional<Tag> getElementById(std::string_view id) const;
+  std::vector<Tag> getElementsByClassName(std::string_view names) const;
+  std::vector<Tag> getElementsByTagName(std::variant<Tag::Native, Tag::Custom> tag) const;
+  template <typename T, std::enable_if_t<std::is_constructible_v<std::string_view, T>, int> = 0>
+  std::vector<Tag> getElementsByTagName(T tag) const { return getElementsByTagName(Tag::s_getType(std::string_view(tag), head.document_->getNames())); }
+
+  // A document of its own with a copy of every element, made without
+  // parsing or copying strings: the copies point to the attribute values
+  // and text of this document, which the copy keeps alive. Elements are not
+  // shared, so copying costs O(n) in elements and their attribute arrays;
+  // editing either document leaves the other as it was, since edits store
+  // new bytes instead of overwriting the shared ones. Meant for pages built
+  // from a shared layout: build the layout once, copy it per request and
+  // fill in the copy.
+  //
+  // This is not an O(1) copy-on-write clone. Elements store their parent
+  // and their position in it, which sibling walks, the index and the
+  // serializer rely on, so one element cannot sit in two trees, and Tags
+  // and getChildren() hand out elements directly, with nothing to copy a
+  // path on the first write through them. OverlayDOM (hi.parser/overlay.h)
+  // is that clone, over a frozen copy of the layout.
+  DOM copyTree() const;
+  // The element of this copy at the place of `original` in the DOM it was
+  // copied from, found by child positions in O(depth); nullopt if
+  // `original` is not in that DOM or its position no longer exists here.
+  std::optional<Tag> findCopy(const Tag& original) const;
 
   std::string toString() const;
+  // What the document allocated by category; all zero but reserved_bytes
+  // and the names of a registry of its own unless MemoryTracker was enabled
+  // when the DOM was created.
+  MemoryUsage getMemoryUsage() const;
+
+private:
+  explicit DOM(std::shared_ptr<detail::Document> document);
+  DOM(const std::shared_ptr<detail::Document>& document, Tag::Element* head, Tag::Element* body);
 }; // class DOM
 
 
@@ -419,6 +913,34 @@ namespace exception
       {}
   }; // class InvalidEvent
 
+  class InvalidSelector : public Error {
+  public:
+      InvalidSelector(const std::string& message) 
+        : Error("Invalid selector was received. " + message) 
+      {}
+  }; // class InvalidSelector
+
+  class IOError : public Error {
+  public:
+      IOError(const std::string& message) 
+        : Error("Output could not be written. " + message) 
+      {}
+  }; // class IOError
+
+  class InvalidSnapshot : public Error {
+  public:
+      InvalidSnapshot(const std::string& message) 
+        : Error("Invalid snapshot was received. " + message) 
+      {}
+  }; // class InvalidSnapshot
+
+  class InvalidTemplate : public Error {
+  public:
+      InvalidTemplate(const std::string& message) 
+        : Error("Invalid template was received. " + message) 
+      {}
+  }; // class InvalidTemplate
+
 } // namespace exception
 
 } // namespace hi
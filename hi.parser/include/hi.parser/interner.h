@@ -0,0 +1,92 @@
+#ifndef HI_INTERNER_H
+#define HI_INTERNER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+#include "hi.parser/arena.h"
+#include "hi.parser/memory.h"
+
+namespace hi {
+namespace detail {
+
+
+// Thread-safe registry of names that are not known at compile time (custom
+// tags and attributes). Names map to dense ids and back; both directions are
+// read without locks:
+//  - name -> id goes through one of kShards open-addressing tables. Writers
+//    serialize per shard and publish slots with release stores. A full table
+//    is replaced by a bigger copy while readers may still hold the old one,
+//    which stays valid in the shard arena until the interner dies. A lookup
+//    that misses is repeated under the shard lock, so it cannot miss a name
+//    that went into the bigger table while it walked the old one.
+//  - id -> name is an append-only table of segments that never move.
+// Ids and name views stay valid for the lifetime of the interner.
+class Interner
+{
+public:
+  using Id = uint32_t;
+  static constexpr std::size_t kShards = 16;
+
+private:
+  static constexpr std::size_t kFirstSegmentBits = 6;
+  static constexpr std::size_t kSegments = 32 - kFirstSegmentBits;
+  static constexpr uint32_t kInitialSlots = 16;
+  // Small first blocks keep short-lived per-document registries cheap.
+  static constexpr std::size_t kShardBlockSize = 512;
+
+  struct Table {
+    uint32_t mask;
+    std::atomic<uint64_t>* slots;  // (hash >> 32) << 32 | (id + 1), 0 when empty
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<const Table*> table{nullptr};
+    mutable std::mutex mutex;  // taken by writers, and by readers after a miss
+    Arena arena{kShardBlockSize};  // name bytes and tables, written under mutex
+    uint32_t count = 0;
+  };
+
+  struct Entry {
+    std::atomic<const char*> data;  // null until the name is published
+    uint32_t size;
+  };
+
+  std::array<Shard, kShards> shards_;
+  std::array<std::atomic<Entry*>, kSegments> segments_;
+  std::atomic<Id> next_id_;
+
+public:
+  Interner();
+  ~Interner();
+
+  Interner(const Interner&) = delete;
+  Interner& operator=(const Interner&) = delete;
+
+  // Id of `name`, registering it on first use.
+  Id intern(std::string_view name);
+  std::optional<Id> find(std::string_view name) const noexcept;
+  std::optional<std::string_view> name(Id id) const noexcept;
+  std::size_t size() const noexcept { return next_id_.load(std::memory_order_relaxed); }
+  // Names as objects; bytes are those of the shard arenas and id segments.
+  // Takes every shard lock in turn.
+  MemoryCounter getMemoryUsage();
+
+  // Registry shared by every document that does not bring its own.
+  static Interner& global();
+
+private:
+  static uint64_t s_hash(std::string_view name) noexcept;
+  std::optional<Id> findIn(const Table* table, std::string_view name, uint64_t hash) const noexcept;
+  const Table* grow(Shard& shard, const Table* table);
+  Entry& entry(Id id);
+}; // class Interner
+
+} // namespace detail
+} // namespace hi
+#endif // HI_INTERNER_H
@@ -0,0 +1,113 @@
+#ifndef HI_MEMORY_H
+#define HI_MEMORY_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace hi {
+
+
+// What the memory accounting tells apart.
+enum class MemoryCategory : unsigned char {
+  Elements,    // HTML5Element objects
+  Attributes,  // attribute arrays with their lookup tables
+  Strings,     // bytes copied into the arena: parsed source, attribute values, short text
+  Children,    // child arrays
+  Text,        // ropes of edited text nodes
+  Caches,      // serialized bytes of cacheable elements
+  Names,       // registry of custom tag and attribute names
+};
+
+constexpr std::size_t kMemoryCategories = 7;
+// Bytes a tracked document allocates before it updates the process totals.
+constexpr std::size_t kMemoryBatch = 64 << 10;
+
+struct MemoryCounter
+{
+  std::size_t allocations = 0;   // made so far
+  std::size_t bytes = 0;         // requested by those allocations
+  std::size_t live_objects = 0;
+  std::size_t live_bytes = 0;    // neither freed nor replaced by a larger copy
+}; // struct MemoryCounter
+
+// A breakdown of one document, or of all tracked ones (MemoryTracker).
+// Arena memory is only returned when its document dies, so bytes - live_bytes
+// of arena categories is what growing arrays left behind, and reserved_bytes
+// minus their live_bytes is what the arena holds unused.
+struct MemoryUsage
+{
+  std::array<MemoryCounter, kMemoryCategories> categories{};
+  std::size_t peak_bytes = 0;      // highest live byte total seen
+  std::size_t reserved_bytes = 0;  // arena blocks taken from the system allocator
+
+  MemoryCounter& operator[](MemoryCategory category) noexcept { return categories[static_cast<std::size_t>(category)]; }
+  const MemoryCounter& operator[](MemoryCategory category) const noexcept { return categories[static_cast<std::size_t>(category)]; }
+
+  std::size_t getLiveBytes() const noexcept;
+  // One line per category and one with the totals.
+  std::string toString() const;
+
+  static const char* s_getName(MemoryCategory category) noexcept;
+}; // struct MemoryUsage
+
+
+// Opt-in accounting of what documents allocate. Documents created while it
+// is enabled count every allocation in their own MemoryUsage (see
+// DOM::getMemoryUsage()) and in process-wide totals; documents created
+// while it is off count nothing and cost one null check per allocation.
+class MemoryTracker
+{
+public:
+  static void setEnabled(bool enabled) noexcept;
+  static bool isEnabled() noexcept;
+
+  // Sums over tracked documents: allocations and bytes since the start,
+  // live counts of the documents still alive, the peak since the last
+  // resetPeak(). Documents pass their counts on in batches, so a live one
+  // may be up to kMemoryBatch bytes ahead of them. Names are those of the
+  // global registry; reserved_bytes is left at 0, as arenas grow without
+  // telling their documents.
+  static MemoryUsage getTotals();
+  static void resetPeak() noexcept;
+}; // class MemoryTracker
+
+
+namespace detail {
+
+// The counters of one tracked document, mirrored into the totals in
+// batches: the shared atomics are touched once per kMemoryBatch bytes
+// rather than per allocation. Takes its live counts out of the totals when
+// destroyed.
+class MemoryAccount
+{
+  MemoryUsage usage_;
+  std::size_t live_bytes_ = 0;
+  MemoryUsage reported_;  // the part of usage_ already in the totals
+  std::size_t unreported_ = 0;  // bytes allocated since
+
+public:
+  MemoryAccount() noexcept;
+  ~MemoryAccount();
+
+  MemoryAccount(const MemoryAccount&) = delete;
+  MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+  // A new object of `bytes`.
+  void allocate(MemoryCategory category, std::size_t bytes) noexcept;
+  // An object moved into a new allocation of `bytes`, leaving `old_bytes` behind.
+  void reallocate(MemoryCategory category, std::size_t old_bytes, std::size_t bytes) noexcept;
+  // An object that grew or shrank in place, as ropes do.
+  void resize(MemoryCategory category, std::size_t old_bytes, std::size_t bytes) noexcept;
+  void release(MemoryCategory category, std::size_t bytes) noexcept;
+
+  const MemoryUsage& getUsage() const noexcept { return usage_; }
+
+private:
+  void addLive(MemoryCategory category, std::ptrdiff_t objects, std::ptrdiff_t bytes) noexcept;
+  void report() noexcept;
+}; // class MemoryAccount
+
+} // namespace detail
+} // namespace hi
+#endif // HI_MEMORY_H
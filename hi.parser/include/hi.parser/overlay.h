@@ -0,0 +1,123 @@
+#ifndef HI_OVERLAY_H
+#define HI_OVERLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/frozen.h"
+
+namespace hi {
+
+class Serializer;
+
+
+// Edits over a FrozenDOM that copy on write, for pages made from a shared
+// layout: freeze the layout once, then copy an OverlayDOM of it per request
+// and fill in the copy.
+//
+// Copying an OverlayDOM is O(1): copies share the frozen layout and every
+// node edited so far. Nodes are never changed once shared; an edit copies
+// the node and its ancestors up to the roots, each with the list of its
+// children, and leaves every other copy as it was (path copying). Subtrees
+// no edit reached are read, and serialized, straight from the frozen
+// arrays. Copies may be used on different threads at once.
+//
+// Nodes are named by their index in the frozen layout, which edits keep: a
+// copied node answers to the index it had there, and the text nodes and
+// subtrees that edits add have none. Edits of a node that an edit removed,
+// with itself or an ancestor, throw exception::InvalidTag.
+class OverlayDOM
+{
+public:
+  using Index = FrozenDOM::Index;
+  using Key = FrozenDOM::Key;
+  static constexpr Index kNone = FrozenDOM::kNone;
+
+private:
+  struct Node;
+
+  // Attribute value or text: a view of frozen strings or of `owned`.
+  struct Value {
+    std::string_view view;
+    std::shared_ptr<const std::string> owned;
+  };
+
+  struct Attribute {
+    Key key;
+    Value value;
+  };
+
+  // A child as its parent lists it: node `index` of frozen tree `tree` (0
+  // for the layout, then the grafted ones) with its subtree as frozen, or
+  // `node` once an edit copied it.
+  struct Child {
+    std::shared_ptr<const Node> node;
+    Index index;
+    uint32_t tree;
+  };
+
+  struct Node {
+    Index origin;  // in the layout; kNone for nodes edits added
+    Key type;      // FrozenDOM keys; customs past the layout's are in names_
+    std::vector<Attribute> attributes;
+    Value text;
+    std::vector<Child> children;
+  };
+
+  FrozenDOM layout_;
+  std::shared_ptr<const std::vector<FrozenDOM>> grafts_;   // trees 1, 2, ...
+  std::shared_ptr<const std::vector<std::string>> names_;  // custom names the layout lacks
+  std::shared_ptr<const Node> top_;  // parent of the roots; null while nothing was edited
+
+public:
+  explicit OverlayDOM(FrozenDOM layout);
+
+  // Values are copied. Text and comment nodes have no attributes and throw
+  // exception::InvalidAttribute.
+  void setAttr(Index node, std::string_view key, std::string_view value);
+  void removeAttr(Index node, std::string_view key);
+  // Replaces the children of an element with one text node, or the content
+  // of a text or comment node.
+  void setText(Index node, std::string_view text);
+  // Appends a frozen copy of `child` and its subtree to an element.
+  void addChild(Index parent, const Tag& child);
+  // Takes the node and its subtree out of its parent; roots stay.
+  void remove(Index node);
+
+  // Whether no edit removed the node, with itself or an ancestor.
+  bool contains(Index node) const;
+  // Throws exception::InvalidAttribute when the node has no such attribute.
+  std::string_view getAttr(Index node, std::string_view key) const;
+
+  const FrozenDOM& getLayout() const noexcept { return layout_; }
+
+  std::string toString() const;
+
+private:
+  // Frozen ancestors of `node` in the layout, roots first, `node` last.
+  std::vector<Index> getPath(Index node) const;
+  // The copy of `node`, or null with `frozen` set when no edit reached it;
+  // both unset when an edit removed it.
+  const Node* find(Index node, Index& frozen) const;
+  template <typename Edit>
+  void edit(Index node, Edit&& edit);
+  Node copyTop() const;
+  Node copyNode(Index node) const;
+  Key findKey(std::string_view name) const noexcept;
+  Key getKey(std::string_view name);
+
+  const FrozenDOM& getTree(const Child& child) const noexcept { return child.tree == 0 ? layout_ : (*grafts_)[child.tree - 1]; }
+  Index getOrigin(const Child& child) const noexcept;
+  Key getType(const Child& child) const noexcept;
+  std::string_view getText(const Child& child) const noexcept;
+  std::string_view getName(Key key) const noexcept;
+
+  friend class Serializer;
+}; // class OverlayDOM
+
+} // namespace hi
+#endif // HI_OVERLAY_H
@@ -0,0 +1,53 @@
+#ifndef HI_PARSER_H
+#define HI_PARSER_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/html5.h"
+#include "hi.parser/tokenizer.h"
+
+namespace hi {
+
+
+// Builds a DOM from HTML bytes. Tree construction follows the HTML5 rules
+// that matter for well-formed pages: metadata before <body> goes to head,
+// void elements never take children, stray end tags are ignored and open
+// <li>, <dt>/<dd>, <option>, <tr> and <td>/<th> elements are closed
+// implicitly. Text and comments become text and comment nodes. Character
+// references in text and attribute values are decoded with detail::unescape;
+// without any, both are views of the source the document retains, so parsing
+// copies none of it. A parser instance keeps its scratch buffers between
+// calls; it is not thread-safe, but any number of parsers may run
+// concurrently.
+class HTML5Parser
+{
+  using Element = detail::HTML5Element;
+
+  std::vector<Element*> open_;
+  std::string name_;
+  std::string text_;
+
+public:
+  // Custom names of the page go to a registry of the document's own, which
+  // dies with it, so untrusted input cannot grow a shared one. Compile
+  // selectors and stylesheets for such a DOM against DOM::getNames(); Tags
+  // grafted into it have their custom names interned there as well.
+  DOM parse(std::string_view html);
+  // Interns custom names in `names` (null: the global registry), for pages
+  // that share compiled selectors and stylesheets.
+  DOM parse(std::string_view html, std::shared_ptr<detail::Interner> names);
+
+private:
+  std::variant<Tag::Native, Tag::Custom> lookup(std::string_view name, detail::Interner& names);
+  // Like lookup(), but never registers a name.
+  std::optional<std::variant<Tag::Native, Tag::Custom>> find(std::string_view name, const detail::Interner& names);
+  void addText(detail::Document& document, Element* parent, const detail::Token& token);
+  void closeImplied(Tag::Native opening) noexcept;
+  void popUntil(std::variant<Tag::Native, Tag::Custom> type) noexcept;
+}; // class HTML5Parser
+
+} // namespace hi
+#endif // HI_PARSER_H
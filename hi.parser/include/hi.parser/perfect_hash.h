@@ -0,0 +1,136 @@
+#ifndef HI_PERFECT_HASH_H
+#define HI_PERFECT_HASH_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace hi {
+namespace detail {
+
+
+constexpr char toLowerAscii(char c) noexcept {
+  return static_cast<unsigned char>(c - 'A') < 26 ? static_cast<char>(c | 0x20) : c;
+}
+
+
+// Case-insensitive perfect hash over a fixed set of lowercase ASCII names,
+// built at compile time with hash-and-displace: the name hash picks a bucket,
+// the bucket's displacement picks a slot no other name uses. A lookup reads
+// three bytes of the name and two small tables, then compares against one
+// candidate; it never allocates.
+template <std::size_t N>
+class PerfectHash
+{
+public:
+  static constexpr std::size_t kSlots = std::bit_ceil(N + N / 2);
+  static constexpr std::size_t kBuckets = std::bit_ceil(N / 3 + 1);
+
+private:
+  static constexpr uint16_t kEmpty = 0xFFFF;
+  static constexpr uint32_t kMaxDisplacement = 1u << 20;
+  static constexpr int kSlotShift = 32 - std::countr_zero(kSlots);
+  static constexpr int kBucketShift = 64 - std::countr_zero(kBuckets);
+
+  static_assert(N < kEmpty, "PerfectHash indexes names with 16 bits");
+
+  std::array<std::string_view, N> names_;
+  std::array<uint32_t, kBuckets> displacements_;
+  std::array<uint16_t, kSlots> slots_;
+  std::size_t max_length_;
+
+public:
+  // Fails to compile if two names hash alike or no displacement separates a bucket.
+  constexpr explicit PerfectHash(const std::array<std::string_view, N>& names)
+    : names_(names), displacements_(), slots_(), max_length_(0)
+  {
+    std::array<std::size_t, kBuckets> sizes{};
+    for (std::string_view name : names_) {
+      ++sizes[s_hash(name) >> kBucketShift];
+      max_length_ = name.size() > max_length_ ? name.size() : max_length_;
+    }
+    for (auto& slot : slots_)
+      slot = kEmpty;
+
+    // Largest buckets first, while most slots are still free.
+    std::size_t largest = 0;
+    for (std::size_t size : sizes)
+      largest = size > largest ? size : largest;
+    for (std::size_t size = largest; size > 0; --size) {
+      for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        if (sizes[bucket] == size)
+          place(bucket, size);
+      }
+    }
+  }
+
+  // Index of `name` in the array the table was built from.
+  constexpr std::optional<std::size_t> find(std::string_view name) const noexcept {
+    if (name.empty() || name.size() > max_length_)
+      return std::nullopt;
+    const uint64_t hash = s_hash(name);
+    const uint16_t index = slots_[s_slot(hash, displacements_[hash >> kBucketShift])];
+    if (index == kEmpty)
+      return std::nullopt;
+    const std::string_view candidate = names_[index];
+    if (candidate.size() != name.size())
+      return std::nullopt;
+    for (std::size_t i = 0; i < name.size(); ++i) {
+      if (toLowerAscii(name[i]) != candidate[i])
+        return std::nullopt;
+    }
+    return index;
+  }
+
+private:
+  // Mixes the length with the first, middle and last byte, case-folded by
+  // setting bit 5 (exact for letters; the final compare catches the rest).
+  // Names that agree on all four make construction fail at compile time.
+  static constexpr uint64_t s_hash(std::string_view name) noexcept {
+    const auto byte = [name](std::size_t i) { return static_cast<uint64_t>(static_cast<unsigned char>(name[i]) | 0x20); };
+    const uint64_t key = byte(0) | byte(name.size() / 2) << 8 | byte(name.size() - 1) << 16 | uint64_t(name.size()) << 24;
+    return key * 0x9E3779B97F4A7C15ull;
+  }
+
+  static constexpr std::size_t s_slot(uint64_t hash, uint32_t displacement) noexcept {
+    return static_cast<uint32_t>((static_cast<uint32_t>(hash) ^ displacement) * 0x9E3779B1u) >> kSlotShift;
+  }
+
+  constexpr void place(std::size_t bucket, std::size_t size) {
+    std::array<std::size_t, N> members{};
+    std::array<uint64_t, N> hashes{};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      const uint64_t hash = s_hash(names_[i]);
+      if ((hash >> kBucketShift) == bucket) {
+        members[count] = i;
+        hashes[count++] = hash;
+      }
+    }
+
+    for (uint32_t displacement = 0; displacement < kMaxDisplacement; ++displacement) {
+      std::array<std::size_t, N> taken{};
+      bool fits = true;
+      for (std::size_t i = 0; i < size && fits; ++i) {
+        taken[i] = s_slot(hashes[i], displacement);
+        fits = slots_[taken[i]] == kEmpty;
+        for (std::size_t j = 0; j < i && fits; ++j)
+          fits = taken[j] != taken[i];
+      }
+      if (!fits)
+        continue;
+      for (std::size_t i = 0; i < size; ++i)
+        slots_[taken[i]] = static_cast<uint16_t>(members[i]);
+      displacements_[bucket] = displacement;
+      return;
+    }
+    throw "PerfectHash: no displacement separates a bucket (names hash alike?)";
+  }
+}; // class PerfectHash
+
+} // namespace detail
+} // namespace hi
+#endif // HI_PERFECT_HASH_H
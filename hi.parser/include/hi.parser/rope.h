@@ -0,0 +1,94 @@
+#ifndef HI_ROPE_H
+#define HI_ROPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hi {
+namespace detail {
+
+
+// Text as a sequence of chunks of up to kChunkSize bytes, kept in an
+// implicit treap ordered by position: every node holds one chunk and the
+// byte count of its subtree, and random priorities keep the tree balanced in
+// expectation. Inserting and erasing cost O(log n) plus the chunk bytes
+// touched; an insert that fits into the chunk at its position is done in
+// place, so appending grows the last chunk until it is full.
+class Rope
+{
+public:
+  static constexpr std::size_t kChunkSize = 1024;
+
+private:
+  struct Node {
+    std::string text;
+    uint32_t priority;
+    std::size_t size;  // bytes in this subtree
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+  };
+
+  std::unique_ptr<Node> root_;
+  uint32_t seed_ = 0x9E3779B9u;
+
+public:
+  Rope() = default;
+  explicit Rope(std::string_view text);
+  Rope(const Rope& other);
+  Rope& operator=(const Rope& other);
+  Rope(Rope&&) noexcept = default;
+  Rope& operator=(Rope&&) noexcept = default;
+  ~Rope();
+
+  std::size_t size() const noexcept { return root_ ? root_->size : 0; }
+  bool empty() const noexcept { return size() == 0; }
+
+  void append(std::string_view text);
+  // Positions past the end append; counts past the end erase to it.
+  void insert(std::size_t position, std::string_view text);
+  void erase(std::size_t position, std::size_t count);
+  void clear() noexcept;
+
+  // Calls `fn` with every chunk in order.
+  template <typename Fn>
+  void forEachChunk(Fn&& fn) const;
+  std::string toString() const;
+  std::size_t getChunkCount() const noexcept;
+
+private:
+  using NodePtr = std::unique_ptr<Node>;
+
+  NodePtr makeNode(std::string_view text);
+  NodePtr makeNodes(std::string_view text);
+  bool insertInPlace(Node* node, std::size_t position, std::string_view text);
+  void split(NodePtr node, std::size_t position, NodePtr& left, NodePtr& right);
+  static NodePtr s_merge(NodePtr left, NodePtr right);
+  static NodePtr s_copy(const Node* node);
+  static void s_update(Node* node) noexcept;
+  static std::size_t s_size(const Node* node) noexcept { return node ? node->size : 0; }
+}; // class Rope
+
+
+// In order without recursion: the stack holds the nodes whose chunk is
+// still to come, at most the height of the tree.
+template <typename Fn>
+void Rope::forEachChunk(Fn&& fn) const {
+  std::vector<const Node*> stack;
+  const Node* node = root_.get();
+  while (node != nullptr || !stack.empty()) {
+    for (; node != nullptr; node = node->left.get())
+      stack.push_back(node);
+    node = stack.back();
+    stack.pop_back();
+    fn(std::string_view(node->text));
+    node = node->right.get();
+  }
+}
+
+} // namespace detail
+} // namespace hi
+#endif // HI_ROPE_H
@@ -0,0 +1,182 @@
+#ifndef HI_SELECTOR_H
+#define HI_SELECTOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/html5.h"
+
+namespace hi {
+
+
+// Counting Bloom filter over the types, ids and classes of the ancestors of
+// the element being matched, after WebKit's SelectorFilter. A walk keeps it
+// on the parents of the current element; a selector whose ancestor
+// compounds need a name the filter has not seen cannot match and is
+// rejected without climbing the parent chain. False positives only cost
+// the climb the filter would have saved. Keeping it up to date costs more
+// than it saves for a single selector, so querySelectorAll() does without;
+// it pays off in walks that test many rules per element, as styling does.
+class SelectorFilter
+{
+public:
+  using Element = detail::HTML5Element;
+
+private:
+  static constexpr unsigned kKeyBits = 12;
+  static constexpr uint32_t kKeyMask = (1u << kKeyBits) - 1;
+
+  struct Parent {
+    const Element* element;
+    uint32_t first;       // first of its hashes in hashes_
+  };
+
+  std::array<uint8_t, 1u << kKeyBits> counters_{};  // saturate at 255
+  std::vector<uint32_t> hashes_;
+  std::vector<Parent> parents_;
+
+public:
+  // Makes the filter hold the ancestors of `element`. In a document-order
+  // walk that only pops finished parents; anywhere else the chain is read
+  // again from the document.
+  void setParentsOf(const Element& element);
+  // Pushes an element whose children come next, and pops it again.
+  void pushParent(const Element& parent);
+  void popParent() noexcept;
+  void clear() noexcept;
+
+  const Element* getParent() const noexcept { return parents_.empty() ? nullptr : parents_.back().element; }
+  bool mayContain(uint32_t hash) const noexcept {
+    return counters_[hash & kKeyMask] != 0 && counters_[(hash >> kKeyBits) & kKeyMask] != 0;
+  }
+}; // class SelectorFilter
+
+// A CSS selector list ("nav a.active, ul > li:nth-child(2n+1)") compiled into
+// flat arrays of tests. Each complex selector is stored right to left, so
+// matching starts with the compound that has to hold for the element itself
+// and only then walks to parents and siblings.
+//
+// Supported: type and universal selectors, #id, .class, [attr] with the =,
+// ~=, |=, ^=, $= and *= operators, :nth-child(), :nth-last-child(),
+// :first-child, :last-child, :only-child and the descendant, child (>), next
+// sibling (+) and subsequent sibling (~) combinators.
+//
+// Element types and attribute names are resolved once, when compiling: known
+// names to their Native ids, anything else to its id in `names`. Match only
+// elements of documents that use the same registry.
+class Selector
+{
+public:
+  using Element = detail::HTML5Element;
+  using Key = detail::Attribute::Key;
+
+  // Relation of a compound to the compound left of it.
+  enum class Combinator : uint8_t {
+    Descendant,
+    Child,
+    NextSibling,
+    SubsequentSibling
+  };
+
+  // One simple selector, checked against a single element. Ops are ordered
+  // from cheap to expensive; the tests of a compound run in that order.
+  struct Test {
+    enum class Op : uint8_t {
+      Type,
+      Id,
+      Class,
+      Attr,
+      AttrEquals,
+      AttrIncludes,
+      AttrDashMatch,
+      AttrPrefix,
+      AttrSuffix,
+      AttrContains,
+      NthChild,
+      NthLastChild
+    };
+
+    Op op;
+    Key key = 0;          // element type or attribute key
+    int32_t a = 0;        // :nth-child(an+b)
+    int32_t b = 0;
+    uint32_t value = 0;   // value to compare with, in strings_
+    uint32_t size = 0;
+  };
+
+  struct Compound {
+    uint32_t first;       // first test in tests_
+    uint32_t tests;
+    Combinator combinator;
+  };
+
+  struct Complex {
+    uint32_t first;       // rightmost compound in compounds_
+    uint32_t compounds;
+    uint32_t specificity; // ids << 16 | classes, attributes and pseudo-classes << 8 | types
+  };
+
+private:
+  // Matching outcome; the failures tell the caller how far it may give up.
+  enum class Result : uint8_t {
+    Matched,
+    Failed,             // try the next candidate for the compound
+    FailedSiblings,     // no later sibling of the element can match either
+    FailedCompletely    // no other candidate of an enclosing walk can match
+  };
+
+  std::vector<Test> tests_;
+  std::vector<Compound> compounds_;
+  std::vector<Complex> complexes_;
+  // Per complex selector: hashes of names its ancestor compounds require,
+  // most selective first, for SelectorFilter; unused slots are 0.
+  std::vector<std::array<uint32_t, 4>> ancestor_hashes_;
+  std::string strings_;
+  const detail::Interner* names_;
+  bool custom_ = false;  // resolved a name through names_
+
+public:
+  // Throws exception::InvalidSelector when `text` is not a selector list.
+  explicit Selector(std::string_view text, detail::Interner& names = detail::Interner::global());
+
+  bool matches(const Element& element) const noexcept;
+  bool matches(const Tag& tag) const noexcept { return matches(*tag.element_); }
+
+  // The same, rejecting complex selectors through `filter` first; it must
+  // hold the parents of `element`.
+  bool matches(const Element& element, const SelectorFilter& filter) const noexcept;
+
+  // Matching elements of the subtree of `root`, root included, in document
+  // order. Combinators may reach ancestors and siblings of the root.
+  std::vector<Element*> querySelectorAll(const Tag& root) const;
+  std::vector<Element*> querySelectorAll(const DOM& dom) const;
+  Element* querySelector(const Tag& root) const;
+
+  std::span<const Complex> getComplexes() const noexcept { return complexes_; }
+  std::span<const Compound> getCompounds() const noexcept { return compounds_; }
+  std::span<const Test> getTests() const noexcept { return tests_; }
+  std::string_view getValue(const Test& test) const noexcept { return {strings_.data() + test.value, test.size}; }
+
+  // Whether the complex selector at `complex` in getComplexes() matches.
+  bool matches(std::size_t complex, const Element& element) const noexcept;
+  bool matches(std::size_t complex, const Element& element, const SelectorFilter& filter) const noexcept;
+  // Whether `filter` proves that the complex selector matches no element
+  // with those parents.
+  bool fastRejects(std::size_t complex, const SelectorFilter& filter) const noexcept;
+
+private:
+  class Compiler;
+
+  Result matchFrom(uint32_t compound, uint32_t end, const Element& element) const noexcept;
+  bool matchCompound(const Compound& compound, const Element& element) const noexcept;
+  bool matchTest(const Test& test, const Element& element) const noexcept;
+  void checkNames(const Tag& root) const;
+}; // class Selector
+
+} // namespace hi
+#endif // HI_SELECTOR_H
@@ -0,0 +1,211 @@
+#ifndef HI_SERIALIZER_H
+#define HI_SERIALIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hi.parser/escape.h"
+#include "hi.parser/html5.h"
+
+namespace hi {
+
+class FrozenDOM;
+class OverlayDOM;
+class Template;
+class ThreadPool;
+
+
+// Destination of serialized bytes. The serializer stages output in a fixed
+// size chunk and hands it over whenever the chunk fills up and on flush().
+class OutputSink
+{
+public:
+  virtual ~OutputSink() = default;
+  virtual void write(std::string_view bytes) = 0;
+
+  // Sinks that can take several pieces at once without joining them first
+  // say so here; a parallel write then hands them its pieces directly
+  // instead of copying them through the serializer's chunk.
+  virtual bool canGather() const noexcept { return false; }
+  virtual void writeParts(std::span<const std::string_view> parts) {
+    for (std::string_view part : parts)
+      write(part);
+  }
+}; // class OutputSink
+
+// Appends to a caller-owned string; clear it between documents to reuse its capacity.
+class StringSink : public OutputSink
+{
+  std::string& out_;
+
+public:
+  explicit StringSink(std::string& out) : out_(out) {}
+  void write(std::string_view bytes) override { out_.append(bytes); }
+  bool canGather() const noexcept override { return true; }
+  void writeParts(std::span<const std::string_view> parts) override;
+}; // class StringSink
+
+// Writes to a file descriptor (socket, pipe, file), retrying short writes.
+// Pieces of a parallel write go out with writev where it exists.
+class FdSink : public OutputSink
+{
+  int fd_;
+
+public:
+  explicit FdSink(int fd) : fd_(fd) {}
+  void write(std::string_view bytes) override;
+#ifndef _WIN32
+  bool canGather() const noexcept override { return true; }
+  void writeParts(std::span<const std::string_view> parts) override;
+#endif
+}; // class FdSink
+
+// Passes every chunk to a callback. All chunks but the last one of a flush
+// are exactly Serializer::getChunkSize() bytes long.
+class CallbackSink : public OutputSink
+{
+  std::function<void(std::string_view)> callback_;
+
+public:
+  explicit CallbackSink(std::function<void(std::string_view)> callback) : callback_(std::move(callback)) {}
+  void write(std::string_view bytes) override { callback_(bytes); }
+}; // class CallbackSink
+
+
+struct SerializeOptions
+{
+  std::string_view indent = "  ";   // repeated once per nesting level
+  std::string_view newline = "\n";  // empty together with indent for compact output;
+                                    // with one, whitespace-only text is left out
+  bool show_children = true;
+  bool show_attrs = true;
+}; // struct SerializeOptions
+
+
+// Streams HTML for tags and documents into an OutputSink. Tag and attribute
+// names come from precomputed "<name" / "</name>" / ' name="' fragments and
+// indentation from a cached run of indent strings, and the traversal stack is
+// reused, so a warm serializer does not allocate per element. Void elements
+// without children get no end tag. Text is escaped (&, <, >) except inside
+// <script>, <style> and the other raw text elements, where only an end tag
+// of the element gets a '\' before its '/', attribute values also
+// get their quotes escaped, and both go through the vector kernels of
+// detail::escape; comments are written as stored, except that a '>' that
+// would end one early ("-->", "--!>", or at its start) is written as "&gt;".
+// Subtrees of cacheable elements are copied from their cached bytes while
+// those are valid. Serializers on several threads may write the same tree at
+// once, caches included, as long as nothing mutates it meanwhile.
+class Serializer
+{
+public:
+  static constexpr std::size_t kDefaultChunkSize = 16 * 1024;
+
+private:
+  using Element = detail::HTML5Element;
+
+  struct Frame {
+    const Element* element;
+    std::span<Element* const> children;
+    std::size_t next;
+  };
+
+  // Run of siblings serialized by one task of a parallel write.
+  struct Task {
+    std::span<Element* const> children;
+    std::size_t level;
+    std::size_t offset;   // where the output goes into the skeleton
+  };
+
+  struct Plan {
+    static constexpr uint32_t kSplit = 0xFFFFFFFFu;
+    // Element counts of the subtrees cut into tasks; kSplit for the elements
+    // above them, which the skeleton holds.
+    std::unordered_map<const Element*, uint32_t> sizes;
+    std::size_t grain = 0;         // most elements per task
+    std::vector<Task> tasks;
+    std::string skeleton;          // everything outside the tasks
+  };
+
+  OutputSink& sink_;
+  std::vector<char> chunk_;
+  std::size_t used_;
+  std::string indent_;
+  std::string indents_;
+  std::vector<Frame> stack_;
+  bool store_cached_ = true;  // off in parallel tasks, which only read caches
+  // Set while a Template compiles through this serializer: text and
+  // attribute values go to it to have their holes cut out, and caches are
+  // neither read nor filled.
+  Template* compiling_ = nullptr;
+
+public:
+  explicit Serializer(OutputSink& sink, std::size_t chunk_size = kDefaultChunkSize);
+
+  Serializer(const Serializer&) = delete;
+  Serializer& operator=(const Serializer&) = delete;
+
+  void write(const Tag& tag, const SerializeOptions& options = {});
+  void write(const DOM& dom, const SerializeOptions& options = {});
+  // Same output as writing the tree the FrozenDOM was made from.
+  void write(const FrozenDOM& frozen, const SerializeOptions& options = {});
+  // Same output as writing that tree with the overlay's edits made to it.
+  void write(const OverlayDOM& overlay, const SerializeOptions& options = {});
+
+  // Same output as the sequential overloads. The tree is cut into runs of
+  // sibling subtrees of similar element counts that `pool` serializes into
+  // buffers of their own, and the buffers are passed on in document order.
+  // Cacheable subtrees outside the runs are written (and cached) first; the
+  // runs only replay valid caches, never fill them.
+  void write(const Tag& tag, ThreadPool& pool, const SerializeOptions& options = {});
+  void write(const DOM& dom, ThreadPool& pool, const SerializeOptions& options = {});
+
+  // Renders a compiled page, see Template::render.
+  void write(const Template& page, std::span<const std::string_view> values);
+
+  // Hands everything staged so far to the sink. Output still staged when
+  // the serializer is destroyed is discarded.
+  void flush();
+
+  std::size_t getChunkSize() const noexcept { return chunk_.size(); }
+
+private:
+  void writeElement(const Element* root, const SerializeOptions& options);
+  void writeSubtree(const Element* root, std::size_t level, const SerializeOptions& options);
+  void writeCached(const Element* element, std::size_t level, const SerializeOptions& options);
+  void writeParallel(std::initializer_list<const Element*> roots, bool document, ThreadPool& pool, const SerializeOptions& options);
+  void planSubtree(const Element* root, const SerializeOptions& options, Plan& plan);
+  void writeOpenTag(const Element* element, const SerializeOptions& options);
+  void writeCloseTag(const Element* element);
+  void writeText(const Element* node);
+  struct CommentState;
+  void appendComment(std::string_view text, CommentState& state);
+  void appendEscaped(std::string_view text, detail::EscapeMode mode);
+  void writeIndent(std::size_t level, const SerializeOptions& options);
+  void writeFrozen(const FrozenDOM& frozen, uint32_t root, std::size_t level, const SerializeOptions& options);
+  void writeFrozenTag(const FrozenDOM& frozen, uint32_t node, bool close, const SerializeOptions& options);
+
+  void append(std::string_view bytes) {
+    if (bytes.size() <= chunk_.size() - used_) {
+      if (!bytes.empty())
+        std::memcpy(chunk_.data() + used_, bytes.data(), bytes.size());
+      used_ += bytes.size();
+      return;
+    }
+    appendSlow(bytes);
+  }
+  void appendSlow(std::string_view bytes);
+
+  friend class Template;
+}; // class Serializer
+
+} // namespace hi
+#endif // HI_SERIALIZER_H
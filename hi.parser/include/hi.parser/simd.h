@@ -0,0 +1,84 @@
+#ifndef HI_SIMD_H
+#define HI_SIMD_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+namespace hi {
+namespace detail {
+namespace simd {
+
+
+enum class Level : unsigned char {
+  Scalar,
+  SSE42,  // 16 bytes per step with PCMPESTRI
+  AVX2,   // 32 bytes per step with VPSHUFB nibble lookups
+};
+
+// Best level supported by the running CPU.
+Level detectLevel() noexcept;
+// Level used by every scanner. Defaults to detectLevel(); tests and
+// benchmarks may lower it, requests above the detected level are clamped.
+Level getLevel() noexcept;
+void setLevel(Level level) noexcept;
+
+const char* levelName(Level level) noexcept;
+
+
+// Finds the first byte that belongs to a small set (up to kMaxNeedles
+// distinct bytes). Bulk input is compared a whole vector at a time; the tail
+// and the scalar fallback use a 256-entry table.
+class CharScanner
+{
+public:
+  static constexpr int kMaxNeedles = 8;
+
+private:
+  std::array<bool, 256> table_;
+  std::array<char, 16> needles_;
+  // Needle i sets bit i in the entries for its low and high nibble, so a byte
+  // is a needle exactly when both lookups share a bit (used with PSHUFB).
+  std::array<unsigned char, 16> low_nibbles_;
+  std::array<unsigned char, 16> high_nibbles_;
+  int count_;
+
+public:
+  constexpr CharScanner(std::initializer_list<char> needles) noexcept
+    : table_(), needles_(), low_nibbles_(), high_nibbles_(), count_(0)
+  {
+    for (char c : needles) {
+      auto byte = static_cast<unsigned char>(c);
+      if (count_ < kMaxNeedles && !table_[byte]) {
+        table_[byte] = true;
+        low_nibbles_[byte & 0x0F] |= static_cast<unsigned char>(1u << count_);
+        high_nibbles_[byte >> 4] |= static_cast<unsigned char>(1u << count_);
+        needles_[count_++] = c;
+      }
+    }
+  }
+
+  bool contains(char c) const noexcept { return table_[static_cast<unsigned char>(c)]; }
+
+  // Returns the first position in [p, end) holding one of the needles, or end.
+  const char* find(const char* p, const char* end) const noexcept;
+  // Same as find(), for scans that mostly stop within a few bytes, such as
+  // those of the tokenizer and the CSS scanner. The AVX2 level uses SSE4.2
+  // here: its 32-byte steps measure slower than PCMPESTRI on markup.
+  const char* findNear(const char* p, const char* end) const noexcept;
+
+  const char* findScalar(const char* p, const char* end) const noexcept {
+    while (p != end && !table_[static_cast<unsigned char>(*p)])
+      ++p;
+    return p;
+  }
+
+private:
+  const char* findSSE42(const char* p, const char* end) const noexcept;
+  const char* findAVX2(const char* p, const char* end) const noexcept;
+}; // class CharScanner
+
+} // namespace simd
+} // namespace detail
+} // namespace hi
+#endif // HI_SIMD_H
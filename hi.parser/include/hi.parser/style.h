@@ -0,0 +1,212 @@
+#ifndef HI_STYLE_H
+#define HI_STYLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CSS.h"
+#include "hi.parser/html5.h"
+#include "hi.parser/selector.h"
+
+namespace hi {
+
+
+// The cascaded properties of an element, inherited ones included. Immutable
+// once built and held through shared_ptr, so any number of elements may
+// point at one. Values are the declared text, viewed in the stylesheets and
+// inline styles of the resolver that built it.
+class ComputedStyle
+{
+public:
+  using PropertyId = hiweb::CSS::PropertyId;
+
+  struct Property {
+    PropertyId id : 31;
+    PropertyId inherited : 1;
+    std::string_view value;
+  };
+
+private:
+  std::vector<Property> properties_;  // sorted by id
+
+public:
+  explicit ComputedStyle(std::vector<Property> properties) noexcept : properties_(std::move(properties)) {}
+
+  std::optional<std::string_view> get(PropertyId property) const noexcept;
+  // Known names case-insensitively, others as interned in `names`.
+  std::optional<std::string_view> get(std::string_view name, const detail::Interner& names = detail::Interner::global()) const;
+
+  std::span<const Property> getProperties() const noexcept { return properties_; }
+  // Whether all properties are inherited ones, so children without
+  // declarations of their own can use this style as is.
+  bool isInheritedOnly() const noexcept;
+
+  std::size_t getMemoryUsage() const noexcept { return sizeof(*this) + properties_.capacity() * sizeof(Property); }
+}; // class ComputedStyle
+
+
+// Computed styles of the elements of a document, as returned by
+// StyleResolver::resolve().
+class Styles
+{
+public:
+  using Element = detail::HTML5Element;
+
+private:
+  std::unordered_map<const Element*, std::shared_ptr<const ComputedStyle>> styles_;
+  std::size_t shared_ = 0;
+
+public:
+  const ComputedStyle* get(const Element& element) const noexcept;
+  const ComputedStyle* get(const Tag& tag) const noexcept { return get(*tag.element_); }
+
+  std::size_t size() const noexcept { return styles_.size(); }
+  // Elements that reused the style of a sibling, a cousin or their parent.
+  std::size_t getSharedCount() const noexcept { return shared_; }
+  // Distinct ComputedStyle objects.
+  std::size_t getStyleCount() const;
+  // Bytes held by the distinct styles and their shared_ptr control blocks,
+  // not counting the element to style map.
+  std::size_t getMemoryUsage() const;
+
+  friend class StyleResolver;
+}; // class Styles
+
+
+struct StyleOptions
+{
+  // Reuse a style for elements known to cascade alike; off, every element
+  // gets its own.
+  bool share = true;
+}; // struct StyleOptions
+
+
+// Cascades stylesheets over a DOM: matches every rule against every element
+// during one walk, with a SelectorFilter, then orders the matches by
+// importance, specificity and source order, adds the inline style and
+// inherits from the parent's style.
+//
+// Rules are indexed by the id, class or type of their rightmost compound,
+// so an element is only tested against rules that can match it. Rules
+// inside @media and other grouping at-rules are skipped, as are selectors
+// hi::Selector cannot compile; the values "inherit", "initial" and "unset"
+// are resolved, other values are kept as written.
+//
+// Siblings and cousins often cascade alike. Before cascading, an element
+// is looked up in a cache keyed on its parent's sharing class, its type,
+// its classes and the values of the attributes the rules test (inline
+// style included); a hit reuses that style object. Rules that depend on
+// siblings (the + and ~ combinators, :nth-child()) are matched before the
+// lookup and their outcome is part of the key. Elements without
+// declarations of their own take the parent's style when it only holds
+// inherited properties.
+//
+// The stylesheets must outlive the resolver, and both the styles it builds.
+class StyleResolver
+{
+public:
+  using Element = detail::HTML5Element;
+  using Key = detail::Attribute::Key;
+  using PropertyId = ComputedStyle::PropertyId;
+
+private:
+  struct Rule {
+    uint32_t selector;      // in selectors_
+    uint32_t complex;
+    uint32_t specificity;
+    uint32_t order;         // source order over all stylesheets
+    const hiweb::CSS* sheet;
+    const hiweb::CSSRule* rule;
+    bool positional;        // depends on siblings, not only on ancestors
+  };
+
+  struct Match {
+    uint64_t priority;      // specificity << 32 | order
+    const Rule* rule;
+  };
+
+  struct Declared {
+    PropertyId id;
+    uint32_t order;
+    std::string_view value;
+  };
+
+  // Elements of one sharing class match the same rules and share one style. Keying on the parent's class
+  // rather than its style keeps that true for cousins: parents can end up
+  // with equal styles through different rules.
+  struct ShareKey {
+    uint32_t parent;        // sharing class of the parent
+    Key type;
+    uint64_t fingerprint;   // classes, tested attribute values, positional matches
+
+    bool operator==(const ShareKey&) const noexcept = default;
+  };
+
+  struct ShareKeyHash {
+    std::size_t operator()(const ShareKey& key) const noexcept;
+  };
+
+  struct Shared {
+    std::shared_ptr<const ComputedStyle> style;
+    std::vector<uint32_t> positional;  // positional rules that matched
+    uint32_t share_class;
+    const Element* element; // compared with, as fingerprints may collide
+  };
+
+  struct Frame {
+    const Element* element;
+    std::shared_ptr<const ComputedStyle> style;
+    uint32_t share_class;
+  };
+
+  detail::Interner* names_;
+  std::deque<Selector> selectors_;  // stable, the indexes view their strings
+  std::vector<Rule> rules_;
+  std::unordered_map<std::string_view, std::vector<uint32_t>> by_id_;     // views into selectors_
+  std::unordered_map<std::string_view, std::vector<uint32_t>> by_class_;
+  std::unordered_map<Key, std::vector<uint32_t>> by_type_;
+  std::vector<uint32_t> universal_;
+  std::vector<Key> tested_keys_;  // attributes selectors test, sorted
+  std::unordered_map<std::string, hiweb::CSS> inline_styles_;
+
+  // Per resolve().
+  SelectorFilter filter_;
+  std::vector<Frame> frames_;
+  std::vector<uint32_t> candidates_;
+  std::vector<uint32_t> positional_;
+  std::vector<Match> matches_;
+  std::vector<Declared> declared_;
+  std::unordered_map<ShareKey, Shared, ShareKeyHash> shared_;
+  uint32_t share_classes_ = 0;
+
+public:
+  explicit StyleResolver(detail::Interner& names = detail::Interner::global());
+
+  // Adds the rules of `sheet` after those of the stylesheets added before.
+  void addStylesheet(const hiweb::CSS& sheet);
+
+  Styles resolve(const Tag& root, const StyleOptions& options = {});
+  Styles resolve(const DOM& dom, const StyleOptions& options = {});
+
+private:
+  void resolveSubtree(const Tag& root, Styles& styles, const StyleOptions& options);
+  Frame resolveElement(const Element& element, const Frame* parent, const StyleOptions& options, bool& shared);
+  void collectCandidates(const Element& element);
+  void addCandidates(const std::vector<uint32_t>& rules);
+  const hiweb::CSS* inlineStyle(const Element& element);
+  std::shared_ptr<const ComputedStyle> cascade(const Element& element, const ComputedStyle* parent);
+  uint64_t fingerprint(const Element& element) const noexcept;
+  bool sameForRules(const Element& left, const Element& right) const noexcept;
+  bool isInherited(PropertyId property) const;
+}; // class StyleResolver
+
+} // namespace hi
+#endif // HI_STYLE_H
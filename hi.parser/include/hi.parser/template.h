@@ -0,0 +1,103 @@
+#ifndef HI_TEMPLATE_H
+#define HI_TEMPLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hi.parser/html5.h"
+#include "hi.parser/serializer.h"
+
+namespace hi {
+
+
+// A page compiled once into the bytes the serializer would write for it,
+// cut at its holes. Rendering copies the static bytes and writes a value for
+// every hole, so its cost beyond the copy is that of the values alone.
+//
+// Holes are written into text and attribute values of the tree they are
+// compiled from: {{name}} takes a value that is escaped for where it is,
+// {{{name}}} in text takes markup that is written as is. In <script>,
+// <style> and the other raw text elements values are written as is, as the
+// serializer writes their text, but a value that would end the element,
+// "</script" in any case, alone or with the bytes around it, is refused. A
+// name may be used any number of times; comments and unterminated braces
+// are left as they are.
+//
+//   Template page = Template::s_parse("<title>{{title}}</title><p class=\"{{kind}}\">{{{body}}}</p>");
+//   const std::string_view values[] = {"A & B", "note", "<b>hi</b>"};  // in order of getHoleName()
+//   std::string html = page.render(values);
+class Template
+{
+public:
+  enum class HoleType : unsigned char {
+    Text,       // escaped as text
+    Attribute,  // escaped as an attribute value
+    Raw,        // as is: the text of a raw text element
+    Markup,     // as is: {{{name}}} in text
+  };
+
+  static constexpr uint32_t kNoHole = 0xFFFFFFFFu;
+
+  // Static bytes followed by a hole; the last one of a program has none.
+  struct Instruction {
+    uint32_t offset;  // into getStaticBytes()
+    uint32_t size;
+    uint32_t hole;    // index into the values, or kNoHole
+    HoleType type;
+    Tag::Native element = 0;  // the raw text element a Raw hole is in
+  };
+
+private:
+  std::string bytes_;
+  std::vector<Instruction> program_;
+  std::vector<std::string> holes_;
+
+public:
+  // Compiles the subtree of `root`, or a whole document with its doctype,
+  // as Serializer::write would serialize them with `options`.
+  explicit Template(const Tag& root, const SerializeOptions& options = {});
+  explicit Template(const DOM& dom, const SerializeOptions& options = {});
+  // Parses `html` into a document and compiles that.
+  static Template s_parse(std::string_view html, const SerializeOptions& options = {});
+
+  // Holes are numbered by their first use in document order.
+  std::size_t getHoleCount() const noexcept { return holes_.size(); }
+  const std::string& getHoleName(std::size_t hole) const { return holes_.at(hole); }
+  std::optional<std::size_t> findHole(std::string_view name) const noexcept;
+
+  std::string_view getStaticBytes() const noexcept { return bytes_; }
+  std::span<const Instruction> getProgram() const noexcept { return program_; }
+
+  // Appends the page with `values[i]` in hole i; throws
+  // exception::InvalidTemplate when there are fewer values than holes or a
+  // value would end its raw text element.
+  void render(std::span<const std::string_view> values, std::string& out) const;
+  std::string render(std::span<const std::string_view> values) const;
+  // See also Serializer::write(const Template&, ...) for output sinks.
+
+private:
+  Template() = default;
+  void compile(const std::function<void(Serializer&)>& write);
+  // Writes `text` through `serializer`, leaving out its holes: the bytes
+  // before each go out with a flush, the hole becomes an instruction.
+  // `element` is the raw text element Raw text belongs to.
+  void compileText(Serializer& serializer, std::string_view text, HoleType type, Tag::Native element = 0);
+  // Ends the static bytes written so far with `hole`.
+  void addInstruction(uint32_t hole, HoleType type, Tag::Native element = 0);
+  uint32_t addHole(std::string_view name);
+  void checkValues(std::span<const std::string_view> values) const;
+  // Throws if "</" and the element's name would come out around hole
+  // `instruction` with `values` in place.
+  void checkRawValue(std::size_t instruction, std::span<const std::string_view> values) const;
+
+  friend class Serializer;
+}; // class Template
+
+} // namespace hi
+#endif // HI_TEMPLATE_H
@@ -0,0 +1,55 @@
+#ifndef HI_THREAD_POOL_H
+#define HI_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hi {
+
+
+// Fixed set of worker threads that run one indexed job at a time. The thread
+// calling run() takes part in the job, so a pool of size 1 runs everything on
+// the caller and starts no thread at all.
+class ThreadPool
+{
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;      // one job at a time
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(std::size_t)>* body_ = nullptr;
+  std::size_t count_ = 0;
+  std::atomic<std::size_t> next_{0};
+  std::size_t busy_ = 0;      // workers still inside the current job
+  std::size_t generation_ = 0;
+  std::exception_ptr error_;
+  bool stopping_ = false;
+
+public:
+  // `threads` counts the caller; 0 means one per hardware thread.
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t size() const noexcept { return workers_.size() + 1; }
+
+  // Calls body(i) for every i in [0, count), spread over the pool, and returns
+  // once all calls finished. The first exception thrown is rethrown here.
+  void run(std::size_t count, const std::function<void(std::size_t)>& body);
+
+private:
+  void work();
+  void drain(const std::function<void(std::size_t)>& body, std::size_t count) noexcept;
+}; // class ThreadPool
+
+} // namespace hi
+#endif // HI_THREAD_POOL_H
@@ -0,0 +1,74 @@
+#ifndef HI_TOKENIZER_H
+#define HI_TOKENIZER_H
+
+#include <string_view>
+#include <vector>
+
+namespace hi {
+namespace detail {
+
+
+struct Token
+{
+  enum class Kind : unsigned char {
+    StartTag,
+    EndTag,
+    Text,
+    Comment,
+    Doctype,
+    EndOfFile,
+  };
+
+  struct Attribute {
+    std::string_view name;
+    std::string_view value;
+  };
+
+  Kind kind = Kind::EndOfFile;
+  // Tag name as written (not lowercased) for tags, contents for text, comments and doctypes.
+  std::string_view data;
+  bool self_closing = false;
+  // Set when the text or one of the attribute values contains '&'.
+  bool has_references = false;
+  // Valid until the next call to Tokenizer::next().
+  const std::vector<Attribute>* attributes = nullptr;
+}; // struct Token
+
+
+// Splits HTML into tokens without copying: every view in a Token points into
+// the input, which must outlive the tokens. Bulk text and attribute values
+// are skipped with simd::CharScanner. Character references are reported, not
+// decoded. After a <script>, <style>, <textarea>, <title>, <xmp>, <iframe>
+// or <noframes> start tag the following text runs up to the matching end tag.
+class Tokenizer
+{
+  const char* begin_;
+  const char* cursor_;
+  const char* end_;
+  std::string_view raw_text_end_;  // name of the element whose end tag closes raw text
+  std::vector<Token::Attribute> attributes_;
+
+public:
+  explicit Tokenizer(std::string_view input);
+
+  // Fills `token` with the next token; returns false once the input is exhausted.
+  bool next(Token& token);
+
+  std::size_t offset() const noexcept { return static_cast<std::size_t>(cursor_ - begin_); }
+
+private:
+  void readText(Token& token);
+  void readRawText(Token& token);
+  void readMarkupDeclaration(Token& token);
+  void readBogusComment(Token& token, const char* start);
+  void readEndTag(Token& token);
+  void readStartTag(Token& token);
+  void readAttributes(Token& token);
+  void skipWhitespace() noexcept;
+}; // class Tokenizer
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) noexcept;
+
+} // namespace detail
+} // namespace hi
+#endif // HI_TOKENIZER_H
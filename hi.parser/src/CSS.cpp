@@ -0,0 +1,326 @@
+#include "CSS.h"
+#include "hi.parser/perfect_hash.h"
+#include "hi.parser/simd.h"
+#include "hi.parser/tokenizer.h"
+
+#include <algorithm>
+
+namespace hiweb
+{
+
+namespace
+{
+
+using hi::detail::simd::CharScanner;
+
+// Bytes that may end a run, and bytes that start something whose contents
+// must not: strings, comments, escapes and parenthesized groups.
+constexpr CharScanner kRun{';', '{', '}', '"', '\'', '/', '(', '\\'};
+constexpr CharScanner kParens{'(', ')', '"', '\'', '/', '\\'};
+constexpr CharScanner kBlock{'{', '}', '"', '\'', '/', '\\'};
+
+constexpr std::array<std::string_view, 11> kGroupingRules = {{
+    "media", "supports", "layer", "container", "document", "-moz-document", "scope", "starting-style",
+    "keyframes", "-webkit-keyframes", "-moz-keyframes"
+}};
+
+constexpr bool s_isSpace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+std::string_view s_trim(std::string_view text) noexcept {
+    while (!text.empty() && s_isSpace(text.front()))
+        text.remove_prefix(1);
+    while (!text.empty() && s_isSpace(text.back()))
+        text.remove_suffix(1);
+    return text;
+}
+
+// Known properties in an open-addressing table built at compile time; the
+// names are too alike for hi::detail::PerfectHash ("min-width", "max-width").
+constexpr std::size_t kPropertySlots = 512;
+constexpr uint16_t kNoProperty = 0xFFFF;
+
+constexpr uint32_t s_hash(std::string_view name) noexcept {
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+        hash = (hash ^ static_cast<unsigned char>(hi::detail::toLowerAscii(c))) * 16777619u;
+    return hash;
+}
+
+constexpr std::array<uint16_t, kPropertySlots> s_makePropertyTable() {
+    static_assert(cssProperties.size() < kPropertySlots / 2, "keep the property table at most half full");
+    std::array<uint16_t, kPropertySlots> slots{};
+    for (auto& slot : slots)
+        slot = kNoProperty;
+    for (std::size_t i = 0; i < cssProperties.size(); ++i) {
+        std::size_t slot = s_hash(cssProperties[i]) & (kPropertySlots - 1);
+        while (slots[slot] != kNoProperty)
+            slot = (slot + 1) & (kPropertySlots - 1);
+        slots[slot] = static_cast<uint16_t>(i);
+    }
+    return slots;
+}
+
+constexpr auto kPropertyTable = s_makePropertyTable();
+
+std::optional<CSS::PropertyId> s_findKnownProperty(std::string_view name) noexcept {
+    for (std::size_t slot = s_hash(name) & (kPropertySlots - 1); kPropertyTable[slot] != kNoProperty; slot = (slot + 1) & (kPropertySlots - 1)) {
+        if (hi::detail::equalsIgnoreCase(cssProperties[kPropertyTable[slot]], name))
+            return kPropertyTable[slot];
+    }
+    return std::nullopt;
+}
+
+// Custom properties ("--x") are case-sensitive; other names are not, and
+// the rare ones written with capitals are lowercased into `buffer`.
+std::string_view s_normalize(std::string_view name, std::string& buffer) {
+    if (name.starts_with("--") || std::none_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; }))
+        return name;
+    buffer.assign(name);
+    std::transform(buffer.begin(), buffer.end(), buffer.begin(), hi::detail::toLowerAscii);
+    return buffer;
+}
+
+} // namespace
+
+
+CSSTokenizer::CSSTokenizer(std::string_view input) noexcept
+    : begin_(input.data()), cursor_(input.data()), end_(input.data() + input.size())
+{}
+
+bool CSSTokenizer::next(Token& token) noexcept {
+    skipSpacesAndComments();
+    if (cursor_ == end_)
+        return false;
+
+    const char* start = cursor_;
+    const char* p = cursor_;
+    token.end = '\0';
+    while ((p = kRun.findNear(p, end_)) != end_) {
+        const char c = *p;
+        if (c == '"' || c == '\'') {
+            p = skipString(p);
+        } else if (c == '/') {
+            p = p + 1 != end_ && p[1] == '*' ? skipComment(p) : p + 1;
+        } else if (c == '(') {
+            p = skipParens(p);
+        } else if (c == '\\') {
+            p = p + 2 < end_ ? p + 2 : end_;
+        } else {
+            token.end = c;
+            break;
+        }
+    }
+
+    cursor_ = p == end_ ? end_ : p + 1;
+    while (p != start && s_isSpace(p[-1]))
+        --p;
+    token.text = std::string_view(start, static_cast<std::size_t>(p - start));
+    return true;
+}
+
+void CSSTokenizer::skipBlock() noexcept {
+    std::size_t depth = 1;
+    const char* p = cursor_;
+    while ((p = kBlock.findNear(p, end_)) != end_) {
+        const char c = *p;
+        if (c == '{') {
+            ++depth;
+            ++p;
+        } else if (c == '}') {
+            ++p;
+            if (--depth == 0)
+                break;
+        } else if (c == '"' || c == '\'') {
+            p = skipString(p);
+        } else if (c == '/') {
+            p = p + 1 != end_ && p[1] == '*' ? skipComment(p) : p + 1;
+        } else {
+            p = p + 2 < end_ ? p + 2 : end_;
+        }
+    }
+    cursor_ = p;
+}
+
+void CSSTokenizer::skipSpacesAndComments() noexcept {
+    for (;;) {
+        while (cursor_ != end_ && s_isSpace(*cursor_))
+            ++cursor_;
+        if (end_ - cursor_ < 2 || cursor_[0] != '/' || cursor_[1] != '*')
+            return;
+        cursor_ = skipComment(cursor_);
+    }
+}
+
+// A string ends at its closing quote or, unterminated, before a newline.
+const char* CSSTokenizer::skipString(const char* p) const noexcept {
+    const char quote = *p++;
+    while (p != end_) {
+        if (*p == quote)
+            return p + 1;
+        if (*p == '\n')
+            return p;
+        p += *p == '\\' && p + 1 != end_ ? 2 : 1;
+    }
+    return end_;
+}
+
+const char* CSSTokenizer::skipComment(const char* p) const noexcept {
+    const std::string_view rest(p + 2, static_cast<std::size_t>(end_ - p - 2));
+    const std::size_t close = rest.find("*/");
+    return close == std::string_view::npos ? end_ : rest.data() + close + 2;
+}
+
+const char* CSSTokenizer::skipParens(const char* p) const noexcept {
+    std::size_t depth = 0;
+    while ((p = kParens.findNear(p, end_)) != end_) {
+        const char c = *p;
+        if (c == '(') {
+            ++depth;
+            ++p;
+        } else if (c == ')') {
+            ++p;
+            if (--depth == 0)
+                return p;
+        } else if (c == '"' || c == '\'') {
+            p = skipString(p);
+        } else if (c == '/') {
+            p = p + 1 != end_ && p[1] == '*' ? skipComment(p) : p + 1;
+        } else {
+            p = p + 2 < end_ ? p + 2 : end_;
+        }
+    }
+    return end_;
+}
+
+
+CSS::CSS(std::string source, hi::detail::Interner& names)
+    : source_(std::move(source)), names_(&names)
+{
+    parse();
+}
+
+CSS CSS::s_fromDeclarations(std::string declarations, hi::detail::Interner& names) {
+    CSS css(std::string(), names);
+    css.source_ = std::move(declarations);
+    CSSTokenizer tokenizer(css.source_);
+    css.parseDeclarations(tokenizer, {}, kNone);
+    return css;
+}
+
+// Top level and grouping at-rule bodies hold rules; a run ending in '{'
+// opens one, and its declarations are read right away, so the rules'
+// declarations come out contiguous and in source order.
+void CSS::parse() {
+    CSSTokenizer tokenizer(source_);
+    CSSTokenizer::Token token;
+    std::vector<uint32_t> groups;
+    const auto group = [&groups] { return groups.empty() ? kNone : groups.back(); };
+
+    while (tokenizer.next(token)) {
+        const std::string_view text = token.text;
+        if (token.end == '}') {
+            if (!groups.empty())
+                groups.pop_back();
+            continue;
+        }
+
+        if (!text.empty() && text.front() == '@') {
+            std::size_t end = 1;
+            while (end < text.size() && !s_isSpace(text[end]) && text[end] != '(' && text[end] != '"' && text[end] != '\'')
+                ++end;
+            const std::string_view name = text.substr(1, end - 1);
+            at_rules_.push_back({slice(name), slice(s_trim(text.substr(end))), group()});
+            const auto index = static_cast<uint32_t>(at_rules_.size() - 1);
+            if (token.end == '{') {
+                const bool grouping = std::any_of(kGroupingRules.begin(), kGroupingRules.end(),
+                    [name](std::string_view rule) { return hi::detail::equalsIgnoreCase(rule, name); });
+                if (grouping)
+                    groups.push_back(index);
+                else
+                    parseDeclarations(tokenizer, {}, index);
+            }
+            continue;
+        }
+
+        if (token.end == '{') {
+            if (text.empty())
+                tokenizer.skipBlock();
+            else
+                parseDeclarations(tokenizer, slice(text), group());
+        }
+        // Anything else outside a block is not a rule and is dropped.
+    }
+}
+
+// Nested blocks inside a declaration block (CSS nesting) are skipped.
+void CSS::parseDeclarations(CSSTokenizer& tokenizer, CSSSlice selector, uint32_t group) {
+    const auto first = static_cast<uint32_t>(declarations_.size());
+    CSSTokenizer::Token token;
+    while (tokenizer.next(token)) {
+        if (token.end == '{') {
+            tokenizer.skipBlock();
+            continue;
+        }
+        addDeclaration(token.text);
+        if (token.end != ';')
+            break;
+    }
+    rules_.emplace_back(selector, first, static_cast<uint32_t>(declarations_.size()) - first, group);
+}
+
+void CSS::addDeclaration(std::string_view text) {
+    const std::size_t colon = text.find(':');
+    if (colon == std::string_view::npos)
+        return;
+    const std::string_view name = s_trim(text.substr(0, colon));
+    if (name.empty())
+        return;
+
+    std::string_view value = s_trim(text.substr(colon + 1));
+    bool important = false;
+    if (const std::size_t bang = value.rfind('!'); bang != std::string_view::npos
+            && hi::detail::equalsIgnoreCase(s_trim(value.substr(bang + 1)), "important")) {
+        important = true;
+        value = s_trim(value.substr(0, bang));
+    }
+    declarations_.push_back({s_getProperty(name, *names_), important, slice(value)});
+}
+
+CSSSlice CSS::slice(std::string_view text) const noexcept {
+    return {static_cast<uint32_t>(text.data() - source_.data()), static_cast<uint32_t>(text.size())};
+}
+
+std::string_view CSS::getPropertyName(PropertyId property) const {
+    if (property < kCustomBase)
+        return cssProperties[property];
+    return names_->name(property - kCustomBase).value_or(std::string_view());
+}
+
+std::size_t CSS::getMemoryUsage() const noexcept {
+    return sizeof(*this) + source_.capacity() + rules_.capacity() * sizeof(CSSRule)
+        + declarations_.capacity() * sizeof(CSSDeclaration) + at_rules_.capacity() * sizeof(CSSAtRule);
+}
+
+std::optional<CSS::PropertyId> CSS::s_findProperty(std::string_view name, const hi::detail::Interner& names) {
+    if (!name.starts_with("--")) {
+        if (auto known = s_findKnownProperty(name))
+            return known;
+    }
+    std::string buffer;
+    if (auto id = names.find(s_normalize(name, buffer)))
+        return kCustomBase + *id;
+    return std::nullopt;
+}
+
+CSS::PropertyId CSS::s_getProperty(std::string_view name, hi::detail::Interner& names) {
+    if (!name.starts_with("--")) {
+        if (auto known = s_findKnownProperty(name))
+            return *known;
+    }
+    std::string buffer;
+    return kCustomBase + names.intern(s_normalize(name, buffer));
+}
+
+} // namespace hiweb
@@ -0,0 +1,75 @@
+#include "hi.parser/arena.h"
+
+#include <algorithm>
+
+namespace hi
+{
+namespace detail
+{
+
+Arena::Arena(std::size_t block_size) noexcept
+  : cursor_(nullptr), end_(nullptr), blocks_(nullptr), finalizers_(nullptr),
+    next_block_size_(std::clamp(block_size, sizeof(Block) * 4, kMaxBlockSize)), capacity_(0)
+{}
+
+Arena::Arena(void* initial_buffer, std::size_t initial_size, std::size_t block_size) noexcept
+  : Arena(block_size)
+{
+  cursor_ = static_cast<char*>(initial_buffer);
+  end_ = cursor_ + initial_size;
+}
+
+Arena::~Arena() {
+  for (Finalizer* f = finalizers_; f != nullptr; f = f->next)
+    f->destroy(f->object);
+
+  Block* block = blocks_;
+  while (block != nullptr) {
+    Block* prev = block->prev;
+    ::operator delete(block);
+    block = prev;
+  }
+}
+
+void* Arena::allocateSlow(std::size_t size, std::size_t align) {
+  const std::size_t needed = sizeof(Block) + size + align;
+
+  // Oversized requests get a dedicated block so the current one keeps serving small allocations.
+  if (needed > next_block_size_ / 2 && cursor_ != nullptr) {
+    auto* block = static_cast<Block*>(::operator new(needed));
+    block->size = needed;
+    if (blocks_ != nullptr) {
+      block->prev = blocks_->prev;
+      blocks_->prev = block;
+    } else {
+      block->prev = nullptr;
+      blocks_ = block;
+    }
+    capacity_ += needed;
+    auto start = reinterpret_cast<std::uintptr_t>(block + 1);
+    return reinterpret_cast<void*>((start + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1));
+  }
+
+  const std::size_t block_size = std::max(next_block_size_, needed);
+  auto* block = static_cast<Block*>(::operator new(block_size));
+  block->prev = blocks_;
+  block->size = block_size;
+  blocks_ = block;
+  capacity_ += block_size;
+  next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+
+  cursor_ = reinterpret_cast<char*>(block + 1);
+  end_ = reinterpret_cast<char*>(block) + block_size;
+  return allocate(size, align);
+}
+
+void Arena::registerFinalizer(void (*destroy)(void*), void* object) {
+  auto* finalizer = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+  finalizer->destroy = destroy;
+  finalizer->object = object;
+  finalizer->next = finalizers_;
+  finalizers_ = finalizer;
+}
+
+} // namespace detail
+} // namespace hi
@@ -0,0 +1,477 @@
+#include "hi.parser/diff.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+
+namespace hi
+{
+
+namespace
+{
+
+constexpr auto kIdKey = static_cast<detail::Attribute::Key>(Tag::Global::Id);
+// Old children looked at past the last match when pairing children by
+// type; beyond it, a long run of removed siblings turns into a remove and
+// an insert rather than a match.
+constexpr std::size_t kLookahead = 32;
+
+// Ids that occur exactly once in the subtree; repeated ones map to nullptr.
+std::unordered_map<std::string_view, const detail::HTML5Element*> s_uniqueIds(const detail::HTML5Element& root) {
+  std::unordered_map<std::string_view, const detail::HTML5Element*> ids;
+  for (const detail::HTML5Element& element : detail::ElementRange(detail::DepthFirstIterator(const_cast<detail::HTML5Element*>(&root)))) {
+    if (const detail::Attribute* id = element.findAttr(kIdKey)) {
+      auto [it, inserted] = ids.try_emplace(id->value(), &element);
+      if (!inserted)
+        it->second = nullptr;
+    }
+  }
+  return ids;
+}
+
+void s_appendJSON(std::string& out, std::string_view text) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+void s_appendPath(std::string& out, const std::vector<uint32_t>& path) {
+  out += '[';
+  for (std::size_t i = 0; i < path.size(); ++i) {
+    if (i != 0)
+      out += ',';
+    out += std::to_string(path[i]);
+  }
+  out += ']';
+}
+
+// Positions in `values` of a longest strictly increasing subsequence.
+std::vector<std::size_t> s_longestIncreasing(const std::vector<uint32_t>& values) {
+  std::vector<std::size_t> tails;      // per length, the position ending the best run
+  std::vector<std::size_t> previous(values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), values[i], [&](std::size_t tail, uint32_t value) { return values[tail] < value; });
+    previous[i] = it == tails.begin() ? values.size() : *(it - 1);
+    if (it == tails.end())
+      tails.push_back(i);
+    else
+      *it = i;
+  }
+  std::vector<std::size_t> run(tails.size());
+  for (std::size_t i = tails.empty() ? values.size() : tails.back(), k = tails.size(); k-- > 0; i = previous[i])
+    run[k] = i;
+  return run;
+}
+
+} // namespace
+
+
+void EditScript::apply(Tag& root) const {
+  if (document_)
+    throw exception::Error("Edit script was made from DOMs");
+  for (const Edit& edit : edits_)
+    applyTo(*root.element_, edit.path, edit, root);
+}
+
+void EditScript::apply(DOM& dom) const {
+  if (!document_)
+    throw exception::Error("Edit script was made from Tags");
+  for (const Edit& edit : edits_) {
+    if (edit.path.empty() || edit.path[0] > 1)
+      throw exception::Error("Edit script path does not start at <head> or <body>");
+    Tag& root = edit.path[0] == 0 ? dom.head : dom.body;
+    applyTo(*root.element_, std::span(edit.path).subspan(1), edit, root);
+  }
+}
+
+void EditScript::applyTo(Tag::Element& root, std::span<const uint32_t> path, const Edit& edit, const Tag& owner) const {
+  const auto resolve = [&root](std::span<const uint32_t> steps) {
+    Tag::Element* element = &root;
+    for (uint32_t step : steps) {
+      const auto children = element->getChildren();
+      if (step >= children.size())
+        throw exception::Error("Edit script path does not fit the tree");
+      element = children[step];
+    }
+    return element;
+  };
+  const auto checkIndex = [](const Tag::Element& parent, uint32_t index) {
+    if (index > parent.getChildren().size())
+      throw exception::Error("Edit script index does not fit the tree");
+  };
+
+  Tag::Element* element = resolve(path);
+  switch (edit.op) {
+    case Edit::Op::Insert: {
+      checkIndex(*element, edit.index);
+      const Tag child = edit.subtree->toTag(0, owner);
+      element->insertChild(child.element_, edit.index);
+      break;
+    }
+    case Edit::Op::Remove:
+      if (element == &root)
+        throw exception::Error("Edit script removes the root");
+      element->getParent()->removeChild(element);
+      break;
+    case Edit::Op::Move: {
+      if (element == &root)
+        throw exception::Error("Edit script moves the root");
+      element->getParent()->removeChild(element);
+      Tag::Element* parent = resolve(std::span(edit.to).subspan(document_ ? 1 : 0));
+      checkIndex(*parent, edit.index);
+      parent->insertChild(element, edit.index);
+      break;
+    }
+    case Edit::Op::SetAttr:
+      element->setAttr(edit.name, edit.value);
+      break;
+    case Edit::Op::RemoveAttr:
+      element->removeAttr(edit.name);
+      break;
+    case Edit::Op::SetType:
+      element->setType(Tag::s_getType(edit.name, element->getDocument()->getNames()));
+      break;
+    case Edit::Op::SetText:
+      element->setText(edit.value);
+      break;
+  }
+}
+
+std::string EditScript::toJSON() const {
+  static constexpr std::string_view kOps[] = {"insert", "remove", "move", "setAttr", "removeAttr", "setType", "setText"};
+  std::string json = "[";
+  for (const Edit& edit : edits_) {
+    if (json.size() > 1)
+      json += ",\n";
+    json += "{\"op\":\"";
+    json += kOps[static_cast<std::size_t>(edit.op)];
+    json += "\",\"path\":";
+    s_appendPath(json, edit.path);
+    switch (edit.op) {
+      case Edit::Op::Insert:
+        json += ",\"index\":" + std::to_string(edit.index) + ",\"html\":";
+        s_appendJSON(json, edit.subtree->toString());
+        break;
+      case Edit::Op::Move:
+        json += ",\"to\":";
+        s_appendPath(json, edit.to);
+        json += ",\"index\":" + std::to_string(edit.index);
+        break;
+      case Edit::Op::SetAttr:
+        json += ",\"name\":";
+        s_appendJSON(json, edit.name);
+        json += ",\"value\":";
+        s_appendJSON(json, edit.value);
+        break;
+      case Edit::Op::RemoveAttr:
+      case Edit::Op::SetType:
+        json += ",\"name\":";
+        s_appendJSON(json, edit.name);
+        break;
+      case Edit::Op::SetText:
+        json += ",\"value\":";
+        s_appendJSON(json, edit.value);
+        break;
+      case Edit::Op::Remove:
+        break;
+    }
+    json += '}';
+  }
+  return json + "]";
+}
+
+
+EditScript TreeDiff::diff(const Tag& from, const Tag& to) {
+  EditScript script;
+  document_ = to.document_;
+  same_names_ = &from.document_->getNames() == &to.document_->getNames();
+  diffRoots(*from.element_, *to.element_, {}, script);
+  document_.reset();
+  return script;
+}
+
+EditScript TreeDiff::diff(const DOM& from, const DOM& to) {
+  EditScript script;
+  script.document_ = true;
+  document_ = to.head.document_;
+  same_names_ = &from.head.document_->getNames() == &to.head.document_->getNames();
+  diffRoots(*from.head.element_, *to.head.element_, {0}, script);
+  diffRoots(*from.body.element_, *to.body.element_, {1}, script);
+  document_.reset();
+  return script;
+}
+
+void TreeDiff::diffRoots(const Element& from, const Element& to, const std::vector<uint32_t>& prefix, EditScript& script) {
+  nodes_.clear();
+  old_ids_.clear();
+  matches_.clear();
+  mirror(from);
+  matches_.reserve(nodes_.size());
+  match(to);
+  place(to, prefix, script);
+  removeUnmatched(prefix, script);
+}
+
+// Node 0 is the root; the others follow in document order.
+void TreeDiff::mirror(const Element& root) {
+  std::vector<uint32_t> open;   // ancestors of the element visited
+  for (const Element& element : detail::ElementRange(detail::DepthFirstIterator(const_cast<Element*>(&root)))) {
+    const auto node = static_cast<uint32_t>(nodes_.size());
+    while (!open.empty() && nodes_[open.back()].element != element.getParent())
+      open.pop_back();
+    uint32_t parent = kNone, position = 0;
+    if (!open.empty()) {
+      parent = open.back();
+      position = static_cast<uint32_t>(nodes_[parent].children.size());
+      nodes_[parent].children.push_back(node);
+    }
+    nodes_.push_back({&element, nullptr, parent, position, {}});
+    open.push_back(node);
+    if (const detail::Attribute* id = element.findAttr(kIdKey)) {
+      auto [it, inserted] = old_ids_.try_emplace(id->value(), node);
+      if (!inserted)
+        it->second = kNone;
+    }
+  }
+}
+
+// Roots always match, and unique ids of the same type wherever they are.
+// Then, top-down over the new tree, children of matched parents pair up
+// with old children by type in order. An id match below a new element
+// that matched nothing is dropped: that element is inserted whole.
+void TreeDiff::match(const Element& to) {
+  setMatch(0, to);
+  for (const auto& [id, element] : s_uniqueIds(to)) {
+    if (element == nullptr || element == &to)
+      continue;
+    const auto it = old_ids_.find(id);
+    if (it == old_ids_.end() || it->second == kNone || it->second == 0 || !sameType(*nodes_[it->second].element, *element))
+      continue;
+    setMatch(it->second, *element);
+  }
+
+  for (const Element& element : detail::ElementRange(detail::DepthFirstIterator(const_cast<Element*>(&to)))) {
+    const auto it = matches_.find(&element);
+    if (it == matches_.end())
+      continue;
+    if (&element != &to && matches_.find(element.getParent()) == matches_.end()) {
+      nodes_[it->second].target = nullptr;
+      matches_.erase(it);
+      continue;
+    }
+    matchChildren(element);
+  }
+}
+
+void TreeDiff::matchChildren(const Element& parent) {
+  const std::vector<uint32_t>& candidates = nodes_[matches_.at(&parent)].children;
+  std::size_t next = 0;
+  for (const Element* child : parent.getChildren()) {
+    if (matches_.count(child) != 0)
+      continue;
+    const std::size_t end = std::min(candidates.size(), next + kLookahead);
+    for (std::size_t i = next; i < end; ++i) {
+      const Node& candidate = nodes_[candidates[i]];
+      if (candidate.target == nullptr && sameType(*candidate.element, *child)) {
+        setMatch(candidates[i], *child);
+        next = i + 1;
+        break;
+      }
+    }
+  }
+}
+
+void TreeDiff::setMatch(uint32_t node, const Element& target) {
+  nodes_[node].target = &target;
+  matches_[&target] = node;
+}
+
+void TreeDiff::place(const Element& root, const std::vector<uint32_t>& prefix, EditScript& script) {
+  if (!sameType(*nodes_[0].element, root)) {
+    script.edits_.push_back({Edit::Op::SetType, prefix, {}, 0, Tag::s_getName(root.getType(), root.getDocument()->getNames()), {}, nullptr});
+  }
+  std::vector<uint32_t> pending{0};
+  while (!pending.empty()) {
+    const uint32_t node = pending.back();
+    pending.pop_back();
+    const Element& target = *nodes_[node].target;
+    diffAttrs(node, target, prefix, script);
+    placeChildren(node, target, prefix, script);
+    const auto& children = nodes_[node].children;
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      if (nodes_[*it].element != nullptr && nodes_[*it].target != nullptr && nodes_[*it].target->getParent() == &target)
+        pending.push_back(*it);
+    }
+  }
+}
+
+// Children already under the node that keep their relative order (a
+// longest increasing run of their positions) stay; the other matched
+// children move in and new ones are inserted around them. Children that
+// matched nothing, or that belong to another parent, are left in between
+// for removeUnmatched() and later moves.
+void TreeDiff::placeChildren(uint32_t node, const Element& target, const std::vector<uint32_t>& prefix, EditScript& script) {
+  const auto targets = target.getChildren();
+  std::vector<uint32_t> positions;
+  std::vector<std::size_t> local;    // index into targets of each entry of positions
+  for (std::size_t i = 0; i < targets.size(); ++i) {
+    const auto it = matches_.find(targets[i]);
+    if (it != matches_.end() && nodes_[it->second].parent == node) {
+      positions.push_back(nodes_[it->second].position);
+      local.push_back(i);
+    }
+  }
+  std::vector<bool> stays(targets.size(), false);
+  for (std::size_t i : s_longestIncreasing(positions))
+    stays[local[i]] = true;
+
+  uint32_t cursor = 0;
+  for (std::size_t i = 0; i < targets.size(); ++i) {
+    const auto it = matches_.find(targets[i]);
+    if (it == matches_.end()) {
+      const auto inserted = static_cast<uint32_t>(nodes_.size());
+      nodes_.push_back({nullptr, targets[i], kNone, 0, {}});
+      attach(inserted, node, cursor);
+      script.edits_.push_back({Edit::Op::Insert, pathOf(node, prefix), {}, cursor, {}, {},
+        std::make_shared<const FrozenDOM>(Tag(document_, const_cast<Element*>(targets[i])))});
+      ++cursor;
+      continue;
+    }
+    const uint32_t child = it->second;
+    if (stays[i]) {
+      cursor = nodes_[child].position + 1;
+      continue;
+    }
+    std::vector<uint32_t> from = pathOf(child, prefix);
+    if (nodes_[child].parent == node && nodes_[child].position < cursor)
+      --cursor;
+    detach(child);
+    attach(child, node, cursor);
+    script.edits_.push_back({Edit::Op::Move, std::move(from), pathOf(node, prefix), cursor, {}, {}, nullptr});
+    ++cursor;
+  }
+}
+
+// What matched nothing is now the only thing between and after the placed
+// children; the topmost such nodes go, their subtrees with them.
+void TreeDiff::removeUnmatched(const std::vector<uint32_t>& prefix, EditScript& script) {
+  for (auto node = static_cast<uint32_t>(nodes_.size()); node-- > 1; ) {
+    const Node& current = nodes_[node];
+    if (current.element == nullptr || current.target != nullptr || current.parent == kNone)
+      continue;
+    if (nodes_[current.parent].target == nullptr)
+      continue;
+    script.edits_.push_back({Edit::Op::Remove, pathOf(node, prefix), {}, 0, {}, {}, nullptr});
+    detach(node);
+  }
+}
+
+void TreeDiff::diffAttrs(uint32_t node, const Element& target, const std::vector<uint32_t>& prefix, EditScript& script) {
+  const Element& element = *nodes_[node].element;
+  if (!target.isElement()) {
+    if (!sameText(element, target))
+      script.edits_.push_back({Edit::Op::SetText, pathOf(node, prefix), {}, 0, {}, target.getText(), nullptr});
+    return;
+  }
+  const detail::Interner& old_names = element.getDocument()->getNames();
+  const detail::Interner& new_names = target.getDocument()->getNames();
+  std::optional<std::vector<uint32_t>> path;
+  const auto add = [&](Edit::Op op, std::string_view name, std::string_view value) {
+    if (!path)
+      path = pathOf(node, prefix);
+    script.edits_.push_back({op, *path, {}, 0, std::string(name), std::string(value), nullptr});
+  };
+
+  for (const detail::Attribute& attribute : element.getAllAttrs()) {
+    const bool kept = same_names_
+      ? target.findAttr(attribute.key) != nullptr
+      : target.findAttr(Tag::s_getAttrName(attribute.key, old_names)) != nullptr;
+    if (!kept)
+      add(Edit::Op::RemoveAttr, Tag::s_getAttrName(attribute.key, old_names), {});
+  }
+  for (const detail::Attribute& attribute : target.getAllAttrs()) {
+    const detail::Attribute* old = same_names_
+      ? element.findAttr(attribute.key)
+      : element.findAttr(Tag::s_getAttrName(attribute.key, new_names));
+    if (old == nullptr || old->value() != attribute.value())
+      add(Edit::Op::SetAttr, Tag::s_getAttrName(attribute.key, new_names), attribute.value());
+  }
+}
+
+bool TreeDiff::sameType(const Element& left, const Element& right) const {
+  const auto left_key = left.getTypeKey();
+  const auto right_key = right.getTypeKey();
+  if (same_names_ || left_key < detail::Attribute::kCustomBase || right_key < detail::Attribute::kCustomBase)
+    return left_key == right_key;
+  return Tag::s_getAttrName(left_key, left.getDocument()->getNames()) == Tag::s_getAttrName(right_key, right.getDocument()->getNames());
+}
+
+// Compares chunk by chunk, as ropes of equal text may be cut differently.
+bool TreeDiff::sameText(const Element& left, const Element& right) {
+  if (left.getTextSize() != right.getTextSize())
+    return false;
+  chunks_.clear();
+  left.forEachTextChunk([this](std::string_view chunk) {
+    if (!chunk.empty())
+      chunks_.push_back(chunk);
+  });
+  std::size_t chunk = 0, offset = 0;
+  bool same = true;
+  right.forEachTextChunk([&](std::string_view piece) {
+    while (same && !piece.empty()) {
+      const std::string_view current = chunks_[chunk].substr(offset);
+      const std::size_t size = std::min(piece.size(), current.size());
+      same = piece.substr(0, size) == current.substr(0, size);
+      piece.remove_prefix(size);
+      offset += size;
+      if (offset == chunks_[chunk].size()) {
+        ++chunk;
+        offset = 0;
+      }
+    }
+  });
+  return same;
+}
+
+std::vector<uint32_t> TreeDiff::pathOf(uint32_t node, const std::vector<uint32_t>& prefix) const {
+  std::vector<uint32_t> path;
+  for (; nodes_[node].parent != kNone; node = nodes_[node].parent)
+    path.push_back(nodes_[node].position);
+  path.insert(path.end(), prefix.rbegin(), prefix.rend());
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+void TreeDiff::detach(uint32_t node) {
+  Node& parent = nodes_[nodes_[node].parent];
+  parent.children.erase(parent.children.begin() + nodes_[node].position);
+  for (std::size_t i = nodes_[node].position; i < parent.children.size(); ++i)
+    nodes_[parent.children[i]].position = static_cast<uint32_t>(i);
+  nodes_[node].parent = kNone;
+}
+
+void TreeDiff::attach(uint32_t node, uint32_t parent, uint32_t position) {
+  auto& children = nodes_[parent].children;
+  children.insert(children.begin() + position, node);
+  for (std::size_t i = position; i < children.size(); ++i)
+    nodes_[children[i]].position = static_cast<uint32_t>(i);
+  nodes_[node].parent = parent;
+}
+
+} // namespace hi
@@ -0,0 +1,291 @@
+#include "hi.parser/element_index.h"
+
+#include <algorithm>
+
+namespace hi
+{
+namespace detail
+{
+
+namespace
+{
+
+constexpr auto kIdKey = static_cast<Attribute::Key>(Tag::Global::Id);
+constexpr auto kClassKey = static_cast<Attribute::Key>(Tag::Global::Class);
+
+bool s_isSpace(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// Calls `fn` once for each distinct word of a whitespace-separated list.
+template <typename Fn>
+void s_forEachWord(std::string_view list, Fn&& fn) {
+  std::size_t i = 0;
+  while (i < list.size()) {
+    while (i < list.size() && s_isSpace(list[i]))
+      ++i;
+    const std::size_t start = i;
+    while (i < list.size() && !s_isSpace(list[i]))
+      ++i;
+    if (i == start)
+      continue;
+    const std::string_view word = list.substr(start, i - start);
+    bool repeated = false;
+    for (std::size_t j = 0; j < start && !repeated; ) {
+      while (j < start && s_isSpace(list[j]))
+        ++j;
+      const std::size_t other = j;
+      while (j < start && !s_isSpace(list[j]))
+        ++j;
+      repeated = list.substr(other, j - other) == word;
+    }
+    if (!repeated)
+      fn(word);
+  }
+}
+
+// A root moved under another element stays in its own document's index.
+bool s_isMovedRoot(const HTML5Element& element) noexcept {
+  return element.isRoot() && element.getParent() != nullptr;
+}
+
+bool s_isTop(const HTML5Element* element) noexcept {
+  return element->isRoot() || element->getParent() == nullptr;
+}
+
+// Depth below the nearest root or, off the roots, below the top.
+std::size_t s_depth(const HTML5Element* element) noexcept {
+  std::size_t depth = 0;
+  for (; !s_isTop(element); element = element->getParent())
+    ++depth;
+  return depth;
+}
+
+// Pre-order over `top` and its subtree, leaving out the subtrees of other
+// roots, which belong to their own document's index.
+template <typename Fn>
+void s_forEachIndexed(HTML5Element& top, Fn&& fn) {
+  HTML5Element* element = &top;
+  for (;;) {
+    if (element == &top || !element->isRoot()) {
+      fn(*element);
+      if (!element->getChildren().empty()) {
+        element = element->getChildren().front();
+        continue;
+      }
+    }
+    while (element != &top && element->getNextSibling() == nullptr)
+      element = element->getParent();
+    if (element == &top)
+      return;
+    element = element->getNextSibling();
+  }
+}
+
+} // namespace
+
+
+ElementIndex::ElementIndex(const Document& document) : document_(&document) {
+  for (HTML5Element* root : document.getRoots())
+    s_forEachIndexed(*root, [this](Element& element) { addElement(element); });
+}
+
+void ElementIndex::add(Element& root) {
+  if (s_isMovedRoot(root))
+    return;
+  s_forEachIndexed(root, [this](Element& element) { addElement(element); });
+}
+
+void ElementIndex::remove(Element& root) {
+  Element* const roots[] = {&root};
+  remove(roots);
+}
+
+// Unmarks the elements first, then compacts each list that held one of
+// them in a single pass, so that taking out a large subtree costs every
+// list it touches once instead of once per element.
+void ElementIndex::remove(std::span<Element* const> roots) {
+  for (Element* root : roots)
+    s_unmark(*root);
+  std::vector<List*> compacted;
+  for (Element* root : roots) {
+    if (s_isMovedRoot(*root))
+      continue;
+    s_forEachIndexed(*root, [&](Element& element) {
+      if (!element.isElement())
+        return;
+      compact(types_, s_getKey(element), compacted);
+      for (const Attribute& attribute : element.getAllAttrs()) {
+        if (attribute.key == kIdKey)
+          compact(ids_, attribute.value(), compacted);
+        else if (attribute.key == kClassKey)
+          s_forEachWord(attribute.value(), [&](std::string_view name) { compact(classes_, name, compacted); });
+      }
+    });
+  }
+  for (List* list : compacted)
+    list->compacted = false;
+}
+
+void ElementIndex::s_unmark(Element& root) noexcept {
+  if (!s_isMovedRoot(root))
+    s_forEachIndexed(root, [](Element& element) { element.indexed_ = 0; });
+}
+
+void ElementIndex::addAttr(Element& element, Key key, std::string_view value) {
+  if (key == kIdKey) {
+    if (!value.empty())
+      insert(ids_[value], &element);
+  } else if (key == kClassKey) {
+    s_forEachWord(value, [&](std::string_view name) { insert(classes_[name], &element); });
+  }
+}
+
+void ElementIndex::removeAttr(Element& element, Key key, std::string_view value) {
+  if (key == kIdKey) {
+    erase(ids_, value, &element);
+  } else if (key == kClassKey) {
+    s_forEachWord(value, [&](std::string_view name) { erase(classes_, name, &element); });
+  }
+}
+
+void ElementIndex::changeType(Element& element, Key from, Key to) {
+  if (from == to)
+    return;
+  erase(types_, from, &element);
+  insert(types_[to], &element);
+}
+
+HTML5Element* ElementIndex::getElementById(std::string_view id) {
+  auto it = ids_.find(id);
+  return it == ids_.end() ? nullptr : sorted(it->second).front();
+}
+
+// Starts from the class with the fewest elements and keeps those that
+// have the other classes as well.
+std::vector<HTML5Element*> ElementIndex::getElementsByClassName(std::string_view names) {
+  std::vector<List*> lists;
+  bool missing = false;
+  s_forEachWord(names, [&](std::string_view name) {
+    auto it = classes_.find(name);
+    if (it == classes_.end())
+      missing = true;
+    else
+      lists.push_back(&it->second);
+  });
+  if (missing || lists.empty())
+    return {};
+
+  std::sort(lists.begin(), lists.end(), [](const List* left, const List* right) { return left->elements.size() < right->elements.size(); });
+  const std::span<Element* const> smallest = sorted(*lists.front());
+  if (lists.size() == 1)
+    return {smallest.begin(), smallest.end()};
+
+  const auto before = [this](const Element* left, const Element* right) { return isBefore(left, right); };
+  for (auto it = lists.begin() + 1; it != lists.end(); ++it)
+    sorted(**it);
+  std::vector<Element*> found;
+  for (Element* element : smallest) {
+    const bool all = std::all_of(lists.begin() + 1, lists.end(), [&](const List* list) {
+      return std::binary_search(list->elements.begin(), list->elements.end(), element, before);
+    });
+    if (all)
+      found.push_back(element);
+  }
+  return found;
+}
+
+std::span<HTML5Element* const> ElementIndex::getElementsByTagName(Key type) {
+  auto it = types_.find(type);
+  return it == types_.end() ? std::span<Element* const>() : sorted(it->second);
+}
+
+// Lifts the deeper element to the depth of the other, then both until they
+// are siblings. Elements below different roots come in the order of the
+// document's roots, wherever the roots were moved: the climb stops at them.
+bool ElementIndex::isBefore(const Element* left, const Element* right) const noexcept {
+  if (left == right)
+    return false;
+  std::size_t left_depth = s_depth(left);
+  std::size_t right_depth = s_depth(right);
+  const Element* a = left;
+  const Element* b = right;
+  for (; left_depth > right_depth; --left_depth)
+    a = a->getParent();
+  for (; right_depth > left_depth; --right_depth)
+    b = b->getParent();
+  if (a == b)
+    return b == left;  // an ancestor comes first
+  for (; !s_isTop(a); a = a->getParent(), b = b->getParent()) {
+    if (a->getParent() == b->getParent())
+      return a->getIndex() < b->getIndex();
+  }
+
+  const auto roots = document_->getRoots();
+  return std::find(roots.begin(), roots.end(), a) < std::find(roots.begin(), roots.end(), b);
+}
+
+Attribute::Key ElementIndex::s_getKey(const Element& element) noexcept {
+  return element.getTypeKey();
+}
+
+// Text and comment nodes are not indexed.
+void ElementIndex::addElement(Element& element) {
+  if (!element.isElement())
+    return;
+  element.indexed_ = element.getDocument() == document_ ? 1 : 2;
+  insert(types_[s_getKey(element)], &element);
+  for (const Attribute& attribute : element.getAllAttrs())
+    addAttr(element, attribute.key, attribute.value());
+}
+
+// Appending keeps a list sorted only when the element comes last, which is
+// what walks in document order produce.
+void ElementIndex::insert(List& list, Element* element) {
+  if (list.sorted && !list.elements.empty() && !isBefore(list.elements.back(), element))
+    list.sorted = false;
+  list.elements.push_back(element);
+}
+
+// Sorted lists are searched in document order.
+template <typename Map, typename Name>
+void ElementIndex::erase(Map& lists, const Name& name, Element* element) {
+  auto it = lists.find(name);
+  if (it == lists.end())
+    return;
+  auto& elements = it->second.elements;
+  auto position = it->second.sorted
+    ? std::lower_bound(elements.begin(), elements.end(), element, [this](const Element* left, const Element* right) { return isBefore(left, right); })
+    : std::find(elements.begin(), elements.end(), element);
+  if (position != elements.end() && *position == element)
+    elements.erase(position);
+  if (elements.empty())
+    lists.erase(it);
+}
+
+// Drops the unmarked elements of a list, the first time remove() reaches it.
+template <typename Map, typename Name>
+void ElementIndex::compact(Map& lists, const Name& name, std::vector<List*>& compacted) {
+  auto it = lists.find(name);
+  if (it == lists.end() || it->second.compacted)
+    return;
+  auto& elements = it->second.elements;
+  elements.erase(std::remove_if(elements.begin(), elements.end(), [](const Element* element) { return element->indexed_ == 0; }), elements.end());
+  if (elements.empty()) {
+    lists.erase(it);
+    return;
+  }
+  it->second.compacted = true;
+  compacted.push_back(&it->second);
+}
+
+std::span<HTML5Element* const> ElementIndex::sorted(List& list) {
+  if (!list.sorted) {
+    std::sort(list.elements.begin(), list.elements.end(), [this](const Element* left, const Element* right) { return isBefore(left, right); });
+    list.sorted = true;
+  }
+  return list.elements;
+}
+
+} // namespace detail
+} // namespace hi
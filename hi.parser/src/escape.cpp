@@ -0,0 +1,363 @@
+#include "hi.parser/escape.h"
+#include "hi.parser/entities.h"
+#include "hi.parser/simd.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HI_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define HI_SIMD_X86 0
+#endif
+
+namespace hi
+{
+namespace detail
+{
+
+namespace
+{
+
+// Trie over the named references, built at compile time. Nodes are laid out
+// breadth first, so the children of a node are contiguous and, as the names
+// come sorted, in byte order. The root has a child for about every letter,
+// so the first byte is looked up in a table instead.
+template <std::size_t N>
+class EntityTrie
+{
+  struct Node {
+    char c;
+    uint8_t children;
+    uint16_t first;     // index of the first child
+    uint16_t entity;    // index into kNamedEntities + 1; 0 when no name ends here
+  };
+
+  static_assert(N < UINT16_MAX, "EntityTrie indexes nodes with 16 bits");
+
+  std::array<Node, N> nodes_;
+  std::array<uint16_t, 128> roots_;  // child of the root per ASCII byte, 0 if none
+
+public:
+  template <std::size_t M>
+  constexpr explicit EntityTrie(const std::array<NamedEntity, M>& entities) : nodes_(), roots_() {
+    static_assert(M < UINT16_MAX, "EntityTrie indexes entities with 16 bits");
+    // Each node covers the run of names that share its prefix.
+    struct Range {
+      std::size_t first;
+      std::size_t last;
+    };
+    std::array<Range, N> ranges{};
+    ranges[0] = {0, M};
+    std::size_t count = 1;
+    for (std::size_t node = 0, depth = 0, level_end = 1; node < count; ++node) {
+      if (node == level_end) {
+        ++depth;
+        level_end = count;
+      }
+      std::size_t i = ranges[node].first;
+      const std::size_t last = ranges[node].last;
+      // A name that ends here sorts before the longer ones it prefixes.
+      if (i < last && entities[i].name.size() == depth)
+        nodes_[node].entity = static_cast<uint16_t>(++i);
+      nodes_[node].first = static_cast<uint16_t>(count);
+      while (i < last) {
+        const char c = entities[i].name[depth];
+        std::size_t j = i + 1;
+        while (j < last && entities[j].name[depth] == c)
+          ++j;
+        nodes_[count].c = c;
+        ranges[count++] = {i, j};
+        i = j;
+      }
+      nodes_[node].children = static_cast<uint8_t>(count - nodes_[node].first);
+    }
+    for (std::size_t child = nodes_[0].first; child != nodes_[0].first + nodes_[0].children; ++child)
+      roots_[static_cast<unsigned char>(nodes_[child].c)] = static_cast<uint16_t>(child);
+  }
+
+  // Length of the longest name at the start of `text`; `entity` receives
+  // its index into kNamedEntities.
+  std::size_t match(std::string_view text, std::size_t& entity) const noexcept {
+    if (text.empty() || static_cast<unsigned char>(text[0]) >= roots_.size() || roots_[static_cast<unsigned char>(text[0])] == 0)
+      return 0;
+    std::size_t node = roots_[static_cast<unsigned char>(text[0])], length = 0;
+    if (nodes_[node].entity != 0) {
+      entity = nodes_[node].entity - 1;
+      length = 1;
+    }
+    for (std::size_t i = 1; i < text.size(); ++i) {
+      const Node& current = nodes_[node];
+      std::size_t next = current.first, end = current.first + current.children;
+      while (next != end && nodes_[next].c < text[i])
+        ++next;
+      if (next == end || nodes_[next].c != text[i])
+        break;
+      node = next;
+      if (nodes_[node].entity != 0) {
+        entity = nodes_[node].entity - 1;
+        length = i + 1;
+      }
+    }
+    return length;
+  }
+}; // class EntityTrie
+
+// Distinct prefixes of the sorted names, the root included.
+template <std::size_t M>
+constexpr std::size_t s_trieSize(const std::array<NamedEntity, M>& entities) {
+  std::size_t size = 1;
+  for (std::size_t i = 0; i < M; ++i) {
+    if (i != 0 && !(entities[i - 1].name < entities[i].name))
+      throw "kNamedEntities must be sorted and unique";
+    std::size_t shared = 0;
+    if (i != 0) {
+      const std::string_view previous = entities[i - 1].name;
+      while (shared < previous.size() && shared < entities[i].name.size() && previous[shared] == entities[i].name[shared])
+        ++shared;
+    }
+    size += entities[i].name.size() - shared;
+  }
+  return size;
+}
+
+constexpr EntityTrie<s_trieSize(kNamedEntities)> kEntityTrie(kNamedEntities);
+
+constexpr simd::CharScanner kAmpersand{'&'};
+
+// Per byte, the replacement in each mode; an empty one keeps the byte.
+struct Replacements {
+  std::array<std::string_view, 256> text;
+  std::array<std::string_view, 256> attribute;
+
+  constexpr Replacements() : text(), attribute() {
+    text['&'] = attribute['&'] = "&amp;";
+    text['<'] = attribute['<'] = "&lt;";
+    text['>'] = attribute['>'] = "&gt;";
+    attribute['"'] = "&quot;";
+    attribute['\''] = "&#39;";
+  }
+}; // struct Replacements
+
+constexpr Replacements kReplacements;
+
+// What 0x80-0x9F stand for in numeric references (windows-1252); 0 keeps the code.
+constexpr uint16_t kWindows1252[32] = {
+  0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+  0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178,
+};
+
+inline char* s_put(char* out, std::string_view bytes) noexcept {
+  std::memcpy(out, bytes.data(), bytes.size());
+  return out + bytes.size();
+}
+
+char* s_escapeScalar(const char* p, const char* end, char* out, const std::array<std::string_view, 256>& replacements) noexcept {
+  for (; p != end; ++p) {
+    const std::string_view replacement = replacements[static_cast<unsigned char>(*p)];
+    if (replacement.empty())
+      *out++ = *p;
+    else
+      out = s_put(out, replacement);
+  }
+  return out;
+}
+
+// Copies the bytes of a stored block between the set bits of `mask`, which
+// mark the bytes to replace.
+inline char* s_escapeBlock(const char* p, std::size_t size, uint32_t mask, char* out, const std::array<std::string_view, 256>& replacements) noexcept {
+  std::size_t done = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    const auto i = static_cast<std::size_t>(__builtin_ctz(mask));
+    std::memcpy(out, p + done, i - done);
+    out = s_put(out + (i - done), replacements[static_cast<unsigned char>(p[i])]);
+    done = i + 1;
+  }
+  std::memcpy(out, p + done, size - done);
+  return out + (size - done);
+}
+
+#if HI_SIMD_X86
+
+// The text mode compares against '&' where the attribute mode has the quotes,
+// which keeps one loop for both.
+__attribute__((target("sse4.2")))
+char* s_escapeSSE(const char* p, const char* end, char* out, EscapeMode mode, const std::array<std::string_view, 256>& replacements) noexcept {
+  const bool attribute = mode == EscapeMode::Attribute;
+  const __m128i amp = _mm_set1_epi8('&');
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>');
+  const __m128i quot = _mm_set1_epi8(attribute ? '"' : '&');
+  const __m128i apos = _mm_set1_epi8(attribute ? '\'' : '&');
+  while (end - p >= 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, amp), _mm_cmpeq_epi8(block, lt)),
+      _mm_or_si128(_mm_cmpeq_epi8(block, gt), _mm_or_si128(_mm_cmpeq_epi8(block, quot), _mm_cmpeq_epi8(block, apos))));
+    const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+    if (mask == 0) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), block);
+      out += 16;
+    } else {
+      out = s_escapeBlock(p, 16, mask, out, replacements);
+    }
+    p += 16;
+  }
+  return s_escapeScalar(p, end, out, replacements);
+}
+
+__attribute__((target("avx2")))
+char* s_escapeAVX2(const char* p, const char* end, char* out, EscapeMode mode, const std::array<std::string_view, 256>& replacements) noexcept {
+  const bool attribute = mode == EscapeMode::Attribute;
+  const __m256i amp = _mm256_set1_epi8('&');
+  const __m256i lt = _mm256_set1_epi8('<');
+  const __m256i gt = _mm256_set1_epi8('>');
+  const __m256i quot = _mm256_set1_epi8(attribute ? '"' : '&');
+  const __m256i apos = _mm256_set1_epi8(attribute ? '\'' : '&');
+  while (end - p >= 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, amp), _mm256_cmpeq_epi8(block, lt)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, gt), _mm256_or_si256(_mm256_cmpeq_epi8(block, quot), _mm256_cmpeq_epi8(block, apos))));
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+    if (mask == 0) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), block);
+      out += 32;
+    } else {
+      out = s_escapeBlock(p, 32, mask, out, replacements);
+    }
+    p += 32;
+  }
+  return s_escapeSSE(p, end, out, mode, replacements);
+}
+
+#else
+
+char* s_escapeSSE(const char* p, const char* end, char* out, EscapeMode, const std::array<std::string_view, 256>& replacements) noexcept {
+  return s_escapeScalar(p, end, out, replacements);
+}
+
+char* s_escapeAVX2(const char* p, const char* end, char* out, EscapeMode, const std::array<std::string_view, 256>& replacements) noexcept {
+  return s_escapeScalar(p, end, out, replacements);
+}
+
+#endif // HI_SIMD_X86
+
+void s_appendUTF8(uint32_t code, std::string& out) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xC0 | code >> 6);
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    out += static_cast<char>(0xE0 | code >> 12);
+    out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | code >> 18);
+    out += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+    out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  }
+}
+
+inline bool s_isAlphanumeric(char c) noexcept {
+  return static_cast<unsigned char>((c | 0x20) - 'a') < 26 || static_cast<unsigned char>(c - '0') < 10;
+}
+
+// Decodes the reference after a '&' at `p`; returns where the text goes on,
+// or nullptr when there is no reference and the '&' stays.
+const char* s_decodeReference(const char* p, const char* end, std::string& out, bool attribute) {
+  if (p != end && *p == '#') {
+    const char* digits = p + 1;
+    const bool hex = digits != end && (*digits == 'x' || *digits == 'X');
+    if (hex)
+      ++digits;
+    uint32_t code = 0;
+    const char* q = digits;
+    for (; q != end; ++q) {
+      uint32_t digit;
+      if (static_cast<unsigned char>(*q - '0') < 10)
+        digit = static_cast<uint32_t>(*q - '0');
+      else if (hex && static_cast<unsigned char>((*q | 0x20) - 'a') < 6)
+        digit = static_cast<uint32_t>((*q | 0x20) - 'a' + 10);
+      else
+        break;
+      code = code * (hex ? 16 : 10) + digit;
+      if (code > 0x10FFFF)
+        code = 0x110000;  // stays out of range however many digits follow
+    }
+    if (q == digits)
+      return nullptr;
+    if (code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+      code = 0xFFFD;
+    else if (code >= 0x80 && code <= 0x9F && kWindows1252[code - 0x80] != 0)
+      code = kWindows1252[code - 0x80];
+    s_appendUTF8(code, out);
+    return q != end && *q == ';' ? q + 1 : q;
+  }
+
+  std::string_view value;
+  const std::size_t length = matchNamedEntity(std::string_view(p, static_cast<std::size_t>(end - p)), value);
+  if (length == 0)
+    return nullptr;
+  const char* after = p + length;
+  if (attribute && p[length - 1] != ';' && after != end && (*after == '=' || s_isAlphanumeric(*after)))
+    return nullptr;
+  out.append(value);
+  return after;
+}
+
+} // namespace
+
+
+char* escape(std::string_view text, char* out, EscapeMode mode) noexcept {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  const auto& replacements = mode == EscapeMode::Attribute ? kReplacements.attribute : kReplacements.text;
+  switch (simd::getLevel()) {
+    case simd::Level::AVX2: return s_escapeAVX2(p, end, out, mode, replacements);
+    case simd::Level::SSE42: return s_escapeSSE(p, end, out, mode, replacements);
+    default: return s_escapeScalar(p, end, out, replacements);
+  }
+}
+
+std::string escape(std::string_view text, EscapeMode mode) {
+  std::string escaped(text.size() * kMaxEscapeGrowth, '\0');
+  escaped.resize(static_cast<std::size_t>(escape(text, escaped.data(), mode) - escaped.data()));
+  return escaped;
+}
+
+std::string_view unescape(std::string_view text, std::string& out, bool attribute) {
+  const char* p = text.data();
+  const char* const end = p + text.size();
+  const char* amp = kAmpersand.find(p, end);
+  if (amp == end)
+    return text;
+
+  out.clear();
+  out.reserve(text.size());
+  while (amp != end) {
+    out.append(p, amp);
+    if (const char* next = s_decodeReference(amp + 1, end, out, attribute)) {
+      p = next;
+    } else {
+      out += '&';
+      p = amp + 1;
+    }
+    amp = kAmpersand.find(p, end);
+  }
+  out.append(p, end);
+  return out;
+}
+
+std::size_t matchNamedEntity(std::string_view name, std::string_view& value) noexcept {
+  std::size_t entity = 0;
+  const std::size_t length = kEntityTrie.match(name, entity);
+  if (length != 0)
+    value = kNamedEntities[entity].value;
+  return length;
+}
+
+} // namespace detail
+} // namespace hi
@@ -0,0 +1,419 @@
+#include "hi.parser/frozen.h"
+#include "hi.parser/serializer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hi
+{
+
+namespace
+{
+
+constexpr char kSnapshotMagic[8] = {'H', 'I', 'F', 'R', 'O', 'Z', 'E', 'N'};
+// Written in the writer's byte order; any other value on load means the
+// snapshot comes from a machine of the other endianness.
+constexpr uint32_t kByteOrder = 0x01020304u;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t nodes;
+  uint32_t attributes;
+  uint32_t names;
+  uint32_t string_bytes;
+  uint32_t flags;           // bit 0: frozen from a DOM
+  uint32_t reserved;
+  uint64_t size;            // of the buffer that follows
+  char padding[16];
+};
+static_assert(sizeof(SnapshotHeader) == FrozenDOM::kSnapshotHeaderSize);
+
+SnapshotHeader s_header(const FrozenDOM::Layout& layout) noexcept {
+  SnapshotHeader header{};
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.version = FrozenDOM::kSnapshotVersion;
+  header.byte_order = kByteOrder;
+  header.nodes = layout.nodes;
+  header.attributes = layout.attributes;
+  header.names = layout.names;
+  header.string_bytes = layout.string_bytes;
+  header.flags = layout.document ? 1 : 0;
+  header.size = layout.size();
+  return header;
+}
+
+} // namespace
+
+
+FrozenDOM::FrozenDOM(const Tag& root) : data_(nullptr) {
+  build({root.element_}, false);
+}
+
+FrozenDOM::FrozenDOM(const DOM& dom) : data_(nullptr) {
+  build({dom.head.element_, dom.body.element_}, true);
+}
+
+FrozenDOM::FrozenDOM(const Layout& layout, std::shared_ptr<const void> storage, const std::byte* data) noexcept
+  : layout_(layout), storage_(std::move(storage)), data_(data)
+{}
+
+void FrozenDOM::build(std::initializer_list<const Tag::Element*> roots, bool document) {
+  std::vector<Key> types;
+  std::vector<Index> parents, first_children, next_siblings;
+  std::vector<uint32_t> attribute_ranges;
+  std::vector<Range> text_ranges;
+  std::vector<Attribute> attributes;
+  std::vector<Range> names;
+  std::string strings;
+  std::unordered_map<std::string_view, Key> local_names;
+
+  const auto addString = [&strings](std::string_view bytes) {
+    Range range{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(bytes.size())};
+    strings.append(bytes);
+    return range;
+  };
+  const auto localKey = [&](Key key, const detail::Interner& interner) -> Key {
+    if (key < detail::Attribute::kCustomBase)
+      return key;
+    const std::string_view name = Tag::s_getAttrName(key, interner);
+    auto [it, inserted] = local_names.try_emplace(name, detail::Attribute::kCustomBase + static_cast<Key>(names.size()));
+    if (inserted)
+      names.push_back(addString(name));
+    return it->second;
+  };
+
+  // Open ancestors of the element being visited, with their last child so far.
+  struct Open {
+    const Tag::Element* element;
+    Index index;
+    Index last_child;
+  };
+  std::vector<Open> path;
+  Index previous_root = kNone;
+
+  for (const Tag::Element* root : roots) {
+    path.clear();
+    for (const Tag::Element& element : detail::ElementRange(detail::DepthFirstIterator(const_cast<Tag::Element*>(root)))) {
+      const auto index = static_cast<Index>(types.size());
+      const detail::Interner& interner = element.getDocument()->getNames();
+      while (!path.empty() && path.back().element != element.getParent())
+        path.pop_back();
+
+      const auto type = element.getType();
+      types.push_back(std::holds_alternative<Tag::Native>(type)
+        ? std::get<Tag::Native>(type)
+        : localKey(detail::Attribute::kCustomBase + std::get<Tag::Custom>(type), interner));
+      parents.push_back(path.empty() ? kNone : path.back().index);
+      first_children.push_back(kNone);
+      next_siblings.push_back(kNone);
+
+      if (path.empty()) {
+        if (previous_root != kNone)
+          next_siblings[previous_root] = index;
+        previous_root = index;
+      } else {
+        Open& parent = path.back();
+        if (parent.last_child == kNone)
+          first_children[parent.index] = index;
+        else
+          next_siblings[parent.last_child] = index;
+        parent.last_child = index;
+      }
+
+      attribute_ranges.push_back(static_cast<uint32_t>(attributes.size()));
+      for (const detail::Attribute& attribute : element.getAllAttrs())
+        attributes.push_back({localKey(attribute.key, interner), addString(attribute.value())});
+      Range text{static_cast<uint32_t>(strings.size()), 0};
+      if (!element.isElement()) {
+        element.forEachTextChunk([&strings](std::string_view chunk) { strings.append(chunk); });
+        text.size = static_cast<uint32_t>(strings.size() - text.offset);
+      }
+      text_ranges.push_back(text);
+
+      path.push_back({&element, index, kNone});
+    }
+  }
+  attribute_ranges.push_back(static_cast<uint32_t>(attributes.size()));
+
+  layout_.nodes = static_cast<uint32_t>(types.size());
+  layout_.attributes = static_cast<uint32_t>(attributes.size());
+  layout_.names = static_cast<uint32_t>(names.size());
+  layout_.string_bytes = static_cast<uint32_t>(strings.size());
+  layout_.document = document;
+
+  auto buffer = std::make_shared<std::byte[]>(layout_.size());
+  const auto copy = [&buffer](std::size_t offset, const auto& values) {
+    if (!values.empty())
+      std::memcpy(buffer.get() + offset, values.data(), values.size() * sizeof(values[0]));
+  };
+  copy(layout_.typesOffset(), types);
+  copy(layout_.parentsOffset(), parents);
+  copy(layout_.firstChildrenOffset(), first_children);
+  copy(layout_.nextSiblingsOffset(), next_siblings);
+  copy(layout_.attributeRangesOffset(), attribute_ranges);
+  copy(layout_.textRangesOffset(), text_ranges);
+  copy(layout_.attributesOffset(), attributes);
+  copy(layout_.namesOffset(), names);
+  copy(layout_.stringsOffset(), strings);
+  data_ = buffer.get();
+  storage_ = std::move(buffer);
+}
+
+void FrozenDOM::write(OutputSink& sink) const {
+  const SnapshotHeader header = s_header(layout_);
+  sink.write({reinterpret_cast<const char*>(&header), sizeof(header)});
+  sink.write({reinterpret_cast<const char*>(data_), layout_.size()});
+}
+
+void FrozenDOM::save(const std::string& path) const {
+  const SnapshotHeader header = s_header(layout_);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(data_), static_cast<std::streamsize>(layout_.size()));
+  out.close();
+  if (!out)
+    throw exception::IOError("Cannot write snapshot " + path);
+}
+
+FrozenDOM FrozenDOM::s_fromSnapshot(std::span<const std::byte> bytes, std::shared_ptr<const void> storage) {
+  SnapshotHeader header;
+  if (bytes.size() < sizeof(header))
+    throw exception::InvalidSnapshot("The snapshot is shorter than its header");
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0)
+    throw exception::InvalidSnapshot("Not a FrozenDOM snapshot");
+  if (header.byte_order != kByteOrder)
+    throw exception::InvalidSnapshot("The snapshot was written with the other byte order");
+  // Version 1 predates text and comment nodes and reads as it is.
+  if (header.version == 0 || header.version > kSnapshotVersion)
+    throw exception::InvalidSnapshot("Snapshot version " + std::to_string(header.version) + " is not supported");
+
+  Layout layout;
+  layout.nodes = header.nodes;
+  layout.attributes = header.attributes;
+  layout.names = header.names;
+  layout.string_bytes = header.string_bytes;
+  layout.document = (header.flags & 1) != 0;
+  if (header.size != layout.size() || bytes.size() - sizeof(header) < layout.size())
+    throw exception::InvalidSnapshot("The snapshot size does not match its header");
+
+  const std::byte* data = bytes.data() + sizeof(header);
+  if (reinterpret_cast<std::uintptr_t>(data) % alignof(Attribute) != 0) {
+    auto copy = std::make_shared<std::byte[]>(layout.size());
+    std::memcpy(copy.get(), data, layout.size());
+    data = copy.get();
+    storage = std::move(copy);
+  }
+  return FrozenDOM(layout, std::move(storage), data);
+}
+
+FrozenDOM FrozenDOM::s_load(const std::string& path) {
+#ifndef _WIN32
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw exception::InvalidSnapshot("Cannot open " + path + ": " + std::strerror(errno));
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    throw exception::InvalidSnapshot("Cannot read " + path);
+  }
+  const auto size = static_cast<std::size_t>(info.st_size);
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw exception::InvalidSnapshot("Cannot map " + path + ": " + std::strerror(errno));
+  std::shared_ptr<const void> storage(mapping, [size](const void* address) { ::munmap(const_cast<void*>(address), size); });
+  return s_fromSnapshot({static_cast<const std::byte*>(mapping), size}, std::move(storage));
+#else
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    throw exception::InvalidSnapshot("Cannot open " + path);
+  const auto size = static_cast<std::size_t>(in.tellg());
+  auto bytes = std::make_shared<std::byte[]>(size);
+  in.seekg(0);
+  if (!in.read(reinterpret_cast<char*>(bytes.get()), static_cast<std::streamsize>(size)))
+    throw exception::InvalidSnapshot("Cannot read " + path);
+  const std::span<const std::byte> view(bytes.get(), size);
+  return s_fromSnapshot(view, std::move(bytes));
+#endif
+}
+
+// Nodes come in document order, so parents precede their children and
+// children and siblings follow their node; that also keeps the walk over
+// the links below from running in circles.
+bool FrozenDOM::isValid() const noexcept {
+  const auto validKey = [this](Key key) {
+    return key < htmlTags.size() || (key >= detail::Attribute::kCustomBase && key - detail::Attribute::kCustomBase < layout_.names);
+  };
+  const auto validRange = [this](Range range) {
+    return uint64_t(range.offset) + range.size <= layout_.string_bytes;
+  };
+  const auto ranges = array<uint32_t>(layout_.attributeRangesOffset(), layout_.nodes + 1);
+  const auto types = getTypes();
+  const auto parents = getParents();
+  const auto first_children = getFirstChildren();
+  const auto next_siblings = getNextSiblings();
+  const auto text_ranges = getTextRanges();
+  for (Index i = 0; i < layout_.nodes; ++i) {
+    if (!validRange(text_ranges[i]))
+      return false;
+    // Text and comment nodes have neither attributes nor children.
+    if (types[i] == Tag::Element::kText || types[i] == Tag::Element::kComment) {
+      if (first_children[i] != kNone || ranges[i] != ranges[i + 1])
+        return false;
+    } else if (!validKey(types[i])) {
+      return false;
+    }
+    if (parents[i] != kNone && parents[i] >= i)
+      return false;
+    if (first_children[i] != kNone && (first_children[i] <= i || first_children[i] >= layout_.nodes))
+      return false;
+    if (next_siblings[i] != kNone && (next_siblings[i] <= i || next_siblings[i] >= layout_.nodes))
+      return false;
+  }
+
+  if (ranges[0] != 0 || ranges[layout_.nodes] != layout_.attributes)
+    return false;
+  for (Index i = 0; i < layout_.nodes; ++i) {
+    if (ranges[i] > ranges[i + 1])
+      return false;
+  }
+  for (const Attribute& attribute : array<Attribute>(layout_.attributesOffset(), layout_.attributes)) {
+    if (!validKey(attribute.key) || !validRange(attribute.value))
+      return false;
+  }
+  for (const Range& name : array<Range>(layout_.namesOffset(), layout_.names)) {
+    if (!validRange(name))
+      return false;
+  }
+
+  if (layout_.nodes == 0)
+    return !layout_.document;
+  // One root, or <head> and <body> for a document.
+  const Index second_root = next_siblings[0];
+  if (parents[0] != kNone || (second_root != kNone) != layout_.document)
+    return false;
+  if (second_root != kNone && next_siblings[second_root] != kNone)
+    return false;
+
+  // The links have to agree with each other and with the parents: walking
+  // them from the roots, the way the serializer does, has to visit every
+  // node once, in index order.
+  Index expected = 0;
+  for (Index node = 0; node != kNone;) {
+    if (node != expected++)
+      return false;
+    if (first_children[node] != kNone) {
+      if (parents[first_children[node]] != node)
+        return false;
+      node = first_children[node];
+      continue;
+    }
+    Index done = node;
+    node = kNone;
+    for (; done != kNone; done = parents[done]) {
+      if (next_siblings[done] != kNone) {
+        if (parents[next_siblings[done]] != parents[done])
+          return false;
+        node = next_siblings[done];
+        break;
+      }
+    }
+  }
+  return expected == layout_.nodes;
+}
+
+std::string_view FrozenDOM::getName(Key key) const noexcept {
+  if (key < detail::Attribute::kCustomBase)
+    return htmlTags[key];
+  return getString(array<Range>(layout_.namesOffset(), layout_.names)[key - detail::Attribute::kCustomBase]);
+}
+
+Tag FrozenDOM::toTag(Index root, std::shared_ptr<detail::Interner> names) const {
+  auto document = detail::Document::s_create(detail::Arena::kDefaultBlockSize, std::move(names));
+  const Thaw thaw = prepareThaw(*document);
+  Tag::Element* element = thaw.build(root, nullptr);
+  return Tag(std::move(document), element);
+}
+
+Tag FrozenDOM::toTag(Index root, const Tag& owner) const {
+  const Thaw thaw = prepareThaw(*owner.document_);
+  return Tag(owner.document_, thaw.build(root, nullptr));
+}
+
+DOM FrozenDOM::toDOM(std::shared_ptr<detail::Interner> names) const {
+  if (!layout_.document)
+    throw exception::Error("FrozenDOM::toDOM needs a tree frozen from a DOM");
+  DOM dom(std::move(names));
+  const Thaw thaw = prepareThaw(*dom.head.document_);
+  thaw.build(0, dom.head.element_);
+  thaw.build(getNextSiblings()[0], dom.body.element_);
+  return dom;
+}
+
+FrozenDOM::Thaw FrozenDOM::prepareThaw(detail::Document& document) const {
+  Thaw thaw{*this, document, document.retain(getString({0, layout_.string_bytes})), {}};
+  detail::Interner& interner = document.getNames();
+  thaw.customs.resize(layout_.names);
+  for (uint32_t i = 0; i < layout_.names; ++i)
+    thaw.customs[i] = interner.intern(getName(detail::Attribute::kCustomBase + i));
+  return thaw;
+}
+
+Tag::Element* FrozenDOM::Thaw::build(Index root, Tag::Element* into) const {
+  const auto types = frozen.getTypes();
+  const auto parents = frozen.getParents();
+  std::vector<Tag::Element*> elements;
+  for (Index i = root; i < frozen.size(); ++i) {
+    if (i != root && (parents[i] == kNone || parents[i] < root))
+      break;
+    Tag::Element* element = into;
+    if (i != root || element == nullptr) {
+      const Key type = types[i];
+      element = document.createElement(type < detail::Attribute::kCustomBase
+        ? std::variant<Tag::Native, Tag::Custom>(static_cast<Tag::Native>(type))
+        : std::variant<Tag::Native, Tag::Custom>(customs[type - detail::Attribute::kCustomBase]));
+    }
+
+    if (!element->isElement()) {
+      const Range text = frozen.getTextRanges()[i];
+      element->setTextView(strings.substr(text.offset, text.size));
+    }
+    const auto attributes = frozen.getAttrs(i);
+    element->reserveAttrs(attributes.size());
+    for (const Attribute& attribute : attributes) {
+      const Key key = attribute.key < detail::Attribute::kCustomBase
+        ? attribute.key
+        : detail::Attribute::kCustomBase + customs[attribute.key - detail::Attribute::kCustomBase];
+      element->setAttrView(key, strings.substr(attribute.value.offset, attribute.value.size));
+    }
+    if (i != root)
+      elements[parents[i] - root]->addChild(element);
+    elements.push_back(element);
+  }
+  return elements.front();
+}
+
+std::string FrozenDOM::toString() const {
+  std::string html;
+  StringSink sink(html);
+  Serializer serializer(sink);
+  serializer.write(*this);
+  serializer.flush();
+  return html;
+}
+
+} // namespace hi
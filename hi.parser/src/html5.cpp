@@ -1,64 +1,372 @@
 #include "hi.parser/html5.h"
+#include "hi.parser/element_index.h"
+#include "hi.parser/perfect_hash.h"
+#include "hi.parser/serializer.h"
+
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include <new>
 
 namespace hi
 {
 
+DOM::DOM() : DOM(detail::Document::s_create()) {}
+
+DOM::DOM(std::shared_ptr<detail::Interner> names)
+  : DOM(detail::Document::s_create(detail::Arena::kDefaultBlockSize, std::move(names)))
+{}
+
+DOM::DOM(std::shared_ptr<detail::Document> document)
+  : head(document, static_cast<Tag::Native>(Tag::Global::Head)),
+    body(document, static_cast<Tag::Native>(Tag::Global::Body))
+{
+  document->addRoot(head.element_);
+  document->addRoot(body.element_);
+}
+
+DOM::DOM(const std::shared_ptr<detail::Document>& document, Tag::Element* head, Tag::Element* body)
+  : head(document, head), body(document, body)
+{
+  document->addRoot(head);
+  document->addRoot(body);
+}
+
+DOM DOM::copyTree() const {
+  auto document = detail::Document::s_create(detail::Arena::kDefaultBlockSize, head.document_->getOwnNames());
+  document->adopt(*head.document_);
+  Tag::Element* head_copy = head.element_->copyTree(*document);
+  Tag::Element* body_copy = body.element_->copyTree(*document);
+  return DOM(document, head_copy, body_copy);
+}
+
+std::optional<Tag> DOM::findCopy(const Tag& original) const {
+  if (Tag::Element* copy = head.document_->findCopy(*original.element_))
+    return Tag(head.document_, copy);
+  return std::nullopt;
+}
+
+Tag DOM::createElement(std::variant<Tag::Native, Tag::Custom> tag) const {
+  return head.createElement(tag);
+}
+
+std::optional<Tag> DOM::getElementById(std::string_view id) const {
+  if (Tag::Element* element = head.document_->getIndex().getElementById(id))
+    return Tag(head.document_, element);
+  return std::nullopt;
+}
+
+std::vector<Tag> DOM::getElementsByClassName(std::string_view names) const {
+  std::vector<Tag> tags;
+  for (Tag::Element* element : head.document_->getIndex().getElementsByClassName(names))
+    tags.push_back(Tag(head.document_, element));
+  return tags;
+}
+
+std::vector<Tag> DOM::getElementsByTagName(std::variant<Tag::Native, Tag::Custom> tag) const {
+  const auto key = std::holds_alternative<Tag::Native>(tag)
+    ? detail::Attribute::Key(std::get<Tag::Native>(tag))
+    : detail::Attribute::kCustomBase + std::get<Tag::Custom>(tag);
+  const auto elements = head.document_->getIndex().getElementsByTagName(key);
+  std::vector<Tag> tags;
+  tags.reserve(elements.size());
+  for (Tag::Element* element : elements)
+    tags.push_back(Tag(head.document_, element));
+  return tags;
+}
+
+MemoryUsage DOM::getMemoryUsage() const {
+  return head.document_->getMemoryUsage();
+}
+
 std::string DOM::toString() const {
-  std::ostringstream html;
-  html << "<!DOCTYPE html>\n<html>\n";
-  html << head.toString();
-  html << body.toString();
-  html << "</html>";
-  return html.str();
+  std::string html;
+  StringSink sink(html);
+  Serializer serializer(sink);
+  serializer.write(*this);
+  serializer.flush();
+  return html;
 }
 
 namespace detail
 {
 
-HTML5Element::HTML5Element(std::variant<HTML5Element::Native, HTML5Element::Custom> type)
+namespace
 {
-  std::visit([this](auto&& arg) {
-    *this = HTML5Element(std::forward<decltype(arg)>(arg));
-  }, type);
+
+Attribute::Key s_typeKey(std::variant<HTML5Element::Native, HTML5Element::Custom> type) noexcept {
+    return std::holds_alternative<HTML5Element::Native>(type)
+        ? std::get<HTML5Element::Native>(type)
+        : Attribute::kCustomBase + std::get<HTML5Element::Custom>(type);
 }
 
-HTML5Element::HTML5Element(Native type)
-  : type_(type), parent_(nullptr)
-{}
+// Slots in the hash table that follows an attribute array of `capacity`;
+// small arrays have none and are scanned.
+std::size_t s_attrTableSize(std::size_t capacity) noexcept {
+    return capacity > HTML5Element::kIndexedAttrs ? std::bit_ceil(capacity * 2) : 0;
+}
 
-HTML5Element::HTML5Element(Custom type)
-  : type_(type), parent_(nullptr)
-{}
+std::size_t s_attrHash(Attribute::Key key) noexcept {
+    return key * 2654435761u;
+}
 
+std::size_t s_serializedSize(const Document::SerializedSubtree& subtree) noexcept {
+    return subtree.bytes.size() + subtree.indent.size() + subtree.newline.size();
+}
 
-void HTML5Element::addChild(std::shared_ptr<HTML5Element> child) {
-    children_.push_back(child);
+// Attributes allocated for an array of `capacity`, its table included.
+std::size_t s_attrArraySize(std::size_t capacity) noexcept {
+    const std::size_t table_bytes = s_attrTableSize(capacity) * sizeof(uint16_t);
+    return capacity + (table_bytes + sizeof(Attribute) - 1) / sizeof(Attribute);
 }
 
-std::vector<std::shared_ptr<HTML5Element>> HTML5Element::getChildren() const {
-    return children_;
+// A child array that grew moved to a new allocation; the first one is new.
+void s_recordChildren(Document* document, std::size_t old_capacity, std::size_t capacity) noexcept {
+    MemoryAccount* memory = document->getMemoryAccount();
+    if (memory == nullptr || capacity == old_capacity) {
+        return;
+    }
+    if (old_capacity == 0) {
+        memory->allocate(MemoryCategory::Children, capacity * sizeof(HTML5Element*));
+    } else {
+        memory->reallocate(MemoryCategory::Children, old_capacity * sizeof(HTML5Element*), capacity * sizeof(HTML5Element*));
+    }
 }
 
-void HTML5Element::removeChild(std::shared_ptr<HTML5Element> child) {
-    auto it = std::find(children_.begin(), children_.end(), child);
-    if (it != children_.end()) {
-        children_.erase(it);
+// Ropes allocate chunks of their own, so their size is what is counted.
+void s_recordRope(Document* document, std::size_t old_size, std::size_t size) noexcept {
+    if (MemoryAccount* memory = document->getMemoryAccount()) {
+        memory->resize(MemoryCategory::Text, old_size, size);
     }
 }
 
+void s_recordString(Document* document, std::size_t size) noexcept {
+    if (MemoryAccount* memory = document->getMemoryAccount()) {
+        memory->allocate(MemoryCategory::Strings, size);
+    }
+}
+
+} // namespace
+
+
+HTML5Element::HTML5Element(Document* document, std::variant<Native, Custom> type)
+  : parent_(nullptr), document_(document), attrs_(nullptr), attr_count_(0), attr_capacity_(0),
+    type_(s_typeKey(type)), index_(0), indexed_(0), root_(0), cache_(0)
+{
+    if (!isElement()) {
+        text_ = {nullptr, 0, 0};
+    }
+}
+
+
+// A child that is the element itself or one of its ancestors would turn
+// the tree into a cycle that every walk over it follows forever. Only the
+// element itself can be a leaf among those, so adding the fresh nodes of a
+// parse does not walk up.
+void HTML5Element::checkChild(const HTML5Element* child) const {
+    if (!isElement()) {
+        throw exception::InvalidTag("Text and comment nodes have no children");
+    }
+    if (child == this) {
+        throw exception::InvalidTag("Cannot add an element to itself");
+    }
+    if (child->children_.empty()) {
+        return;
+    }
+    for (const HTML5Element* ancestor = parent_; ancestor != nullptr; ancestor = ancestor->parent_) {
+        if (ancestor == child) {
+            throw exception::InvalidTag("Cannot add an element under one of its descendants");
+        }
+    }
+}
+
+void HTML5Element::addChild(HTML5Element* child) {
+    checkChild(child);
+    if (child->parent_ != nullptr) {
+        child->parent_->removeChild(child);
+    }
+    if (&child->document_->getNames() != &document_->getNames()) {
+        child->rehome(*document_);
+    }
+    invalidate();
+    child->parent_ = this;
+    child->index_ = static_cast<uint32_t>(children_.size());
+    const std::size_t capacity = children_.capacity();
+    children_.push_back(document_->getArena(), child);
+    s_recordChildren(document_, capacity, children_.capacity());
+    if (child->document_ != document_) {
+        document_->addGrafted(child);
+    }
+    if (ElementIndex* index = findIndex()) {
+        index->add(*child);
+    }
+}
+
+void HTML5Element::insertChild(HTML5Element* child, std::size_t position) {
+    checkChild(child);
+    if (child->parent_ != nullptr) {
+        child->parent_->removeChild(child);
+    }
+    if (&child->document_->getNames() != &document_->getNames()) {
+        child->rehome(*document_);
+    }
+    position = std::min(position, children_.size());
+    invalidate();
+    child->parent_ = this;
+    const std::size_t capacity = children_.capacity();
+    children_.insert(document_->getArena(), children_.begin() + position, child);
+    s_recordChildren(document_, capacity, children_.capacity());
+    if (child->document_ != document_) {
+        document_->addGrafted(child);
+    }
+    for (std::size_t i = position; i < children_.size(); ++i) {
+        children_[i]->index_ = static_cast<uint32_t>(i);
+    }
+    if (ElementIndex* index = findIndex()) {
+        index->add(*child);
+    }
+}
+
+// Custom ids, the index and the selectors of a tree are those of its root's
+// registry, and an element's ids are read in its document's, so elements
+// from another registry are moved over to `document`: their custom ids are
+// interned again there, ropes move with them and cached bytes are dropped.
+// Their memory stays with their former documents, which are tied to
+// `document` both ways, as handles to those reach elements that now
+// allocate from it. Every edge of a tree joins elements of one registry,
+// so the whole subtree moves.
+void HTML5Element::rehome(Document& document) {
+    // Roots moved along leave their documents for `document`, indexes
+    // included.
+    for (HTML5Element& element : ElementRange(DepthFirstIterator(this))) {
+        if (element.isRoot()) {
+            ElementIndex* index = element.findIndex();
+            element.root_ = 0;
+            if (index != nullptr) {
+                index->remove(element);
+            }
+        }
+    }
+    if (ElementIndex* index = findIndex()) {
+        index->remove(*this);
+    }
+    Interner& names = document.getNames();
+    const auto remap = [&names](Attribute::Key key, const Interner& from) {
+        if (key < Attribute::kCustomBase) {
+            return key;
+        }
+        return Attribute::kCustomBase + names.intern(*from.name(key - Attribute::kCustomBase));
+    };
+    Document* tied = nullptr;
+    for (HTML5Element& element : ElementRange(DepthFirstIterator(this))) {
+        Document* former = element.document_;
+        if (element.isElement()) {
+            element.type_ = remap(element.type_, former->getNames());
+            Attribute* attributes = element.getAttrData();
+            for (std::size_t i = 0; i < element.attr_count_; ++i) {
+                attributes[i].key = remap(attributes[i].key, former->getNames());
+            }
+            if (element.getAttrTable() != nullptr) {
+                element.indexAttrs();
+            }
+        } else if (element.text_.rope != 0) {
+            const uint32_t slot = document.createRope(element.getRope()->toString());
+            former->dropRope(element.text_.rope - 1);
+            element.text_.rope = slot + 1;
+        }
+        former->dropSerialized(element);
+        for (HTML5Element* child : element.children_) {
+            if (child->document_ != former) {
+                former->removeGrafted(child);
+            }
+        }
+        element.document_ = &document;
+        if (former != tied) {
+            document.adopt(*former);
+            former->adopt(document);
+            tied = former;
+        }
+    }
+}
+
+std::span<HTML5Element* const> HTML5Element::getChildren() const noexcept {
+    return {children_.data(), children_.size()};
+}
+
+void HTML5Element::removeChild(HTML5Element* child) {
+    if (child->parent_ != this) {
+        return;
+    }
+    invalidate();
+    if (ElementIndex* index = findIndex()) {
+        index->remove(*child);
+    }
+    children_.erase(children_.begin() + child->index_);
+    for (std::size_t i = child->index_; i < children_.size(); ++i) {
+        children_[i]->index_ = static_cast<uint32_t>(i);
+    }
+    if (child->document_ != document_) {
+        document_->removeGrafted(child);
+    }
+    child->parent_ = nullptr;
+    child->index_ = 0;
+}
+
 void HTML5Element::clearChildren() {
+    invalidate();
+    if (ElementIndex* index = findIndex()) {
+        index->remove(getChildren());
+    }
+    for (HTML5Element* child : children_) {
+        if (child->document_ != document_) {
+            document_->removeGrafted(child);
+        }
+        child->parent_ = nullptr;
+        child->index_ = 0;
+    }
     children_.clear();
 }
 
-void HTML5Element::setType(std::variant<Native, Custom> type) noexcept {
-    type_ = type;
+HTML5Element* HTML5Element::getNextSibling() const noexcept {
+    if (parent_ == nullptr || std::size_t(index_) + 1 >= parent_->children_.size()) {
+        return nullptr;
+    }
+    return parent_->children_[index_ + 1];
+}
+
+HTML5Element* HTML5Element::getPreviousSibling() const noexcept {
+    if (parent_ == nullptr || index_ == 0) {
+        return nullptr;
+    }
+    return parent_->children_[index_ - 1];
+}
+
+std::size_t HTML5Element::getIndex() const noexcept {
+    return parent_ == nullptr ? 0 : index_;
+}
+
+void HTML5Element::setType(std::variant<Native, Custom> type) {
+    const Attribute::Key key = s_typeKey(type);
+    if (isElement() != (key != kText && key != kComment)) {
+        throw exception::InvalidTag("Cannot turn an element into a text or comment node or back");
+    }
+    invalidate();
+    const Attribute::Key from = ElementIndex::s_getKey(*this);
+    type_ = key;
+    if (ElementIndex* index = findIndex()) {
+        index->changeType(*this, from, ElementIndex::s_getKey(*this));
+    }
 }
 
 std::variant<HTML5Element::Native, HTML5Element::Custom> HTML5Element::getType() const noexcept {
-    return type_;
+    if (type_ < Attribute::kCustomBase) {
+        return static_cast<Native>(type_);
+    }
+    return static_cast<Custom>(type_ - Attribute::kCustomBase);
 }
 
 void HTML5Element::setParent(HTML5Element* parent) {
+    invalidate();
     parent_ = parent;
 }
 
@@ -66,44 +374,1002 @@ HTML5Element* HTML5Element::getParent() const {
     return parent_;
 }
 
-void HTML5Element::setAttr(const std::string& key, const std::string& value) {
-    attributes_[key] = value;
+Document* HTML5Element::getDocument() const noexcept {
+    return document_;
+}
+
+void HTML5Element::setAttr(std::string_view key, std::string_view value) {
+    setAttrView(Tag::s_getAttrKey(key, document_->getNames()), document_->retain(value));
+}
+
+void HTML5Element::setAttr(Attribute::Key key, std::string_view value) {
+    setAttrView(key, document_->retain(value));
+}
+
+void HTML5Element::setAttrView(Attribute::Key key, std::string_view value) {
+    if (!isElement()) {
+        throw exception::InvalidAttribute("Text and comment nodes have no attributes");
+    }
+    invalidate();
+    ElementIndex* index = findIndex();
+    if (Attribute* attribute = findAttrSlot(key)) {
+        if (index != nullptr) {
+            index->removeAttr(*this, key, attribute->value());
+        }
+        attribute->size = static_cast<uint32_t>(value.size());
+        attribute->data = value.data();
+        if (index != nullptr) {
+            index->addAttr(*this, key, value);
+        }
+        return;
+    }
+    if (attr_count_ == kMaxAttrs) {
+        throw exception::InvalidAttribute("Too many attributes");
+    }
+    if (attr_count_ == std::max<std::size_t>(attr_capacity_, 1)) {
+        growAttrs(std::min(attr_capacity_ == 0 ? std::size_t(4) : attr_capacity_ * std::size_t(2), kMaxAttrs));
+    }
+    getAttrData()[attr_count_] = {key, static_cast<uint32_t>(value.size()), value.data()};
+    if (getAttrTable() != nullptr) {
+        indexAttr(attr_count_);
+    }
+    ++attr_count_;
+    if (index != nullptr) {
+        index->addAttr(*this, key, value);
+    }
+}
+
+void HTML5Element::reserveAttrs(std::size_t count) {
+    if (!isElement()) {
+        return;
+    }
+    count = std::min(count, kMaxAttrs);
+    if (count > std::max<std::size_t>(attr_capacity_, 1)) {
+        growAttrs(count);
+    }
+}
+
+std::string_view HTML5Element::getAttr(std::string_view key) const {
+    if (const Attribute* attribute = findAttr(key)) {
+        return attribute->value();
+    }
+    throw exception::InvalidAttribute("Attribute " + std::string(key) + " not found");
+}
+
+std::string_view HTML5Element::getAttr(Attribute::Key key) const {
+    if (const Attribute* attribute = findAttr(key)) {
+        return attribute->value();
+    }
+    throw exception::InvalidAttribute("Attribute " + std::string(Tag::s_getAttrName(key, document_->getNames())) + " not found");
+}
+
+bool HTML5Element::hasAttr(std::string_view key) const noexcept {
+    return findAttr(key) != nullptr;
+}
+
+bool HTML5Element::hasAttr(Attribute::Key key) const noexcept {
+    return findAttr(key) != nullptr;
+}
+
+void HTML5Element::removeAttr(std::string_view key) {
+    if (auto id = Tag::s_findAttrKey(key, document_->getNames())) {
+        removeAttr(*id);
+    }
+}
+
+void HTML5Element::removeAttr(Attribute::Key key) {
+    if (const Attribute* attribute = findAttr(key)) {
+        invalidate();
+        if (ElementIndex* index = findIndex()) {
+            index->removeAttr(*this, key, attribute->value());
+        }
+        Attribute* data = getAttrData();
+        const std::size_t position = attribute - data;
+        std::copy(data + position + 1, data + attr_count_, data + position);
+        --attr_count_;
+        if (getAttrTable() != nullptr) {
+            indexAttrs();
+        }
+    }
+}
+
+std::span<const Attribute> HTML5Element::getAllAttrs() const noexcept {
+    return {getAttrData(), attr_count_};
+}
+
+void HTML5Element::setTextView(std::string_view text) {
+    checkText();
+    invalidate();
+    if (text_.rope != 0) {
+        document_->dropRope(text_.rope - 1);
+    }
+    text_ = {text.data(), static_cast<uint32_t>(text.size()), 0};
+}
+
+void HTML5Element::setText(std::string_view text) {
+    setTextView(document_->retain(text));
+}
+
+void HTML5Element::appendText(std::string_view text) {
+    insertText(getTextSize(), text);
+}
+
+void HTML5Element::insertText(std::size_t position, std::string_view text) {
+    checkText();
+    if (text.empty()) {
+        return;
+    }
+    invalidate();
+    if (Rope* rope = getRope()) {
+        const std::size_t old_size = rope->size();
+        rope->insert(position, text);
+        s_recordRope(document_, old_size, rope->size());
+        return;
+    }
+    const std::string_view current(text_.data, text_.size);
+    position = std::min(position, current.size());
+    const std::size_t size = current.size() + text.size();
+    if (size > kMaxCopiedText) {
+        text_.rope = document_->createRope(current) + 1;
+        getRope()->insert(position, text);
+        s_recordRope(document_, current.size(), size);
+        return;
+    }
+    char* copy = document_->getArena().allocateArray<char>(size);
+    s_recordString(document_, size);
+    std::copy(current.begin(), current.begin() + position, copy);
+    std::copy(text.begin(), text.end(), copy + position);
+    std::copy(current.begin() + position, current.end(), copy + position + text.size());
+    text_.data = copy;
+    text_.size = static_cast<uint32_t>(size);
+}
+
+// Cutting off either end of a view only narrows it.
+void HTML5Element::eraseText(std::size_t position, std::size_t count) {
+    checkText();
+    if (Rope* rope = getRope()) {
+        invalidate();
+        const std::size_t old_size = rope->size();
+        rope->erase(position, count);
+        s_recordRope(document_, old_size, rope->size());
+        return;
+    }
+    const std::string_view current(text_.data, text_.size);
+    position = std::min(position, current.size());
+    count = std::min(count, current.size() - position);
+    if (count == 0) {
+        return;
+    }
+    invalidate();
+    if (position == 0 || position + count == current.size()) {
+        text_.data += position == 0 ? count : 0;
+        text_.size -= static_cast<uint32_t>(count);
+        return;
+    }
+    const std::size_t size = current.size() - count;
+    if (size > kMaxCopiedText) {
+        text_.rope = document_->createRope(current) + 1;
+        getRope()->erase(position, count);
+        s_recordRope(document_, current.size(), size);
+        return;
+    }
+    char* copy = document_->getArena().allocateArray<char>(size);
+    s_recordString(document_, size);
+    std::copy(current.begin(), current.begin() + position, copy);
+    std::copy(current.begin() + position + count, current.end(), copy + position);
+    text_.data = copy;
+    text_.size = static_cast<uint32_t>(size);
+}
+
+std::size_t HTML5Element::getTextSize() const noexcept {
+    if (isElement()) {
+        return 0;
+    }
+    const Rope* rope = getRope();
+    return rope != nullptr ? rope->size() : text_.size;
+}
+
+std::string HTML5Element::getText() const {
+    checkText();
+    const Rope* rope = getRope();
+    return rope != nullptr ? rope->toString() : std::string(text_.data, text_.size);
+}
+
+void HTML5Element::setCacheable(bool cacheable) {
+    if (cacheable == isCacheable()) {
+        return;
+    }
+    document_->dropSerialized(*this);
+    setCache(cacheable ? 1 : 0);
+}
+
+bool HTML5Element::isCacheable() const noexcept {
+    return getCache() != 0;
+}
+
+// Cached bytes of an ancestor cover every element on the way down to this
+// one, which all have kInCache, so the first element without it ends the
+// walk. Bits left set below a dropped entry only make a later walk longer.
+void HTML5Element::invalidate() noexcept {
+    for (const HTML5Element* element = this; element != nullptr && (element->cache_ & kInCache) != 0; element = element->parent_) {
+        element->cache_.fetch_and(~kInCache, std::memory_order_relaxed);
+        element->document_->dropSerialized(*element);
+    }
+}
+
+// Keeps kInCache, which serializers of other subtrees may be setting.
+void HTML5Element::setCache(uint32_t cache) const noexcept {
+    uint32_t current = cache_.load(std::memory_order_relaxed);
+    while (!cache_.compare_exchange_weak(current, (current & kInCache) | cache, std::memory_order_relaxed)) {
+    }
+}
+
+void HTML5Element::markCached() const noexcept {
+    for (const HTML5Element& element : ElementRange(DepthFirstIterator(const_cast<HTML5Element*>(this)))) {
+        element.cache_.fetch_or(kInCache, std::memory_order_relaxed);
+    }
+}
+
+// Pre-order over the subtree with the copies of the open ancestors on a
+// stack; children are linked directly, as nothing of the copy is cached or
+// indexed yet.
+HTML5Element* HTML5Element::copyTree(Document& document) const {
+    struct Open {
+        const HTML5Element* original;
+        HTML5Element* copy;
+    };
+    std::vector<Open> open;
+    HTML5Element* root = nullptr;
+    for (const HTML5Element& element : ElementRange(DepthFirstIterator(const_cast<HTML5Element*>(this)))) {
+        while (!open.empty() && open.back().original != element.parent_) {
+            open.pop_back();
+        }
+        HTML5Element* copy = element.copyNode(document);
+        if (open.empty()) {
+            root = copy;
+        } else {
+            HTML5Element* parent = open.back().copy;
+            copy->parent_ = parent;
+            copy->index_ = static_cast<uint32_t>(parent->children_.size());
+            parent->children_.push_back(document.getArena(), copy);
+        }
+        if (!element.children_.empty()) {
+            copy->children_.reserve(document.getArena(), static_cast<uint32_t>(element.children_.size()));
+            s_recordChildren(&document, 0, copy->children_.capacity());
+            open.push_back({&element, copy});
+        }
+    }
+    return root;
+}
+
+// Attribute arrays are copied at their size rather than their capacity;
+// a single attribute moves inline.
+HTML5Element* HTML5Element::copyNode(Document& document) const {
+    HTML5Element* copy = document.createElement(getType());
+    if (!isElement()) {
+        if (const Rope* rope = getRope()) {
+            copy->text_.rope = document.createRope(rope->toString()) + 1;
+        } else {
+            copy->text_ = text_;
+        }
+    } else if (attr_count_ == 1) {
+        copy->attr_ = getAttrData()[0];
+        copy->attr_count_ = 1;
+    } else if (attr_count_ > 1) {
+        copy->attrs_ = document.getArena().allocateArray<Attribute>(s_attrArraySize(attr_count_));
+        if (MemoryAccount* memory = document.getMemoryAccount()) {
+            memory->allocate(MemoryCategory::Attributes, s_attrArraySize(attr_count_) * sizeof(Attribute));
+        }
+        std::copy_n(attrs_, attr_count_, copy->attrs_);
+        copy->attr_count_ = attr_count_;
+        copy->attr_capacity_ = attr_count_;
+        if (s_attrTableSize(attr_count_) != 0) {
+            copy->indexAttrs();
+        }
+    }
+    // The copy has the same shape, so kInCache carries over as it is.
+    copy->cache_.store(cache_.load(std::memory_order_relaxed) & kInCache, std::memory_order_relaxed);
+    if (const auto serialized = document_->findSerialized(*this)) {
+        document.storeSerialized(*copy, *serialized);
+    } else {
+        copy->setCache(getCache());
+    }
+    return copy;
+}
+
+void HTML5Element::checkText() const {
+    if (isElement()) {
+        throw exception::InvalidTag("Only text and comment nodes have text content");
+    }
+}
+
+Rope* HTML5Element::getRope() const noexcept {
+    return text_.rope != 0 ? &document_->getRope(text_.rope - 1) : nullptr;
+}
+
+// The index marks the elements it holds, so only elements grafted from
+// another document walk to the root.
+ElementIndex* HTML5Element::findIndex() const noexcept {
+    if (indexed_ == 0) {
+        return nullptr;
+    }
+    if (indexed_ == 1) {
+        return document_->findIndex();
+    }
+    const HTML5Element* root = this;
+    while (!root->isRoot() && root->parent_ != nullptr) {
+        root = root->parent_;
+    }
+    return root->document_->findIndex();
+}
+
+const Attribute* HTML5Element::findAttr(std::string_view key) const noexcept {
+    auto id = Tag::s_findAttrKey(key, document_->getNames());
+    return id ? findAttr(*id) : nullptr;
 }
 
-std::string HTML5Element::getAttr(const std::string& key) const {
-    auto it = attributes_.find(key);
-    if (it != attributes_.end()) {
-        return it->second;
+Attribute* HTML5Element::findAttrSlot(Attribute::Key key) const noexcept {
+    Attribute* data = getAttrData();
+    if (const uint16_t* table = getAttrTable()) {
+        const std::size_t mask = s_attrTableSize(attr_capacity_) - 1;
+        for (std::size_t slot = s_attrHash(key) & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+            if (data[table[slot] - 1].key == key) {
+                return &data[table[slot] - 1];
+            }
+        }
+        return nullptr;
     }
-    throw exception::InvalidAttribute("Attribute " + key + " not found");
+    for (Attribute* attribute = data; attribute != data + attr_count_; ++attribute) {
+        if (attribute->key == key) {
+            return attribute;
+        }
+    }
+    return nullptr;
 }
 
-bool HTML5Element::hasAttr(const std::string& key) const noexcept {
-    return attributes_.find(key) != attributes_.end();
+Attribute* HTML5Element::getAttrData() const noexcept {
+    return attr_capacity_ == 0 ? const_cast<Attribute*>(&attr_) : attrs_;
 }
 
-void HTML5Element::removeAttr(const std::string& key) {
-    attributes_.erase(key);
+uint16_t* HTML5Element::getAttrTable() const noexcept {
+    if (s_attrTableSize(attr_capacity_) == 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<uint16_t*>(attrs_ + attr_capacity_);
 }
 
-std::unordered_map<std::string, std::string> HTML5Element::getAllAttrs() const {
-    return attributes_;
+// The old array is left to the arena. The table is allocated as trailing
+// Attributes, which keeps it aligned and in the same block.
+void HTML5Element::growAttrs(std::size_t capacity) {
+    Attribute* data = document_->getArena().allocateArray<Attribute>(s_attrArraySize(capacity));
+    if (MemoryAccount* memory = document_->getMemoryAccount()) {
+        const std::size_t bytes = s_attrArraySize(capacity) * sizeof(Attribute);
+        if (attr_capacity_ == 0) {
+            memory->allocate(MemoryCategory::Attributes, bytes);
+        } else {
+            memory->reallocate(MemoryCategory::Attributes, s_attrArraySize(attr_capacity_) * sizeof(Attribute), bytes);
+        }
+    }
+    std::copy_n(getAttrData(), attr_count_, data);
+    attrs_ = data;
+    attr_capacity_ = static_cast<uint16_t>(capacity);
+    if (s_attrTableSize(capacity) != 0) {
+        indexAttrs();
+    }
+}
+
+// Rebuilds the table, as removals shift the attributes after the one
+// removed.
+void HTML5Element::indexAttrs() noexcept {
+    std::fill_n(getAttrTable(), s_attrTableSize(attr_capacity_), uint16_t(0));
+    for (std::size_t i = 0; i < attr_count_; ++i) {
+        indexAttr(i);
+    }
+}
+
+// Slots hold the position of an attribute + 1; 0 is empty.
+void HTML5Element::indexAttr(std::size_t position) noexcept {
+    uint16_t* table = getAttrTable();
+    const std::size_t mask = s_attrTableSize(attr_capacity_) - 1;
+    std::size_t slot = s_attrHash(getAttrData()[position].key) & mask;
+    while (table[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    table[slot] = static_cast<uint16_t>(position + 1);
+}
+
+
+DepthFirstIterator& DepthFirstIterator::operator++() noexcept {
+  auto children = current_->getChildren();
+  if (!children.empty()) {
+    current_ = children.front();
+    return *this;
+  }
+  while (current_ != root_) {
+    if (HTML5Element* sibling = current_->getNextSibling()) {
+      current_ = sibling;
+      return *this;
+    }
+    current_ = current_->getParent();
+  }
+  current_ = nullptr;
+  return *this;
+}
+
+BreadthFirstIterator& BreadthFirstIterator::operator++() {
+  if (++position_ < level_.size()) {
+    current_ = level_[position_];
+    return *this;
+  }
+  // The level is done: the next one is the children of its nodes, in order.
+  next_.clear();
+  if (level_.empty()) {
+    auto children = current_->getChildren();
+    next_.assign(children.begin(), children.end());
+  }
+  for (HTML5Element* node : level_) {
+    auto children = node->getChildren();
+    next_.insert(next_.end(), children.begin(), children.end());
+  }
+  level_.swap(next_);
+  position_ = 0;
+  ++depth_;
+  current_ = level_.empty() ? nullptr : level_.front();
+  return *this;
 }
 
 
+// Handles to a document share the count of the group that owned it when
+// they were made. A group merged into another hands its documents over and
+// from then on only keeps that one alive, so handles made before the merge
+// still keep the documents alive.
+struct Document::Group : std::enable_shared_from_this<Group> {
+  // A document taken over from another group, whose allocation holds it.
+  struct Absorbed {
+    Document* document;
+    std::weak_ptr<Group> room;
+  };
+
+  Document* own = nullptr;  // made in this group's allocation; null once taken over
+  std::vector<Absorbed> absorbed;
+  std::vector<std::shared_ptr<Group>> adopted;
+  std::shared_ptr<Group> merged;  // the group that took the documents over
+  // Groups that hold this one; while there are none, nothing it adopts can
+  // lead back to it.
+  std::atomic<uint32_t> adopters{0};
+
+  ~Group();
+
+  template <typename Fn>
+  void forEachDocument(Fn&& fn) const {
+    if (own != nullptr)
+      fn(own);
+    for (const Absorbed& entry : absorbed)
+      fn(entry.document);
+  }
+  template <typename Fn>
+  void forEachHeld(Fn&& fn) const {
+    for (const auto& group : adopted)
+      fn(group.get());
+    if (merged)
+      fn(merged.get());
+  }
+  bool reaches(const Group* target) const;
+  void absorb(Group& other);
+};
+
+namespace
+{
+
+// Allocates a group's control block with room for its document behind it,
+// so a standalone document costs one allocation. The room is freed with the
+// block, once neither handles nor a group that took the document over (see
+// Group::Absorbed) refer to it.
+template <typename T>
+struct DocumentRoom {
+  using value_type = T;
+  void** room;
+
+  explicit DocumentRoom(void** room) noexcept : room(room) {}
+  template <typename U>
+  DocumentRoom(const DocumentRoom<U>& other) noexcept : room(other.room) {}
+
+  static constexpr std::size_t s_offset(std::size_t n) noexcept {
+    return (n * sizeof(T) + alignof(Document) - 1) / alignof(Document) * alignof(Document);
+  }
+  T* allocate(std::size_t n) {
+    char* block = static_cast<char*>(::operator new(s_offset(n) + sizeof(Document)));
+    *room = block + s_offset(n);
+    return reinterpret_cast<T*>(block);
+  }
+  void deallocate(T* block, std::size_t n) noexcept {
+    ::operator delete(block, s_offset(n) + sizeof(Document));
+  }
+  template <typename U>
+  bool operator==(const DocumentRoom<U>&) const noexcept { return true; }
+};
+
+} // namespace
+
+Document::Group::~Group() {
+  // Elements are linked across the documents of a group and into adopted
+  // ones, which outlive it: all of them let go of their grafts before any
+  // document is freed. Grafts leave this group's indexes with them.
+  forEachDocument([](Document* document) {
+    Extras* extras = document->extras_.load(std::memory_order_acquire);
+    if (extras == nullptr)
+      return;
+    for (HTML5Element* element : extras->grafted) {
+      if (document->index_)
+        ElementIndex::s_unmark(*element);
+      element->orphan();
+    }
+    extras->grafted.clear();
+  });
+  forEachDocument([](Document* document) { document->~Document(); });
+  absorbed.clear();
+
+  for (const auto& group : adopted)
+    group->adopters.fetch_sub(1, std::memory_order_relaxed);
+  if (merged) {
+    merged->adopters.fetch_sub(1, std::memory_order_relaxed);
+    adopted.push_back(std::move(merged));
+  }
+
+  // Adopted groups that die with this one are released in a loop by the
+  // outermost destructor, so a long chain of them cannot overflow the stack.
+  static thread_local std::vector<std::shared_ptr<Group>>* s_releasing = nullptr;
+  if (s_releasing != nullptr) {
+    std::move(adopted.begin(), adopted.end(), std::back_inserter(*s_releasing));
+    return;
+  }
+  std::vector<std::shared_ptr<Group>> releasing = std::move(adopted);
+  s_releasing = &releasing;
+  while (!releasing.empty()) {
+    std::shared_ptr<Group> group = std::move(releasing.back());
+    releasing.pop_back();
+    group.reset();
+  }
+  s_releasing = nullptr;
+}
+
+// Visits every group once, so it stays linear on adoptions that share
+// groups.
+bool Document::Group::reaches(const Group* target) const {
+  std::vector<const Group*> pending{this};
+  std::unordered_set<const Group*> visited{this};
+  while (!pending.empty()) {
+    const Group* group = pending.back();
+    pending.pop_back();
+    if (group == target)
+      return true;
+    group->forEachHeld([&pending, &visited](const Group* held) {
+      if (visited.insert(held).second)
+        pending.push_back(held);
+    });
+  }
+  return false;
+}
+
+// `other` reaches this group. Every group on a way from it back here takes
+// part in the cycle and moves its documents here; what they held off the
+// cycle is held by this group instead.
+void Document::Group::absorb(Group& other) {
+  std::vector<Group*> reachable{&other};
+  std::unordered_set<Group*> seen{&other};
+  std::unordered_map<Group*, std::vector<Group*>> holders;
+  for (std::size_t i = 0; i < reachable.size(); ++i) {
+    Group* group = reachable[i];
+    group->forEachHeld([group, &reachable, &seen, &holders](Group* held) {
+      holders[held].push_back(group);
+      if (seen.insert(held).second)
+        reachable.push_back(held);
+    });
+  }
+  std::vector<std::shared_ptr<Group>> cycle{shared_from_this()};
+  std::unordered_set<Group*> on_cycle{this};
+  for (std::size_t i = 0; i < cycle.size(); ++i) {
+    for (Group* holder : holders[cycle[i].get()]) {
+      if (on_cycle.insert(holder).second)
+        cycle.push_back(holder->shared_from_this());
+    }
+  }
+
+  std::vector<std::shared_ptr<Group>> held = std::move(adopted);
+  adopted.clear();
+  for (std::size_t i = 1; i < cycle.size(); ++i) {
+    Group& group = *cycle[i];
+    group.forEachDocument([this](Document* document) { document->group_ = this; });
+    if (group.own != nullptr)
+      absorbed.push_back({group.own, cycle[i]});
+    group.own = nullptr;
+    std::move(group.absorbed.begin(), group.absorbed.end(), std::back_inserter(absorbed));
+    group.absorbed.clear();
+    std::move(group.adopted.begin(), group.adopted.end(), std::back_inserter(held));
+    group.adopted.clear();
+    if (group.merged)
+      held.push_back(std::move(group.merged));
+    group.merged = cycle[0];
+    adopters.fetch_add(1, std::memory_order_relaxed);
+  }
+  for (auto& group : held) {
+    if (on_cycle.count(group.get()) != 0)
+      group->adopters.fetch_sub(1, std::memory_order_relaxed);
+    else
+      adopted.push_back(std::move(group));
+  }
+}
+
+
+Document::Document(std::size_t block_size, std::shared_ptr<Interner> names)
+  : arena_(inline_block_, kInlineSize, block_size), own_names_(std::move(names)),
+    memory_(MemoryTracker::isEnabled() ? std::make_unique<MemoryAccount>() : nullptr)
+{}
+
+Document::~Document() {
+  delete extras_.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<Document> Document::s_create(std::size_t block_size, std::shared_ptr<Interner> names) {
+  void* room = nullptr;
+  auto group = std::allocate_shared<Group>(DocumentRoom<Group>(&room));
+  Document* document = new (room) Document(block_size, std::move(names));
+  document->group_ = group.get();
+  group->own = document;
+  return std::shared_ptr<Document>(std::move(group), document);
+}
+
+HTML5Element* Document::createElement(std::variant<HTML5Element::Native, HTML5Element::Custom> type) {
+  if (memory_)
+    memory_->allocate(MemoryCategory::Elements, sizeof(HTML5Element));
+  return arena_.make<HTML5Element>(this, type);
+}
+
+void Document::adopt(Document& other) {
+  Group* group = group_;
+  Group* target = other.group_;
+  if (target == group)
+    return;
+  if (!group->adopted.empty() && group->adopted.back().get() == target)
+    return;
+  // A group nobody holds cannot be reached, which is what building a tree
+  // bottom-up from standalone Tags runs into at every level.
+  if (group->adopters.load(std::memory_order_relaxed) != 0 && target->reaches(group)) {
+    group->absorb(*target);
+    return;
+  }
+  target->adopters.fetch_add(1, std::memory_order_relaxed);
+  group->adopted.push_back(target->shared_from_this());
+}
+
+void Document::addGrafted(HTML5Element* element) {
+  getExtras().grafted.insert(element);
+}
+
+void Document::removeGrafted(HTML5Element* element) noexcept {
+  // Only called for elements addGrafted() saw, so the extras exist.
+  extras_.load(std::memory_order_acquire)->grafted.erase(element);
+}
+
+Document::Extras& Document::getExtras() const {
+  Extras* extras = extras_.load(std::memory_order_acquire);
+  if (extras != nullptr)
+    return *extras;
+  auto created = std::make_unique<Extras>();
+  if (extras_.compare_exchange_strong(extras, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+    return *created.release();
+  return *extras;
+}
+
+std::string_view Document::retain(std::string_view bytes) {
+  if (bytes.empty())
+    return {};
+  char* copy = arena_.allocateArray<char>(bytes.size());
+  std::memcpy(copy, bytes.data(), bytes.size());
+  if (memory_)
+    memory_->allocate(MemoryCategory::Strings, bytes.size());
+  return {copy, bytes.size()};
+}
+
+Arena& Document::getArena() noexcept {
+  return arena_;
+}
+
+Interner& Document::getNames() const noexcept {
+  return own_names_ ? *own_names_ : Interner::global();
+}
+
+MemoryUsage Document::getMemoryUsage() const {
+  MemoryUsage usage = memory_ ? memory_->getUsage() : MemoryUsage();
+  usage.reserved_bytes = arena_.capacity();
+  if (own_names_)
+    usage[MemoryCategory::Names] = own_names_->getMemoryUsage();
+  return usage;
+}
+
+void Document::addRoot(HTML5Element* root) {
+  getExtras().roots.push_back(root);
+  root->root_ = 1;
+  if (index_)
+    index_->add(*root);
+}
+
+HTML5Element* Document::findCopy(const HTML5Element& original) const {
+  std::vector<std::size_t> path;
+  const HTML5Element* root = &original;
+  for (; root->getParent() != nullptr; root = root->getParent())
+    path.push_back(root->getIndex());
+  if (!group_->reaches(root->getDocument()->group_))
+    return nullptr;
+  const auto originals = root->getDocument()->getRoots();
+  const std::size_t position = std::find(originals.begin(), originals.end(), root) - originals.begin();
+  const auto roots = getRoots();
+  if (position >= std::min(originals.size(), roots.size()))
+    return nullptr;
+  HTML5Element* copy = roots[position];
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    const auto children = copy->getChildren();
+    if (*it >= children.size())
+      return nullptr;
+    copy = children[*it];
+  }
+  return copy->getTypeKey() == original.getTypeKey() ? copy : nullptr;
+}
+
+ElementIndex& Document::getIndex() {
+  if (!index_)
+    index_ = std::make_unique<ElementIndex>(*this);
+  return *index_;
+}
+
+
+std::shared_ptr<const Document::SerializedSubtree> Document::findSerialized(const HTML5Element& element) const {
+  Extras& extras = getExtras();
+  std::lock_guard lock(extras.serialized_mutex);
+  const uint32_t cache = element.getCache();
+  return cache > 1 ? extras.serialized[cache - 2] : nullptr;
+}
+
+void Document::storeSerialized(const HTML5Element& element, SerializedSubtree subtree) {
+  auto stored = std::make_shared<const SerializedSubtree>(std::move(subtree));
+  Extras& extras = getExtras();
+  std::lock_guard lock(extras.serialized_mutex);
+  if (memory_)
+    memory_->allocate(MemoryCategory::Caches, s_serializedSize(*stored));
+  const uint32_t cache = element.getCache();
+  if (cache > 1) {
+    if (memory_)
+      memory_->release(MemoryCategory::Caches, s_serializedSize(*extras.serialized[cache - 2]));
+    extras.serialized[cache - 2] = std::move(stored);
+    return;
+  }
+  uint32_t slot;
+  if (!extras.free_serialized.empty()) {
+    slot = extras.free_serialized.back();
+    extras.free_serialized.pop_back();
+    extras.serialized[slot] = std::move(stored);
+  } else {
+    slot = static_cast<uint32_t>(extras.serialized.size());
+    extras.serialized.push_back(std::move(stored));
+    // Room for every slot on the free list, so dropping never allocates.
+    extras.free_serialized.reserve(extras.serialized.size());
+  }
+  element.setCache(slot + 2);
+}
+
+void Document::dropSerialized(const HTML5Element& element) noexcept {
+  const uint32_t cache = element.getCache();
+  if (cache <= 1)
+    return;
+  // A slot was stored, so the extras exist.
+  Extras& extras = *extras_.load(std::memory_order_acquire);
+  std::lock_guard lock(extras.serialized_mutex);
+  if (memory_)
+    memory_->release(MemoryCategory::Caches, s_serializedSize(*extras.serialized[cache - 2]));
+  extras.serialized[cache - 2].reset();
+  extras.free_serialized.push_back(cache - 2);
+  element.setCache(1);
+}
+
+uint32_t Document::createRope(std::string_view text) {
+  Extras& extras = getExtras();
+  if (memory_)
+    memory_->allocate(MemoryCategory::Text, text.size());
+  if (!extras.free_ropes.empty()) {
+    const uint32_t slot = extras.free_ropes.back();
+    extras.free_ropes.pop_back();
+    extras.ropes[slot] = Rope(text);
+    return slot;
+  }
+  extras.ropes.emplace_back(text);
+  extras.free_ropes.reserve(extras.ropes.size());
+  return static_cast<uint32_t>(extras.ropes.size() - 1);
+}
+
+void Document::dropRope(uint32_t slot) noexcept {
+  Extras& extras = *extras_.load(std::memory_order_acquire);
+  if (memory_)
+    memory_->release(MemoryCategory::Text, extras.ropes[slot].size());
+  extras.ropes[slot].clear();
+  extras.free_ropes.push_back(slot);
+}
+
 } // namespace detail
 
-const std::unordered_map<std::string, Tag::Native> Tag::kNativeMap = Tag::s_createNativeMap();
-const std::unordered_map<Tag::Native, std::string> Tag::kNativeMapInverse = Tag::s_createNativeMapInverse();
+namespace
+{
+
+constexpr detail::PerfectHash kNativeNames(htmlTags);
 
+} // namespace
+
+static_assert(htmlTags.size() == static_cast<std::size_t>(Tag::Event::__END__),
+  "htmlTags must list every Tag::Global and Tag::Event member in declaration order");
+
+
+
+// The parent's document has to keep the child's alive; see Document::adopt
+// for a child's document that already keeps the parent's alive, and
+// HTML5Element::rehome for one with another registry.
+void Tag::s_checkGraft(const Tag& parent, const Tag& child) {
+  parent.element_->getDocument()->adopt(*child.element_->getDocument());
+}
+
+Tag::Tag(std::variant<Native, Custom> tag)
+  : Tag(detail::Document::s_create(detail::Document::kStandaloneBlockSize), tag)
+{}
+
+Tag::Tag(std::shared_ptr<detail::Document> document, std::variant<Native, Custom> tag)
+  : document_(std::move(document)), element_(document_->createElement(tag))
+{}
+
+Tag::Tag(std::shared_ptr<detail::Document> document, Element* element) noexcept
+  : document_(std::move(document)), element_(element)
+{}
 
 Tag& Tag::operator<<(const Tag& child) {
+  s_checkGraft(*this, child);
   element_->addChild(child.element_);
   return *this;
 }
 
+Tag& Tag::insertChild(const Tag& child, std::size_t position) {
+  s_checkGraft(*this, child);
+  element_->insertChild(child.element_, position);
+  return *this;
+}
+
+Tag& Tag::removeChild(const Tag& child) {
+  element_->removeChild(child.element_);
+  return *this;
+}
+
+Tag Tag::createElement(std::variant<Native, Custom> tag) const {
+  return Tag(document_, tag);
+}
+
+std::span<Tag::Element* const> Tag::getChildren() const noexcept {
+  return element_->getChildren();
+}
+
+void Tag::setCacheable(bool cacheable) {
+  element_->setCacheable(cacheable);
+}
+
+detail::ElementRange<detail::DepthFirstIterator> Tag::depthFirst() const noexcept {
+  return detail::ElementRange(detail::DepthFirstIterator(element_));
+}
+
+detail::ElementRange<detail::BreadthFirstIterator> Tag::breadthFirst() const {
+  return detail::ElementRange(detail::BreadthFirstIterator(element_));
+}
+
+void Tag::setAttr(std::string_view key, std::string_view value) {
+  element_->setAttr(key, value);
+}
+
+std::string_view Tag::getAttr(std::string_view key) const {
+  return element_->getAttr(key);
+}
+
+bool Tag::hasAttr(std::string_view key) const noexcept {
+  return element_->hasAttr(key);
+}
+
+void Tag::removeAttr(std::string_view key) {
+  element_->removeAttr(key);
+}
+
+void Tag::setAttr(AttrKey key, std::string_view value) {
+  element_->setAttr(key.get(), value);
+}
+
+std::string_view Tag::getAttr(AttrKey key) const {
+  return element_->getAttr(key.get());
+}
+
+bool Tag::hasAttr(AttrKey key) const noexcept {
+  return element_->hasAttr(key.get());
+}
+
+void Tag::removeAttr(AttrKey key) {
+  element_->removeAttr(key.get());
+}
+
+Tag::AttrKey Tag::getAttrKey(std::string_view name) const {
+  return AttrKey(s_getAttrKey(name, element_->getDocument()->getNames()));
+}
+
+Tag Tag::createText(std::string_view text) const {
+  Tag tag(document_, Element::kText);
+  tag.element_->setText(text);
+  return tag;
+}
+
+Tag Tag::createComment(std::string_view text) const {
+  Tag tag(document_, Element::kComment);
+  tag.element_->setText(text);
+  return tag;
+}
+
+// The node goes into the element's document, which is not this handle's
+// when the element was grafted from another one: there it lives as long as
+// the element, without an adoption the handle's document would have to make.
+Tag& Tag::addText(std::string_view text) {
+  detail::Document* document = element_->getDocument();
+  Element* node = document->createElement(Element::kText);
+  node->setText(text);
+  element_->addChild(node);
+  return *this;
+}
+
+bool Tag::isText() const noexcept {
+  return element_->isText();
+}
+
+bool Tag::isComment() const noexcept {
+  return element_->isComment();
+}
+
+std::string Tag::getText() const {
+  if (!element_->isElement())
+    return element_->getText();
+  std::string text;
+  for (const Element& node : depthFirst()) {
+    if (node.isText())
+      node.forEachTextChunk([&text](std::string_view chunk) { text.append(chunk); });
+  }
+  return text;
+}
+
+void Tag::setText(std::string_view text) {
+  if (!element_->isElement()) {
+    element_->setText(text);
+    return;
+  }
+  element_->clearChildren();
+  addText(text);
+}
+
+void Tag::appendText(std::string_view text) {
+  element_->appendText(text);
+}
+
+void Tag::insertText(std::size_t position, std::string_view text) {
+  element_->insertText(position, text);
+}
+
+void Tag::eraseText(std::size_t position, std::size_t count) {
+  element_->eraseText(position, count);
+}
+
 std::string Tag::toString(const std::string& indent, bool show_children, bool show_attrs) const {
-  return s_toString(element_, indent, show_children, show_attrs);
+  std::string html;
+  StringSink sink(html);
+  Serializer serializer(sink);
+  serializer.write(*this, {indent, "\n", show_children, show_attrs});
+  serializer.flush();
+  return html;
 }
 
 std::variant<Tag::Native, Tag::Custom> Tag::getType() const noexcept {
@@ -111,509 +1377,95 @@ std::variant<Tag::Native, Tag::Custom> Tag::getType() const noexcept {
 }
 
 std::string Tag::getName() const {
-  return s_getName(getType());
+  return s_getName(getType(), element_->getDocument()->getNames());
 }
 
-constexpr bool Tag::isCustom() const noexcept {
-  return std::visit([](auto&& arg) -> bool {
-    using T = std::decay_t<decltype(arg)>;
-    if constexpr (std::is_same_v<T, Native> || std::is_same_v<T, Custom>)
-      return detail::EnumRangeChecker::inRange<T, Tag::Global, Tag::Event>(arg);
-    else
-      return false;
-  }, element_->getType());
+bool Tag::isCustom() const noexcept {
+  return std::holds_alternative<Custom>(element_->getType());
 }
 
-std::string Tag::s_toString(
-  std::shared_ptr<detail::HTML5Element> element, 
-  const std::string& indent, 
-  bool show_children, 
-  bool show_attrs)
-{
-  std::ostringstream html;
-  std::stack<std::pair<std::shared_ptr<detail::HTML5Element>, int>> stack;
-  stack.push({std::move(element), 0});
-  while (!stack.empty()) {
-    auto [current_element, level] = std::move(stack.top());
-    stack.pop();
-
-    std::string name = Tag::s_getName(current_element->getType());
-    std::string current_indent(level * indent.length(), ' ');
-    html << current_indent << "<" << name << " ";
-
-    if (show_attrs) {
-      for (const auto& [key, value] : current_element->getAllAttrs()) {
-          html << key << "=\"" << value << "\" ";
-      }
-    }
-    html << ">\n";
-    
-    if (show_children) {
-        const auto& children = current_element->getChildren();
-        if (!children.empty()) {
-            for (auto it = children.rbegin(); it != children.rend(); ++it) {
-                stack.push({*it, level + 1});
-            }
-        }
-    }
-    html << current_indent << "</" << name << ">\n";
+bool Tag::s_isVoid(std::variant<Native, Custom> tag) noexcept {
+  if (!std::holds_alternative<Native>(tag))
+    return false;
+  switch (static_cast<Global>(std::get<Native>(tag))) {
+    case Global::Area: case Global::Base: case Global::Br: case Global::Col:
+    case Global::Embed: case Global::Hr: case Global::Img: case Global::Input:
+    case Global::Link: case Global::Meta: case Global::Param: case Global::Source:
+    case Global::Wbr:
+      return true;
+    default:
+      return false;
   }
-  return html.str();
 }
 
 std::string Tag::s_getName(Native tag)
 {
-  auto it = kNativeMapInverse.find(tag);
-  if (it == kNativeMapInverse.end())
+  if (tag == Element::kText)
+    return "#text";
+  if (tag == Element::kComment)
+    return "#comment";
+  if (tag >= htmlTags.size())
     throw exception::InvalidTag("Cannot find native type with tag " + std::to_string(static_cast<Native>(tag)));
-  return it->second;
+  return std::string(htmlTags[tag]);
 }
 
-std::string Tag::s_getName(Custom tag)
+std::string Tag::s_getName(Custom tag, const detail::Interner& names)
 {
-  auto it = s_custom_inverse_map_.find(tag);
-  if (it == s_custom_inverse_map_.end())
+  auto name = names.name(tag);
+  if (!name)
     throw exception::InvalidTag("Cannot find custom type with tag " + std::to_string(static_cast<Custom>(tag)));
-  return it->second;
+  return std::string(*name);
 }
 
-inline std::string Tag::s_getName(std::variant<Native, Custom> tag) {
-    return std::visit([](auto&& arg) -> std::string {
-        return Tag::s_getName(arg);
-    }, tag);
+std::string Tag::s_getName(std::variant<Native, Custom> tag, const detail::Interner& names) {
+    if (std::holds_alternative<Custom>(tag))
+        return Tag::s_getName(std::get<Custom>(tag), names);
+    return Tag::s_getName(std::get<Native>(tag));
 }
 
-inline std::variant<Tag::Native, Tag::Custom> Tag::s_getType(const std::string& tag_name) noexcept {
-  try {
-    return s_getTypeNative(tag_name);
-  }
-  catch(const exception::InvalidTag& e) {
-    return s_getTypeCustom(tag_name);   // If it's not a native type, it must be a custom type
-  }
+detail::Attribute::Key Tag::s_getAttrKey(std::string_view name, detail::Interner& names) {
+  if (auto native = s_findNative(name))
+    return *native;
+  return detail::Attribute::kCustomBase + s_getTypeCustom(name, names);
 }
 
-constexpr Tag::Native Tag::s_getTypeNative(const std::string& name) {
-  auto it = kNativeMap.find(name);
-  if (it == kNativeMap.end())
-    return static_cast<Tag::Native>(Tag::Global::Custom);
-  return static_cast<Tag::Native>(it->second);  // Return the type of the tag
+std::optional<detail::Attribute::Key> Tag::s_findAttrKey(std::string_view name, const detail::Interner& names) noexcept {
+  if (auto native = s_findNative(name))
+    return *native;
+  if (auto custom = names.find(name))
+    return detail::Attribute::kCustomBase + *custom;
+  return std::nullopt;
 }
 
-Tag::Custom Tag::s_getTypeCustom(const std::string& custom_name) noexcept {
-  if (s_custom_map_.find(custom_name) == s_custom_map_.end())
-  {
-    // If the custom tag doesn't exist, add it to the map
-    size_t value = s_custom_map_.size();
-    s_custom_inverse_map_[value] = custom_name; // Add the custom tag to the inverse map
-    s_custom_map_[custom_name] = value;         // Add the custom tag to the map
-    return value;
-  }
-  return static_cast<Custom>(s_custom_map_[custom_name]);  // Return the type of the custom tag
-}
-
-constexpr const std::array<std::pair<std::string_view, detail::HTML5Element::Native>, 174> Tag::s_createNativeMap() noexcept {
-  #define CONCAT(a, b) a##b
-  #define TO_STRING(name) #name
-
-  #define GLOBAL_TAG(name) {TO_STRING(name), static_cast<detail::HTML5Element::Native>(Tag::Global::name)}
-  #define EVENT_TAG(name) {TO_STRING(name), static_cast<detail::HTML5Element::Native>(Tag::Event::name)}
-
-  return {{
-  {"custom", static_cast<detail::HTML5Element::Native>(Tag::Global::Custom)},
-  GLOBAL_TAG(Address),
-  GLOBAL_TAG(Area),
-  GLOBAL_TAG(Article),
-  GLOBAL_TAG(Aside),
-  GLOBAL_TAG(Footer),
-  GLOBAL_TAG(Header),
-  GLOBAL_TAG(Main),
-  GLOBAL_TAG(Nav),
-  GLOBAL_TAG(Section),
-  // Grouping Content
-  GLOBAL_TAG(Div),
-  GLOBAL_TAG(Figure),
-  GLOBAL_TAG(Figcaption),
-  GLOBAL_TAG(Hr),
-  GLOBAL_TAG(Ol),
-  GLOBAL_TAG(Ul),
-  GLOBAL_TAG(Li),
-  GLOBAL_TAG(Dl),
-  GLOBAL_TAG(Dt),
-  GLOBAL_TAG(Dd),
-  GLOBAL_TAG(Pre),
-  // Text Content
-  GLOBAL_TAG(A),
-  GLOBAL_TAG(B),
-  GLOBAL_TAG(Em),
-  GLOBAL_TAG(I),
-  GLOBAL_TAG(Mark),
-  GLOBAL_TAG(Small),
-  GLOBAL_TAG(Strong),
-  GLOBAL_TAG(Sub),
-  GLOBAL_TAG(Sup),
-  GLOBAL_TAG(U),
-  // Forms
-  GLOBAL_TAG(Button),
-  GLOBAL_TAG(Datalist),
-  GLOBAL_TAG(Fieldset),
-  GLOBAL_TAG(Form),
-  GLOBAL_TAG(Input),
-  GLOBAL_TAG(Label),
-  GLOBAL_TAG(Legend),
-  GLOBAL_TAG(Meter),
-  GLOBAL_TAG(Optgroup),
-  GLOBAL_TAG(Option),
-  GLOBAL_TAG(Output),
-  GLOBAL_TAG(Progress),
-  GLOBAL_TAG(Select),
-  GLOBAL_TAG(Textarea),
-  // Interactive Elements
-  GLOBAL_TAG(Details),
-  GLOBAL_TAG(Dialog),
-  GLOBAL_TAG(Menu),
-  GLOBAL_TAG(Summary),
-  // Embedded Content
-  GLOBAL_TAG(Audio),
-  GLOBAL_TAG(Canvas),
-  GLOBAL_TAG(Embed),
-  GLOBAL_TAG(IFrame),
-  GLOBAL_TAG(Img),
-  GLOBAL_TAG(Object),
-  GLOBAL_TAG(Picture),
-  GLOBAL_TAG(Source),
-  GLOBAL_TAG(Svg),
-  GLOBAL_TAG(Video),
-  // Tabular Data
-  GLOBAL_TAG(Table),
-  GLOBAL_TAG(Caption),
-  GLOBAL_TAG(Col),
-  GLOBAL_TAG(Colgroup),
-  GLOBAL_TAG(Tbody),
-  GLOBAL_TAG(Td),
-  GLOBAL_TAG(Tfoot),
-  GLOBAL_TAG(Th),
-  GLOBAL_TAG(Thead),
-  GLOBAL_TAG(Tr),
-  // Document Metadata
-  GLOBAL_TAG(Base),
-  GLOBAL_TAG(Body),
-  GLOBAL_TAG(Head),
-  GLOBAL_TAG(Link),
-  GLOBAL_TAG(Meta),
-  GLOBAL_TAG(Style),
-  GLOBAL_TAG(Title),
-  // Scripting
-  GLOBAL_TAG(Noscript),
-  GLOBAL_TAG(Script),
-  GLOBAL_TAG(Template),
-  // Demarcating Edits
-  GLOBAL_TAG(Del),
-  GLOBAL_TAG(Ins),
-  // Text-Level Semantics
-  GLOBAL_TAG(Abbr),
-  GLOBAL_TAG(Bdi),
-  GLOBAL_TAG(Bdo),
-  GLOBAL_TAG(Br),
-  GLOBAL_TAG(Cite),
-  GLOBAL_TAG(Code),
-  GLOBAL_TAG(Data),
-  GLOBAL_TAG(Dfn),
-  GLOBAL_TAG(Kbd),
-  GLOBAL_TAG(Q),
-  GLOBAL_TAG(Rp),
-  GLOBAL_TAG(Rt),
-  GLOBAL_TAG(Ruby),
-  GLOBAL_TAG(Samp),
-  GLOBAL_TAG(Span),
-  GLOBAL_TAG(Time),
-  GLOBAL_TAG(Var),
-  GLOBAL_TAG(Wbr),
-  // Obsolete and Deprecated Elements
-  GLOBAL_TAG(Acronym),
-  GLOBAL_TAG(Big),
-  GLOBAL_TAG(Center),
-  GLOBAL_TAG(Dir),
-  GLOBAL_TAG(Font),
-  GLOBAL_TAG(Frame),
-  GLOBAL_TAG(Frameset),
-  GLOBAL_TAG(Marquee),
-  GLOBAL_TAG(MenuItem),
-  GLOBAL_TAG(NoFrames),
-  GLOBAL_TAG(Nobr),
-  GLOBAL_TAG(Param),
-  GLOBAL_TAG(PlainText),
-  GLOBAL_TAG(Rb),
-  GLOBAL_TAG(Rtc),
-  GLOBAL_TAG(Strike),
-  GLOBAL_TAG(Tt),
-  GLOBAL_TAG(Xmp),
-  // Attribute
-  GLOBAL_TAG(AccessKey),
-  GLOBAL_TAG(Class),
-  GLOBAL_TAG(ContentEditable),
-  GLOBAL_TAG(ContextMenu),
-  GLOBAL_TAG(Draggable),
-  GLOBAL_TAG(DropZone),
-  GLOBAL_TAG(Hidden),
-  GLOBAL_TAG(Id),
-  GLOBAL_TAG(Lang),
-  GLOBAL_TAG(SpellCheck),
-  GLOBAL_TAG(TabIndex),
-  GLOBAL_TAG(Translate),
-  GLOBAL_TAG(XmlLang),
-  // Event Attributes
-  EVENT_TAG(OnAfterPrint),
-  EVENT_TAG(OnBeforePrint),
-  EVENT_TAG(OnBeforeUnload),
-  EVENT_TAG(OnError),
-  EVENT_TAG(OnHashChange),
-  EVENT_TAG(OnLoad),
-  EVENT_TAG(OnMessage),
-  EVENT_TAG(OnOffline),
-  EVENT_TAG(OnOnline),
-  EVENT_TAG(OnPageHide),
-  EVENT_TAG(OnPageShow),
-  EVENT_TAG(OnPopState),
-  EVENT_TAG(OnResize),
-  EVENT_TAG(OnStorage),
-  EVENT_TAG(OnUnload),
-  EVENT_TAG(OnBlur),
-  EVENT_TAG(OnChange),
-  EVENT_TAG(OnFocus),
-  EVENT_TAG(OnInput),
-  EVENT_TAG(OnInvalid),
-  EVENT_TAG(OnReset),
-  EVENT_TAG(OnSelect),
-  EVENT_TAG(OnSearch),
-  EVENT_TAG(OnSubmit),
-  EVENT_TAG(OnClick),
-  EVENT_TAG(OnDblClick),
-  EVENT_TAG(OnContextMenu),
-  EVENT_TAG(OnDrag),
-  EVENT_TAG(OnDragEnd),
-  EVENT_TAG(OnDragEnter),
-  EVENT_TAG(OnDragLeave),
-  EVENT_TAG(OnDragOver),
-  EVENT_TAG(OnDragStart),
-  EVENT_TAG(OnDrop),
-  EVENT_TAG(OnMouseDown),
-  EVENT_TAG(OnMouseMove),
-  EVENT_TAG(OnMouseOut),
-  EVENT_TAG(OnMouseOver),
-  EVENT_TAG(OnMouseUp),
-  EVENT_TAG(OnMouseWheel),
-  EVENT_TAG(OnScroll),
-  EVENT_TAG(OnShow),
-  EVENT_TAG(OnToggle),
-  EVENT_TAG(OnWheel)
-}};
-  #undef GLOBAL_TAG
-  #undef EVENT_TAG
-  #undef CONCAT
-  #undef TO_STRING
-}
-
-constexpr const std::array<std::pair<Tag::Native, std::string_view>, 174> Tag::s_createNativeMapInverse() noexcept {
-
-  #define CONCAT(a, b) a##b
-  #define TO_STRING(name) #name
-
-  #define GLOBAL_TAG(name) {static_cast<detail::HTML5Element::Native>(Tag::Global::name), TO_STRING(name)}
-  #define EVENT_TAG(name) {static_cast<detail::HTML5Element::Native>(Tag::Event::name), TO_STRING(name)}
-  return {{
-    {static_cast<detail::HTML5Element::Native>(Tag::Global::Custom), TO_STRING(custom)},
-    GLOBAL_TAG(Address),
-    GLOBAL_TAG(Area),
-    GLOBAL_TAG(Article),
-    GLOBAL_TAG(Aside),
-    GLOBAL_TAG(Footer),
-    GLOBAL_TAG(Header),
-    GLOBAL_TAG(Main),
-    GLOBAL_TAG(Nav),
-    GLOBAL_TAG(Section),
-    // Grouping Content
-    GLOBAL_TAG(Div),
-    GLOBAL_TAG(Figure),
-    GLOBAL_TAG(Figcaption),
-    GLOBAL_TAG(Hr),
-    GLOBAL_TAG(Ol),
-    GLOBAL_TAG(Ul),
-    GLOBAL_TAG(Li),
-    GLOBAL_TAG(Dl),
-    GLOBAL_TAG(Dt),
-    GLOBAL_TAG(Dd),
-    GLOBAL_TAG(Pre),
-    // Text Content
-    GLOBAL_TAG(A),
-    GLOBAL_TAG(B),
-    GLOBAL_TAG(Em),
-    GLOBAL_TAG(I),
-    GLOBAL_TAG(Mark),
-    GLOBAL_TAG(Small),
-    GLOBAL_TAG(Strong),
-    GLOBAL_TAG(Sub),
-    GLOBAL_TAG(Sup),
-    GLOBAL_TAG(U),
-    // Forms
-    GLOBAL_TAG(Button),
-    GLOBAL_TAG(Datalist),
-    GLOBAL_TAG(Fieldset),
-    GLOBAL_TAG(Form),
-    GLOBAL_TAG(Input),
-    GLOBAL_TAG(Label),
-    GLOBAL_TAG(Legend),
-    GLOBAL_TAG(Meter),
-    GLOBAL_TAG(Optgroup),
-    GLOBAL_TAG(Option),
-    GLOBAL_TAG(Output),
-    GLOBAL_TAG(Progress),
-    GLOBAL_TAG(Select),
-    GLOBAL_TAG(Textarea),
-    // Interactive Elements
-    GLOBAL_TAG(Details),
-    GLOBAL_TAG(Dialog),
-    GLOBAL_TAG(Menu),
-    GLOBAL_TAG(Summary),
-    // Embedded Content
-    GLOBAL_TAG(Audio),
-    GLOBAL_TAG(Canvas),
-    GLOBAL_TAG(Embed),
-    GLOBAL_TAG(IFrame),
-    GLOBAL_TAG(Img),
-    GLOBAL_TAG(Object),
-    GLOBAL_TAG(Picture),
-    GLOBAL_TAG(Source),
-    GLOBAL_TAG(Svg),
-    GLOBAL_TAG(Video),
-    // Tabular Data
-    GLOBAL_TAG(Table),
-    GLOBAL_TAG(Caption),
-    GLOBAL_TAG(Col),
-    GLOBAL_TAG(Colgroup),
-    GLOBAL_TAG(Tbody),
-    GLOBAL_TAG(Td),
-    GLOBAL_TAG(Tfoot),
-    GLOBAL_TAG(Th),
-    GLOBAL_TAG(Thead),
-    GLOBAL_TAG(Tr),
-    // Document Metadata
-    GLOBAL_TAG(Base),
-    GLOBAL_TAG(Body),
-    GLOBAL_TAG(Head),
-    GLOBAL_TAG(Link),
-    GLOBAL_TAG(Meta),
-    GLOBAL_TAG(Style),
-    GLOBAL_TAG(Title),
-    // Scripting
-    GLOBAL_TAG(Noscript),
-    GLOBAL_TAG(Script),
-    GLOBAL_TAG(Template),
-    // Demarcating Edits
-    GLOBAL_TAG(Del),
-    GLOBAL_TAG(Ins),
-    // Text-Level Semantics
-    GLOBAL_TAG(Abbr),
-    GLOBAL_TAG(Bdi),
-    GLOBAL_TAG(Bdo),
-    GLOBAL_TAG(Br),
-    GLOBAL_TAG(Cite),
-    GLOBAL_TAG(Code),
-    GLOBAL_TAG(Data),
-    GLOBAL_TAG(Dfn),
-    GLOBAL_TAG(Kbd),
-    GLOBAL_TAG(Q),
-    GLOBAL_TAG(Rp),
-    GLOBAL_TAG(Rt),
-    GLOBAL_TAG(Ruby),
-    GLOBAL_TAG(Samp),
-    GLOBAL_TAG(Span),
-    GLOBAL_TAG(Time),
-    GLOBAL_TAG(Var),
-    GLOBAL_TAG(Wbr),
-    // Obsolete and Deprecated Elements
-    GLOBAL_TAG(Acronym),
-    GLOBAL_TAG(Big),
-    GLOBAL_TAG(Center),
-    GLOBAL_TAG(Dir),
-    GLOBAL_TAG(Font),
-    GLOBAL_TAG(Frame),
-    GLOBAL_TAG(Frameset),
-    GLOBAL_TAG(Marquee),
-    GLOBAL_TAG(MenuItem),
-    GLOBAL_TAG(NoFrames),
-    GLOBAL_TAG(Nobr),
-    GLOBAL_TAG(Param),
-    GLOBAL_TAG(PlainText),
-    GLOBAL_TAG(Rb),
-    GLOBAL_TAG(Rtc),
-    GLOBAL_TAG(Strike),
-    GLOBAL_TAG(Tt),
-    GLOBAL_TAG(Xmp),
-    // Attribute
-    GLOBAL_TAG(AccessKey),
-    GLOBAL_TAG(Class),
-    GLOBAL_TAG(ContentEditable),
-    GLOBAL_TAG(ContextMenu),
-    GLOBAL_TAG(Draggable),
-    GLOBAL_TAG(DropZone),
-    GLOBAL_TAG(Hidden),
-    GLOBAL_TAG(Id),
-    GLOBAL_TAG(Lang),
-    GLOBAL_TAG(SpellCheck),
-    GLOBAL_TAG(TabIndex),
-    GLOBAL_TAG(Translate),
-    GLOBAL_TAG(XmlLang),
-    // Event Attributes
-    EVENT_TAG(OnAfterPrint),
-    EVENT_TAG(OnBeforePrint),
-    EVENT_TAG(OnBeforeUnload),
-    EVENT_TAG(OnError),
-    EVENT_TAG(OnHashChange),
-    EVENT_TAG(OnLoad),
-    EVENT_TAG(OnMessage),
-    EVENT_TAG(OnOffline),
-    EVENT_TAG(OnOnline),
-    EVENT_TAG(OnPageHide),
-    EVENT_TAG(OnPageShow),
-    EVENT_TAG(OnPopState),
-    EVENT_TAG(OnResize),
-    EVENT_TAG(OnStorage),
-    EVENT_TAG(OnUnload),
-    EVENT_TAG(OnBlur),
-    EVENT_TAG(OnChange),
-    EVENT_TAG(OnFocus),
-    EVENT_TAG(OnInput),
-    EVENT_TAG(OnInvalid),
-    EVENT_TAG(OnReset),
-    EVENT_TAG(OnSelect),
-    EVENT_TAG(OnSearch),
-    EVENT_TAG(OnSubmit),
-    EVENT_TAG(OnClick),
-    EVENT_TAG(OnDblClick),
-    EVENT_TAG(OnContextMenu),
-    EVENT_TAG(OnDrag),
-    EVENT_TAG(OnDragEnd),
-    EVENT_TAG(OnDragEnter),
-    EVENT_TAG(OnDragLeave),
-    EVENT_TAG(OnDragOver),
-    EVENT_TAG(OnDragStart),
-    EVENT_TAG(OnDrop),
-    EVENT_TAG(OnMouseDown),
-    EVENT_TAG(OnMouseMove),
-    EVENT_TAG(OnMouseOut),
-    EVENT_TAG(OnMouseOver),
-    EVENT_TAG(OnMouseUp),
-    EVENT_TAG(OnMouseWheel),
-    EVENT_TAG(OnScroll),
-    EVENT_TAG(OnShow),
-    EVENT_TAG(OnToggle),
-    EVENT_TAG(OnWheel)
-    }};
-  #undef GLOBAL_TAG
-  #undef EVENT_TAG
-  #undef CONCAT
-  #undef TO_STRING
+std::string_view Tag::s_getAttrName(detail::Attribute::Key key, const detail::Interner& names) {
+  if (key < detail::Attribute::kCustomBase)
+    return htmlTags.at(key);
+  auto name = names.name(key - detail::Attribute::kCustomBase);
+  if (!name)
+    throw exception::InvalidAttribute("Cannot find attribute with key " + std::to_string(key));
+  return *name;
+}
+
+std::variant<Tag::Native, Tag::Custom> Tag::s_getType(std::string_view tag_name, detail::Interner& names) {
+  if (auto native = s_findNative(tag_name))
+    return *native;
+  return s_getTypeCustom(tag_name, names);   // If it's not a native type, it must be a custom type
+}
+
+Tag::Native Tag::s_getTypeNative(std::string_view native_name) {
+  if (auto native = s_findNative(native_name))
+    return *native;
+  throw exception::InvalidTag("Cannot find native type with name " + std::string(native_name));
 }
 
+std::optional<Tag::Native> Tag::s_findNative(std::string_view name) noexcept {
+  if (auto index = kNativeNames.find(name))
+    return static_cast<Native>(*index);
+  return std::nullopt;
+}
+
+Tag::Custom Tag::s_getTypeCustom(std::string_view custom_name, detail::Interner& names) {
+  return names.intern(custom_name);
+}
 
 } // namespace hi
\ No newline at end of file
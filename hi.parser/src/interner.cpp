@@ -0,0 +1,176 @@
+#include "hi.parser/interner.h"
+
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+namespace hi
+{
+namespace detail
+{
+
+namespace
+{
+
+constexpr std::size_t kShardMask = Interner::kShards - 1;
+
+// Segment k holds ids [64 * (2^k - 1), 64 * (2^(k+1) - 1)).
+std::size_t s_segment(uint32_t id, std::size_t first_bits) noexcept {
+  return static_cast<std::size_t>(std::bit_width((static_cast<uint64_t>(id) >> first_bits) + 1)) - 1;
+}
+
+std::size_t s_segmentStart(std::size_t segment, std::size_t first_bits) noexcept {
+  return ((std::size_t(1) << segment) - 1) << first_bits;
+}
+
+} // namespace
+
+Interner::Interner() : next_id_(0) {
+  for (auto& segment : segments_)
+    segment.store(nullptr, std::memory_order_relaxed);
+}
+
+Interner::~Interner() {
+  for (auto& segment : segments_)
+    delete[] segment.load(std::memory_order_relaxed);
+}
+
+Interner& Interner::global() {
+  static Interner interner;
+  return interner;
+}
+
+uint64_t Interner::s_hash(std::string_view name) noexcept {
+  // Spread std::hash upwards: the slot uses the low bits, the shard bits
+  // 28-31 and the tag stored next to the id the high half.
+  return static_cast<uint64_t>(std::hash<std::string_view>{}(name)) * 0x9E3779B97F4A7C15ull;
+}
+
+std::optional<Interner::Id> Interner::find(std::string_view name) const noexcept {
+  const uint64_t hash = s_hash(name);
+  const Shard& shard = shards_[(hash >> 28) & kShardMask];
+  if (auto id = findIn(shard.table.load(std::memory_order_acquire), name, hash))
+    return id;
+  std::lock_guard lock(shard.mutex);
+  return findIn(shard.table.load(std::memory_order_relaxed), name, hash);
+}
+
+Interner::Id Interner::intern(std::string_view name) {
+  const uint64_t hash = s_hash(name);
+  Shard& shard = shards_[(hash >> 28) & kShardMask];
+  if (auto id = findIn(shard.table.load(std::memory_order_acquire), name, hash))
+    return *id;
+
+  std::lock_guard lock(shard.mutex);
+  const Table* table = shard.table.load(std::memory_order_relaxed);
+  if (auto id = findIn(table, name, hash))
+    return *id;
+  if (table == nullptr || (shard.count + 1) * 2 > table->mask + 1)
+    table = grow(shard, table);
+
+  const Id id = next_id_.fetch_add(1, std::memory_order_relaxed);
+  char* copy = shard.arena.allocateArray<char>(name.size() + 1);
+  std::memcpy(copy, name.data(), name.size());
+  copy[name.size()] = '\0';
+  Entry& slot = entry(id);
+  slot.size = static_cast<uint32_t>(name.size());
+  slot.data.store(copy, std::memory_order_release);
+
+  uint32_t i = static_cast<uint32_t>(hash) & table->mask;
+  while (table->slots[i].load(std::memory_order_relaxed) != 0)
+    i = (i + 1) & table->mask;
+  table->slots[i].store((hash >> 32 << 32) | (static_cast<uint64_t>(id) + 1), std::memory_order_release);
+  ++shard.count;
+  return id;
+}
+
+std::optional<std::string_view> Interner::name(Id id) const noexcept {
+  const std::size_t segment = s_segment(id, kFirstSegmentBits);
+  if (segment >= kSegments)
+    return std::nullopt;
+  const Entry* entries = segments_[segment].load(std::memory_order_acquire);
+  if (entries == nullptr)
+    return std::nullopt;
+  const Entry& entry = entries[id - s_segmentStart(segment, kFirstSegmentBits)];
+  const char* data = entry.data.load(std::memory_order_acquire);
+  if (data == nullptr)
+    return std::nullopt;
+  return std::string_view(data, entry.size);
+}
+
+std::optional<Interner::Id> Interner::findIn(const Table* table, std::string_view name, uint64_t hash) const noexcept {
+  if (table == nullptr)
+    return std::nullopt;
+  const uint64_t tag = hash >> 32;
+  for (uint32_t i = static_cast<uint32_t>(hash) & table->mask;; i = (i + 1) & table->mask) {
+    const uint64_t slot = table->slots[i].load(std::memory_order_acquire);
+    if (slot == 0)
+      return std::nullopt;
+    if ((slot >> 32) != tag)
+      continue;
+    const Id id = static_cast<Id>(slot) - 1;
+    if (this->name(id) == name)
+      return id;
+  }
+}
+
+MemoryCounter Interner::getMemoryUsage() {
+  MemoryCounter usage;
+  for (Shard& shard : shards_) {
+    std::lock_guard lock(shard.mutex);
+    usage.bytes += shard.arena.capacity();
+  }
+  for (std::size_t segment = 0; segment < kSegments; ++segment) {
+    if (segments_[segment].load(std::memory_order_acquire) != nullptr)
+      usage.bytes += sizeof(Entry) << (segment + kFirstSegmentBits);
+  }
+  usage.allocations = usage.live_objects = size();
+  usage.live_bytes = usage.bytes;
+  return usage;
+}
+
+// Shards start without a table, so an unused registry allocates nothing.
+const Interner::Table* Interner::grow(Shard& shard, const Table* table) {
+  const uint32_t capacity = table == nullptr ? kInitialSlots : (table->mask + 1) * 2;
+  auto* bigger = shard.arena.make<Table>();
+  bigger->mask = capacity - 1;
+  bigger->slots = static_cast<std::atomic<uint64_t>*>(
+    shard.arena.allocate(sizeof(std::atomic<uint64_t>) * capacity, alignof(std::atomic<uint64_t>)));
+  for (uint32_t i = 0; i < capacity; ++i)
+    new (&bigger->slots[i]) std::atomic<uint64_t>(0);
+
+  for (uint32_t i = 0; table != nullptr && i <= table->mask; ++i) {
+    const uint64_t slot = table->slots[i].load(std::memory_order_relaxed);
+    if (slot == 0)
+      continue;
+    const uint64_t hash = s_hash(*name(static_cast<Id>(slot) - 1));
+    uint32_t j = static_cast<uint32_t>(hash) & bigger->mask;
+    while (bigger->slots[j].load(std::memory_order_relaxed) != 0)
+      j = (j + 1) & bigger->mask;
+    bigger->slots[j].store(slot, std::memory_order_relaxed);
+  }
+  // Readers still walking the old table keep seeing a consistent, if stale,
+  // view; a miss there sends find() and intern() to the locked path.
+  shard.table.store(bigger, std::memory_order_release);
+  return bigger;
+}
+
+Interner::Entry& Interner::entry(Id id) {
+  const std::size_t segment = s_segment(id, kFirstSegmentBits);
+  if (segment >= kSegments)
+    throw std::length_error("hi::detail::Interner ran out of ids");
+  Entry* entries = segments_[segment].load(std::memory_order_acquire);
+  if (entries == nullptr) {
+    Entry* fresh = new Entry[std::size_t(1) << (segment + kFirstSegmentBits)]();
+    if (segments_[segment].compare_exchange_strong(entries, fresh, std::memory_order_acq_rel))
+      entries = fresh;
+    else
+      delete[] fresh;
+  }
+  return entries[id - s_segmentStart(segment, kFirstSegmentBits)];
+}
+
+} // namespace detail
+} // namespace hi
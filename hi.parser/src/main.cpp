@@ -1,9 +1,26 @@
 #include "hi.parser/html5.h"
+#include "hi.parser/parser.h"
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 using namespace hi;
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file) {
+            std::cerr << "Cannot open " << argv[1] << std::endl;
+            return 1;
+        }
+        std::ostringstream source;
+        source << file.rdbuf();
+
+        HTML5Parser parser;
+        std::cout << parser.parse(source.str()).toString() << std::endl;
+        return 0;
+    }
+
     std::string d = "div";
     Tag div("div");
 
@@ -11,4 +28,4 @@ int main() {
     std::cout << div.toString() << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,169 @@
+#include "hi.parser/memory.h"
+#include "hi.parser/interner.h"
+
+#include <atomic>
+#include <cstdio>
+
+namespace hi
+{
+
+namespace
+{
+
+struct AtomicCounter {
+  std::atomic<std::size_t> allocations{0};
+  std::atomic<std::size_t> bytes{0};
+  std::atomic<std::size_t> live_objects{0};
+  std::atomic<std::size_t> live_bytes{0};
+};
+
+std::atomic<bool> s_enabled{false};
+std::array<AtomicCounter, kMemoryCategories> s_totals;
+std::atomic<std::size_t> s_live_bytes{0};
+std::atomic<std::size_t> s_peak_bytes{0};
+
+constexpr const char* kCategoryNames[kMemoryCategories] = {
+  "elements", "attributes", "strings", "children", "text", "caches", "names",
+};
+
+// Wraps around for negative deltas, which unsigned addition undoes exactly.
+inline void s_add(std::atomic<std::size_t>& counter, std::ptrdiff_t delta) noexcept {
+  counter.fetch_add(static_cast<std::size_t>(delta), std::memory_order_relaxed);
+}
+
+inline void s_raise(std::atomic<std::size_t>& peak, std::size_t value) noexcept {
+  std::size_t current = peak.load(std::memory_order_relaxed);
+  while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+
+std::size_t MemoryUsage::getLiveBytes() const noexcept {
+  std::size_t live = 0;
+  for (const MemoryCounter& counter : categories)
+    live += counter.live_bytes;
+  return live;
+}
+
+std::string MemoryUsage::toString() const {
+  std::string text;
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-12s %12s %14s %12s %14s\n", "category", "allocations", "bytes", "live", "live bytes");
+  text += line;
+  MemoryCounter total;
+  for (std::size_t i = 0; i < kMemoryCategories; ++i) {
+    const MemoryCounter& counter = categories[i];
+    std::snprintf(line, sizeof(line), "%-12s %12zu %14zu %12zu %14zu\n",
+      kCategoryNames[i], counter.allocations, counter.bytes, counter.live_objects, counter.live_bytes);
+    text += line;
+    total.allocations += counter.allocations;
+    total.bytes += counter.bytes;
+    total.live_objects += counter.live_objects;
+    total.live_bytes += counter.live_bytes;
+  }
+  std::snprintf(line, sizeof(line), "%-12s %12zu %14zu %12zu %14zu\npeak %zu bytes, reserved %zu bytes\n",
+    "total", total.allocations, total.bytes, total.live_objects, total.live_bytes, peak_bytes, reserved_bytes);
+  text += line;
+  return text;
+}
+
+const char* MemoryUsage::s_getName(MemoryCategory category) noexcept {
+  return kCategoryNames[static_cast<std::size_t>(category)];
+}
+
+
+void MemoryTracker::setEnabled(bool enabled) noexcept {
+  s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool MemoryTracker::isEnabled() noexcept {
+  return s_enabled.load(std::memory_order_relaxed);
+}
+
+MemoryUsage MemoryTracker::getTotals() {
+  MemoryUsage usage;
+  for (std::size_t i = 0; i < kMemoryCategories; ++i) {
+    usage.categories[i].allocations = s_totals[i].allocations.load(std::memory_order_relaxed);
+    usage.categories[i].bytes = s_totals[i].bytes.load(std::memory_order_relaxed);
+    usage.categories[i].live_objects = s_totals[i].live_objects.load(std::memory_order_relaxed);
+    usage.categories[i].live_bytes = s_totals[i].live_bytes.load(std::memory_order_relaxed);
+  }
+  usage[MemoryCategory::Names] = detail::Interner::global().getMemoryUsage();
+  usage.peak_bytes = s_peak_bytes.load(std::memory_order_relaxed);
+  return usage;
+}
+
+void MemoryTracker::resetPeak() noexcept {
+  s_peak_bytes.store(s_live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+
+namespace detail
+{
+
+MemoryAccount::MemoryAccount() noexcept = default;
+
+MemoryAccount::~MemoryAccount() {
+  report();
+  for (std::size_t i = 0; i < kMemoryCategories; ++i) {
+    s_add(s_totals[i].live_objects, -static_cast<std::ptrdiff_t>(usage_.categories[i].live_objects));
+    s_add(s_totals[i].live_bytes, -static_cast<std::ptrdiff_t>(usage_.categories[i].live_bytes));
+  }
+  s_add(s_live_bytes, -static_cast<std::ptrdiff_t>(live_bytes_));
+}
+
+void MemoryAccount::allocate(MemoryCategory category, std::size_t bytes) noexcept {
+  MemoryCounter& counter = usage_[category];
+  ++counter.allocations;
+  counter.bytes += bytes;
+  addLive(category, 1, static_cast<std::ptrdiff_t>(bytes));
+}
+
+void MemoryAccount::reallocate(MemoryCategory category, std::size_t old_bytes, std::size_t bytes) noexcept {
+  MemoryCounter& counter = usage_[category];
+  ++counter.allocations;
+  counter.bytes += bytes;
+  addLive(category, 0, static_cast<std::ptrdiff_t>(bytes) - static_cast<std::ptrdiff_t>(old_bytes));
+}
+
+void MemoryAccount::resize(MemoryCategory category, std::size_t old_bytes, std::size_t bytes) noexcept {
+  if (bytes > old_bytes)
+    usage_[category].bytes += bytes - old_bytes;
+  addLive(category, 0, static_cast<std::ptrdiff_t>(bytes) - static_cast<std::ptrdiff_t>(old_bytes));
+}
+
+void MemoryAccount::release(MemoryCategory category, std::size_t bytes) noexcept {
+  addLive(category, -1, -static_cast<std::ptrdiff_t>(bytes));
+}
+
+void MemoryAccount::addLive(MemoryCategory category, std::ptrdiff_t objects, std::ptrdiff_t bytes) noexcept {
+  MemoryCounter& counter = usage_[category];
+  counter.live_objects += static_cast<std::size_t>(objects);
+  counter.live_bytes += static_cast<std::size_t>(bytes);
+  live_bytes_ += static_cast<std::size_t>(bytes);
+  if (live_bytes_ > usage_.peak_bytes)
+    usage_.peak_bytes = live_bytes_;
+  if (bytes > 0 && (unreported_ += static_cast<std::size_t>(bytes)) >= kMemoryBatch)
+    report();
+}
+
+// Moves what changed since the last report into the totals. Differences of
+// counters that shrank wrap around, which s_add undoes.
+void MemoryAccount::report() noexcept {
+  const std::size_t live_delta = live_bytes_ - reported_.getLiveBytes();
+  for (std::size_t i = 0; i < kMemoryCategories; ++i) {
+    const MemoryCounter& counter = usage_.categories[i];
+    MemoryCounter& reported = reported_.categories[i];
+    s_add(s_totals[i].allocations, static_cast<std::ptrdiff_t>(counter.allocations - reported.allocations));
+    s_add(s_totals[i].bytes, static_cast<std::ptrdiff_t>(counter.bytes - reported.bytes));
+    s_add(s_totals[i].live_objects, static_cast<std::ptrdiff_t>(counter.live_objects - reported.live_objects));
+    s_add(s_totals[i].live_bytes, static_cast<std::ptrdiff_t>(counter.live_bytes - reported.live_bytes));
+    reported = counter;
+  }
+  s_raise(s_peak_bytes, s_live_bytes.fetch_add(live_delta, std::memory_order_relaxed) + live_delta);
+  unreported_ = 0;
+}
+
+} // namespace detail
+} // namespace hi
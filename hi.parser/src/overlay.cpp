@@ -0,0 +1,259 @@
+#include "hi.parser/overlay.h"
+#include "hi.parser/serializer.h"
+
+#include <algorithm>
+
+namespace hi
+{
+
+namespace
+{
+
+bool s_isText(FrozenDOM::Key type) noexcept {
+  return type == Tag::Element::kText || type == Tag::Element::kComment;
+}
+
+} // namespace
+
+
+OverlayDOM::OverlayDOM(FrozenDOM layout) : layout_(std::move(layout)) {}
+
+void OverlayDOM::setAttr(Index node, std::string_view key, std::string_view value) {
+  const Key id = getKey(key);
+  auto owned = std::make_shared<const std::string>(value);
+  edit(node, [&](Node& copy) {
+    if (s_isText(copy.type))
+      throw exception::InvalidAttribute("Text and comment nodes have no attributes");
+    const Value stored{*owned, owned};
+    for (Attribute& attribute : copy.attributes) {
+      if (attribute.key == id) {
+        attribute.value = stored;
+        return;
+      }
+    }
+    copy.attributes.push_back({id, stored});
+  });
+}
+
+void OverlayDOM::removeAttr(Index node, std::string_view key) {
+  const Key id = findKey(key);
+  Index frozen = kNone;
+  const Node* copy = find(node, frozen);
+  if (copy == nullptr && frozen == kNone)
+    throw exception::InvalidTag("Node " + std::to_string(node) + " was removed");
+  // Nothing to copy when the attribute is not there.
+  const auto has = [id](const auto& attributes) {
+    return std::any_of(attributes.begin(), attributes.end(), [id](const auto& attribute) { return attribute.key == id; });
+  };
+  if (id == kNone || !(copy != nullptr ? has(copy->attributes) : has(layout_.getAttrs(frozen))))
+    return;
+  edit(node, [id](Node& copy) {
+    std::erase_if(copy.attributes, [id](const Attribute& attribute) { return attribute.key == id; });
+  });
+}
+
+void OverlayDOM::setText(Index node, std::string_view text) {
+  auto owned = std::make_shared<const std::string>(text);
+  edit(node, [&](Node& copy) {
+    const Value stored{*owned, owned};
+    if (s_isText(copy.type)) {
+      copy.text = stored;
+      return;
+    }
+    auto child = std::make_shared<const Node>(Node{kNone, Tag::Element::kText, {}, stored, {}});
+    copy.children.clear();
+    copy.children.push_back({std::move(child), kNone, 0});
+  });
+}
+
+// The copy of the frozen child goes to the grafts of this overlay alone:
+// the list is copied, not the trees in it.
+void OverlayDOM::addChild(Index parent, const Tag& child) {
+  auto grafts = grafts_ ? std::make_shared<std::vector<FrozenDOM>>(*grafts_) : std::make_shared<std::vector<FrozenDOM>>();
+  grafts->emplace_back(child);
+  const auto tree = static_cast<uint32_t>(grafts->size());
+  edit(parent, [tree](Node& copy) {
+    if (s_isText(copy.type))
+      throw exception::InvalidTag("Text and comment nodes have no children");
+    copy.children.push_back({nullptr, 0, tree});
+  });
+  grafts_ = std::move(grafts);
+}
+
+void OverlayDOM::remove(Index node) {
+  if (node >= layout_.size())
+    throw exception::InvalidTag("Node " + std::to_string(node) + " is not in the layout");
+  const Index parent = layout_.getParents()[node];
+  if (parent == kNone)
+    throw exception::InvalidTag("Roots cannot be removed");
+  edit(parent, [&](Node& copy) {
+    const auto it = std::find_if(copy.children.begin(), copy.children.end(), [&](const Child& child) { return getOrigin(child) == node; });
+    if (it == copy.children.end())
+      throw exception::InvalidTag("Node " + std::to_string(node) + " was removed");
+    copy.children.erase(it);
+  });
+}
+
+bool OverlayDOM::contains(Index node) const {
+  Index frozen = kNone;
+  return find(node, frozen) != nullptr || frozen != kNone;
+}
+
+std::string_view OverlayDOM::getAttr(Index node, std::string_view key) const {
+  const Key id = findKey(key);
+  Index frozen = kNone;
+  if (const Node* copy = find(node, frozen)) {
+    for (const Attribute& attribute : copy->attributes) {
+      if (attribute.key == id)
+        return attribute.value.view;
+    }
+  } else if (frozen != kNone) {
+    for (const FrozenDOM::Attribute& attribute : layout_.getAttrs(frozen)) {
+      if (attribute.key == id)
+        return layout_.getString(attribute.value);
+    }
+  } else {
+    throw exception::InvalidTag("Node " + std::to_string(node) + " was removed");
+  }
+  throw exception::InvalidAttribute("Attribute " + std::string(key) + " not found");
+}
+
+std::string OverlayDOM::toString() const {
+  std::string html;
+  StringSink sink(html);
+  Serializer serializer(sink);
+  serializer.write(*this);
+  serializer.flush();
+  return html;
+}
+
+std::vector<OverlayDOM::Index> OverlayDOM::getPath(Index node) const {
+  if (node >= layout_.size())
+    throw exception::InvalidTag("Node " + std::to_string(node) + " is not in the layout");
+  std::vector<Index> path;
+  for (; node != kNone; node = layout_.getParents()[node])
+    path.push_back(node);
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+// Below the first child no edit reached, the subtree is as frozen.
+const OverlayDOM::Node* OverlayDOM::find(Index node, Index& frozen) const {
+  const std::vector<Index> path = getPath(node);
+  frozen = kNone;
+  if (!top_) {
+    frozen = node;
+    return nullptr;
+  }
+  const Node* copy = top_.get();
+  for (Index index : path) {
+    const auto it = std::find_if(copy->children.begin(), copy->children.end(), [&](const Child& child) { return getOrigin(child) == index; });
+    if (it == copy->children.end())
+      return nullptr;
+    if (!it->node) {
+      frozen = node;
+      return nullptr;
+    }
+    copy = it->node.get();
+  }
+  return copy;
+}
+
+// Copies the nodes on the path from the top down to `node`, edits the last
+// one and links the copies back up. Nothing changes if `edit` throws.
+template <typename Edit>
+void OverlayDOM::edit(Index node, Edit&& edit) {
+  const std::vector<Index> path = getPath(node);
+  std::vector<std::pair<Node, std::size_t>> copies;  // with the position of the next copy among the children
+  copies.reserve(path.size());
+  Node copy = top_ ? *top_ : copyTop();
+  for (Index index : path) {
+    const auto it = std::find_if(copy.children.begin(), copy.children.end(), [&](const Child& child) { return getOrigin(child) == index; });
+    if (it == copy.children.end())
+      throw exception::InvalidTag("Node " + std::to_string(node) + " was removed");
+    const auto position = static_cast<std::size_t>(it - copy.children.begin());
+    Node next = it->node ? *it->node : copyNode(index);
+    copies.emplace_back(std::move(copy), position);
+    copy = std::move(next);
+  }
+  edit(copy);
+
+  auto linked = std::make_shared<const Node>(std::move(copy));
+  for (auto it = copies.rbegin(); it != copies.rend(); ++it) {
+    it->first.children[it->second] = {std::move(linked), kNone, 0};
+    linked = std::make_shared<const Node>(std::move(it->first));
+  }
+  top_ = std::move(linked);
+}
+
+OverlayDOM::Node OverlayDOM::copyTop() const {
+  Node top{kNone, 0, {}, {}, {}};
+  if (layout_.size() != 0) {
+    for (Index root = 0; root != kNone; root = layout_.getNextSiblings()[root])
+      top.children.push_back({nullptr, root, 0});
+  }
+  return top;
+}
+
+OverlayDOM::Node OverlayDOM::copyNode(Index node) const {
+  Node copy{node, layout_.getTypes()[node], {}, {layout_.getText(node), nullptr}, {}};
+  const auto attributes = layout_.getAttrs(node);
+  copy.attributes.reserve(attributes.size());
+  for (const FrozenDOM::Attribute& attribute : attributes)
+    copy.attributes.push_back({attribute.key, {layout_.getString(attribute.value), nullptr}});
+  const auto next_siblings = layout_.getNextSiblings();
+  for (Index child = layout_.getFirstChildren()[node]; child != kNone; child = next_siblings[child])
+    copy.children.push_back({nullptr, child, 0});
+  return copy;
+}
+
+// kNone for names neither the layout nor an edit used.
+OverlayDOM::Key OverlayDOM::findKey(std::string_view name) const noexcept {
+  if (auto native = Tag::s_findNative(name))
+    return *native;
+  const uint32_t names = layout_.getLayout().names;
+  for (uint32_t i = 0; i < names; ++i) {
+    if (layout_.getName(detail::Attribute::kCustomBase + i) == name)
+      return detail::Attribute::kCustomBase + i;
+  }
+  if (names_) {
+    const auto it = std::find(names_->begin(), names_->end(), name);
+    if (it != names_->end())
+      return detail::Attribute::kCustomBase + names + static_cast<Key>(it - names_->begin());
+  }
+  return kNone;
+}
+
+// New names go to a copy of the list, which the other overlays keep.
+OverlayDOM::Key OverlayDOM::getKey(std::string_view name) {
+  const Key key = findKey(name);
+  if (key != kNone)
+    return key;
+  auto names = names_ ? std::make_shared<std::vector<std::string>>(*names_) : std::make_shared<std::vector<std::string>>();
+  names->emplace_back(name);
+  names_ = std::move(names);
+  return detail::Attribute::kCustomBase + layout_.getLayout().names + static_cast<Key>(names_->size() - 1);
+}
+
+OverlayDOM::Index OverlayDOM::getOrigin(const Child& child) const noexcept {
+  if (child.node)
+    return child.node->origin;
+  return child.tree == 0 ? child.index : kNone;
+}
+
+OverlayDOM::Key OverlayDOM::getType(const Child& child) const noexcept {
+  return child.node ? child.node->type : getTree(child).getTypes()[child.index];
+}
+
+std::string_view OverlayDOM::getText(const Child& child) const noexcept {
+  return child.node ? child.node->text.view : getTree(child).getText(child.index);
+}
+
+std::string_view OverlayDOM::getName(Key key) const noexcept {
+  const uint32_t names = layout_.getLayout().names;
+  if (key < detail::Attribute::kCustomBase + names)
+    return layout_.getName(key);
+  return (*names_)[key - detail::Attribute::kCustomBase - names];
+}
+
+} // namespace hi
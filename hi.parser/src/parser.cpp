@@ -0,0 +1,236 @@
+#include "hi.parser/parser.h"
+#include "hi.parser/escape.h"
+
+namespace hi
+{
+
+namespace
+{
+
+using Native = Tag::Native;
+using Global = Tag::Global;
+
+constexpr bool s_is(Native type, Global global) noexcept {
+  return type == static_cast<Native>(global);
+}
+
+bool s_isVoid(const std::variant<Native, Tag::Custom>& type, std::string_view name) noexcept {
+  if (std::holds_alternative<Tag::Custom>(type))
+    return name == "track" || name == "keygen";
+  return Tag::s_isVoid(type);
+}
+
+bool s_isMetadata(const std::variant<Native, Tag::Custom>& type) noexcept {
+  if (std::holds_alternative<Tag::Custom>(type))
+    return false;
+  switch (static_cast<Global>(std::get<Native>(type))) {
+    case Global::Base: case Global::Link: case Global::Meta: case Global::Noscript:
+    case Global::Script: case Global::Style: case Global::Template: case Global::Title:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool s_isBlank(std::string_view text) noexcept {
+  for (char c : text) {
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '\f')
+      return false;
+  }
+  return true;
+}
+
+void s_toLower(std::string_view name, std::string& out) {
+  out.assign(name);
+  for (char& c : out) {
+    if (static_cast<unsigned char>(c - 'A') < 26)
+      c = static_cast<char>(c | 0x20);
+  }
+}
+
+} // namespace
+
+DOM HTML5Parser::parse(std::string_view html) {
+  return parse(html, std::make_shared<detail::Interner>());
+}
+
+DOM HTML5Parser::parse(std::string_view html, std::shared_ptr<detail::Interner> names) {
+  DOM dom(std::move(names));
+  detail::Document& document = *dom.head.document_;
+  detail::Interner& interner = document.getNames();
+  Element* const head = dom.head.element_;
+  Element* const body = dom.body.element_;
+  bool in_body = false;
+  open_.clear();
+
+  // Attribute values stay views into the retained copy of the source, but
+  // for those with references, which are decoded into a retained copy.
+  // The first value of a name wins, as in browsers: a later duplicate in
+  // the same tag, or in a repeated <head> or <body> tag, is dropped.
+  const auto setAttributes = [this, &document, &interner](Element* element, const detail::Token& token) {
+    element->reserveAttrs(token.attributes->size());
+    for (const auto& attribute : *token.attributes) {
+      if (element->getAllAttrs().size() == Element::kMaxAttrs)
+        break;
+      detail::Attribute::Key key;
+      if (auto native = Tag::s_findNative(attribute.name)) {
+        key = *native;
+      } else {
+        s_toLower(attribute.name, name_);
+        key = Tag::s_getAttrKey(name_, interner);
+      }
+      if (element->hasAttr(key))
+        continue;
+      std::string_view value = attribute.value;
+      if (token.has_references) {
+        value = detail::unescape(value, text_, true);
+        if (value.data() != attribute.value.data())
+          value = document.retain(value);
+      }
+      element->setAttrView(key, value);
+    }
+  };
+
+  detail::Tokenizer tokenizer(document.retain(html));
+  detail::Token token;
+  while (tokenizer.next(token)) {
+    if (token.kind == detail::Token::Kind::StartTag) {
+      auto type = lookup(token.data, interner);
+      if (name_ == "html")
+        continue;
+      if (std::holds_alternative<Native>(type)) {
+        Native native = std::get<Native>(type);
+        if (s_is(native, Global::Head) || s_is(native, Global::Body)) {
+          in_body = s_is(native, Global::Body);
+          open_.clear();
+          setAttributes(in_body ? body : head, token);
+          continue;
+        }
+        closeImplied(native);
+      }
+      if (!in_body && open_.empty() && !s_isMetadata(type))
+        in_body = true;
+
+      Element* parent = open_.empty() ? (in_body ? body : head) : open_.back();
+      Element* element = document.createElement(type);
+      setAttributes(element, token);
+      parent->addChild(element);
+      if (!token.self_closing && !s_isVoid(type, name_))
+        open_.push_back(element);
+    } else if (token.kind == detail::Token::Kind::EndTag) {
+      // An end tag closes an open element, so it never needs a new name.
+      auto type = find(token.data, interner);
+      if (!type || name_ == "html" || name_ == "body")
+        continue;
+      if (std::holds_alternative<Native>(*type) && s_is(std::get<Native>(*type), Global::Head)) {
+        in_body = true;
+        open_.clear();
+        continue;
+      }
+      popUntil(*type);
+    } else if (token.kind == detail::Token::Kind::Text) {
+      // Whitespace between metadata elements is dropped; other text starts the body.
+      if (!in_body && open_.empty()) {
+        if (s_isBlank(token.data))
+          continue;
+        in_body = true;
+      }
+      addText(document, open_.empty() ? (in_body ? body : head) : open_.back(), token);
+    } else if (token.kind == detail::Token::Kind::Comment) {
+      Element* comment = document.createElement(Element::kComment);
+      comment->setTextView(token.data);
+      (open_.empty() ? (in_body ? body : head) : open_.back())->addChild(comment);
+    }
+    // The doctype has no representation in the DOM; the serializer writes its own.
+  }
+  return dom;
+}
+
+// Text stays a view into the retained source unless it has references to
+// decode. A '<' that opens no tag splits the tokens of one run of text,
+// which joins the previous text node again.
+void HTML5Parser::addText(detail::Document& document, Element* parent, const detail::Token& token) {
+  std::string_view text = token.data;
+  if (token.has_references)
+    text = document.retain(detail::unescape(text, text_));
+  const auto children = parent->getChildren();
+  if (!children.empty() && children.back()->isText()) {
+    Element* last = children.back();
+    std::string_view previous;
+    last->forEachTextChunk([&previous](std::string_view chunk) { previous = chunk; });
+    if (previous.size() == last->getTextSize() && previous.data() + previous.size() == text.data())
+      last->setTextView({previous.data(), previous.size() + text.size()});
+    else
+      last->appendText(text);
+    return;
+  }
+  Element* node = document.createElement(Element::kText);
+  node->setTextView(text);
+  parent->addChild(node);
+}
+
+std::variant<Tag::Native, Tag::Custom> HTML5Parser::lookup(std::string_view name, detail::Interner& names) {
+  s_toLower(name, name_);
+  return Tag::s_getType(name_, names);
+}
+
+std::optional<std::variant<Tag::Native, Tag::Custom>> HTML5Parser::find(std::string_view name, const detail::Interner& names) {
+  s_toLower(name, name_);
+  if (auto native = Tag::s_findNative(name_))
+    return *native;
+  if (auto custom = names.find(name_))
+    return *custom;
+  return std::nullopt;
+}
+
+void HTML5Parser::closeImplied(Native opening) noexcept {
+  const auto closeOpen = [this](std::initializer_list<Global> closes, std::initializer_list<Global> boundaries) {
+    for (auto it = open_.rbegin(); it != open_.rend(); ++it) {
+      const auto& type = (*it)->getType();
+      if (!std::holds_alternative<Native>(type))
+        continue;
+      Native native = std::get<Native>(type);
+      for (Global close : closes) {
+        if (s_is(native, close)) {
+          open_.erase(std::next(it).base(), open_.end());
+          return;
+        }
+      }
+      for (Global boundary : boundaries) {
+        if (s_is(native, boundary))
+          return;
+      }
+    }
+  };
+
+  switch (static_cast<Global>(opening)) {
+    case Global::Li:
+      closeOpen({Global::Li}, {Global::Ul, Global::Ol, Global::Menu});
+      break;
+    case Global::Dt: case Global::Dd:
+      closeOpen({Global::Dt, Global::Dd}, {Global::Dl});
+      break;
+    case Global::Option:
+      closeOpen({Global::Option}, {Global::Select, Global::Datalist, Global::Optgroup});
+      break;
+    case Global::Tr:
+      closeOpen({Global::Tr}, {Global::Table, Global::Tbody, Global::Thead, Global::Tfoot});
+      break;
+    case Global::Td: case Global::Th:
+      closeOpen({Global::Td, Global::Th}, {Global::Tr, Global::Table});
+      break;
+    default:
+      break;
+  }
+}
+
+void HTML5Parser::popUntil(std::variant<Native, Tag::Custom> type) noexcept {
+  for (auto it = open_.rbegin(); it != open_.rend(); ++it) {
+    if ((*it)->getType() == type) {
+      open_.erase(std::next(it).base(), open_.end());
+      return;
+    }
+  }
+}
+
+} // namespace hi
@@ -0,0 +1,202 @@
+#include "hi.parser/rope.h"
+
+#include <algorithm>
+
+namespace hi
+{
+namespace detail
+{
+
+namespace
+{
+
+// Inserts into the chunk holding `position` when the result still fits;
+// sizes on the way down are updated as the recursion unwinds.
+template <typename Node>
+bool s_insertInPlace(Node* node, std::size_t position, std::string_view text, std::size_t limit) {
+  if (node == nullptr)
+    return false;
+  const std::size_t left = node->left ? node->left->size : 0;
+  bool done;
+  if (position < left) {
+    done = s_insertInPlace(node->left.get(), position, text, limit);
+  } else if (position - left <= node->text.size()) {
+    done = node->text.size() + text.size() <= limit;
+    if (done)
+      node->text.insert(position - left, text);
+  } else {
+    done = s_insertInPlace(node->right.get(), position - left - node->text.size(), text, limit);
+  }
+  if (done)
+    node->size += text.size();
+  return done;
+}
+
+// Erases from the chunk holding the whole range when it keeps a byte.
+template <typename Node>
+bool s_eraseInPlace(Node* node, std::size_t position, std::size_t count) {
+  if (node == nullptr)
+    return false;
+  const std::size_t left = node->left ? node->left->size : 0;
+  bool done;
+  if (position < left) {
+    done = s_eraseInPlace(node->left.get(), position, count);
+  } else if (position - left < node->text.size()) {
+    done = position - left + count <= node->text.size() && count < node->text.size();
+    if (done)
+      node->text.erase(position - left, count);
+  } else {
+    done = s_eraseInPlace(node->right.get(), position - left - node->text.size(), count);
+  }
+  if (done)
+    node->size -= count;
+  return done;
+}
+
+} // namespace
+
+
+Rope::Rope(std::string_view text) {
+  append(text);
+}
+
+Rope::Rope(const Rope& other) : root_(s_copy(other.root_.get())), seed_(other.seed_) {}
+
+Rope& Rope::operator=(const Rope& other) {
+  if (this != &other) {
+    root_ = s_copy(other.root_.get());
+    seed_ = other.seed_;
+  }
+  return *this;
+}
+
+Rope::~Rope() = default;
+
+void Rope::append(std::string_view text) {
+  insert(size(), text);
+}
+
+void Rope::insert(std::size_t position, std::string_view text) {
+  if (text.empty())
+    return;
+  position = std::min(position, size());
+  if (s_insertInPlace(root_.get(), position, text, kChunkSize))
+    return;
+  NodePtr left, right;
+  split(std::move(root_), position, left, right);
+  root_ = s_merge(s_merge(std::move(left), makeNodes(text)), std::move(right));
+}
+
+void Rope::erase(std::size_t position, std::size_t count) {
+  position = std::min(position, size());
+  count = std::min(count, size() - position);
+  if (count == 0)
+    return;
+  if (s_eraseInPlace(root_.get(), position, count))
+    return;
+  NodePtr left, middle, right;
+  split(std::move(root_), position, left, right);
+  split(std::move(right), count, middle, right);
+  root_ = s_merge(std::move(left), std::move(right));
+}
+
+void Rope::clear() noexcept {
+  root_.reset();
+}
+
+std::string Rope::toString() const {
+  std::string text;
+  text.reserve(size());
+  forEachChunk([&text](std::string_view chunk) { text.append(chunk); });
+  return text;
+}
+
+std::size_t Rope::getChunkCount() const noexcept {
+  std::size_t count = 0;
+  forEachChunk([&count](std::string_view) { ++count; });
+  return count;
+}
+
+// xorshift32; the sequence only has to look random to the treap.
+Rope::NodePtr Rope::makeNode(std::string_view text) {
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  auto node = std::make_unique<Node>();
+  node->text.reserve(std::max(text.size(), std::min<std::size_t>(text.size() * 2, kChunkSize)));
+  node->text.assign(text);
+  node->priority = seed_;
+  node->size = text.size();
+  return node;
+}
+
+Rope::NodePtr Rope::makeNodes(std::string_view text) {
+  NodePtr nodes;
+  for (std::size_t i = 0; i < text.size(); i += kChunkSize)
+    nodes = s_merge(std::move(nodes), makeNode(text.substr(i, kChunkSize)));
+  return nodes;
+}
+
+// A position inside a chunk cuts it in two nodes.
+void Rope::split(NodePtr node, std::size_t position, NodePtr& left, NodePtr& right) {
+  if (!node) {
+    left.reset();
+    right.reset();
+    return;
+  }
+  const std::size_t left_size = s_size(node->left.get());
+  if (position <= left_size) {
+    NodePtr inner;
+    split(std::move(node->left), position, left, inner);
+    node->left = std::move(inner);
+    s_update(node.get());
+    right = std::move(node);
+  } else if (position >= left_size + node->text.size()) {
+    NodePtr inner;
+    split(std::move(node->right), position - left_size - node->text.size(), inner, right);
+    node->right = std::move(inner);
+    s_update(node.get());
+    left = std::move(node);
+  } else {
+    const std::size_t cut = position - left_size;
+    NodePtr tail = makeNode(std::string_view(node->text).substr(cut));
+    node->text.resize(cut);
+    right = s_merge(std::move(tail), std::move(node->right));
+    s_update(node.get());
+    left = std::move(node);
+  }
+}
+
+Rope::NodePtr Rope::s_merge(NodePtr left, NodePtr right) {
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+  if (left->priority > right->priority) {
+    left->right = s_merge(std::move(left->right), std::move(right));
+    s_update(left.get());
+    return left;
+  }
+  right->left = s_merge(std::move(left), std::move(right->left));
+  s_update(right.get());
+  return right;
+}
+
+Rope::NodePtr Rope::s_copy(const Node* node) {
+  if (node == nullptr)
+    return nullptr;
+  auto copy = std::make_unique<Node>();
+  copy->text = node->text;
+  copy->priority = node->priority;
+  copy->size = node->size;
+  copy->left = s_copy(node->left.get());
+  copy->right = s_copy(node->right.get());
+  return copy;
+}
+
+void Rope::s_update(Node* node) noexcept {
+  node->size = s_size(node->left.get()) + node->text.size() + s_size(node->right.get());
+}
+
+} // namespace detail
+} // namespace hi
@@ -0,0 +1,654 @@
+#include "hi.parser/selector.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace hi
+{
+
+namespace
+{
+
+constexpr uint32_t kIdSpecificity = 1u << 16;
+constexpr uint32_t kClassSpecificity = 1u << 8;
+constexpr uint32_t kTypeSpecificity = 1u;
+
+constexpr auto kIdKey = static_cast<detail::Attribute::Key>(Tag::Global::Id);
+constexpr auto kClassKey = static_cast<detail::Attribute::Key>(Tag::Global::Class);
+
+bool s_isSpace(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool s_isNameChar(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+    || c == '-' || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+// Whether the whitespace-separated list contains `word`.
+bool s_includes(std::string_view list, std::string_view word) noexcept {
+  if (word.empty())
+    return false;
+  std::size_t i = 0;
+  while (i < list.size()) {
+    while (i < list.size() && s_isSpace(list[i]))
+      ++i;
+    const std::size_t start = i;
+    while (i < list.size() && !s_isSpace(list[i]))
+      ++i;
+    if (i - start == word.size() && list.compare(start, word.size(), word) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Hashes of the names SelectorFilter tracks, salted by kind so that a class
+// and a type or id of the same name differ. Never 0, which marks unused
+// slots.
+constexpr uint32_t kTypeSalt = 0x2c1b3c6du;
+constexpr uint32_t kIdSalt = 0x297a2d39u;
+constexpr uint32_t kClassSalt = 0x165667b1u;
+
+uint32_t s_finish(uint32_t hash) noexcept {
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash != 0 ? hash : 1;
+}
+
+uint32_t s_typeHash(detail::Attribute::Key key) noexcept {
+  return s_finish(static_cast<uint32_t>(key) * 0x9e3779b9u ^ kTypeSalt);
+}
+
+uint32_t s_nameHash(std::string_view name, uint32_t salt) noexcept {
+  uint32_t hash = 2166136261u ^ salt;
+  for (char c : name)
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  return s_finish(hash);
+}
+
+// Whether position (1-based) is a + b for some n >= 0.
+bool s_isNth(int32_t a, int32_t b, int64_t position) noexcept {
+  if (a == 0)
+    return position == b;
+  const int64_t steps = position - b;
+  return steps % a == 0 && steps / a >= 0;
+}
+
+// Sibling elements, passing over text and comment nodes.
+const detail::HTML5Element* s_previousElement(const detail::HTML5Element& element) noexcept {
+  const detail::HTML5Element* sibling = element.getPreviousSibling();
+  while (sibling != nullptr && !sibling->isElement())
+    sibling = sibling->getPreviousSibling();
+  return sibling;
+}
+
+const detail::HTML5Element* s_nextElement(const detail::HTML5Element& element) noexcept {
+  const detail::HTML5Element* sibling = element.getNextSibling();
+  while (sibling != nullptr && !sibling->isElement())
+    sibling = sibling->getNextSibling();
+  return sibling;
+}
+
+} // namespace
+
+
+// Recursive descent over the selector text; writes straight into the arrays
+// of the selector being built.
+class Selector::Compiler
+{
+  Selector& selector_;
+  detail::Interner& names_;
+  std::string_view text_;
+  std::size_t pos_ = 0;
+
+public:
+  Compiler(Selector& selector, detail::Interner& names, std::string_view text)
+    : selector_(selector), names_(names), text_(text)
+  {}
+
+  void compile() {
+    std::vector<Compound> compounds;
+    std::vector<Test> tests;
+    for (;;) {
+      compounds.clear();
+      tests.clear();
+      uint32_t specificity = 0;
+      Combinator combinator = Combinator::Descendant;
+      skipSpaces();
+      for (;;) {
+        const auto first = static_cast<uint32_t>(tests.size());
+        if (!compileCompound(tests, specificity))
+          fail("expected a compound selector");
+        compounds.push_back({first, static_cast<uint32_t>(tests.size()) - first, combinator});
+
+        const bool spaces = skipSpaces();
+        if (atEnd() || peek() == ',')
+          break;
+        if (peek() == '>' || peek() == '+' || peek() == '~') {
+          combinator = peek() == '>' ? Combinator::Child : peek() == '+' ? Combinator::NextSibling : Combinator::SubsequentSibling;
+          ++pos_;
+          skipSpaces();
+        } else if (spaces) {
+          combinator = Combinator::Descendant;
+        } else {
+          fail("unexpected character");
+        }
+      }
+
+      // Stored right to left: each compound keeps the combinator that joins
+      // it to the compound on its left, which is the one written before it.
+      Complex complex{static_cast<uint32_t>(selector_.compounds_.size()), static_cast<uint32_t>(compounds.size()), specificity};
+      for (std::size_t i = compounds.size(); i-- > 0;) {
+        const Compound& compound = compounds[i];
+        const auto first = static_cast<uint32_t>(selector_.tests_.size());
+        selector_.tests_.insert(selector_.tests_.end(), tests.begin() + compound.first, tests.begin() + compound.first + compound.tests);
+        std::stable_sort(selector_.tests_.begin() + first, selector_.tests_.end(),
+          [](const Test& left, const Test& right) { return left.op < right.op; });
+        selector_.compounds_.push_back({first, compound.tests, compound.combinator});
+      }
+      selector_.complexes_.push_back(complex);
+      selector_.ancestor_hashes_.push_back(ancestorHashes(complex));
+
+      if (atEnd())
+        return;
+      ++pos_;  // ','
+    }
+  }
+
+private:
+  // A compound is matched against an ancestor of the subject when the
+  // combinator on its right is a descendant or child one; ancestors reached
+  // through siblings of the subject are still its ancestors.
+  std::array<uint32_t, 4> ancestorHashes(const Complex& complex) const {
+    std::vector<uint32_t> ids, classes, types;
+    for (uint32_t i = complex.first + 1; i < complex.first + complex.compounds; ++i) {
+      const Combinator combinator = selector_.compounds_[i - 1].combinator;
+      if (combinator != Combinator::Descendant && combinator != Combinator::Child)
+        continue;
+      const Compound& compound = selector_.compounds_[i];
+      for (uint32_t t = compound.first; t < compound.first + compound.tests; ++t) {
+        const Test& test = selector_.tests_[t];
+        if (test.op == Test::Op::Id)
+          ids.push_back(s_nameHash(selector_.getValue(test), kIdSalt));
+        else if (test.op == Test::Op::Class)
+          classes.push_back(s_nameHash(selector_.getValue(test), kClassSalt));
+        else if (test.op == Test::Op::Type)
+          types.push_back(s_typeHash(test.key));
+      }
+    }
+
+    std::array<uint32_t, 4> hashes{};
+    std::size_t count = 0;
+    for (const std::vector<uint32_t>* kind : {&ids, &classes, &types}) {
+      for (std::size_t i = 0; i < kind->size() && count < hashes.size(); ++i)
+        hashes[count++] = (*kind)[i];
+    }
+    return hashes;
+  }
+
+  bool atEnd() const noexcept { return pos_ == text_.size(); }
+  char peek() const noexcept { return text_[pos_]; }
+
+  bool skipSpaces() noexcept {
+    const std::size_t start = pos_;
+    while (!atEnd() && s_isSpace(peek()))
+      ++pos_;
+    return pos_ != start;
+  }
+
+  [[noreturn]] void fail(const std::string& what) const {
+    throw exception::InvalidSelector(what + " at offset " + std::to_string(pos_) + " of \"" + std::string(text_) + "\"");
+  }
+
+  void expect(char c) {
+    if (atEnd() || peek() != c)
+      fail(std::string("expected '") + c + "'");
+    ++pos_;
+  }
+
+  bool atName() const noexcept {
+    return !atEnd() && (s_isNameChar(peek()) || peek() == '\\');
+  }
+
+  // An identifier with backslash escapes of single characters.
+  std::string name() {
+    std::string result;
+    while (!atEnd()) {
+      if (peek() == '\\' && pos_ + 1 < text_.size()) {
+        result += text_[pos_ + 1];
+        pos_ += 2;
+      } else if (s_isNameChar(peek())) {
+        result += text_[pos_++];
+      } else {
+        break;
+      }
+    }
+    if (result.empty())
+      fail("expected a name");
+    return result;
+  }
+
+  static std::string lower(std::string name) {
+    for (char& c : name) {
+      if (c >= 'A' && c <= 'Z')
+        c = static_cast<char>(c - 'A' + 'a');
+    }
+    return name;
+  }
+
+  // Names are resolved the way the parser resolves them, so that custom ones
+  // meet the ids the parser interned.
+  Key typeKey(const std::string& name) {
+    if (auto native = Tag::s_findNative(name))
+      return *native;
+    selector_.custom_ = true;
+    return detail::Attribute::kCustomBase + names_.intern(lower(name));
+  }
+
+  Key attrKey(const std::string& name) {
+    if (auto native = Tag::s_findNative(name))
+      return *native;
+    selector_.custom_ = true;
+    return Tag::s_getAttrKey(lower(name), names_);
+  }
+
+  Test valueTest(Test::Op op, Key key, std::string_view value) {
+    Test test{op, key};
+    test.value = static_cast<uint32_t>(selector_.strings_.size());
+    test.size = static_cast<uint32_t>(value.size());
+    selector_.strings_.append(value);
+    return test;
+  }
+
+  bool compileCompound(std::vector<Test>& tests, uint32_t& specificity) {
+    bool any = false;
+    if (!atEnd() && peek() == '*') {
+      ++pos_;
+      any = true;
+    } else if (atName()) {
+      tests.push_back({Test::Op::Type, typeKey(name())});
+      specificity += kTypeSpecificity;
+      any = true;
+    }
+
+    while (!atEnd()) {
+      const char c = peek();
+      if (c == '#') {
+        ++pos_;
+        tests.push_back(valueTest(Test::Op::Id, kIdKey, name()));
+        specificity += kIdSpecificity;
+      } else if (c == '.') {
+        ++pos_;
+        tests.push_back(valueTest(Test::Op::Class, kClassKey, name()));
+        specificity += kClassSpecificity;
+      } else if (c == '[') {
+        ++pos_;
+        tests.push_back(attribute());
+        specificity += kClassSpecificity;
+      } else if (c == ':') {
+        ++pos_;
+        pseudoClass(tests);
+        specificity += kClassSpecificity;
+      } else {
+        break;
+      }
+      any = true;
+    }
+    return any;
+  }
+
+  Test attribute() {
+    skipSpaces();
+    const Key key = attrKey(name());
+    skipSpaces();
+    if (!atEnd() && peek() == ']') {
+      ++pos_;
+      return {Test::Op::Attr, key};
+    }
+
+    Test::Op op;
+    switch (atEnd() ? '\0' : peek()) {
+      case '=': op = Test::Op::AttrEquals; break;
+      case '~': op = Test::Op::AttrIncludes; break;
+      case '|': op = Test::Op::AttrDashMatch; break;
+      case '^': op = Test::Op::AttrPrefix; break;
+      case '$': op = Test::Op::AttrSuffix; break;
+      case '*': op = Test::Op::AttrContains; break;
+      default: fail("expected an attribute operator");
+    }
+    if (op != Test::Op::AttrEquals)
+      ++pos_;
+    expect('=');
+    skipSpaces();
+
+    std::string value;
+    if (!atEnd() && (peek() == '"' || peek() == '\'')) {
+      const char quote = text_[pos_++];
+      while (!atEnd() && peek() != quote) {
+        if (peek() == '\\' && pos_ + 1 < text_.size())
+          ++pos_;
+        value += text_[pos_++];
+      }
+      expect(quote);
+    } else {
+      value = name();
+    }
+    skipSpaces();
+    expect(']');
+    return valueTest(op, key, value);
+  }
+
+  void pseudoClass(std::vector<Test>& tests) {
+    const std::string pseudo = lower(name());
+    if (pseudo == "first-child") {
+      tests.push_back({Test::Op::NthChild, 0, 0, 1});
+    } else if (pseudo == "last-child") {
+      tests.push_back({Test::Op::NthLastChild, 0, 0, 1});
+    } else if (pseudo == "only-child") {
+      tests.push_back({Test::Op::NthChild, 0, 0, 1});
+      tests.push_back({Test::Op::NthLastChild, 0, 0, 1});
+    } else if (pseudo == "nth-child" || pseudo == "nth-last-child") {
+      expect('(');
+      Test test{pseudo == "nth-child" ? Test::Op::NthChild : Test::Op::NthLastChild};
+      nth(test.a, test.b);
+      expect(')');
+      tests.push_back(test);
+    } else {
+      fail("unsupported pseudo-class :" + pseudo);
+    }
+  }
+
+  // The An+B microsyntax, including "odd" and "even".
+  void nth(int32_t& a, int32_t& b) {
+    std::string expression;
+    while (!atEnd() && peek() != ')') {
+      if (!s_isSpace(peek()))
+        expression += peek();
+      ++pos_;
+    }
+    expression = lower(std::move(expression));
+    if (expression == "odd") {
+      a = 2;
+      b = 1;
+      return;
+    }
+    if (expression == "even") {
+      a = 2;
+      b = 0;
+      return;
+    }
+
+    const auto number = [this](std::string_view digits, int32_t& out) {
+      if (!digits.empty() && digits.front() == '+')
+        digits.remove_prefix(1);
+      auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), out);
+      if (digits.empty() || error != std::errc() || end != digits.data() + digits.size())
+        fail("invalid An+B expression");
+    };
+    const std::size_t n = expression.find('n');
+    if (n == std::string::npos) {
+      a = 0;
+      number(expression, b);
+      return;
+    }
+    const std::string_view step = std::string_view(expression).substr(0, n);
+    const std::string_view offset = std::string_view(expression).substr(n + 1);
+    if (step.empty() || step == "+")
+      a = 1;
+    else if (step == "-")
+      a = -1;
+    else
+      number(step, a);
+    if (offset.empty()) {
+      b = 0;
+    } else if (offset.front() != '+' && offset.front() != '-') {
+      fail("invalid An+B expression");
+    } else {
+      number(offset, b);
+    }
+  }
+}; // class Selector::Compiler
+
+
+Selector::Selector(std::string_view text, detail::Interner& names) : names_(&names) {
+  Compiler(*this, names, text).compile();
+}
+
+bool Selector::matches(const Element& element) const noexcept {
+  for (std::size_t i = 0; i < complexes_.size(); ++i) {
+    if (matches(i, element))
+      return true;
+  }
+  return false;
+}
+
+bool Selector::matches(const Element& element, const SelectorFilter& filter) const noexcept {
+  for (std::size_t i = 0; i < complexes_.size(); ++i) {
+    if (matches(i, element, filter))
+      return true;
+  }
+  return false;
+}
+
+bool Selector::matches(std::size_t complex, const Element& element) const noexcept {
+  const Complex& selector = complexes_[complex];
+  return matchFrom(selector.first, selector.first + selector.compounds, element) == Result::Matched;
+}
+
+bool Selector::matches(std::size_t complex, const Element& element, const SelectorFilter& filter) const noexcept {
+  return !fastRejects(complex, filter) && matches(complex, element);
+}
+
+bool Selector::fastRejects(std::size_t complex, const SelectorFilter& filter) const noexcept {
+  for (uint32_t hash : ancestor_hashes_[complex]) {
+    if (hash == 0)
+      return false;
+    if (!filter.mayContain(hash))
+      return true;
+  }
+  return false;
+}
+
+std::vector<Selector::Element*> Selector::querySelectorAll(const Tag& root) const {
+  checkNames(root);
+  std::vector<Element*> found;
+  for (Element& element : root.depthFirst()) {
+    if (matches(element))
+      found.push_back(&element);
+  }
+  return found;
+}
+
+std::vector<Selector::Element*> Selector::querySelectorAll(const DOM& dom) const {
+  std::vector<Element*> found = querySelectorAll(dom.head);
+  std::vector<Element*> body = querySelectorAll(dom.body);
+  found.insert(found.end(), body.begin(), body.end());
+  return found;
+}
+
+Selector::Element* Selector::querySelector(const Tag& root) const {
+  checkNames(root);
+  for (Element& element : root.depthFirst()) {
+    if (matches(element))
+      return &element;
+  }
+  return nullptr;
+}
+
+void Selector::checkNames(const Tag& root) const {
+  if (custom_ && &root.element_->getDocument()->getNames() != names_)
+    throw exception::InvalidSelector("The selector was compiled for another name registry than the document uses");
+}
+
+// Right-to-left matching with the failure kinds of WebKit's SelectorChecker:
+// once the left part of a descendant combinator matches no ancestor, no
+// other candidate further out can succeed either, and the same holds for
+// siblings, so the enclosing loops stop early.
+Selector::Result Selector::matchFrom(uint32_t compound, uint32_t end, const Element& element) const noexcept {
+  const Compound& current = compounds_[compound];
+  if (!element.isElement() || !matchCompound(current, element))
+    return Result::Failed;
+  if (compound + 1 == end)
+    return Result::Matched;
+
+  switch (current.combinator) {
+    case Combinator::Descendant:
+      for (const Element* ancestor = element.getParent(); ancestor != nullptr; ancestor = ancestor->getParent()) {
+        const Result result = matchFrom(compound + 1, end, *ancestor);
+        if (result == Result::Matched || result == Result::FailedCompletely)
+          return result;
+      }
+      return Result::FailedCompletely;
+
+    case Combinator::Child: {
+      const Element* parent = element.getParent();
+      if (parent == nullptr)
+        return Result::FailedCompletely;
+      return matchFrom(compound + 1, end, *parent);
+    }
+
+    case Combinator::NextSibling: {
+      const Element* sibling = s_previousElement(element);
+      if (sibling == nullptr)
+        return Result::FailedSiblings;
+      return matchFrom(compound + 1, end, *sibling);
+    }
+
+    case Combinator::SubsequentSibling:
+      for (const Element* sibling = s_previousElement(element); sibling != nullptr; sibling = s_previousElement(*sibling)) {
+        const Result result = matchFrom(compound + 1, end, *sibling);
+        if (result != Result::Failed)
+          return result;
+      }
+      return Result::FailedSiblings;
+  }
+  return Result::Failed;
+}
+
+bool Selector::matchCompound(const Compound& compound, const Element& element) const noexcept {
+  for (uint32_t i = compound.first; i < compound.first + compound.tests; ++i) {
+    if (!matchTest(tests_[i], element))
+      return false;
+  }
+  return true;
+}
+
+bool Selector::matchTest(const Test& test, const Element& element) const noexcept {
+  switch (test.op) {
+    case Test::Op::Type:
+      return element.getTypeKey() == test.key;
+
+    case Test::Op::NthChild:
+    case Test::Op::NthLastChild: {
+      // Positions count element siblings only, so text between them is skipped.
+      std::size_t position = 1;
+      if (test.op == Test::Op::NthChild) {
+        for (const Element* sibling = s_previousElement(element); sibling != nullptr; sibling = s_previousElement(*sibling))
+          ++position;
+      } else {
+        for (const Element* sibling = s_nextElement(element); sibling != nullptr; sibling = s_nextElement(*sibling))
+          ++position;
+      }
+      return s_isNth(test.a, test.b, static_cast<int64_t>(position));
+    }
+
+    default:
+      break;
+  }
+
+  const detail::Attribute* attribute = element.findAttr(test.key);
+  if (attribute == nullptr)
+    return false;
+  const std::string_view value = attribute->value();
+  const std::string_view expected = getValue(test);
+  switch (test.op) {
+    case Test::Op::Attr:
+      return true;
+    case Test::Op::Id:
+    case Test::Op::AttrEquals:
+      return value == expected;
+    case Test::Op::Class:
+    case Test::Op::AttrIncludes:
+      return s_includes(value, expected);
+    case Test::Op::AttrDashMatch:
+      return value.size() >= expected.size() && value.compare(0, expected.size(), expected) == 0
+        && (value.size() == expected.size() || value[expected.size()] == '-');
+    case Test::Op::AttrPrefix:
+      return !expected.empty() && value.starts_with(expected);
+    case Test::Op::AttrSuffix:
+      return !expected.empty() && value.ends_with(expected);
+    case Test::Op::AttrContains:
+      return !expected.empty() && value.find(expected) != std::string_view::npos;
+    default:
+      return false;
+  }
+}
+
+
+void SelectorFilter::setParentsOf(const Element& element) {
+  const Element* parent = element.getParent();
+  while (!parents_.empty() && parents_.back().element != parent)
+    popParent();
+  if (!parents_.empty() || parent == nullptr)
+    return;
+
+  std::vector<const Element*> chain;
+  for (; parent != nullptr; parent = parent->getParent())
+    chain.push_back(parent);
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+    pushParent(**it);
+}
+
+void SelectorFilter::pushParent(const Element& parent) {
+  const auto first = static_cast<uint32_t>(hashes_.size());
+  hashes_.push_back(s_typeHash(parent.getTypeKey()));
+  for (const detail::Attribute& attribute : parent.getAllAttrs()) {
+    if (attribute.key == kIdKey) {
+      hashes_.push_back(s_nameHash(attribute.value(), kIdSalt));
+    } else if (attribute.key == kClassKey) {
+      const std::string_view list = attribute.value();
+      std::size_t i = 0;
+      while (i < list.size()) {
+        while (i < list.size() && s_isSpace(list[i]))
+          ++i;
+        const std::size_t start = i;
+        while (i < list.size() && !s_isSpace(list[i]))
+          ++i;
+        if (i != start)
+          hashes_.push_back(s_nameHash(list.substr(start, i - start), kClassSalt));
+      }
+    }
+  }
+
+  for (std::size_t i = first; i < hashes_.size(); ++i) {
+    for (uint32_t key : {hashes_[i] & kKeyMask, (hashes_[i] >> kKeyBits) & kKeyMask}) {
+      if (counters_[key] != UINT8_MAX)
+        ++counters_[key];
+    }
+  }
+  parents_.push_back({&parent, first});
+}
+
+void SelectorFilter::popParent() noexcept {
+  const uint32_t first = parents_.back().first;
+  for (std::size_t i = first; i < hashes_.size(); ++i) {
+    // A saturated counter has lost count and stays set.
+    for (uint32_t key : {hashes_[i] & kKeyMask, (hashes_[i] >> kKeyBits) & kKeyMask}) {
+      if (counters_[key] != UINT8_MAX)
+        --counters_[key];
+    }
+  }
+  hashes_.resize(first);
+  parents_.pop_back();
+}
+
+void SelectorFilter::clear() noexcept {
+  counters_.fill(0);
+  hashes_.clear();
+  parents_.clear();
+}
+
+} // namespace hi
@@ -0,0 +1,968 @@
+#include "hi.parser/serializer.h"
+#include "hi.parser/frozen.h"
+#include "hi.parser/overlay.h"
+#include "hi.parser/template.h"
+#include "hi.parser/thread_pool.h"
+#include "hi.parser/tokenizer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace hi
+{
+
+namespace
+{
+
+struct Fragment
+{
+  char data[24];
+  unsigned char size;
+
+  constexpr std::string_view view() const noexcept { return {data, size}; }
+}; // struct Fragment
+
+constexpr Fragment s_makeFragment(std::string_view prefix, std::string_view name, std::string_view suffix) {
+  Fragment fragment{};
+  for (std::string_view part : {prefix, name, suffix}) {
+    for (char c : part)
+      fragment.data[fragment.size++] = c;
+  }
+  return fragment;
+}
+
+template <std::size_t N>
+constexpr std::array<Fragment, N> s_makeFragments(std::string_view prefix, std::string_view suffix) {
+  std::array<Fragment, N> fragments{};
+  for (std::size_t i = 0; i < N; ++i)
+    fragments[i] = s_makeFragment(prefix, htmlTags[i], suffix);
+  return fragments;
+}
+
+constexpr auto kOpenTags = s_makeFragments<htmlTags.size()>("<", "");
+constexpr auto kCloseTags = s_makeFragments<htmlTags.size()>("</", ">");
+constexpr auto kAttrNames = s_makeFragments<htmlTags.size()>(" ", "=\"");
+
+// A parallel write cuts about this many tasks per thread, so that threads
+// finishing early pick up more work, but never tasks below kMinTaskElements.
+constexpr std::size_t kTasksPerThread = 4;
+constexpr std::size_t kMinTaskElements = 256;
+
+// Text escaped on the stack when the chunk has no room for it: small enough
+// to stay in L1, large enough for the vector kernels to get going.
+constexpr std::size_t kEscapeBlock = 64;
+
+// Elements whose text is written as is: the tokenizer reads it as raw text
+// and would not decode references.
+bool s_isRawText(detail::Attribute::Key type) noexcept {
+  if (type >= detail::Attribute::kCustomBase)
+    return false;
+  switch (static_cast<Tag::Global>(type)) {
+    case Tag::Global::Script: case Tag::Global::Style: case Tag::Global::Xmp:
+    case Tag::Global::IFrame: case Tag::Global::NoFrames: case Tag::Global::PlainText:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool s_isBlank(std::string_view text) noexcept {
+  for (char c : text) {
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '\f')
+      return false;
+  }
+  return true;
+}
+
+// Indented output puts every node on a line of its own, which stands in for
+// whitespace-only text: such text nodes are left out.
+bool s_isSkipped(const detail::HTML5Element* node, const SerializeOptions& options) noexcept {
+  if (!node->isText() || options.newline.empty())
+    return false;
+  bool blank = true;
+  node->forEachTextChunk([&blank](std::string_view chunk) { blank = blank && s_isBlank(chunk); });
+  return blank;
+}
+
+bool s_hasEndTag(const detail::HTML5Element* element) noexcept {
+  return element->isElement() && !Tag::s_isVoid(element->getType());
+}
+
+std::size_t s_countElements(const detail::HTML5Element* root) {
+  std::size_t count = 0;
+  for (const auto& element : detail::ElementRange(detail::DepthFirstIterator(const_cast<detail::HTML5Element*>(root)))) {
+    (void)element;
+    ++count;
+  }
+  return count;
+}
+
+// Raw text ends at "</" and the element's name in any case, so a '\' goes
+// before each such '/': "<\/script>" reads the same inside a script's
+// strings and regular expressions and a style's. The text next to `text`
+// may finish an end tag too: `after_lt` says the text before ends in '<',
+// `more` that text follows, which makes a name cut short at the end count.
+// Returns `text` itself when nothing changes, else a view of `out`.
+std::string_view s_escapeRawText(std::string_view text, std::string_view name, bool after_lt, bool more, std::string& out) {
+  out.clear();
+  std::size_t copied = 0;
+  for (std::size_t at = text.find('/'); at != std::string_view::npos; at = text.find('/', at + 1)) {
+    if (at == 0 ? !after_lt : text[at - 1] != '<')
+      continue;
+    const std::string_view rest = text.substr(at + 1, name.size());
+    if ((rest.size() < name.size() && !more) || !detail::equalsIgnoreCase(rest, name.substr(0, rest.size())))
+      continue;
+    out.append(text.substr(copied, at - copied));
+    out += '\\';
+    copied = at;
+  }
+  if (out.empty())
+    return text;
+  out.append(text.substr(copied));
+  return out;
+}
+
+// The content of a text node in one piece; ropes are joined in `storage`.
+std::string_view s_getText(const detail::HTML5Element* node, std::string& storage) {
+  std::string_view text;
+  std::size_t chunks = 0;
+  node->forEachTextChunk([&](std::string_view chunk) {
+    if (++chunks == 1) {
+      text = chunk;
+      return;
+    }
+    if (chunks == 2)
+      storage.assign(text);
+    storage.append(chunk);
+  });
+  return chunks > 1 ? std::string_view(storage) : text;
+}
+
+bool s_endsInLessThan(const detail::HTML5Element* node) {
+  if (node == nullptr || !node->isText())
+    return false;
+  char last = 0;
+  node->forEachTextChunk([&last](std::string_view chunk) {
+    if (!chunk.empty())
+      last = chunk.back();
+  });
+  return last == '<';
+}
+
+} // namespace
+
+
+// What a '>' in comment text depends on: the characters written before it,
+// which may have come in an earlier chunk.
+struct Serializer::CommentState {
+  std::size_t size = 0;
+  char last[3] = {};  // most recent last
+
+  // At the start, after a leading '-' and after "--" or "--!", a '>' would
+  // end the comment.
+  bool closes() const noexcept {
+    return size == 0 || (size == 1 && last[2] == '-') || (last[1] == '-' && last[2] == '-')
+      || (last[0] == '-' && last[1] == '-' && last[2] == '!');
+  }
+
+  void push(std::string_view text) noexcept {
+    size += text.size();
+    for (char c : text.substr(text.size() - std::min<std::size_t>(text.size(), 3))) {
+      last[0] = last[1];
+      last[1] = last[2];
+      last[2] = c;
+    }
+  }
+}; // struct Serializer::CommentState
+
+
+void FdSink::write(std::string_view bytes) {
+  while (!bytes.empty()) {
+#ifdef _WIN32
+    auto written = ::_write(fd_, bytes.data(), static_cast<unsigned int>(bytes.size()));
+#else
+    auto written = ::write(fd_, bytes.data(), bytes.size());
+#endif
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw exception::IOError("write to fd " + std::to_string(fd_) + " failed: " + std::strerror(errno));
+    }
+    bytes.remove_prefix(static_cast<std::size_t>(written));
+  }
+}
+
+#ifndef _WIN32
+void FdSink::writeParts(std::span<const std::string_view> parts) {
+  std::vector<iovec> vectors;
+  vectors.reserve(std::min<std::size_t>(parts.size(), IOV_MAX));
+  while (!parts.empty()) {
+    vectors.clear();
+    for (std::string_view part : parts.first(std::min<std::size_t>(parts.size(), IOV_MAX)))
+      vectors.push_back({const_cast<char*>(part.data()), part.size()});
+    auto written = ::writev(fd_, vectors.data(), static_cast<int>(vectors.size()));
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw exception::IOError("write to fd " + std::to_string(fd_) + " failed: " + std::strerror(errno));
+    }
+    // Drop the parts that went out; finish a partly written one on its own.
+    auto left = static_cast<std::size_t>(written);
+    while (!parts.empty() && parts.front().size() <= left) {
+      left -= parts.front().size();
+      parts = parts.subspan(1);
+    }
+    if (left != 0) {
+      write(parts.front().substr(left));
+      parts = parts.subspan(1);
+    }
+  }
+}
+#endif
+
+void StringSink::writeParts(std::span<const std::string_view> parts) {
+  std::size_t size = out_.size();
+  for (std::string_view part : parts)
+    size += part.size();
+  out_.reserve(size);
+  for (std::string_view part : parts)
+    out_.append(part);
+}
+
+
+Serializer::Serializer(OutputSink& sink, std::size_t chunk_size)
+  : sink_(sink), chunk_(chunk_size == 0 ? kDefaultChunkSize : chunk_size), used_(0)
+{}
+
+void Serializer::write(const Tag& tag, const SerializeOptions& options) {
+  writeElement(tag.element_, options);
+}
+
+void Serializer::write(const DOM& dom, const SerializeOptions& options) {
+  append("<!DOCTYPE html>");
+  append(options.newline);
+  append("<html>");
+  append(options.newline);
+  writeElement(dom.head.element_, options);
+  writeElement(dom.body.element_, options);
+  append("</html>");
+}
+
+void Serializer::write(const Tag& tag, ThreadPool& pool, const SerializeOptions& options) {
+  writeParallel({tag.element_}, false, pool, options);
+}
+
+void Serializer::write(const DOM& dom, ThreadPool& pool, const SerializeOptions& options) {
+  writeParallel({dom.head.element_, dom.body.element_}, true, pool, options);
+}
+
+void Serializer::write(const FrozenDOM& frozen, const SerializeOptions& options) {
+  if (frozen.isDocument()) {
+    append("<!DOCTYPE html>");
+    append(options.newline);
+    append("<html>");
+    append(options.newline);
+  }
+  for (uint32_t root = 0; root != FrozenDOM::kNone; root = frozen.getNextSiblings()[root])
+    writeFrozen(frozen, root, 0, options);
+  if (frozen.isDocument())
+    append("</html>");
+}
+
+// Walks the copies the edits made; children no edit reached are written
+// from their frozen tree, text and comments here, since their siblings
+// may have changed.
+void Serializer::write(const OverlayDOM& overlay, const SerializeOptions& options) {
+  if (!overlay.top_) {
+    write(overlay.layout_, options);
+    return;
+  }
+  if (options.indent != indent_) {
+    indent_ = options.indent;
+    indents_.clear();
+  }
+  using Node = OverlayDOM::Node;
+  using Child = OverlayDOM::Child;
+  const auto writeTag = [&](const Node& node, bool close) {
+    const std::string_view name = node.type < detail::Attribute::kCustomBase ? std::string_view() : overlay.getName(node.type);
+    if (close) {
+      if (name.empty()) {
+        append(kCloseTags[node.type].view());
+      } else {
+        append("</");
+        append(name);
+        append(">");
+      }
+      return;
+    }
+    if (name.empty()) {
+      append(kOpenTags[node.type].view());
+    } else {
+      append("<");
+      append(name);
+    }
+    if (options.show_attrs) {
+      for (const OverlayDOM::Attribute& attribute : node.attributes) {
+        if (attribute.key < detail::Attribute::kCustomBase) {
+          append(kAttrNames[attribute.key].view());
+        } else {
+          append(" ");
+          append(overlay.getName(attribute.key));
+          append("=\"");
+        }
+        appendEscaped(attribute.value.view, detail::EscapeMode::Attribute);
+        append("\"");
+      }
+    }
+    append(">");
+  };
+  const auto writeTextChild = [&](const Node& parent, std::size_t position) {
+    const Child& child = parent.children[position];
+    const std::string_view text = overlay.getText(child);
+    if (overlay.getType(child) == Element::kComment) {
+      append("<!--");
+      CommentState state;
+      appendComment(text, state);
+      append("-->");
+    } else if (s_isRawText(parent.type)) {
+      const auto isText = [&](std::size_t at) { return at < parent.children.size() && overlay.getType(parent.children[at]) == Element::kText; };
+      const bool after_lt = !text.empty() && text[0] == '/' && position != 0 && isText(position - 1) && overlay.getText(parent.children[position - 1]).ends_with('<');
+      std::string escaped;
+      append(s_escapeRawText(text, htmlTags[parent.type], after_lt, isText(position + 1), escaped));
+    } else {
+      appendEscaped(text, detail::EscapeMode::Text);
+    }
+  };
+
+  if (overlay.layout_.isDocument()) {
+    append("<!DOCTYPE html>");
+    append(options.newline);
+    append("<html>");
+    append(options.newline);
+  }
+  struct OverlayFrame {
+    const Node* node;
+    std::size_t next;
+  };
+  std::vector<OverlayFrame> frames{{overlay.top_.get(), 0}};
+  while (!frames.empty()) {
+    OverlayFrame& frame = frames.back();
+    const Node& parent = *frame.node;
+    const std::size_t level = frames.size() - 1;  // of the children; the roots are the top's
+    if (frame.next == parent.children.size()) {
+      frames.pop_back();
+      const bool has_children = !parent.children.empty();
+      if (!frames.empty() && (has_children || parent.type >= detail::Attribute::kCustomBase || !Tag::s_isVoid(static_cast<Tag::Native>(parent.type)))) {
+        writeIndent(level - 1, options);
+        writeTag(parent, true);
+        append(options.newline);
+      }
+      continue;
+    }
+
+    const std::size_t position = frame.next++;
+    const Child& child = parent.children[position];
+    const auto type = overlay.getType(child);
+    if (type == Element::kText || type == Element::kComment) {
+      if (type == Element::kText && !options.newline.empty() && s_isBlank(overlay.getText(child)))
+        continue;
+      writeIndent(level, options);
+      writeTextChild(parent, position);
+      append(options.newline);
+      continue;
+    }
+    if (!child.node) {
+      writeFrozen(overlay.getTree(child), child.index, level, options);
+      continue;
+    }
+    writeIndent(level, options);
+    writeTag(*child.node, false);
+    append(options.newline);
+    if (!options.show_children) {
+      writeIndent(level, options);
+      writeTag(*child.node, true);
+      append(options.newline);
+      continue;
+    }
+    frames.push_back({child.node.get(), 0});
+  }
+  if (overlay.layout_.isDocument())
+    append("</html>");
+}
+
+void Serializer::write(const Template& page, std::span<const std::string_view> values) {
+  page.checkValues(values);
+  const std::string_view bytes = page.getStaticBytes();
+  for (const Template::Instruction& instruction : page.getProgram()) {
+    append(bytes.substr(instruction.offset, instruction.size));
+    if (instruction.hole == Template::kNoHole)
+      continue;
+    const std::string_view value = values[instruction.hole];
+    switch (instruction.type) {
+      case Template::HoleType::Text:
+        appendEscaped(value, detail::EscapeMode::Text);
+        break;
+      case Template::HoleType::Attribute:
+        appendEscaped(value, detail::EscapeMode::Attribute);
+        break;
+      case Template::HoleType::Raw:
+      case Template::HoleType::Markup:
+        append(value);
+        break;
+    }
+  }
+}
+
+void Serializer::flush() {
+  if (used_ != 0) {
+    sink_.write(std::string_view(chunk_.data(), used_));
+    used_ = 0;
+  }
+}
+
+void Serializer::writeElement(const Element* root, const SerializeOptions& options) {
+  if (options.indent != indent_) {
+    indent_ = options.indent;
+    indents_.clear();
+  }
+  if (root->getCache() != 0 && compiling_ == nullptr)
+    writeCached(root, 0, options);
+  else
+    writeSubtree(root, 0, options);
+}
+
+void Serializer::writeSubtree(const Element* root, std::size_t level, const SerializeOptions& options) {
+  if (s_isSkipped(root, options))
+    return;
+  writeIndent(level, options);
+  writeOpenTag(root, options);
+  append(options.newline);
+  if (!options.show_children) {
+    writeIndent(level, options);
+    writeCloseTag(root);
+    append(options.newline);
+    return;
+  }
+
+  stack_.clear();
+  stack_.push_back({root, root->getChildren(), 0});
+  while (!stack_.empty()) {
+    Frame& frame = stack_.back();
+    if (frame.next == frame.children.size()) {
+      const Element* element = frame.element;
+      const bool has_children = !frame.children.empty();
+      const std::size_t depth = level + stack_.size() - 1;
+      stack_.pop_back();
+      if (has_children || s_hasEndTag(element)) {
+        writeIndent(depth, options);
+        writeCloseTag(element);
+        append(options.newline);
+      }
+      continue;
+    }
+
+    const Element* child = frame.children[frame.next++];
+    if (child->getCache() != 0 && compiling_ == nullptr) {
+      writeCached(child, level + stack_.size(), options);
+      continue;
+    }
+    if (s_isSkipped(child, options))
+      continue;
+    writeIndent(level + stack_.size(), options);
+    writeOpenTag(child, options);
+    append(options.newline);
+    stack_.push_back({child, child->getChildren(), 0});
+  }
+}
+
+// Replays the bytes cached for `element` if they were made at the same level
+// with the same options; otherwise serializes the subtree into a new cache
+// entry, which replaces the old one. Cacheable elements below it get their
+// own entries on the way. Without store_cached_, as on the pool of a parallel
+// write, the document is only read: a stale entry is written around and left
+// in place.
+void Serializer::writeCached(const Element* element, std::size_t level, const SerializeOptions& options) {
+  detail::Document& document = *element->getDocument();
+  if (const auto cached = document.findSerialized(*element)) {
+    if (cached->level == level && cached->indent == options.indent && cached->newline == options.newline
+        && cached->show_children == options.show_children && cached->show_attrs == options.show_attrs) {
+      append(cached->bytes);
+      return;
+    }
+  }
+
+  detail::Document::SerializedSubtree subtree;
+  subtree.indent = options.indent;
+  subtree.newline = options.newline;
+  subtree.level = level;
+  subtree.show_children = options.show_children;
+  subtree.show_attrs = options.show_attrs;
+  {
+    StringSink sink(subtree.bytes);
+    Serializer nested(sink, chunk_.size());
+    nested.store_cached_ = store_cached_;
+    nested.writeSubtree(element, level, options);
+    nested.flush();
+  }
+  append(subtree.bytes);
+  if (store_cached_) {
+    document.storeSerialized(*element, std::move(subtree));
+    element->markCached();
+  }
+}
+
+// Splits the roots breadth first until there are a few subtrees per thread
+// and counts their elements on the pool; subtrees above the grain are split
+// and counted again until none is left. A serializer of its own then writes
+// the skeleton and cuts the counted subtrees into tasks, which run on the
+// pool, and skeleton and task output go to the sink interleaved.
+void Serializer::writeParallel(std::initializer_list<const Element*> roots, bool document, ThreadPool& pool, const SerializeOptions& options) {
+  const auto writeSequential = [&] {
+    if (document) {
+      append("<!DOCTYPE html>");
+      append(options.newline);
+      append("<html>");
+      append(options.newline);
+    }
+    for (const Element* root : roots)
+      writeElement(root, options);
+    if (document)
+      append("</html>");
+  };
+  if (pool.size() == 1 || !options.show_children) {
+    writeSequential();
+    return;
+  }
+
+  Plan plan;
+  std::vector<const Element*> frontier(roots), next;
+  std::size_t total = 0;
+  const auto split = [&](const Element* element) {
+    plan.sizes[element] = Plan::kSplit;
+    ++total;
+    const auto children = element->getChildren();
+    next.insert(next.end(), children.begin(), children.end());
+  };
+  while (frontier.size() < pool.size() * kTasksPerThread) {
+    next.clear();
+    for (const Element* element : frontier) {
+      if (element->getCache() == 0 && !element->getChildren().empty())
+        split(element);
+      else
+        next.push_back(element);
+    }
+    if (next.size() == frontier.size() && std::equal(next.begin(), next.end(), frontier.begin()))
+      break;
+    std::swap(frontier, next);
+  }
+
+  std::vector<std::size_t> counts;
+  while (!frontier.empty()) {
+    counts.assign(frontier.size(), 0);
+    pool.run(frontier.size(), [&](std::size_t i) { counts[i] = s_countElements(frontier[i]); });
+    for (std::size_t i = 0; i < frontier.size(); ++i)
+      plan.sizes[frontier[i]] = static_cast<uint32_t>(counts[i]);
+
+    if (plan.grain == 0) {
+      for (std::size_t count : counts)
+        total += count;
+      if (total < 2 * kMinTaskElements) {
+        writeSequential();
+        return;
+      }
+      plan.grain = std::max(kMinTaskElements, total / (pool.size() * kTasksPerThread));
+    }
+    next.clear();
+    for (std::size_t i = 0; i < frontier.size(); ++i) {
+      if (counts[i] > plan.grain && frontier[i]->getCache() == 0)
+        split(frontier[i]);
+    }
+    std::swap(frontier, next);
+  }
+
+  {
+    StringSink sink(plan.skeleton);
+    Serializer planner(sink, chunk_.size());
+    if (document) {
+      planner.append("<!DOCTYPE html>");
+      planner.append(options.newline);
+      planner.append("<html>");
+      planner.append(options.newline);
+    }
+    for (const Element* root : roots)
+      planner.planSubtree(root, options, plan);
+    if (document)
+      planner.append("</html>");
+    planner.flush();
+  }
+
+  std::vector<std::string> outputs(plan.tasks.size());
+  pool.run(plan.tasks.size(), [&](std::size_t i) {
+    const Task& task = plan.tasks[i];
+    StringSink sink(outputs[i]);
+    Serializer serializer(sink, chunk_.size());
+    serializer.store_cached_ = false;
+    for (const Element* child : task.children) {
+      if (child->getCache() != 0)
+        serializer.writeCached(child, task.level, options);
+      else
+        serializer.writeSubtree(child, task.level, options);
+    }
+    serializer.flush();
+  });
+
+  const std::string_view skeleton = plan.skeleton;
+  std::vector<std::string_view> parts;
+  parts.reserve(2 * plan.tasks.size() + 1);
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < plan.tasks.size(); ++i) {
+    parts.push_back(skeleton.substr(offset, plan.tasks[i].offset - offset));
+    parts.push_back(outputs[i]);
+    offset = plan.tasks[i].offset;
+  }
+  parts.push_back(skeleton.substr(offset));
+
+  if (sink_.canGather()) {
+    flush();
+    sink_.writeParts(parts);
+  } else {
+    for (std::string_view part : parts)
+      append(part);
+  }
+}
+
+// Writes the subtree of `root` like writeElement, except that runs of counted
+// sibling subtrees are left out and recorded in `plan` as tasks of up to the
+// grain elements, or of one larger subtree that could not be split. A root
+// that was not split is small enough to write right away.
+void Serializer::planSubtree(const Element* root, const SerializeOptions& options, Plan& plan) {
+  if (plan.sizes.at(root) != Plan::kSplit) {
+    writeElement(root, options);
+    return;
+  }
+  if (options.indent != indent_) {
+    indent_ = options.indent;
+    indents_.clear();
+  }
+
+  writeOpenTag(root, options);
+  append(options.newline);
+  stack_.clear();
+  stack_.push_back({root, root->getChildren(), 0});
+  while (!stack_.empty()) {
+    Frame& frame = stack_.back();
+    if (frame.next == frame.children.size()) {
+      const Element* element = frame.element;
+      const bool has_children = !frame.children.empty();
+      const std::size_t depth = stack_.size() - 1;
+      stack_.pop_back();
+      if (has_children || s_hasEndTag(element)) {
+        writeIndent(depth, options);
+        writeCloseTag(element);
+        append(options.newline);
+      }
+      continue;
+    }
+
+    const std::size_t level = stack_.size();
+    const Element* child = frame.children[frame.next];
+    if (child->getCache() != 0) {
+      writeCached(child, level, options);
+      ++frame.next;
+      continue;
+    }
+    if (plan.sizes.at(child) == Plan::kSplit) {
+      writeIndent(level, options);
+      writeOpenTag(child, options);
+      append(options.newline);
+      ++frame.next;
+      stack_.push_back({child, child->getChildren(), 0});
+      continue;
+    }
+
+    // Greedily take following siblings up to the grain; cacheable and split
+    // ones end the run. The first child always goes in.
+    const std::size_t first = frame.next;
+    std::size_t elements = 0;
+    while (frame.next < frame.children.size()) {
+      const Element* sibling = frame.children[frame.next];
+      const uint32_t size = plan.sizes.at(sibling);
+      if (sibling->getCache() != 0 || size == Plan::kSplit || (elements != 0 && elements + size > plan.grain))
+        break;
+      elements += size;
+      ++frame.next;
+    }
+    plan.tasks.push_back({frame.children.subspan(first, frame.next - first), level, plan.skeleton.size() + used_});
+  }
+}
+
+// Walks the index arrays directly; the parent array replaces the stack.
+// `root` goes at `level`, its subtree below it.
+void Serializer::writeFrozen(const FrozenDOM& frozen, uint32_t root, std::size_t level, const SerializeOptions& options) {
+  if (options.indent != indent_) {
+    indent_ = options.indent;
+    indents_.clear();
+  }
+
+  const auto types = frozen.getTypes();
+  const auto parents = frozen.getParents();
+  const auto first_children = frozen.getFirstChildren();
+  const auto next_siblings = frozen.getNextSiblings();
+  const auto closeIfNeeded = [&](uint32_t node, std::size_t level, bool has_children) {
+    const auto type = types[node];
+    if (type == Element::kText || type == Element::kComment)
+      return;
+    if (has_children || type >= detail::Attribute::kCustomBase || !Tag::s_isVoid(static_cast<Tag::Native>(type))) {
+      writeIndent(level, options);
+      writeFrozenTag(frozen, node, true, options);
+      append(options.newline);
+    }
+  };
+
+  const auto isSkipped = [&](uint32_t node) {
+    return types[node] == Element::kText && !options.newline.empty() && s_isBlank(frozen.getText(node));
+  };
+
+  if (isSkipped(root))
+    return;
+  writeIndent(level, options);
+  writeFrozenTag(frozen, root, false, options);
+  append(options.newline);
+  if (!options.show_children || first_children[root] == FrozenDOM::kNone) {
+    if (!options.show_children) {
+      writeIndent(level, options);
+      writeFrozenTag(frozen, root, true, options);
+      append(options.newline);
+    } else {
+      closeIfNeeded(root, level, false);
+    }
+    return;
+  }
+
+  uint32_t node = first_children[root];
+  ++level;
+  for (;;) {
+    if (!isSkipped(node)) {
+      writeIndent(level, options);
+      writeFrozenTag(frozen, node, false, options);
+      append(options.newline);
+    }
+    if (first_children[node] != FrozenDOM::kNone) {
+      node = first_children[node];
+      ++level;
+      continue;
+    }
+    closeIfNeeded(node, level, false);
+    while (next_siblings[node] == FrozenDOM::kNone) {
+      node = parents[node];
+      --level;
+      closeIfNeeded(node, level, true);
+      if (node == root)
+        return;
+    }
+    node = next_siblings[node];
+  }
+}
+
+void Serializer::writeFrozenTag(const FrozenDOM& frozen, uint32_t node, bool close, const SerializeOptions& options) {
+  const auto type = frozen.getTypes()[node];
+  if (type == Element::kText || type == Element::kComment) {
+    const uint32_t parent = frozen.getParents()[node];
+    if (close)
+      return;
+    if (type == Element::kComment) {
+      append("<!--");
+      CommentState state;
+      appendComment(frozen.getText(node), state);
+      append("-->");
+    } else if (parent != FrozenDOM::kNone && s_isRawText(frozen.getTypes()[parent])) {
+      const std::string_view text = frozen.getText(node);
+      bool after_lt = false;
+      if (!text.empty() && text[0] == '/') {
+        uint32_t previous = frozen.getFirstChildren()[parent];
+        while (previous != node && frozen.getNextSiblings()[previous] != node)
+          previous = frozen.getNextSiblings()[previous];
+        after_lt = previous != node && frozen.getTypes()[previous] == Element::kText && frozen.getText(previous).ends_with('<');
+      }
+      const uint32_t next = frozen.getNextSiblings()[node];
+      std::string escaped;
+      append(s_escapeRawText(text, htmlTags[frozen.getTypes()[parent]], after_lt, next != FrozenDOM::kNone && frozen.getTypes()[next] == Element::kText, escaped));
+    } else {
+      appendEscaped(frozen.getText(node), detail::EscapeMode::Text);
+    }
+    return;
+  }
+  if (close) {
+    if (type < detail::Attribute::kCustomBase) {
+      append(kCloseTags[type].view());
+    } else {
+      append("</");
+      append(frozen.getName(type));
+      append(">");
+    }
+    return;
+  }
+
+  if (type < detail::Attribute::kCustomBase) {
+    append(kOpenTags[type].view());
+  } else {
+    append("<");
+    append(frozen.getName(type));
+  }
+  if (options.show_attrs) {
+    for (const auto& attribute : frozen.getAttrs(node)) {
+      if (attribute.key < detail::Attribute::kCustomBase) {
+        append(kAttrNames[attribute.key].view());
+      } else {
+        append(" ");
+        append(frozen.getName(attribute.key));
+        append("=\"");
+      }
+      appendEscaped(frozen.getString(attribute.value), detail::EscapeMode::Attribute);
+      append("\"");
+    }
+  }
+  append(">");
+}
+
+void Serializer::writeOpenTag(const Element* element, const SerializeOptions& options) {
+  if (!element->isElement()) {
+    writeText(element);
+    return;
+  }
+  const auto type = element->getType();
+  if (std::holds_alternative<Tag::Native>(type)) {
+    append(kOpenTags[std::get<Tag::Native>(type)].view());
+  } else {
+    append("<");
+    append(Tag::s_getAttrName(detail::Attribute::kCustomBase + std::get<Tag::Custom>(type), element->getDocument()->getNames()));
+  }
+
+  if (options.show_attrs) {
+    for (const auto& attribute : element->getAllAttrs()) {
+      if (attribute.key < detail::Attribute::kCustomBase) {
+        append(kAttrNames[attribute.key].view());
+      } else {
+        append(" ");
+        append(Tag::s_getAttrName(attribute.key, element->getDocument()->getNames()));
+        append("=\"");
+      }
+      if (compiling_ != nullptr)
+        compiling_->compileText(*this, attribute.value(), Template::HoleType::Attribute);
+      else
+        appendEscaped(attribute.value(), detail::EscapeMode::Attribute);
+      append("\"");
+    }
+  }
+  append(">");
+}
+
+void Serializer::writeCloseTag(const Element* element) {
+  if (!element->isElement())
+    return;
+  const auto type = element->getType();
+  if (std::holds_alternative<Tag::Native>(type)) {
+    append(kCloseTags[std::get<Tag::Native>(type)].view());
+  } else {
+    append("</");
+    append(Tag::s_getAttrName(detail::Attribute::kCustomBase + std::get<Tag::Custom>(type), element->getDocument()->getNames()));
+    append(">");
+  }
+}
+
+// Raw text goes out as stored but for end tags of its element, other text
+// escaped, and comments as stored but for a '>' that would end them early.
+void Serializer::writeText(const Element* node) {
+  if (node->isComment()) {
+    append("<!--");
+    CommentState state;
+    node->forEachTextChunk([this, &state](std::string_view chunk) { appendComment(chunk, state); });
+    append("-->");
+    return;
+  }
+  const Element* parent = node->getParent();
+  if (parent != nullptr && s_isRawText(parent->getTypeKey())) {
+    std::string joined;
+    std::string escaped;
+    const std::string_view stored = s_getText(node, joined);
+    const bool after_lt = !stored.empty() && stored[0] == '/' && s_endsInLessThan(node->getPreviousSibling());
+    const Element* next = node->getNextSibling();
+    const auto element = static_cast<Tag::Native>(parent->getTypeKey());
+    const std::string_view text = s_escapeRawText(stored, htmlTags[element], after_lt, next != nullptr && next->isText(), escaped);
+    if (compiling_ != nullptr)
+      compiling_->compileText(*this, text, Template::HoleType::Raw, element);
+    else
+      append(text);
+    return;
+  }
+  if (compiling_ != nullptr) {
+    compiling_->compileText(*this, node->getText(), Template::HoleType::Text);
+    return;
+  }
+  node->forEachTextChunk([this](std::string_view chunk) { appendEscaped(chunk, detail::EscapeMode::Text); });
+}
+
+// Comment text set through the API could otherwise close the comment and
+// turn the rest of it into markup, as "x--><script>" would.
+void Serializer::appendComment(std::string_view text, CommentState& state) {
+  while (!text.empty()) {
+    const std::string_view before = text.substr(0, text.find('>'));
+    append(before);
+    state.push(before);
+    if (before.size() == text.size())
+      return;
+    append(state.closes() ? "&gt;" : ">");
+    state.push(">");
+    text.remove_prefix(before.size() + 1);
+  }
+}
+
+// Escapes straight into the chunk while it has room for the worst case, and
+// block by block through the stack near its end, so that append() still
+// hands over full chunks.
+void Serializer::appendEscaped(std::string_view text, detail::EscapeMode mode) {
+  while (!text.empty()) {
+    const std::size_t room = (chunk_.size() - used_) / detail::kMaxEscapeGrowth;
+    if (room >= kEscapeBlock || room >= text.size()) {
+      const std::size_t size = std::min(room, text.size());
+      used_ = static_cast<std::size_t>(detail::escape(text.substr(0, size), chunk_.data() + used_, mode) - chunk_.data());
+      text.remove_prefix(size);
+    } else {
+      char buffer[kEscapeBlock * detail::kMaxEscapeGrowth];
+      const std::size_t size = std::min(kEscapeBlock, text.size());
+      append(std::string_view(buffer, static_cast<std::size_t>(detail::escape(text.substr(0, size), buffer, mode) - buffer)));
+      text.remove_prefix(size);
+    }
+  }
+}
+
+void Serializer::writeIndent(std::size_t level, const SerializeOptions& options) {
+  const std::size_t size = level * options.indent.size();
+  if (size == 0)
+    return;
+  while (indents_.size() < size)
+    indents_.append(options.indent);
+  append(std::string_view(indents_.data(), size));
+}
+
+void Serializer::appendSlow(std::string_view bytes) {
+  while (!bytes.empty()) {
+    std::size_t n = std::min(bytes.size(), chunk_.size() - used_);
+    std::memcpy(chunk_.data() + used_, bytes.data(), n);
+    used_ += n;
+    bytes.remove_prefix(n);
+    if (used_ == chunk_.size())
+      flush();
+  }
+}
+
+} // namespace hi
@@ -0,0 +1,116 @@
+#include "hi.parser/simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HI_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define HI_SIMD_X86 0
+#endif
+
+namespace hi
+{
+namespace detail
+{
+namespace simd
+{
+
+namespace
+{
+
+Level s_level = detectLevel();
+
+} // namespace
+
+Level detectLevel() noexcept {
+#if HI_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return Level::AVX2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return Level::SSE42;
+#endif
+  return Level::Scalar;
+}
+
+Level getLevel() noexcept {
+  return s_level;
+}
+
+void setLevel(Level level) noexcept {
+  Level detected = detectLevel();
+  s_level = static_cast<unsigned char>(level) > static_cast<unsigned char>(detected) ? detected : level;
+}
+
+const char* levelName(Level level) noexcept {
+  switch (level) {
+    case Level::AVX2: return "avx2";
+    case Level::SSE42: return "sse4.2";
+    default: return "scalar";
+  }
+}
+
+const char* CharScanner::find(const char* p, const char* end) const noexcept {
+  switch (s_level) {
+    case Level::AVX2: return findAVX2(p, end);
+    case Level::SSE42: return findSSE42(p, end);
+    default: return findScalar(p, end);
+  }
+}
+
+const char* CharScanner::findNear(const char* p, const char* end) const noexcept {
+  if (s_level == Level::Scalar)
+    return findScalar(p, end);
+  return findSSE42(p, end);
+}
+
+#if HI_SIMD_X86
+
+__attribute__((target("sse4.2")))
+const char* CharScanner::findSSE42(const char* p, const char* end) const noexcept {
+  const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i*>(needles_.data()));
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int index = _mm_cmpestri(needles, count_, chunk, 16,
+      _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+    if (index != 16)
+      return p + index;
+    p += 16;
+  }
+  return findScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* CharScanner::findAVX2(const char* p, const char* end) const noexcept {
+  const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low_nibbles_.data())));
+  const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high_nibbles_.data())));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (end - p >= 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i lo = _mm256_shuffle_epi8(low, _mm256_and_si256(chunk, nibble));
+    __m256i hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+    __m256i misses = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+    auto mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(misses));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return findSSE42(p, end);
+}
+
+#else
+
+const char* CharScanner::findSSE42(const char* p, const char* end) const noexcept {
+  return findScalar(p, end);
+}
+
+const char* CharScanner::findAVX2(const char* p, const char* end) const noexcept {
+  return findScalar(p, end);
+}
+
+#endif // HI_SIMD_X86
+
+} // namespace simd
+} // namespace detail
+} // namespace hi
@@ -0,0 +1,402 @@
+#include "hi.parser/style.h"
+#include "hi.parser/tokenizer.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace hi
+{
+
+namespace
+{
+
+constexpr auto kIdKey = static_cast<detail::Attribute::Key>(Tag::Global::Id);
+constexpr auto kClassKey = static_cast<detail::Attribute::Key>(Tag::Global::Class);
+constexpr auto kStyleKey = static_cast<detail::Attribute::Key>(Tag::Global::Style);
+
+constexpr std::array<std::string_view, 42> kInheritedProperties = {{
+  "border-collapse", "border-spacing", "caption-side", "caret-color", "color", "cursor", "direction",
+  "empty-cells", "fill", "font", "font-family", "font-feature-settings", "font-size", "font-stretch",
+  "font-style", "font-variant", "font-variant-numeric", "font-weight", "hyphens", "letter-spacing",
+  "line-height", "list-style", "list-style-image", "list-style-position", "list-style-type",
+  "overflow-wrap", "pointer-events", "quotes", "stroke", "stroke-width", "tab-size", "text-align",
+  "text-indent", "text-rendering", "text-shadow", "text-transform", "visibility", "white-space",
+  "word-break", "word-spacing", "word-wrap", "writing-mode"
+}};
+
+constexpr std::array<bool, hiweb::cssProperties.size()> s_makeInherited() {
+  std::array<bool, hiweb::cssProperties.size()> inherited{};
+  for (std::string_view name : kInheritedProperties) {
+    std::size_t i = 0;
+    while (i < hiweb::cssProperties.size() && hiweb::cssProperties[i] != name)
+      ++i;
+    if (i == hiweb::cssProperties.size())
+      throw "kInheritedProperties names an unknown property";
+    inherited[i] = true;
+  }
+  return inherited;
+}
+
+constexpr auto kInherited = s_makeInherited();
+
+bool s_isSpace(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// Calls `fn` with each word of a whitespace-separated list.
+template <typename Fn>
+void s_forEachWord(std::string_view list, Fn&& fn) {
+  std::size_t i = 0;
+  while (i < list.size()) {
+    while (i < list.size() && s_isSpace(list[i]))
+      ++i;
+    const std::size_t start = i;
+    while (i < list.size() && !s_isSpace(list[i]))
+      ++i;
+    if (i != start)
+      fn(list.substr(start, i - start));
+  }
+}
+
+uint64_t s_mix(uint64_t hash, uint64_t value) noexcept {
+  hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+uint64_t s_hash(std::string_view text) noexcept {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : text)
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  return hash;
+}
+
+} // namespace
+
+
+std::optional<std::string_view> ComputedStyle::get(PropertyId property) const noexcept {
+  const auto it = std::lower_bound(properties_.begin(), properties_.end(), property,
+    [](const Property& left, PropertyId id) { return left.id < id; });
+  if (it == properties_.end() || it->id != property)
+    return std::nullopt;
+  return it->value;
+}
+
+std::optional<std::string_view> ComputedStyle::get(std::string_view name, const detail::Interner& names) const {
+  if (auto property = hiweb::CSS::s_findProperty(name, names))
+    return get(*property);
+  return std::nullopt;
+}
+
+bool ComputedStyle::isInheritedOnly() const noexcept {
+  return std::all_of(properties_.begin(), properties_.end(), [](const Property& property) { return property.inherited; });
+}
+
+
+const ComputedStyle* Styles::get(const Element& element) const noexcept {
+  const auto it = styles_.find(&element);
+  return it == styles_.end() ? nullptr : it->second.get();
+}
+
+std::size_t Styles::getStyleCount() const {
+  std::unordered_set<const ComputedStyle*> distinct;
+  for (const auto& [element, style] : styles_)
+    distinct.insert(style.get());
+  return distinct.size();
+}
+
+std::size_t Styles::getMemoryUsage() const {
+  std::unordered_set<const ComputedStyle*> distinct;
+  std::size_t bytes = 0;
+  for (const auto& [element, style] : styles_) {
+    // make_shared puts the two reference counts next to the style.
+    if (distinct.insert(style.get()).second)
+      bytes += style->getMemoryUsage() + 2 * sizeof(long);
+  }
+  return bytes;
+}
+
+
+std::size_t StyleResolver::ShareKeyHash::operator()(const ShareKey& key) const noexcept {
+  return static_cast<std::size_t>(s_mix(s_mix(key.fingerprint, key.parent), key.type));
+}
+
+StyleResolver::StyleResolver(detail::Interner& names) : names_(&names), tested_keys_{kStyleKey} {}
+
+// Each complex selector of a rule becomes its own entry, filed under the
+// most selective test of its rightmost compound.
+void StyleResolver::addStylesheet(const hiweb::CSS& sheet) {
+  for (const hiweb::CSSRule& rule : sheet.getRules()) {
+    if (rule.getGroup() != hiweb::CSS::kNone || rule.getDeclarationCount() == 0)
+      continue;
+    try {
+      selectors_.emplace_back(sheet.getSelector(rule), *names_);
+    } catch (const exception::InvalidSelector&) {
+      continue;
+    }
+
+    const Selector& selector = selectors_.back();
+    const auto order = static_cast<uint32_t>(rules_.size());
+    for (std::size_t c = 0; c < selector.getComplexes().size(); ++c) {
+      const Selector::Complex& complex = selector.getComplexes()[c];
+      bool positional = false;
+      for (uint32_t i = complex.first; i < complex.first + complex.compounds; ++i) {
+        const Selector::Compound& compound = selector.getCompounds()[i];
+        if (i + 1 < complex.first + complex.compounds
+            && (compound.combinator == Selector::Combinator::NextSibling || compound.combinator == Selector::Combinator::SubsequentSibling))
+          positional = true;
+        for (const Selector::Test& test : selector.getTests().subspan(compound.first, compound.tests)) {
+          if (test.op == Selector::Test::Op::NthChild || test.op == Selector::Test::Op::NthLastChild)
+            positional = true;
+          else if (test.op != Selector::Test::Op::Type && test.op != Selector::Test::Op::Class)
+            tested_keys_.push_back(test.key);
+        }
+      }
+
+      const auto index = static_cast<uint32_t>(rules_.size());
+      rules_.push_back({static_cast<uint32_t>(selectors_.size() - 1), static_cast<uint32_t>(c), complex.specificity,
+        order, &sheet, &rule, positional});
+
+      const Selector::Compound& subject = selector.getCompounds()[complex.first];
+      const Selector::Test* best = nullptr;
+      for (const Selector::Test& test : selector.getTests().subspan(subject.first, subject.tests)) {
+        if (test.op == Selector::Test::Op::Id || (test.op == Selector::Test::Op::Class && (best == nullptr || best->op != Selector::Test::Op::Id))
+            || (test.op == Selector::Test::Op::Type && best == nullptr))
+          best = &test;
+      }
+      if (best == nullptr)
+        universal_.push_back(index);
+      else if (best->op == Selector::Test::Op::Id)
+        by_id_[selector.getValue(*best)].push_back(index);
+      else if (best->op == Selector::Test::Op::Class)
+        by_class_[selector.getValue(*best)].push_back(index);
+      else
+        by_type_[best->key].push_back(index);
+    }
+  }
+  std::sort(tested_keys_.begin(), tested_keys_.end());
+  tested_keys_.erase(std::unique(tested_keys_.begin(), tested_keys_.end()), tested_keys_.end());
+}
+
+Styles StyleResolver::resolve(const Tag& root, const StyleOptions& options) {
+  Styles styles;
+  resolveSubtree(root, styles, options);
+  return styles;
+}
+
+Styles StyleResolver::resolve(const DOM& dom, const StyleOptions& options) {
+  Styles styles;
+  resolveSubtree(dom.head, styles, options);
+  resolveSubtree(dom.body, styles, options);
+  return styles;
+}
+
+// The root starts without a parent style: the cascade does not reach above
+// it, though selectors do.
+void StyleResolver::resolveSubtree(const Tag& root, Styles& styles, const StyleOptions& options) {
+  filter_.clear();
+  frames_.clear();
+  shared_.clear();
+  for (const Element& element : root.depthFirst()) {
+    if (!element.isElement())
+      continue;
+    filter_.setParentsOf(element);
+    while (!frames_.empty() && frames_.back().element != element.getParent())
+      frames_.pop_back();
+
+    bool shared = false;
+    Frame frame = resolveElement(element, frames_.empty() ? nullptr : &frames_.back(), options, shared);
+    styles.shared_ += shared;
+    styles.styles_.emplace(&element, frame.style);
+    if (!element.getChildren().empty()) {
+      filter_.pushParent(element);
+      frames_.push_back(std::move(frame));
+    }
+  }
+}
+
+// Rules that depend on siblings are matched first: their outcome joins the
+// sharing key, so that elements share only when those rules treat them
+// alike, and the other rules are matched only on a miss.
+StyleResolver::Frame StyleResolver::resolveElement(const Element& element, const Frame* parent, const StyleOptions& options, bool& shared) {
+  collectCandidates(element);
+  matches_.clear();
+  positional_.clear();
+  for (uint32_t index : candidates_) {
+    const Rule& rule = rules_[index];
+    if (rule.positional && selectors_[rule.selector].matches(rule.complex, element, filter_)) {
+      matches_.push_back({static_cast<uint64_t>(rule.specificity) << 32 | rule.order, &rule});
+      positional_.push_back(index);
+    }
+  }
+
+  ShareKey key{};
+  if (options.share) {
+    uint64_t hash = fingerprint(element);
+    for (uint32_t index : positional_)
+      hash = s_mix(hash, index);
+    key = {parent == nullptr ? 0 : parent->share_class, element.getTypeKey(), hash};
+    const auto it = shared_.find(key);
+    if (it != shared_.end() && it->second.positional == positional_ && sameForRules(element, *it->second.element)) {
+      shared = true;
+      return {&element, it->second.style, it->second.share_class};
+    }
+  }
+
+  for (uint32_t index : candidates_) {
+    const Rule& rule = rules_[index];
+    if (!rule.positional && selectors_[rule.selector].matches(rule.complex, element, filter_))
+      matches_.push_back({static_cast<uint64_t>(rule.specificity) << 32 | rule.order, &rule});
+  }
+
+  const ComputedStyle* parent_style = parent == nullptr ? nullptr : parent->style.get();
+  std::shared_ptr<const ComputedStyle> style;
+  if (matches_.empty() && options.share && parent_style != nullptr && parent_style->isInheritedOnly() && inlineStyle(element) == nullptr) {
+    shared = true;
+    style = parent->style;
+  } else {
+    style = cascade(element, parent_style);
+  }
+
+  const uint32_t share_class = ++share_classes_;
+  if (options.share)
+    shared_[key] = {style, positional_, share_class, &element};
+  return {&element, std::move(style), share_class};
+}
+
+// Rules whose rightmost compound may match: those filed under the
+// element's id, one of its classes, its type, and the universal ones.
+void StyleResolver::collectCandidates(const Element& element) {
+  candidates_.clear();
+  for (const detail::Attribute& attribute : element.getAllAttrs()) {
+    if (attribute.key == kIdKey && !by_id_.empty()) {
+      const auto it = by_id_.find(attribute.value());
+      if (it != by_id_.end())
+        addCandidates(it->second);
+    } else if (attribute.key == kClassKey && !by_class_.empty()) {
+      s_forEachWord(attribute.value(), [&](std::string_view name) {
+        const auto it = by_class_.find(name);
+        if (it != by_class_.end())
+          addCandidates(it->second);
+      });
+    }
+  }
+  const auto it = by_type_.find(element.getTypeKey());
+  if (it != by_type_.end())
+    addCandidates(it->second);
+  addCandidates(universal_);
+
+  // A class listed twice would file its rules twice.
+  std::sort(candidates_.begin(), candidates_.end());
+  candidates_.erase(std::unique(candidates_.begin(), candidates_.end()), candidates_.end());
+}
+
+void StyleResolver::addCandidates(const std::vector<uint32_t>& rules) {
+  candidates_.insert(candidates_.end(), rules.begin(), rules.end());
+}
+
+const hiweb::CSS* StyleResolver::inlineStyle(const Element& element) {
+  const detail::Attribute* attribute = element.findAttr(kStyleKey);
+  if (attribute == nullptr)
+    return nullptr;
+  std::string text(attribute->value());
+  auto it = inline_styles_.find(text);
+  if (it == inline_styles_.end())
+    it = inline_styles_.emplace(text, hiweb::CSS::s_fromDeclarations(text, *names_)).first;
+  return &it->second;
+}
+
+// Declarations in cascade order: normal ones from rules by specificity and
+// source order, then the inline style, then important ones the same way;
+// the last declaration of a property wins.
+std::shared_ptr<const ComputedStyle> StyleResolver::cascade(const Element& element, const ComputedStyle* parent) {
+  std::sort(matches_.begin(), matches_.end(), [](const Match& left, const Match& right) { return left.priority < right.priority; });
+  const hiweb::CSS* inline_style = inlineStyle(element);
+
+  declared_.clear();
+  for (bool important : {false, true}) {
+    const auto declare = [&](const hiweb::CSS& sheet, const hiweb::CSSRule& rule) {
+      for (const hiweb::CSSDeclaration& declaration : sheet.getDeclarations(rule)) {
+        if (declaration.important == important)
+          declared_.push_back({declaration.property, static_cast<uint32_t>(declared_.size()), sheet.getValue(declaration)});
+      }
+    };
+    for (const Match& match : matches_)
+      declare(*match.rule->sheet, *match.rule->rule);
+    if (inline_style != nullptr && !inline_style->getRules().empty())
+      declare(*inline_style, inline_style->getRules().front());
+  }
+  std::sort(declared_.begin(), declared_.end(), [](const Declared& left, const Declared& right) {
+    return left.id != right.id ? left.id < right.id : left.order < right.order;
+  });
+
+  // Merge the winning declarations with what the parent passes down.
+  const std::span<const ComputedStyle::Property> inherited = parent == nullptr
+    ? std::span<const ComputedStyle::Property>() : parent->getProperties();
+  std::vector<ComputedStyle::Property> properties;
+  properties.reserve(declared_.size() + inherited.size());
+  std::size_t d = 0, p = 0;
+  while (d < declared_.size() || p < inherited.size()) {
+    if (d == declared_.size() || (p < inherited.size() && inherited[p].id < declared_[d].id)) {
+      if (inherited[p].inherited)
+        properties.push_back(inherited[p]);
+      ++p;
+      continue;
+    }
+
+    while (d + 1 < declared_.size() && declared_[d + 1].id == declared_[d].id)
+      ++d;
+    const Declared& winner = declared_[d++];
+    const bool is_inherited = isInherited(winner.id);
+    const std::string_view value = winner.value;
+    if (p < inherited.size() && inherited[p].id == winner.id)
+      ++p;
+    if (detail::equalsIgnoreCase(value, "initial") || (!is_inherited && detail::equalsIgnoreCase(value, "unset")))
+      continue;
+    if (detail::equalsIgnoreCase(value, "inherit") || detail::equalsIgnoreCase(value, "unset")) {
+      if (auto from_parent = parent == nullptr ? std::nullopt : parent->get(winner.id))
+        properties.push_back({winner.id, is_inherited, *from_parent});
+      continue;
+    }
+    properties.push_back({winner.id, is_inherited, value});
+  }
+  return std::make_shared<const ComputedStyle>(std::move(properties));
+}
+
+uint64_t StyleResolver::fingerprint(const Element& element) const noexcept {
+  uint64_t hash = 0;
+  for (const detail::Attribute& attribute : element.getAllAttrs()) {
+    if (attribute.key == kClassKey || std::binary_search(tested_keys_.begin(), tested_keys_.end(), attribute.key))
+      hash += s_mix(s_hash(attribute.value()), attribute.key);  // order-independent
+  }
+  return hash;
+}
+
+// The attributes any rule looks at, classes and inline style included,
+// are present in both elements with the same values.
+bool StyleResolver::sameForRules(const Element& left, const Element& right) const noexcept {
+  if (left.getTypeKey() != right.getTypeKey())
+    return false;
+  std::size_t compared = 0;
+  for (const detail::Attribute& attribute : left.getAllAttrs()) {
+    if (attribute.key != kClassKey && !std::binary_search(tested_keys_.begin(), tested_keys_.end(), attribute.key))
+      continue;
+    const detail::Attribute* other = right.findAttr(attribute.key);
+    if (other == nullptr || other->value() != attribute.value())
+      return false;
+    ++compared;
+  }
+  for (const detail::Attribute& attribute : right.getAllAttrs()) {
+    if (attribute.key == kClassKey || std::binary_search(tested_keys_.begin(), tested_keys_.end(), attribute.key))
+      --compared;
+  }
+  return compared == 0;
+}
+
+bool StyleResolver::isInherited(PropertyId property) const {
+  if (property < hiweb::CSS::kCustomBase)
+    return kInherited[property];
+  const auto name = names_->name(property - hiweb::CSS::kCustomBase);
+  return name && name->starts_with("--");
+}
+
+} // namespace hi
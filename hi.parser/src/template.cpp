@@ -0,0 +1,184 @@
+#include "hi.parser/template.h"
+#include "hi.parser/escape.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/tokenizer.h"
+
+#include <algorithm>
+
+namespace hi
+{
+
+namespace
+{
+
+// Values are escaped through the stack in blocks of this size.
+constexpr std::size_t kEscapeBlock = 256;
+
+std::string_view s_trim(std::string_view text) noexcept {
+  const std::size_t first = text.find_first_not_of(" \t\n\r\f");
+  if (first == std::string_view::npos)
+    return {};
+  return text.substr(first, text.find_last_not_of(" \t\n\r\f") - first + 1);
+}
+
+// Names are anything but empty, with no braces in them.
+bool s_isHoleName(std::string_view name) noexcept {
+  return !name.empty() && name.find_first_of("{}") == std::string_view::npos;
+}
+
+} // namespace
+
+
+Template::Template(const Tag& root, const SerializeOptions& options) {
+  compile([&](Serializer& serializer) { serializer.write(root, options); });
+}
+
+Template::Template(const DOM& dom, const SerializeOptions& options) {
+  compile([&](Serializer& serializer) { serializer.write(dom, options); });
+}
+
+Template Template::s_parse(std::string_view html, const SerializeOptions& options) {
+  HTML5Parser parser;
+  return Template(parser.parse(html), options);
+}
+
+std::optional<std::size_t> Template::findHole(std::string_view name) const noexcept {
+  const auto it = std::find(holes_.begin(), holes_.end(), name);
+  if (it == holes_.end())
+    return std::nullopt;
+  return static_cast<std::size_t>(it - holes_.begin());
+}
+
+void Template::render(std::span<const std::string_view> values, std::string& out) const {
+  checkValues(values);
+  std::size_t size = out.size() + bytes_.size();
+  for (std::string_view value : values)
+    size += value.size();
+  out.reserve(size);
+
+  char buffer[kEscapeBlock * detail::kMaxEscapeGrowth];
+  for (const Instruction& instruction : program_) {
+    out.append(bytes_.data() + instruction.offset, instruction.size);
+    if (instruction.hole == kNoHole)
+      continue;
+    std::string_view value = values[instruction.hole];
+    if (instruction.type == HoleType::Raw || instruction.type == HoleType::Markup) {
+      out.append(value);
+      continue;
+    }
+    const auto mode = instruction.type == HoleType::Text ? detail::EscapeMode::Text : detail::EscapeMode::Attribute;
+    while (!value.empty()) {
+      const std::size_t block = std::min(kEscapeBlock, value.size());
+      out.append(buffer, static_cast<std::size_t>(detail::escape(value.substr(0, block), buffer, mode) - buffer));
+      value.remove_prefix(block);
+    }
+  }
+}
+
+std::string Template::render(std::span<const std::string_view> values) const {
+  std::string out;
+  render(values, out);
+  return out;
+}
+
+void Template::compile(const std::function<void(Serializer&)>& write) {
+  StringSink sink(bytes_);
+  Serializer serializer(sink);
+  serializer.compiling_ = this;
+  write(serializer);
+  serializer.flush();
+  addInstruction(kNoHole, HoleType::Text);
+}
+
+void Template::compileText(Serializer& serializer, std::string_view text, HoleType type, Tag::Native element) {
+  const auto write = [&serializer, type](std::string_view part) {
+    if (type == HoleType::Raw)
+      serializer.append(part);
+    else
+      serializer.appendEscaped(part, type == HoleType::Text ? detail::EscapeMode::Text : detail::EscapeMode::Attribute);
+  };
+  for (std::size_t from = 0;;) {
+    const std::size_t open = text.find("{{", from);
+    if (open == std::string_view::npos)
+      break;
+    const bool markup = type == HoleType::Text && text.substr(open, 3) == "{{{";
+    const std::string_view closing = markup ? "}}}" : "}}";
+    const std::size_t start = open + closing.size();
+    const std::size_t close = text.find(closing, start);
+    if (close == std::string_view::npos)
+      break;
+    const std::string_view name = s_trim(text.substr(start, close - start));
+    if (!s_isHoleName(name)) {
+      from = open + 1;
+      continue;
+    }
+    write(text.substr(0, open));
+    serializer.flush();
+    addInstruction(addHole(name), markup ? HoleType::Markup : type, element);
+    text.remove_prefix(close + closing.size());
+    from = 0;
+  }
+  write(text);
+}
+
+void Template::addInstruction(uint32_t hole, HoleType type, Tag::Native element) {
+  if (bytes_.size() > UINT32_MAX)
+    throw exception::InvalidTemplate("Static bytes past 4 GiB");
+  const uint32_t offset = program_.empty() ? 0 : program_.back().offset + program_.back().size;
+  program_.push_back({offset, static_cast<uint32_t>(bytes_.size()) - offset, hole, type, element});
+}
+
+uint32_t Template::addHole(std::string_view name) {
+  if (const auto hole = findHole(name))
+    return static_cast<uint32_t>(*hole);
+  holes_.emplace_back(name);
+  return static_cast<uint32_t>(holes_.size() - 1);
+}
+
+void Template::checkValues(std::span<const std::string_view> values) const {
+  if (values.size() < holes_.size())
+    throw exception::InvalidTemplate(std::to_string(holes_.size()) + " holes but " + std::to_string(values.size()) + " values");
+  for (std::size_t i = 0; i < program_.size(); ++i) {
+    if (program_[i].type == HoleType::Raw)
+      checkRawValue(i, values);
+  }
+}
+
+// The end tag may also be completed by the static bytes or values next to
+// the hole, as in "<{{x}}/script>" with x = "", so those bytes are looked
+// at too, as far as an end tag could reach into the value.
+void Template::checkRawValue(std::size_t instruction, std::span<const std::string_view> values) const {
+  const std::string_view name = htmlTags[program_[instruction].element];
+  const std::size_t reach = name.size() + 1;
+  const auto staticBytes = [this](std::size_t i) {
+    return std::string_view(bytes_).substr(program_[i].offset, program_[i].size);
+  };
+  const auto value = [&values, this](std::size_t i) {
+    return program_[i].hole == kNoHole ? std::string_view() : values[program_[i].hole];
+  };
+
+  std::string before;
+  for (std::size_t i = instruction + 1; i-- > 0 && before.size() < reach;) {
+    if (i != instruction)
+      before.insert(0, value(i).substr(value(i).size() - std::min(value(i).size(), reach)));
+    before.insert(0, staticBytes(i).substr(staticBytes(i).size() - std::min(staticBytes(i).size(), reach)));
+  }
+  before.erase(0, before.size() - std::min(before.size(), reach));
+  std::string after;
+  for (std::size_t i = instruction + 1; i < program_.size() && after.size() < reach; ++i) {
+    after.append(staticBytes(i).substr(0, reach));
+    after.append(value(i).substr(0, reach));
+  }
+  after.resize(std::min(after.size(), reach));
+
+  const std::string window = before + std::string(value(instruction)) + after;
+  const std::size_t hole_end = window.size() - after.size();
+  for (std::size_t at = window.find("</"); at != std::string::npos && at < hole_end; at = window.find("</", at + 1)) {
+    if (at + 2 + name.size() > before.size() && window.size() - at - 2 >= name.size()
+        && detail::equalsIgnoreCase(std::string_view(window).substr(at + 2, name.size()), name))
+      throw exception::InvalidTemplate("The value of hole \"" + holes_[program_[instruction].hole] + "\" would end its <"
+        + std::string(name) + "> element");
+  }
+}
+
+} // namespace hi
@@ -0,0 +1,84 @@
+#include "hi.parser/thread_pool.h"
+
+#include <algorithm>
+
+namespace hi
+{
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  workers_.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i)
+    workers_.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t)>& body) {
+  if (count == 0)
+    return;
+  std::lock_guard run_lock(run_mutex_);
+  {
+    std::lock_guard lock(mutex_);
+    body_ = &body;
+    count_ = count;
+    next_.store(0, std::memory_order_relaxed);
+    busy_ = workers_.size();
+    error_ = nullptr;
+    ++generation_;
+  }
+  wake_.notify_all();
+  drain(body, count);
+
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [this] { return busy_ == 0; });
+  body_ = nullptr;
+  if (error_)
+    std::rethrow_exception(error_);
+}
+
+void ThreadPool::work() {
+  std::size_t seen = 0;
+  for (;;) {
+    const std::function<void(std::size_t)>* body;
+    std::size_t count;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_)
+        return;
+      seen = generation_;
+      body = body_;
+      count = count_;
+    }
+    drain(*body, count);
+    {
+      std::lock_guard lock(mutex_);
+      --busy_;
+    }
+    done_.notify_one();
+  }
+}
+
+void ThreadPool::drain(const std::function<void(std::size_t)>& body, std::size_t count) noexcept {
+  for (std::size_t i = next_.fetch_add(1, std::memory_order_relaxed); i < count; i = next_.fetch_add(1, std::memory_order_relaxed)) {
+    try {
+      body(i);
+    } catch (...) {
+      std::lock_guard lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+    }
+  }
+}
+
+} // namespace hi
@@ -0,0 +1,290 @@
+#include "hi.parser/tokenizer.h"
+#include "hi.parser/simd.h"
+
+#include <array>
+#include <cstring>
+
+namespace hi
+{
+namespace detail
+{
+
+namespace
+{
+
+using simd::CharScanner;
+
+constexpr CharScanner kText{'<', '&'};
+constexpr CharScanner kTagOpen{'<'};
+constexpr CharScanner kTagClose{'>'};
+constexpr CharScanner kTagName{' ', '\t', '\n', '\f', '\r', '/', '>'};
+constexpr CharScanner kAttrName{' ', '\t', '\n', '\f', '\r', '/', '>', '='};
+constexpr CharScanner kUnquoted{' ', '\t', '\n', '\f', '\r', '>', '&'};
+constexpr CharScanner kDoubleQuoted{'"', '&'};
+constexpr CharScanner kSingleQuoted{'\'', '&'};
+
+constexpr std::array<std::string_view, 7> kRawTextElements = {{
+  "script", "style", "textarea", "title", "xmp", "iframe", "noframes"
+}};
+
+inline bool s_isWhitespace(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+inline bool s_isAlpha(char c) noexcept {
+  return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+
+inline char s_toLower(char c) noexcept {
+  return static_cast<unsigned char>(c - 'A') < 26 ? static_cast<char>(c | 0x20) : c;
+}
+
+// Advances past everything up to the first byte `scanner` stops at, except
+// '&', which only marks the token as containing character references.
+inline const char* s_scanValue(const CharScanner& scanner, const char* p, const char* end, bool& has_references) noexcept {
+  for (;;) {
+    p = scanner.findNear(p, end);
+    if (p == end || *p != '&')
+      return p;
+    has_references = true;
+    ++p;
+  }
+}
+
+} // namespace
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (s_toLower(a[i]) != s_toLower(b[i]))
+      return false;
+  }
+  return true;
+}
+
+Tokenizer::Tokenizer(std::string_view input)
+  : begin_(input.data()), cursor_(input.data()), end_(input.data() + input.size())
+{}
+
+bool Tokenizer::next(Token& token) {
+  token.self_closing = false;
+  token.has_references = false;
+  token.attributes = nullptr;
+
+  if (!raw_text_end_.empty()) {
+    readRawText(token);
+    if (!token.data.empty())
+      return true;
+  }
+
+  // "</>" is dropped entirely, however many follow each other.
+  while (end_ - cursor_ >= 3 && cursor_[0] == '<' && cursor_[1] == '/' && cursor_[2] == '>')
+    cursor_ += 3;
+
+  if (cursor_ == end_) {
+    token.kind = Token::Kind::EndOfFile;
+    token.data = {};
+    return false;
+  }
+
+  if (*cursor_ != '<' || cursor_ + 1 == end_) {
+    readText(token);
+    return true;
+  }
+
+  const char c = cursor_[1];
+  if (c == '!') {
+    readMarkupDeclaration(token);
+  } else if (c == '/') {
+    if (cursor_ + 2 < end_ && s_isAlpha(cursor_[2])) {
+      readEndTag(token);
+    } else {
+      readBogusComment(token, cursor_ + 2);
+    }
+  } else if (c == '?') {
+    readBogusComment(token, cursor_ + 1);
+  } else if (s_isAlpha(c)) {
+    readStartTag(token);
+  } else {
+    readText(token);
+  }
+  return true;
+}
+
+void Tokenizer::readText(Token& token) {
+  const char* start = cursor_;
+  bool has_references = false;
+  // A '<' that does not open a tag is plain text.
+  const char* p = s_scanValue(kText, cursor_ + 1, end_, has_references);
+  has_references |= *start == '&';
+
+  token.kind = Token::Kind::Text;
+  token.data = std::string_view(start, static_cast<std::size_t>(p - start));
+  token.has_references = has_references;
+  cursor_ = p;
+}
+
+void Tokenizer::readRawText(Token& token) {
+  const char* start = cursor_;
+  const char* p = cursor_;
+  const std::size_t length = raw_text_end_.size();
+  for (;;) {
+    p = kTagOpen.findNear(p, end_);
+    if (p == end_)
+      break;
+    const char* name = p + 2;
+    if (p + 1 < end_ && p[1] == '/' && static_cast<std::size_t>(end_ - name) >= length
+        && equalsIgnoreCase(std::string_view(name, length), raw_text_end_)
+        && (name + length == end_ || s_isWhitespace(name[length]) || name[length] == '/' || name[length] == '>'))
+      break;
+    ++p;
+  }
+
+  token.kind = Token::Kind::Text;
+  token.data = std::string_view(start, static_cast<std::size_t>(p - start));
+  // Only <textarea> and <title> (RCDATA) take character references.
+  token.has_references = (raw_text_end_.size() == 5 || raw_text_end_.size() == 8)
+    && (equalsIgnoreCase(raw_text_end_, "title") || equalsIgnoreCase(raw_text_end_, "textarea"))
+    && std::memchr(start, '&', token.data.size()) != nullptr;
+  raw_text_end_ = {};
+  cursor_ = p;
+}
+
+void Tokenizer::readMarkupDeclaration(Token& token) {
+  const char* start = cursor_ + 2;
+  const std::size_t available = static_cast<std::size_t>(end_ - start);
+
+  if (available >= 2 && start[0] == '-' && start[1] == '-') {
+    const char* content = start + 2;
+    const char* p = content;
+    for (;;) {
+      p = kTagClose.findNear(p, end_);
+      if (p == end_ || (p - content >= 2 && p[-1] == '-' && p[-2] == '-'))
+        break;
+      // "<!-->" and "<!--->" are abruptly closed empty comments.
+      if (p - content < 2 && (p == content || (p == content + 1 && *content == '-')))
+        break;
+      ++p;
+    }
+    token.kind = Token::Kind::Comment;
+    const char* data_end = p == end_ ? end_ : (p - content >= 2 ? p - 2 : content);
+    token.data = std::string_view(content, static_cast<std::size_t>(data_end - content));
+    cursor_ = p == end_ ? end_ : p + 1;
+    return;
+  }
+
+  if (available >= 7 && equalsIgnoreCase(std::string_view(start, 7), "doctype")) {
+    const char* content = start + 7;
+    const char* p = kTagClose.findNear(content, end_);
+    while (content != p && s_isWhitespace(*content))
+      ++content;
+    token.kind = Token::Kind::Doctype;
+    token.data = std::string_view(content, static_cast<std::size_t>(p - content));
+    cursor_ = p == end_ ? end_ : p + 1;
+    return;
+  }
+
+  readBogusComment(token, start);
+}
+
+void Tokenizer::readBogusComment(Token& token, const char* start) {
+  const char* p = kTagClose.findNear(start, end_);
+  token.kind = Token::Kind::Comment;
+  token.data = std::string_view(start, static_cast<std::size_t>(p - start));
+  cursor_ = p == end_ ? end_ : p + 1;
+}
+
+void Tokenizer::readEndTag(Token& token) {
+  const char* name = cursor_ + 2;
+  const char* p = kTagName.findNear(name, end_);
+  token.kind = Token::Kind::EndTag;
+  token.data = std::string_view(name, static_cast<std::size_t>(p - name));
+  p = kTagClose.findNear(p, end_);
+  cursor_ = p == end_ ? end_ : p + 1;
+}
+
+void Tokenizer::readStartTag(Token& token) {
+  const char* name = cursor_ + 1;
+  const char* p = kTagName.findNear(name, end_);
+  token.kind = Token::Kind::StartTag;
+  token.data = std::string_view(name, static_cast<std::size_t>(p - name));
+  cursor_ = p;
+  readAttributes(token);
+
+  for (std::string_view raw : kRawTextElements) {
+    if (equalsIgnoreCase(token.data, raw)) {
+      raw_text_end_ = raw;
+      break;
+    }
+  }
+}
+
+void Tokenizer::readAttributes(Token& token) {
+  attributes_.clear();
+  token.attributes = &attributes_;
+
+  for (;;) {
+    skipWhitespace();
+    if (cursor_ == end_)
+      return;
+
+    const char c = *cursor_;
+    if (c == '>') {
+      ++cursor_;
+      return;
+    }
+    if (c == '/') {
+      ++cursor_;
+      if (cursor_ != end_ && *cursor_ == '>') {
+        token.self_closing = true;
+        ++cursor_;
+        return;
+      }
+      continue;
+    }
+
+    // A leading '=' belongs to the name.
+    const char* name = cursor_;
+    cursor_ = kAttrName.findNear(cursor_ + 1, end_);
+    Token::Attribute attribute{std::string_view(name, static_cast<std::size_t>(cursor_ - name)), {}};
+
+    skipWhitespace();
+    if (cursor_ != end_ && *cursor_ == '=') {
+      ++cursor_;
+      skipWhitespace();
+      if (cursor_ != end_) {
+        const char quote = *cursor_;
+        if (quote == '"' || quote == '\'') {
+          const char* value = cursor_ + 1;
+          const char* p = s_scanValue(quote == '"' ? kDoubleQuoted : kSingleQuoted, value, end_, token.has_references);
+          attribute.value = std::string_view(value, static_cast<std::size_t>(p - value));
+          cursor_ = p == end_ ? end_ : p + 1;
+        } else {
+          const char* value = cursor_;
+          cursor_ = s_scanValue(kUnquoted, value, end_, token.has_references);
+          attribute.value = std::string_view(value, static_cast<std::size_t>(cursor_ - value));
+        }
+      }
+    }
+
+    // Later duplicates of an attribute are ignored.
+    bool duplicate = false;
+    for (const auto& existing : attributes_) {
+      if (equalsIgnoreCase(existing.name, attribute.name)) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (!duplicate)
+      attributes_.push_back(attribute);
+  }
+}
+
+void Tokenizer::skipWhitespace() noexcept {
+  while (cursor_ != end_ && s_isWhitespace(*cursor_))
+    ++cursor_;
+}
+
+} // namespace detail
+} // namespace hi
@@ -0,0 +1,44 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+
+#include <memory>
+
+using namespace hi;
+
+
+HI_TEST(known_names_map_to_global_and_event_ids) {
+  const Tag div("div");
+  CHECK(div.getAttrKey("class") == Tag::AttrKey(Tag::Global::Class));
+  CHECK(div.getAttrKey("ID") == Tag::AttrKey(Tag::Global::Id));
+  CHECK(div.getAttrKey("onclick") == Tag::AttrKey(Tag::Event::OnClick));
+  CHECK(Tag::AttrKey(Tag::Global::Class) != Tag::AttrKey(Tag::Global::Id));
+  CHECK_EQ(Tag::s_getAttrName(Tag::AttrKey(Tag::Global::Hidden).get()), std::string_view("hidden"));
+  CHECK(div.getAttrKey("data-x").get() >= detail::Attribute::kCustomBase);
+}
+
+HI_TEST(access_by_key_and_by_name_agree) {
+  Tag div("div");
+  div.setAttr(Tag::Global::Id, "main");
+  div.setAttr("class", "wide");
+  div.setAttr(Tag::Event::OnClick, "go()");
+  CHECK_EQ(div.getAttr("id"), std::string_view("main"));
+  CHECK_EQ(div.getAttr(Tag::Global::Class), std::string_view("wide"));
+  CHECK_EQ(div.getAttr("onclick"), std::string_view("go()"));
+  const Tag::AttrKey role = div.getAttrKey("data-role");
+  div.setAttr(role, "nav");
+  CHECK_EQ(div.getAttr("data-role"), std::string_view("nav"));
+  CHECK(div.hasAttr(role));
+  div.removeAttr(Tag::Global::Class);
+  CHECK(!div.hasAttr("class"));
+  CHECK_THROWS(div.getAttr(Tag::Global::Class), exception::InvalidAttribute);
+}
+
+HI_TEST(custom_keys_belong_to_the_registry_of_the_document) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<div data-role=nav></div>", std::make_shared<detail::Interner>());
+  const Tag div = dom.getElementsByTagName("div").front();
+  const Tag::AttrKey role = div.getAttrKey("data-role");
+  CHECK(dom.getNames().find("data-role").has_value());
+  CHECK_EQ(div.getAttr(role), std::string_view("nav"));
+  CHECK_EQ(Tag::s_getAttrName(role.get(), dom.getNames()), std::string_view("data-role"));
+}
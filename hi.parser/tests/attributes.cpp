@@ -0,0 +1,98 @@
+#include "test.h"
+#include "hi.parser/html5.h"
+
+#include <string>
+#include <vector>
+
+using namespace hi;
+using hi::detail::Attribute;
+
+namespace
+{
+
+// Names of the attributes of `element` in storage order, space separated.
+std::string s_names(const Tag::Element& element) {
+  std::string names;
+  for (const Attribute& attribute : element.getAllAttrs()) {
+    if (!names.empty())
+      names += ' ';
+    names += Tag::s_getAttrName(attribute.key);
+  }
+  return names;
+}
+
+} // namespace
+
+
+HI_TEST(the_first_attribute_is_stored_inline) {
+  DOM dom;
+  dom.body << dom.createElement("div");
+  Tag::Element& div = *dom.body.getChildren()[0];
+  CHECK(div.getAllAttrs().empty());
+  CHECK(!div.hasAttr("id"));
+  div.setAttr("id", "a");
+  CHECK_EQ(div.getAttr("id"), std::string_view("a"));
+  div.setAttr("id", "b");
+  CHECK_EQ(div.getAllAttrs().size(), std::size_t(1));
+  CHECK_EQ(div.getAttr("id"), std::string_view("b"));
+  div.removeAttr("id");
+  CHECK(!div.hasAttr("id"));
+  CHECK_THROWS(div.getAttr("id"), exception::InvalidAttribute);
+  div.removeAttr("id");
+}
+
+HI_TEST(more_attributes_move_to_an_array_in_order) {
+  DOM dom;
+  dom.body << dom.createElement("div");
+  Tag::Element& div = *dom.body.getChildren()[0];
+  div.setAttr("id", "a");
+  div.setAttr("class", "c");
+  div.setAttr("title", "t");
+  CHECK_EQ(s_names(div), std::string("id class title"));
+  CHECK_EQ(div.getAttr("id"), std::string_view("a"));
+  CHECK_EQ(div.getAttr("title"), std::string_view("t"));
+  div.removeAttr("class");
+  CHECK_EQ(s_names(div), std::string("id title"));
+  div.setAttr("class", "d");
+  CHECK_EQ(s_names(div), std::string("id title class"));
+  CHECK_EQ(div.getAttr("class"), std::string_view("d"));
+}
+
+HI_TEST(many_attributes_are_found_through_a_table) {
+  DOM dom;
+  dom.body << dom.createElement("div");
+  Tag::Element& div = *dom.body.getChildren()[0];
+  constexpr Attribute::Key kFirst = Attribute::kCustomBase + 100000;
+  constexpr std::size_t kCount = 40;
+  for (std::size_t i = 0; i < kCount; ++i)
+    div.setAttr(kFirst + Attribute::Key(i), std::to_string(i));
+  CHECK_EQ(div.getAllAttrs().size(), kCount);
+  for (std::size_t i = 0; i < kCount; i += 2)
+    div.removeAttr(kFirst + Attribute::Key(i));
+  CHECK_EQ(div.getAllAttrs().size(), kCount / 2);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    CHECK_EQ(div.hasAttr(kFirst + Attribute::Key(i)), i % 2 == 1);
+    if (i % 2 == 1)
+      CHECK_EQ(std::string(div.getAttr(kFirst + Attribute::Key(i))), std::to_string(i));
+  }
+  div.setAttr(kFirst, "again");
+  CHECK_EQ(div.getAttr(kFirst), std::string_view("again"));
+}
+
+HI_TEST(an_element_holds_at_most_kMaxAttrs) {
+  DOM dom;
+  dom.body << dom.createElement("div");
+  Tag::Element& div = *dom.body.getChildren()[0];
+  constexpr Attribute::Key kFirst = Attribute::kCustomBase + 100000;
+  for (std::size_t i = 0; i < Tag::Element::kMaxAttrs; ++i)
+    div.setAttrView(kFirst + Attribute::Key(i), "v");
+  CHECK_THROWS(div.setAttrView(kFirst + Attribute::Key(Tag::Element::kMaxAttrs), "v"), exception::InvalidAttribute);
+  div.setAttrView(kFirst, "replaced");
+  CHECK_EQ(div.getAttr(kFirst), std::string_view("replaced"));
+}
+
+HI_TEST(text_nodes_have_no_attributes) {
+  DOM dom;
+  dom.body.addText("text");
+  CHECK_THROWS(dom.body.getChildren()[0]->setAttr("id", "a"), exception::InvalidAttribute);
+}
@@ -0,0 +1,74 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+
+#include <optional>
+#include <string>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kLayout =
+  "<title>Layout</title><div id=main class=page><h1>Heading</h1><time datetime=x>now</time><ul><li>1<li>2</ul></div>";
+
+} // namespace
+
+
+HI_TEST(copies_serialize_like_their_original) {
+  HTML5Parser parser;
+  const DOM layout = parser.parse(kLayout);
+  const DOM copy = layout.copyTree();
+  CHECK_EQ(copy.toString(), layout.toString());
+  CHECK(copy.body.getChildren()[0] != layout.body.getChildren()[0]);
+  CHECK(copy.getElementById("main").has_value());
+  CHECK_EQ(copy.getElementsByTagName("li").size(), std::size_t(2));
+}
+
+HI_TEST(edits_stay_in_their_document) {
+  HTML5Parser parser;
+  DOM layout = parser.parse(kLayout);
+  const std::string before = layout.toString();
+  DOM copy = layout.copyTree();
+
+  Tag heading = *copy.findCopy(layout.getElementsByTagName("h1").front());
+  heading.setText("Request 1");
+  Tag time = *copy.findCopy(layout.getElementsByTagName("time").front());
+  time.setAttr("datetime", "2024-01-01");
+  copy.body << copy.createElement("footer");
+  CHECK_EQ(layout.toString(), before);
+  CHECK(copy.toString().find("Request 1") != std::string::npos);
+  CHECK(copy.toString().find("2024-01-01") != std::string::npos);
+
+  const std::string copied = copy.toString();
+  layout.getElementsByTagName("h1").front().setText("Changed");
+  layout.getElementsByTagName("ul").front().setAttr("class", "list");
+  CHECK_EQ(copy.toString(), copied);
+}
+
+HI_TEST(copies_keep_the_strings_of_their_original) {
+  HTML5Parser parser;
+  std::optional<DOM> copy;
+  std::string expected;
+  {
+    std::string html = kLayout;
+    const DOM layout = parser.parse(html);
+    expected = layout.toString();
+    copy.emplace(layout.copyTree());
+  }
+  CHECK_EQ(copy->toString(), expected);
+  const DOM second = copy->copyTree();
+  copy.reset();
+  CHECK_EQ(second.toString(), expected);
+}
+
+HI_TEST(find_copy_follows_positions) {
+  HTML5Parser parser;
+  const DOM layout = parser.parse(kLayout);
+  DOM copy = layout.copyTree();
+  const Tag second = layout.getElementsByTagName("li").back();
+  CHECK_EQ(copy.findCopy(second)->getText(), std::string("2"));
+  CHECK(!copy.findCopy(parser.parse(kLayout).body).has_value());
+  const DOM other = parser.parse(kLayout);
+  CHECK(!other.findCopy(second).has_value());
+}
@@ -0,0 +1,94 @@
+#include "test.h"
+#include "CSS.h"
+
+#include <optional>
+#include <string>
+
+using hiweb::CSS;
+
+namespace
+{
+
+// "property: value" of every declaration of `rule`, separated by "; ", with
+// " !" after important ones.
+std::string s_declarations(const CSS& sheet, const hiweb::CSSRule& rule) {
+  std::string text;
+  for (const auto& declaration : sheet.getDeclarations(rule)) {
+    if (!text.empty())
+      text += "; ";
+    text += sheet.getPropertyName(declaration.property);
+    text += ": ";
+    text += sheet.getValue(declaration);
+    if (declaration.important)
+      text += " !";
+  }
+  return text;
+}
+
+} // namespace
+
+
+HI_TEST(rules_and_declarations) {
+  const CSS sheet("a { color: red; margin : 0 auto }\n"
+                  "ul > li.item, #main { padding: 1px !important; }");
+  CHECK_EQ(sheet.getRules().size(), std::size_t(2));
+  CHECK_EQ(sheet.getSelector(sheet.getRules()[0]), std::string_view("a"));
+  CHECK_EQ(s_declarations(sheet, sheet.getRules()[0]), std::string("color: red; margin: 0 auto"));
+  CHECK_EQ(sheet.getSelector(sheet.getRules()[1]), std::string_view("ul > li.item, #main"));
+  CHECK_EQ(s_declarations(sheet, sheet.getRules()[1]), std::string("padding: 1px !"));
+  CHECK_EQ(sheet.getRules()[0].getGroup(), CSS::kNone);
+}
+
+HI_TEST(comments_and_strings_do_not_end_runs) {
+  const CSS sheet("/* a; b { } */ p /* x */ { content: \"a;b}c\"; /* color: red; */ background: url(a;b.png) }\n"
+                  "q { quotes: '{' '}' }");
+  CHECK_EQ(sheet.getRules().size(), std::size_t(2));
+  CHECK_EQ(s_declarations(sheet, sheet.getRules()[0]), std::string("content: \"a;b}c\"; background: url(a;b.png)"));
+  CHECK_EQ(s_declarations(sheet, sheet.getRules()[1]), std::string("quotes: '{' '}'"));
+}
+
+HI_TEST(at_rules) {
+  const CSS sheet("@charset \"utf-8\";\n"
+                  "@import url(base.css);\n"
+                  "@media (min-width: 600px) { .wide { width: 100% } @supports (gap: 1px) { .grid { gap: 1px } } }\n"
+                  "@font-face { font-family: X; src: url(x.woff2) }\n"
+                  "b { font-weight: bold }");
+  const auto at_rules = sheet.getAtRules();
+  CHECK_EQ(at_rules.size(), std::size_t(5));
+  CHECK_EQ(sheet.getText(at_rules[0].name), std::string_view("charset"));
+  CHECK_EQ(sheet.getText(at_rules[1].prelude), std::string_view("url(base.css)"));
+  CHECK_EQ(sheet.getText(at_rules[2].name), std::string_view("media"));
+  CHECK_EQ(sheet.getText(at_rules[2].prelude), std::string_view("(min-width: 600px)"));
+  CHECK_EQ(at_rules[3].parent, uint32_t(2));
+  CHECK_EQ(sheet.getText(at_rules[4].name), std::string_view("font-face"));
+
+  const auto rules = sheet.getRules();
+  CHECK_EQ(rules.size(), std::size_t(4));
+  CHECK_EQ(sheet.getSelector(rules[0]), std::string_view(".wide"));
+  CHECK_EQ(rules[0].getGroup(), uint32_t(2));
+  CHECK_EQ(rules[1].getGroup(), uint32_t(3));
+  CHECK_EQ(rules[2].getGroup(), uint32_t(4));
+  CHECK_EQ(s_declarations(sheet, rules[2]), std::string("font-family: X; src: url(x.woff2)"));
+  CHECK_EQ(rules[3].getGroup(), CSS::kNone);
+}
+
+HI_TEST(custom_properties_are_interned) {
+  hi::detail::Interner names;
+  const CSS sheet(":root { --accent: #f00; -webkit-appearance: none; COLOR: blue }", names);
+  const auto declarations = sheet.getDeclarations(sheet.getRules()[0]);
+  CHECK_EQ(declarations.size(), std::size_t(3));
+  CHECK(declarations[0].property >= CSS::kCustomBase);
+  CHECK_EQ(sheet.getPropertyName(declarations[0].property), std::string_view("--accent"));
+  CHECK_EQ(CSS::s_findProperty("--accent", names), std::optional<CSS::PropertyId>(declarations[0].property));
+  CHECK_EQ(sheet.getPropertyName(declarations[1].property), std::string_view("-webkit-appearance"));
+  CHECK_EQ(sheet.getPropertyName(declarations[2].property), std::string_view("color"));
+  CHECK(!CSS::s_findProperty("--unused", names).has_value());
+}
+
+HI_TEST(unreadable_input_is_dropped) {
+  const CSS sheet("a { color red; width: 1px; : 2px } } b { top: 0");
+  CHECK_EQ(s_declarations(sheet, sheet.getRules()[0]), std::string("width: 1px"));
+  const CSS declarations = CSS::s_fromDeclarations("color: red; ; font-size: 2em");
+  CHECK_EQ(declarations.getRules().size(), std::size_t(1));
+  CHECK_EQ(s_declarations(declarations, declarations.getRules()[0]), std::string("color: red; font-size: 2em"));
+}
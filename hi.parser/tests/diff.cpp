@@ -0,0 +1,74 @@
+#include "test.h"
+#include "hi.parser/diff.h"
+#include "hi.parser/parser.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+// Diffs the pages, patches a fresh parse of the first and returns the
+// patched markup next to that of the second.
+std::pair<std::string, std::string> s_patch(const std::string& from, const std::string& to, std::size_t* edits = nullptr) {
+  HTML5Parser parser;
+  const DOM old_dom = parser.parse(from);
+  const DOM new_dom = parser.parse(to);
+  const EditScript script = TreeDiff().diff(old_dom, new_dom);
+  if (edits != nullptr)
+    *edits = script.size();
+  DOM patched = parser.parse(from);
+  script.apply(patched);
+  return {patched.toString(), new_dom.toString()};
+}
+
+} // namespace
+
+
+HI_TEST(same_trees_give_an_empty_script) {
+  std::size_t edits = 1;
+  const auto [patched, expected] = s_patch("<div id=a><span>x</span></div>", "<div id=a><span>x</span></div>", &edits);
+  CHECK_EQ(edits, std::size_t(0));
+  CHECK_EQ(patched, expected);
+}
+
+HI_TEST(patch_of_diff_gives_the_new_tree) {
+  const std::vector<std::pair<std::string, std::string>> cases = {
+    {"<div class=a>x</div>", "<div class=b title=t>x</div>"},
+    {"<div class=a title=t>x</div>", "<div>x</div>"},
+    {"<ul><li>1<li>2</ul>", "<ul><li>1<li>2<li>3</ul>"},
+    {"<ul><li>1<li>2<li>3</ul>", "<ul><li>1<li>3</ul>"},
+    {"<ul><li id=a>1<li id=b>2<li id=c>3</ul>", "<ul><li id=c>3<li id=a>1<li id=b>2</ul>"},
+    {"<div id=x><span>s</span></div><section></section>", "<section><div id=x><span>s</span></div></section>"},
+    {"<span>old</span><!-- a -->", "<span>new</span><!-- b -->"},
+    {"<div><span>x</span></div>", "<div><em>x</em></div>"},
+    {"<x-card data-n=1>a</x-card>", "<x-card data-n=2><x-title>t</x-title>a</x-card>"},
+    {"<title>A</title><div>x</div>", "<title>B</title><meta name=m><div>x</div>"},
+    {"<div><a>1</a><b>2</b><i>3</i></div>", "<div><i>3</i><b>2</b><a>1</a></div>"},
+    {"<div>x</div>", ""},
+    {"", "<div><span>x</span>y</div>"},
+  };
+  for (const auto& [from, to] : cases) {
+    const auto [patched, expected] = s_patch(from, to);
+    CHECK_EQ(patched, expected);
+  }
+}
+
+HI_TEST(moves_by_id_keep_the_subtree) {
+  std::size_t edits = 0;
+  const auto [patched, expected] = s_patch("<ul><li id=a><b>1</b><i>2</i></li><li id=b>3</li></ul>",
+                                           "<ul><li id=b>3</li><li id=a><b>1</b><i>2</i></li></ul>", &edits);
+  CHECK_EQ(patched, expected);
+  CHECK_EQ(edits, std::size_t(1));
+}
+
+HI_TEST(scripts_apply_only_to_their_tree) {
+  HTML5Parser parser;
+  const EditScript script = TreeDiff().diff(parser.parse("<div><span>x</span></div>"), parser.parse("<div><span class=c>x</span></div>"));
+  CHECK(script.toJSON().find("\"op\":\"setAttr\"") != std::string::npos);
+  DOM other = parser.parse("");
+  CHECK_THROWS(script.apply(other), exception::Error);
+}
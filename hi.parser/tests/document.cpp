@@ -0,0 +1,177 @@
+#include "test.h"
+#include "hi.parser/html5.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+
+HI_TEST(child_outlives_the_document_of_its_parent) {
+  Tag z("div");
+  Tag y("span");
+  {
+    Tag x("p");
+    x << y;
+    CHECK_EQ(x.getChildren().size(), std::size_t(1));
+  }
+  z << y;
+  CHECK_EQ(z.getChildren().size(), std::size_t(1));
+  CHECK_EQ(z.toString("", false), std::string("<div>\n</div>\n"));
+  CHECK_EQ(z.toString(""), std::string("<div>\n<span>\n</span>\n</div>\n"));
+}
+
+// b's document is kept alive by a's and then has to keep a's alive too:
+// the two live as long as either is used, whichever goes first.
+HI_TEST(graft_into_a_document_that_keeps_the_child_alive_ties_them) {
+  Tag b("span");
+  {
+    Tag a("div");
+    a << b;
+    b << a.createElement("em");
+    b.insertChild(a.createElement("i"), 0);
+  }
+  CHECK_EQ(b.toString(""), std::string("<span>\n<i>\n</i>\n<em>\n</em>\n</span>\n"));
+
+  std::optional<Tag> kept;
+  {
+    DOM dom;
+    Tag div("div");
+    dom.body << div;
+    div << dom.createElement("p");
+    kept = div;
+  }
+  CHECK_EQ(kept->toString(""), std::string("<div>\n<p>\n</p>\n</div>\n"));
+
+  std::optional<Tag> body;
+  {
+    DOM dom;
+    Tag div("div");
+    dom.body << div;
+    div << dom.createElement("p");
+    body = dom.body;
+  }
+  CHECK_EQ(body->toString(""), std::string("<body>\n<div>\n<p>\n</p>\n</div>\n</body>\n"));
+
+  // A longer way back ties every document on it.
+  std::optional<Tag> first;
+  {
+    Tag a("ul");
+    Tag b("li");
+    Tag c("em");
+    a << b;
+    b << c;
+    c << a.createElement("b");
+    first = b;
+  }
+  CHECK_EQ(first->toString(""), std::string("<li>\n<em>\n<b>\n</b>\n</em>\n</li>\n"));
+
+  // Tying the documents together does not let the elements form a cycle.
+  Tag x("div");
+  Tag y("span");
+  x << y;
+  CHECK_THROWS(y << x, exception::InvalidTag);
+}
+
+// An element under itself or under one of its descendants would make the
+// tree a cycle that serializing or walking it never gets out of.
+HI_TEST(adding_an_element_under_itself_is_refused) {
+  Tag a("div");
+  CHECK_THROWS(a << a, exception::InvalidTag);
+  CHECK_THROWS(a.insertChild(a, 0), exception::InvalidTag);
+  CHECK(a.getChildren().empty());
+
+  Tag b = a.createElement("span");
+  Tag c = a.createElement("em");
+  a << b;
+  b << c;
+  CHECK_THROWS(b << a, exception::InvalidTag);
+  CHECK_THROWS(c.insertChild(a, 0), exception::InvalidTag);
+  CHECK(c.getChildren().empty());
+  CHECK_EQ(a.toString(""), std::string("<div>\n<span>\n<em>\n</em>\n</span>\n</div>\n"));
+}
+
+HI_TEST(graft_keeps_the_child_document_alive) {
+  Tag parent("div");
+  {
+    Tag child("span");
+    child.setAttr("class", "kept");
+    parent << child;
+  }
+  CHECK_EQ(parent.toString(""), std::string("<div>\n<span class=\"kept\">\n</span>\n</div>\n"));
+}
+
+HI_TEST(moving_children_between_documents) {
+  DOM first;
+  DOM second;
+  Tag item = first.createElement("li");
+  first.body << item;
+  second.body << item;
+  CHECK(first.body.getChildren().empty());
+  CHECK_EQ(second.body.getChildren().size(), std::size_t(1));
+  second.body.insertChild(second.createElement("ul"), 0);
+  CHECK_EQ(second.body.getChildren()[1]->getIndex(), std::size_t(1));
+}
+
+HI_TEST(building_a_deep_tree_bottom_up_from_standalone_tags) {
+  constexpr int kDepth = 100000;
+  Tag child("span");
+  for (int i = 0; i < kDepth; ++i) {
+    Tag parent("div");
+    parent << child;
+    child = parent;
+  }
+  std::size_t depth = 0;
+  for (const Tag::Element* element = child.getChildren()[0]; !element->getChildren().empty(); element = element->getChildren()[0])
+    ++depth;
+  CHECK_EQ(depth, std::size_t(kDepth - 1));
+}
+
+HI_TEST(grafts_over_shared_documents_are_checked_once_per_document) {
+  // Every level adopts both documents of the level below, which makes
+  // 2^kLevels paths to the bottom.
+  constexpr int kLevels = 64;
+  std::vector<Tag> level{Tag("span"), Tag("span")};
+  for (int i = 0; i < kLevels; ++i) {
+    std::vector<Tag> next{Tag("div"), Tag("div")};
+    for (Tag& parent : next) {
+      parent << level[0].createElement("em");
+      parent << level[1].createElement("em");
+    }
+    level = std::move(next);
+  }
+  Tag top("body");
+  top << level[0] << level[1];
+  Tag bottom("p");
+  level[0] << top.createElement("b");
+  level[0] << bottom.createElement("b");
+  CHECK_EQ(level[0].getChildren().size(), std::size_t(4));
+}
+
+HI_TEST(moved_grafts_are_not_orphaned_by_their_former_parent) {
+  Tag keeper("div");
+  Tag item("li");
+  {
+    Tag list("ul");
+    list << item;
+    keeper << item;
+  }
+  CHECK_EQ(keeper.getChildren().size(), std::size_t(1));
+  CHECK(keeper.getChildren()[0]->getParent() != nullptr);
+  CHECK_EQ(keeper.toString(""), std::string("<div>\n<li>\n</li>\n</div>\n"));
+}
+
+// A standalone element and its first few children fit in the document
+// itself; the arena only reserves a small block once they outgrow it.
+HI_TEST(standalone_document_starts_without_arena_blocks) {
+  const auto li = static_cast<Tag::Native>(Tag::Global::Li);
+  auto items = detail::Document::s_create();
+  auto document = detail::Document::s_create(detail::Document::kStandaloneBlockSize);
+  detail::HTML5Element* list = document->createElement(static_cast<Tag::Native>(Tag::Global::Ul));
+  for (int i = 0; i < 4; ++i)
+    list->addChild(items->createElement(li));
+  CHECK_EQ(document->getMemoryUsage().reserved_bytes, std::size_t(0));
+  list->addChild(items->createElement(li));
+  CHECK_EQ(document->getMemoryUsage().reserved_bytes, detail::Document::kStandaloneBlockSize);
+}
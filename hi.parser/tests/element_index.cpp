@@ -0,0 +1,211 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+std::string s_ids(const std::vector<Tag>& tags) {
+  std::string ids;
+  for (const Tag& tag : tags) {
+    if (!ids.empty())
+      ids += ' ';
+    ids += tag.getAttr("id");
+  }
+  return ids;
+}
+
+} // namespace
+
+
+HI_TEST(lookups_on_a_parsed_document) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<div id=a class=\"x y\"><span id=b class=y></span></div><div id=c class=\"y x\"></div><div id=a></div>");
+  CHECK_EQ(dom.getElementById("a")->getAttr("class"), std::string_view("x y"));
+  CHECK(!dom.getElementById("z").has_value());
+  CHECK_EQ(s_ids(dom.getElementsByClassName("y")), std::string("a b c"));
+  CHECK_EQ(s_ids(dom.getElementsByClassName(" x  y ")), std::string("a c"));
+  CHECK_EQ(s_ids(dom.getElementsByClassName("x z")), std::string());
+  CHECK_EQ(s_ids(dom.getElementsByTagName("div")), std::string("a c a"));
+  CHECK_EQ(s_ids(dom.getElementsByTagName("span")), std::string("b"));
+}
+
+HI_TEST(adding_and_removing_elements) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<div id=a class=k></div><div id=c class=k></div>");
+  CHECK_EQ(s_ids(dom.getElementsByClassName("k")), std::string("a c"));
+
+  Tag b = dom.createElement("div");
+  b.setAttr("id", "b");
+  b.setAttr("class", "k");
+  Tag inner = dom.createElement("span");
+  inner.setAttr("id", "d");
+  b << inner;
+  // Detached elements are not indexed until they are connected.
+  CHECK(!dom.getElementById("b").has_value());
+  dom.body.insertChild(b, 1);
+  CHECK_EQ(s_ids(dom.getElementsByClassName("k")), std::string("a b c"));
+  CHECK_EQ(dom.getElementById("d")->getAttr("id"), std::string_view("d"));
+  CHECK_EQ(s_ids(dom.getElementsByTagName("div")), std::string("a b c"));
+
+  dom.body.removeChild(b);
+  CHECK(!dom.getElementById("b").has_value());
+  CHECK(!dom.getElementById("d").has_value());
+  CHECK_EQ(s_ids(dom.getElementsByClassName("k")), std::string("a c"));
+  CHECK(dom.getElementsByTagName("span").empty());
+}
+
+HI_TEST(attribute_and_type_changes) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<div id=a class=k></div><em id=b></em>");
+  Tag a = *dom.getElementById("a");
+  a.setAttr("id", "renamed");
+  CHECK(!dom.getElementById("a").has_value());
+  CHECK_EQ(dom.getElementById("renamed")->getAttr("class"), std::string_view("k"));
+
+  a.setAttr("class", "m n");
+  CHECK(dom.getElementsByClassName("k").empty());
+  CHECK_EQ(s_ids(dom.getElementsByClassName("n m")), std::string("renamed"));
+  a.removeAttr("class");
+  CHECK(dom.getElementsByClassName("m").empty());
+
+  Tag b = *dom.getElementById("b");
+  b.setAttr("class", "k");
+  CHECK_EQ(s_ids(dom.getElementsByClassName("k")), std::string("b"));
+  b.removeAttr("id");
+  CHECK(!dom.getElementById("b").has_value());
+
+  dom.body.getChildren()[1]->setType(static_cast<Tag::Native>(Tag::Global::Strong));
+  CHECK(dom.getElementsByTagName("em").empty());
+  CHECK_EQ(dom.getElementsByTagName("strong").size(), std::size_t(1));
+}
+
+HI_TEST(elements_moved_to_another_document_leave_the_index) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<div id=a></div>");
+  DOM other;
+  other.body << *dom.getElementById("a");
+  CHECK(!dom.getElementById("a").has_value());
+  CHECK_EQ(other.getElementById("a")->getAttr("id"), std::string_view("a"));
+}
+
+// Elements grafted into the page go through the page's index, and leave it
+// when the page dies.
+HI_TEST(grafted_elements_follow_the_index_they_are_in) {
+  DOM source;
+  CHECK(!source.getElementById("x").has_value());
+  Tag card = source.createElement("div");
+  Tag label = source.createElement("span");
+  card << label;
+  {
+    DOM page;
+    page.body << card;
+    CHECK(!page.getElementById("x").has_value());
+    label.setAttr("id", "x");
+    CHECK(page.getElementById("x").has_value());
+    CHECK(!source.getElementById("x").has_value());
+    label.setAttr("id", "y");
+    CHECK(!page.getElementById("x").has_value());
+    CHECK(page.getElementById("y").has_value());
+  }
+  label.setAttr("id", "z");
+  card << source.createElement("em");
+  CHECK(!source.getElementById("z").has_value());
+  CHECK(source.getElementsByTagName("em").empty());
+  source.body << card;
+  CHECK(source.getElementById("z").has_value());
+  CHECK_EQ(source.getElementsByTagName("em").size(), std::size_t(1));
+}
+
+// Replacing the children with text takes every one of them out of the
+// lists they share with the elements that stay.
+HI_TEST(clearing_children_keeps_the_rest_of_the_lists) {
+  DOM dom;
+  Tag list = dom.createElement("ul");
+  for (int i = 0; i < 1000; ++i) {
+    Tag item = dom.createElement("li");
+    std::string id(1, 'i');
+    id += std::to_string(i);
+    item.setAttr("id", id);
+    item.setAttr("class", i % 2 == 0 ? "even row" : "odd row");
+    item << dom.createElement("span");
+    list << item;
+  }
+  Tag kept = dom.createElement("li");
+  kept.setAttr("id", "kept");
+  kept.setAttr("class", "even row");
+  dom.body << kept << list;
+  CHECK_EQ(dom.getElementsByClassName("row").size(), std::size_t(1001));
+
+  list.setText("empty");
+  CHECK_EQ(s_ids(dom.getElementsByClassName("row")), std::string("kept"));
+  CHECK_EQ(s_ids(dom.getElementsByClassName("even")), std::string("kept"));
+  CHECK(dom.getElementsByClassName("odd").empty());
+  CHECK(!dom.getElementById("i7").has_value());
+  CHECK_EQ(dom.getElementsByTagName("li").size(), std::size_t(1));
+  CHECK(dom.getElementsByTagName("span").empty());
+  CHECK_EQ(dom.getElementsByTagName("ul").size(), std::size_t(1));
+}
+
+HI_TEST(removed_children_leave_the_index_and_can_come_back) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<nav id=n class=menu><a id=a class=item></a><a id=b class=item></a></nav><main id=m></main>");
+  Tag nav = *dom.getElementById("n");
+  Tag a = *dom.getElementById("a");
+  Tag main = *dom.getElementById("m");
+
+  // Not a child of main: nothing happens.
+  main.removeChild(a);
+  CHECK_EQ(s_ids(dom.getElementsByClassName("item")), std::string("a b"));
+
+  nav.removeChild(a);
+  CHECK(!dom.getElementById("a").has_value());
+  CHECK_EQ(s_ids(dom.getElementsByClassName("item")), std::string("b"));
+  CHECK_EQ(s_ids(dom.getElementsByTagName("a")), std::string("b"));
+  // Detached elements can still change without touching the index.
+  a.setAttr("id", "moved");
+  CHECK(!dom.getElementById("moved").has_value());
+
+  main << a;
+  CHECK_EQ(dom.getElementById("moved")->getAttr("class"), std::string_view("item"));
+  CHECK_EQ(s_ids(dom.getElementsByClassName("item")), std::string("b moved"));
+
+  dom.body.removeChild(nav);
+  CHECK(dom.getElementsByClassName("menu").empty());
+  CHECK_EQ(s_ids(dom.getElementsByClassName("item")), std::string("moved"));
+  CHECK(!dom.getElementById("b").has_value());
+  dom.body.insertChild(nav, 0);
+  CHECK_EQ(s_ids(dom.getElementsByClassName("item")), std::string("b moved"));
+  CHECK_EQ(nav.getChildren().size(), std::size_t(1));
+}
+
+// <head> and <body> keep their order and their elements in the index
+// wherever they are moved, rather than follow the tree they end up in.
+HI_TEST(moved_roots_keep_their_place_in_the_index) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<meta id=h class=x><div id=b class=x></div>");
+  CHECK_EQ(s_ids(dom.getElementsByClassName("x")), std::string("h b"));
+
+  Tag holder = dom.createElement("section");
+  holder << dom.head;
+  Tag late = dom.createElement("p");
+  late.setAttr("id", "c");
+  late.setAttr("class", "x");
+  dom.body << late;
+  Tag link = dom.createElement("link");
+  link.setAttr("id", "i");
+  link.setAttr("class", "x");
+  dom.head << link;
+  CHECK_EQ(s_ids(dom.getElementsByClassName("x")), std::string("h i b c"));
+
+  dom.body << dom.head;
+  CHECK_EQ(s_ids(dom.getElementsByClassName("x")), std::string("h i b c"));
+  CHECK_EQ(dom.getElementsByTagName("meta").size(), std::size_t(1));
+  dom.body.removeChild(dom.head);
+  CHECK_EQ(s_ids(dom.getElementsByClassName("x")), std::string("h i b c"));
+  CHECK_EQ(dom.getElementById("i")->getAttr("class"), std::string_view("x"));
+}
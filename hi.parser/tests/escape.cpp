@@ -0,0 +1,95 @@
+#include "test.h"
+#include "hi.parser/escape.h"
+
+#include <string>
+
+using namespace hi;
+using detail::EscapeMode;
+
+namespace
+{
+
+std::string s_unescape(std::string_view text, bool attribute = false) {
+  std::string out;
+  return std::string(detail::unescape(text, out, attribute));
+}
+
+// One byte at a time, as the kernels must agree with.
+std::string s_escapeBytes(std::string_view text, EscapeMode mode) {
+  std::string out;
+  for (char c : text) {
+    switch (c) {
+    case '&': out += "&amp;"; break;
+    case '<': out += "&lt;"; break;
+    case '>': out += "&gt;"; break;
+    case '"': out += mode == EscapeMode::Attribute ? "&quot;" : "\""; break;
+    case '\'': out += mode == EscapeMode::Attribute ? "&#39;" : "'"; break;
+    default: out += c;
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+
+HI_TEST(escape_replaces_by_mode) {
+  CHECK_EQ(detail::escape("a < b && c > \"d\" 'e'"), std::string("a &lt; b &amp;&amp; c &gt; \"d\" 'e'"));
+  CHECK_EQ(detail::escape("a < b && c > \"d\" 'e'", EscapeMode::Attribute),
+           s_escapeBytes("a < b && c > \"d\" 'e'", EscapeMode::Attribute));
+  CHECK_EQ(detail::escape("plain text"), std::string("plain text"));
+  CHECK_EQ(detail::escape(""), std::string());
+}
+
+HI_TEST(escape_agrees_with_bytes_across_blocks) {
+  std::string text;
+  for (int i = 0; i < 300; ++i)
+    text += "abcdefghijklmnopq<>&\"'"[i * 7 % 22];
+  for (std::size_t length = 0; length <= text.size(); length += 13) {
+    const std::string_view part(text.data(), length);
+    for (EscapeMode mode : {EscapeMode::Text, EscapeMode::Attribute})
+      CHECK_EQ(detail::escape(part, mode), s_escapeBytes(part, mode));
+  }
+}
+
+HI_TEST(unescape_named_references) {
+  CHECK_EQ(s_unescape("a &amp; b &lt;c&gt; &quot;"), std::string("a & b <c> \""));
+  CHECK_EQ(s_unescape("&nbsp;&copy;&euro;"), std::string(" ©€"));
+  // Longest match: &notin; is a name, &notit; is legacy &not then "it;".
+  CHECK_EQ(s_unescape("&notin;"), std::string("∉"));
+  CHECK_EQ(s_unescape("&notit;"), std::string("¬it;"));
+  CHECK_EQ(s_unescape("&amp"), std::string("&"));
+
+  std::string_view value;
+  CHECK_EQ(detail::matchNamedEntity("lt;x", value), std::size_t(3));
+  CHECK_EQ(value, std::string_view("<"));
+  CHECK_EQ(detail::matchNamedEntity("nosuch;", value), std::size_t(0));
+}
+
+HI_TEST(unescape_numeric_references) {
+  CHECK_EQ(s_unescape("&#65;&#x42;&#X43;"), std::string("ABC"));
+  CHECK_EQ(s_unescape("&#233;&#x1F600;"), std::string("é\U0001F600"));
+  CHECK_EQ(s_unescape("&#65"), std::string("A"));
+  // windows-1252 fixups, then replacements for what cannot be a character.
+  CHECK_EQ(s_unescape("&#x80;&#150;"), std::string("€–"));
+  CHECK_EQ(s_unescape("&#0;&#xD800;&#x110000;"), std::string("���"));
+}
+
+HI_TEST(invalid_references_stay_as_written) {
+  for (const char* text : {"&", "& b", "&;", "&#;", "&#x;", "&#xg;", "&nosuch;", "a&b"})
+    CHECK_EQ(s_unescape(text), std::string(text));
+}
+
+HI_TEST(attribute_values_keep_legacy_names_before_alphanumerics) {
+  CHECK_EQ(s_unescape("?a=1&copy=2", true), std::string("?a=1&copy=2"));
+  CHECK_EQ(s_unescape("?a=1&copyx", true), std::string("?a=1&copyx"));
+  CHECK_EQ(s_unescape("?a=1&copy=2"), std::string("?a=1©=2"));
+  CHECK_EQ(s_unescape("&copy;=2", true), std::string("©=2"));
+  CHECK_EQ(s_unescape("&copy 2", true), std::string("© 2"));
+}
+
+HI_TEST(unescape_without_references_returns_the_input) {
+  std::string out;
+  const std::string_view text = "no references in this rather long text, longer than a vector";
+  CHECK(detail::unescape(text, out).data() == text.data());
+}
@@ -0,0 +1,124 @@
+#include "test.h"
+#include "hi.parser/frozen.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kPage =
+  "<title>T</title><div id=a class=\"x y\"><x-card data-n=1>text &amp; more</x-card><!-- note --><br></div><ul><li>1<li>2</ul>";
+
+std::string s_snapshot(const FrozenDOM& frozen) {
+  std::string bytes;
+  StringSink sink(bytes);
+  frozen.write(sink);
+  return bytes;
+}
+
+FrozenDOM s_fromBytes(const std::string& bytes) {
+  auto copy = std::make_shared<std::vector<std::byte>>(bytes.size());
+  std::memcpy(copy->data(), bytes.data(), bytes.size());
+  return FrozenDOM::s_fromSnapshot(*copy, copy);
+}
+
+} // namespace
+
+
+HI_TEST(freeze_and_thaw_keep_the_document) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const FrozenDOM frozen(dom);
+  CHECK(frozen.isDocument());
+  CHECK(frozen.isValid());
+  CHECK_EQ(frozen.toString(), dom.toString());
+  CHECK_EQ(frozen.toDOM().toString(), dom.toString());
+  CHECK_EQ(frozen.getName(frozen.getTypes()[0]), std::string_view("head"));
+}
+
+HI_TEST(save_map_and_compare) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const FrozenDOM frozen(dom);
+  const std::string path = (std::filesystem::temp_directory_path() / "hiparser_test_snapshot.bin").string();
+  frozen.save(path);
+  {
+    const FrozenDOM mapped = FrozenDOM::s_load(path);
+    CHECK(mapped.isValid());
+    CHECK_EQ(mapped.size(), frozen.size());
+    CHECK(mapped.getBuffer().size() == frozen.getBuffer().size());
+    CHECK(std::equal(mapped.getBuffer().begin(), mapped.getBuffer().end(), frozen.getBuffer().begin()));
+    CHECK_EQ(mapped.toString(), dom.toString());
+    CHECK_EQ(mapped.toDOM().toString(), dom.toString());
+  }
+  std::filesystem::remove(path);
+}
+
+HI_TEST(bad_snapshots_are_rejected) {
+  HTML5Parser parser;
+  const FrozenDOM frozen(parser.parse(kPage));
+  const std::string bytes = s_snapshot(frozen);
+  CHECK(s_fromBytes(bytes).isValid());
+
+  std::string magic = bytes;
+  magic[0] ^= 0x55;
+  CHECK_THROWS(s_fromBytes(magic), exception::InvalidSnapshot);
+  CHECK_THROWS(s_fromBytes(bytes.substr(0, bytes.size() - 1)), exception::InvalidSnapshot);
+  CHECK_THROWS(s_fromBytes(bytes.substr(0, 10)), exception::InvalidSnapshot);
+
+  // A parent index past the last node passes the header check only.
+  std::string tampered = bytes;
+  const std::size_t parents = FrozenDOM::kSnapshotHeaderSize + frozen.getLayout().parentsOffset();
+  const uint32_t out_of_range = frozen.getLayout().nodes + 7;
+  std::memcpy(tampered.data() + parents + sizeof(uint32_t), &out_of_range, sizeof(out_of_range));
+  CHECK(!s_fromBytes(tampered).isValid());
+}
+
+// Links that stay in bounds but disagree with each other would send the
+// serializer's walk up the wrong parents.
+HI_TEST(snapshots_with_inconsistent_links_are_rejected) {
+  HTML5Parser parser;
+  const FrozenDOM frozen(parser.parse(kPage));
+  const std::string bytes = s_snapshot(frozen);
+  const FrozenDOM::Layout& layout = frozen.getLayout();
+  const auto corrupt = [&bytes](std::size_t offset, FrozenDOM::Index node, FrozenDOM::Index value) {
+    std::string tampered = bytes;
+    std::memcpy(tampered.data() + FrozenDOM::kSnapshotHeaderSize + offset + node * sizeof(value), &value, sizeof(value));
+    return s_fromBytes(tampered);
+  };
+  for (FrozenDOM::Index node = 0; node < layout.nodes; ++node) {
+    const FrozenDOM::Index parent = frozen.getParents()[node];
+    for (FrozenDOM::Index value = 0; value < node; ++value) {
+      if (value != parent)
+        CHECK(!corrupt(layout.parentsOffset(), node, value).isValid());
+    }
+    if (parent != FrozenDOM::kNone)
+      CHECK(!corrupt(layout.parentsOffset(), node, FrozenDOM::kNone).isValid());
+    if (frozen.getFirstChildren()[node] != FrozenDOM::kNone)
+      CHECK(!corrupt(layout.firstChildrenOffset(), node, FrozenDOM::kNone).isValid());
+    if (frozen.getNextSiblings()[node] != FrozenDOM::kNone)
+      CHECK(!corrupt(layout.nextSiblingsOffset(), node, FrozenDOM::kNone).isValid());
+  }
+
+  const std::string path = (std::filesystem::temp_directory_path() / "hiparser_test_corrupt.bin").string();
+  std::string tampered = bytes;
+  const FrozenDOM::Index last = layout.nodes - 1;
+  const FrozenDOM::Index wrong = frozen.getParents()[last] == 0 ? 1 : 0;
+  std::memcpy(tampered.data() + FrozenDOM::kSnapshotHeaderSize + layout.parentsOffset() + last * sizeof(wrong), &wrong, sizeof(wrong));
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(tampered.data(), static_cast<std::streamsize>(tampered.size()));
+  }
+  CHECK(!FrozenDOM::s_load(path).isValid());
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "hi.parser/interner.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using hi::detail::Interner;
+
+namespace
+{
+
+constexpr int kThreads = 4;
+constexpr int kNames = 20000;
+
+std::string s_name(int i) {
+  return "x-name-" + std::to_string(i);
+}
+
+} // namespace
+
+
+HI_TEST(names_and_ids_round_trip) {
+  Interner names;
+  const Interner::Id a = names.intern("my-widget");
+  CHECK_EQ(names.intern("my-widget"), a);
+  CHECK(names.intern("other") != a);
+  CHECK_EQ(names.find("my-widget"), std::optional(a));
+  CHECK_EQ(names.name(a), std::optional(std::string_view("my-widget")));
+  CHECK(!names.find("missing").has_value());
+  CHECK(!names.name(1000).has_value());
+  CHECK_EQ(names.size(), std::size_t(2));
+}
+
+HI_TEST(concurrent_interns_agree_on_ids) {
+  Interner names;
+  std::vector<std::vector<Interner::Id>> ids(kThreads, std::vector<Interner::Id>(kNames));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      // Every thread interns every name, each starting at another place.
+      for (int i = 0; i < kNames; ++i) {
+        const int n = (i + t * kNames / kThreads) % kNames;
+        ids[t][n] = names.intern(s_name(n));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  CHECK_EQ(names.size(), std::size_t(kNames));
+  for (int n = 0; n < kNames; ++n) {
+    for (int t = 1; t < kThreads; ++t)
+      CHECK_EQ(ids[t][n], ids[0][n]);
+    const std::string name = s_name(n);
+    CHECK_EQ(names.name(ids[0][n]), std::optional(std::string_view(name)));
+  }
+}
+
+// Readers look up names a writer has published while the writer keeps
+// growing the tables; none of them may be missed.
+HI_TEST(find_does_not_miss_names_while_tables_grow) {
+  Interner names;
+  std::atomic<int> published{0};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> threads;
+  threads.emplace_back([&] {
+    for (int i = 0; i < kNames; ++i) {
+      names.intern(s_name(i));
+      published.store(i + 1, std::memory_order_release);
+    }
+  });
+  for (int t = 1; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      int seen = 0;
+      while (seen < kNames) {
+        seen = published.load(std::memory_order_acquire);
+        // The latest names land in the tables that are being grown.
+        for (int i = seen > 64 ? seen - 64 : 0; i < seen; ++i) {
+          auto id = names.find(s_name(i));
+          if (!id || names.name(*id) != std::string_view(s_name(i)))
+            misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        names.find("x-name-missing-" + std::to_string(t));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  CHECK_EQ(misses.load(), 0);
+}
@@ -0,0 +1,79 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace hi {
+namespace test {
+
+namespace
+{
+
+struct Test {
+  const char* name;
+  std::string suite;
+  TestFn fn;
+};
+
+std::vector<Test>& s_registry() {
+  static std::vector<Test> registry;
+  return registry;
+}
+
+std::size_t s_failures = 0;
+
+// tests/rope.cpp -> rope
+std::string s_suite(std::string_view file) {
+  const std::size_t slash = file.find_last_of("/\\");
+  if (slash != std::string_view::npos)
+    file.remove_prefix(slash + 1);
+  return std::string(file.substr(0, file.find('.')));
+}
+
+} // namespace
+
+void fail(const char* file, int line, const std::string& message) {
+  ++s_failures;
+  std::printf("  %s:%d: check failed: %s\n", file, line, message.c_str());
+}
+
+bool registerTest(const char* name, const char* file, TestFn fn) {
+  s_registry().push_back({name, s_suite(file), fn});
+  return true;
+}
+
+} // namespace test
+} // namespace hi
+
+// Usage: HiParserTests [suite...]
+// Runs the tests of the named suites (source files without extension), or
+// all of them; exits with 1 when a check failed or a test threw.
+int main(int argc, char** argv) {
+  using namespace hi::test;
+
+  std::size_t ran = 0;
+  std::size_t failed = 0;
+  for (const Test& test : s_registry()) {
+    const bool selected = argc < 2 || std::any_of(argv + 1, argv + argc, [&](const char* suite) {
+      return test.suite == suite;
+    });
+    if (!selected)
+      continue;
+    const std::size_t failures = s_failures;
+    try {
+      test.fn();
+    } catch (const std::exception& error) {
+      fail(test.name, 0, std::string("threw ") + error.what());
+    }
+    ++ran;
+    if (s_failures != failures) {
+      ++failed;
+      std::printf("FAIL %s.%s\n", test.suite.c_str(), test.name);
+    }
+  }
+  std::printf("%zu tests, %zu failed\n", ran, failed);
+  return failed == 0 && ran != 0 ? 0 : 1;
+}
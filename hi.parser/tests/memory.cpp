@@ -0,0 +1,95 @@
+#include "test.h"
+#include "hi.parser/memory.h"
+#include "hi.parser/parser.h"
+
+#include <string>
+
+using namespace hi;
+
+namespace
+{
+
+// Tracks the documents created in its scope.
+struct Tracking
+{
+  Tracking() { MemoryTracker::setEnabled(true); }
+  ~Tracking() { MemoryTracker::setEnabled(false); }
+};
+
+std::string s_page(std::size_t items) {
+  std::string page = "<ul class=list>";
+  for (std::size_t i = 0; i < items; ++i)
+    page += "<li class=item data-n=" + std::to_string(i) + ">item " + std::to_string(i) + "</li>";
+  return page + "</ul>";
+}
+
+} // namespace
+
+
+HI_TEST(untracked_documents_count_nothing) {
+  CHECK(!MemoryTracker::isEnabled());
+  HTML5Parser parser;
+  const DOM dom = parser.parse(s_page(10));
+  const MemoryUsage usage = dom.getMemoryUsage();
+  // A registry of its own is counted, as it belongs to the document alone.
+  CHECK_EQ(usage.getLiveBytes(), usage[MemoryCategory::Names].live_bytes);
+  CHECK_EQ(usage[MemoryCategory::Elements].allocations, std::size_t(0));
+  CHECK(usage.reserved_bytes > 0);
+}
+
+HI_TEST(tracked_documents_count_by_category) {
+  Tracking tracking;
+  HTML5Parser parser;
+  DOM dom = parser.parse(s_page(100));
+  const MemoryUsage parsed = dom.getMemoryUsage();
+  // head, body, ul, 100 li
+  CHECK(parsed[MemoryCategory::Elements].live_objects >= std::size_t(103));
+  CHECK(parsed[MemoryCategory::Strings].live_bytes > 0);
+  CHECK(parsed[MemoryCategory::Attributes].live_bytes > 0);
+  CHECK(parsed[MemoryCategory::Children].live_bytes > 0);
+  CHECK_EQ(parsed[MemoryCategory::Text].live_bytes, std::size_t(0));
+  CHECK_EQ(parsed[MemoryCategory::Caches].live_bytes, std::size_t(0));
+  CHECK(parsed.getLiveBytes() - parsed[MemoryCategory::Names].live_bytes <= parsed.peak_bytes);
+  CHECK(parsed.getLiveBytes() <= parsed.reserved_bytes);
+  CHECK(parsed.toString().find("elements") != std::string::npos);
+
+  Tag text = dom.body.createText("");
+  dom.body << text;
+  for (int i = 0; i < 100; ++i)
+    text.appendText("a line of text that grows into a rope\n");
+  const MemoryUsage edited = dom.getMemoryUsage();
+  CHECK(edited[MemoryCategory::Text].live_bytes >= text.getText().size());
+  text.setText("x");
+  CHECK_EQ(dom.getMemoryUsage()[MemoryCategory::Text].live_bytes, std::size_t(0));
+
+  dom.body.setCacheable();
+  const std::string html = dom.toString();
+  CHECK(dom.getMemoryUsage()[MemoryCategory::Caches].live_bytes > 0);
+  CHECK_EQ(dom.toString(), html);
+}
+
+HI_TEST(custom_names_are_counted_with_their_registry) {
+  Tracking tracking;
+  HTML5Parser parser;
+  const DOM plain = parser.parse(s_page(1));
+  const DOM custom = parser.parse("<x-card x-size=big><x-title>t</x-title></x-card>");
+  CHECK(custom.getMemoryUsage()[MemoryCategory::Names].live_bytes > plain.getMemoryUsage()[MemoryCategory::Names].live_bytes);
+}
+
+HI_TEST(totals_drop_the_live_counts_of_dead_documents) {
+  Tracking tracking;
+  const MemoryUsage before = MemoryTracker::getTotals();
+  {
+    HTML5Parser parser;
+    const DOM dom = parser.parse(s_page(5000));
+    const MemoryUsage during = MemoryTracker::getTotals();
+    CHECK(during[MemoryCategory::Elements].live_objects > before[MemoryCategory::Elements].live_objects);
+    CHECK(during[MemoryCategory::Elements].allocations > before[MemoryCategory::Elements].allocations);
+  }
+  const MemoryUsage after = MemoryTracker::getTotals();
+  CHECK_EQ(after[MemoryCategory::Elements].live_objects, before[MemoryCategory::Elements].live_objects);
+  CHECK_EQ(after.getLiveBytes() - after[MemoryCategory::Names].live_bytes,
+           before.getLiveBytes() - before[MemoryCategory::Names].live_bytes);
+  CHECK(after[MemoryCategory::Elements].allocations > before[MemoryCategory::Elements].allocations);
+  CHECK(after.peak_bytes >= after.getLiveBytes());
+}
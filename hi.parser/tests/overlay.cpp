@@ -0,0 +1,142 @@
+#include "test.h"
+#include "hi.parser/overlay.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kPage =
+  "<title>T</title><style>p{}</style><div id=a class=x><strong>Old</strong><x-card data-n=1>text &amp; more</x-card><!-- note --><br></div>"
+  "<ul><li>1<li>2</ul>";
+
+// The first node of the type in the layout.
+OverlayDOM::Index s_find(const FrozenDOM& frozen, Tag::Global type) {
+  const auto types = frozen.getTypes();
+  return static_cast<OverlayDOM::Index>(std::find(types.begin(), types.end(), static_cast<FrozenDOM::Key>(type)) - types.begin());
+}
+
+} // namespace
+
+
+HI_TEST(copies_share_the_layout_until_edited) {
+  HTML5Parser parser;
+  DOM dom = parser.parse(kPage);
+  const FrozenDOM frozen(dom);
+  const OverlayDOM layout(frozen);
+  CHECK_EQ(layout.toString(), dom.toString());
+
+  OverlayDOM page = layout;
+  const auto title = s_find(frozen, Tag::Global::Title);
+  const auto heading = s_find(frozen, Tag::Global::Strong);
+  const auto div = s_find(frozen, Tag::Global::Div);
+  page.setText(title, "Request 1");
+  page.setText(heading, "<New>");
+  page.setAttr(div, "class", "y \"z\"");
+  page.setAttr(div, "data-extra", "1");
+  page.removeAttr(div, "id");
+
+  // The same edits on a parsed copy give the same bytes.
+  dom.getElementsByTagName("title").front().setText("Request 1");
+  dom.getElementsByTagName("strong").front().setText("<New>");
+  Tag live_div = dom.getElementsByTagName("div").front();
+  live_div.setAttr("class", "y \"z\"");
+  live_div.setAttr("data-extra", "1");
+  live_div.removeAttr("id");
+  CHECK_EQ(page.toString(), dom.toString());
+  CHECK_EQ(layout.toString(), frozen.toString());
+  CHECK_EQ(page.getAttr(div, "data-extra"), std::string_view("1"));
+  CHECK_THROWS(page.getAttr(div, "id"), exception::InvalidAttribute);
+  CHECK_EQ(layout.getAttr(div, "id"), std::string_view("a"));
+
+  std::string compact;
+  StringSink sink(compact);
+  Serializer serializer(sink);
+  serializer.write(page, SerializeOptions{"", ""});
+  serializer.flush();
+  std::string expected;
+  StringSink expected_sink(expected);
+  Serializer expected_serializer(expected_sink);
+  expected_serializer.write(dom, SerializeOptions{"", ""});
+  expected_serializer.flush();
+  CHECK_EQ(compact, expected);
+}
+
+// Every copy keeps the edits it had when it was copied and nothing after.
+HI_TEST(copies_of_copies_keep_their_own_edits) {
+  HTML5Parser parser;
+  const FrozenDOM frozen(parser.parse(kPage));
+  const auto title = s_find(frozen, Tag::Global::Title);
+  const auto heading = s_find(frozen, Tag::Global::Strong);
+  OverlayDOM first(frozen);
+  first.setText(title, "first");
+  OverlayDOM second = first;
+  second.setText(heading, "second");
+  OverlayDOM third = second;
+  third.setText(title, "third");
+  first.setAttr(heading, "class", "late");
+
+  CHECK(first.toString().find("<title>\n    first") != std::string::npos);
+  CHECK(first.toString().find("<strong class=\"late\">\n      Old") != std::string::npos);
+  CHECK(second.toString().find("first") != std::string::npos);
+  CHECK(second.toString().find("<strong>\n      second") != std::string::npos);
+  CHECK(third.toString().find("first") == std::string::npos);
+  CHECK(third.toString().find("third") != std::string::npos);
+  CHECK(third.toString().find("second") != std::string::npos);
+}
+
+HI_TEST(removed_and_added_subtrees) {
+  HTML5Parser parser;
+  DOM dom = parser.parse(kPage);
+  const FrozenDOM frozen(dom);
+  const auto div = s_find(frozen, Tag::Global::Div);
+  const auto heading = s_find(frozen, Tag::Global::Strong);
+  const auto list = s_find(frozen, Tag::Global::Ul);
+  OverlayDOM page(frozen);
+
+  page.remove(div);
+  CHECK(!page.contains(div));
+  CHECK(!page.contains(heading));
+  CHECK(page.contains(list));
+  CHECK_THROWS(page.setText(heading, "gone"), exception::InvalidTag);
+  CHECK_THROWS(page.remove(div), exception::InvalidTag);
+  CHECK_THROWS(page.remove(0), exception::InvalidTag);
+  CHECK_THROWS(page.setAttr(static_cast<OverlayDOM::Index>(frozen.size()), "id", "x"), exception::InvalidTag);
+
+  Tag item("li");
+  item.setAttr("class", "added");
+  item << item.createElement("my-badge");
+  page.addChild(list, item);
+  page.setAttr(list, "my-attr", "1");
+
+  dom.body.removeChild(*dom.getElementById("a"));
+  Tag live_list = dom.getElementsByTagName("ul").front();
+  live_list << item;
+  live_list.setAttr("my-attr", "1");
+  CHECK_EQ(page.toString(), dom.toString());
+  CHECK(OverlayDOM(frozen).contains(heading));
+}
+
+// Text of edited raw text elements still cannot end them early, and text
+// and comment nodes take no attributes or children.
+HI_TEST(edited_text_keeps_its_escaping) {
+  HTML5Parser parser;
+  DOM dom = parser.parse(kPage);
+  const FrozenDOM frozen(dom);
+  const auto style = s_find(frozen, Tag::Global::Style);
+  const auto text = frozen.getFirstChildren()[style];
+  OverlayDOM page(frozen);
+  page.setText(text, "p{}</style><script>");
+  CHECK(page.toString().find("<\\/style><script>") != std::string::npos);
+  CHECK_THROWS(page.setAttr(text, "id", "x"), exception::InvalidAttribute);
+  CHECK_THROWS(page.addChild(text, Tag("b")), exception::InvalidTag);
+
+  page.setText(style, "</STYLE>");
+  dom.getElementsByTagName("style").front().setText("</STYLE>");
+  CHECK_EQ(page.toString(), dom.toString());
+}
@@ -0,0 +1,103 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+
+#include <optional>
+#include <string>
+
+using namespace hi;
+
+
+HI_TEST(repeated_body_tags_keep_the_first_value) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<body class=\"first\"><p>a</p><body class=\"second\" id=\"added\" data-x=\"1\"><body data-x=\"2\">");
+  CHECK_EQ(dom.body.getAttr("class"), std::string_view("first"));
+  CHECK_EQ(dom.body.getAttr("id"), std::string_view("added"));
+  CHECK_EQ(dom.body.getAttr("data-x"), std::string_view("1"));
+  CHECK_EQ(dom.body.getChildren().size(), std::size_t(1));
+}
+
+HI_TEST(repeated_head_tags_keep_the_first_value) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<head lang=\"en\"><title>t</title></head><head lang=\"fr\" dir=\"ltr\">");
+  CHECK_EQ(dom.head.getAttr("lang"), std::string_view("en"));
+  CHECK_EQ(dom.head.getAttr("dir"), std::string_view("ltr"));
+}
+
+HI_TEST(duplicate_attributes_in_a_tag_keep_the_first_value) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<p id=\"one\" ID=\"two\" data-a=\"&amp;\" data-a=\"b\"></p>");
+  const Tag p = dom.getElementsByTagName("p").front();
+  CHECK_EQ(p.getAttr("id"), std::string_view("one"));
+  CHECK_EQ(p.getAttr("data-a"), std::string_view("&"));
+}
+
+HI_TEST(html_start_tags_do_not_open_elements) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<html lang=\"en\"><body><html><div></div></body></html>");
+  CHECK_EQ(dom.body.getChildren().size(), std::size_t(1));
+}
+
+// Every "</>" is dropped without a frame of its own, so long runs of
+// them do not grow the stack.
+HI_TEST(runs_of_empty_end_tags_are_dropped) {
+  std::string html = "<p>a";
+  for (int i = 0; i < 2000000; ++i)
+    html += "</>";
+  html += "b</p></></>";
+  HTML5Parser parser;
+  const DOM dom = parser.parse(html);
+  CHECK_EQ(dom.body.getChildren().size(), std::size_t(1));
+  CHECK_EQ(dom.body.getText(), std::string("ab"));
+}
+
+HI_TEST(unknown_names_stay_in_the_document_registry) {
+  const std::size_t global_names = detail::Interner::global().size();
+  HTML5Parser parser;
+  const DOM dom = parser.parse("<x-widget data-q=\"1\">a</x-widget></x-stray><p></P>");
+  CHECK_EQ(detail::Interner::global().size(), global_names);
+  CHECK(dom.getNames().find("x-widget").has_value());
+  CHECK(dom.getNames().find("data-q").has_value());
+  // End tags never register a name.
+  CHECK(!dom.getNames().find("x-stray").has_value());
+  CHECK_EQ(dom.body.getChildren().size(), std::size_t(2));
+  CHECK_EQ(dom.body.getChildren()[0]->getAttr("data-q"), std::string_view("1"));
+}
+
+// The Tag's names are interned in the page's registry as it is grafted, so
+// lookups and selectors of the page see them, and again in the global one
+// when it moves back out.
+HI_TEST(custom_named_tags_graft_into_a_page_with_its_own_registry) {
+  HTML5Parser parser;
+  std::optional<Tag> card;
+  {
+    DOM dom = parser.parse("<x-card data-q=1></x-card>");
+    card = Tag("custom-el");
+    card->setAttr("data-role", "main");
+    card->setText(std::string(200, 'a'));
+    card->getChildren()[0]->appendText("b");
+    dom.body << *card;
+    CHECK(dom.getNames().find("custom-el").has_value());
+    CHECK_EQ(dom.getElementsByTagName("custom-el").size(), std::size_t(1));
+    CHECK_EQ(dom.getElementsByTagName("x-card").size(), std::size_t(1));
+    CHECK_EQ(card->getName(), std::string("custom-el"));
+    CHECK_EQ(card->getAttr(card->getAttrKey("data-role")), std::string_view("main"));
+    CHECK(dom.body.toString("").find("<custom-el data-role=\"main\">\n" + std::string(200, 'a') + "b\n</custom-el>") != std::string::npos);
+
+    Tag list("x-list");
+    list << dom.getElementsByTagName("x-card").front();
+    CHECK(dom.getElementsByTagName("x-card").empty());
+    CHECK_EQ(list.toString(""), std::string("<x-list>\n<x-card data-q=\"1\">\n</x-card>\n</x-list>\n"));
+  }
+  // The handle keeps the page it was grafted into alive.
+  CHECK_EQ(card->getChildren()[0]->getText(), std::string(200, 'a') + "b");
+  CHECK_EQ(card->toString("", false), std::string("<custom-el data-role=\"main\">\n</custom-el>\n"));
+}
+
+HI_TEST(pages_can_share_a_registry) {
+  auto names = std::make_shared<detail::Interner>();
+  HTML5Parser parser;
+  const DOM first = parser.parse("<x-card></x-card>", names);
+  const DOM second = parser.parse("<x-card></x-card>", names);
+  CHECK_EQ(&first.getNames(), &second.getNames());
+  CHECK(first.body.getChildren()[0]->getType() == second.body.getChildren()[0]->getType());
+}
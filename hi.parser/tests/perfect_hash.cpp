@@ -0,0 +1,93 @@
+#include "test.h"
+#include "hi.parser/html5.h"
+#include "hi.parser/perfect_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace hi;
+
+namespace
+{
+
+bool s_isNative(std::string_view name) {
+  return std::find(htmlTags.begin(), htmlTags.end(), name) != htmlTags.end();
+}
+
+} // namespace
+
+
+HI_TEST(every_native_name_round_trips_in_any_case) {
+  for (std::size_t i = 0; i < htmlTags.size(); ++i) {
+    std::string name(htmlTags[i]);
+    CHECK_EQ(Tag::s_findNative(name), std::optional<Tag::Native>(static_cast<Tag::Native>(i)));
+    name[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+    CHECK_EQ(Tag::s_findNative(name), std::optional<Tag::Native>(static_cast<Tag::Native>(i)));
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    CHECK_EQ(Tag::s_findNative(name), std::optional<Tag::Native>(static_cast<Tag::Native>(i)));
+  }
+}
+
+HI_TEST(unknown_names_miss) {
+  CHECK(!Tag::s_findNative(""));
+  CHECK(!Tag::s_findNative("blink"));
+  CHECK(!Tag::s_findNative("data-role"));
+  CHECK(!Tag::s_findNative(std::string(256, 'a')));
+  for (std::string_view native : htmlTags) {
+    const std::string longer = std::string(native) + "x";
+    CHECK_EQ(Tag::s_findNative(longer).has_value(), s_isNative(longer));
+    const std::string_view shorter = native.substr(0, native.size() - 1);
+    CHECK_EQ(Tag::s_findNative(shorter).has_value(), s_isNative(shorter));
+  }
+  // Every name of up to three letters.
+  std::string name;
+  for (char a = 'a'; a <= 'z'; ++a) {
+    for (char b = 'a' - 1; b <= 'z'; ++b) {
+      for (char c = 'a' - 1; c <= 'z'; ++c) {
+        if (b < 'a' && c >= 'a')
+          continue;
+        name.assign(1, a);
+        if (b >= 'a')
+          name += b;
+        if (c >= 'a')
+          name += c;
+        CHECK_EQ(Tag::s_findNative(name).has_value(), s_isNative(name));
+      }
+    }
+  }
+}
+
+// The hash only reads the length and the first, middle and last byte.
+// Names that agree with a native one there land in its slot and have to be
+// told apart by the final compare.
+HI_TEST(names_hashing_like_native_ones_miss) {
+  for (std::string_view native : htmlTags) {
+    const std::size_t middle = native.size() / 2;
+    for (std::size_t i = 1; i + 1 < native.size(); ++i) {
+      if (i == middle)
+        continue;
+      std::string name(native);
+      name[i] = name[i] == 'q' ? 'z' : 'q';
+      CHECK_EQ(Tag::s_findNative(name).has_value(), s_isNative(name));
+    }
+  }
+}
+
+HI_TEST(small_tables_find_their_own_names) {
+  static constexpr std::array<std::string_view, 5> kNames = {{"div", "span", "p", "table", "h1"}};
+  constexpr detail::PerfectHash table(kNames);
+  static_assert(table.find("span") == std::optional<std::size_t>(1));
+  static_assert(!table.find("sxan"));
+  for (std::size_t i = 0; i < kNames.size(); ++i)
+    CHECK_EQ(table.find(kNames[i]), std::optional<std::size_t>(i));
+  CHECK_EQ(table.find("TABLE"), std::optional<std::size_t>(3));
+  CHECK(!table.find("sxan"));
+  // Bit 5 folds case in the hash; outside letters it changes the byte.
+  CHECK(!table.find("h\x11"));
+  CHECK(!table.find("tables"));
+  CHECK(!table.find("a"));
+}
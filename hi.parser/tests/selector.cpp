@@ -0,0 +1,105 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/selector.h"
+
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kPage =
+  "<nav id=n><ul><li id=a class=\"item first\"><a id=l1 href=\"/docs/x.png\">x</a></li>"
+  "<li id=b class=item lang=en-US></li><li id=c class=\"item last\" data-x=\"one two\"></li></ul></nav>"
+  "<main id=m><p id=p1></p><span id=s1></span><p id=p2></p><x-card id=x></x-card></main>";
+
+// Ids of what `selector` finds in `dom`, space separated.
+std::string s_select(const DOM& dom, std::string_view selector) {
+  std::string ids;
+  for (const Selector::Element* element : Selector(selector, dom.getNames()).querySelectorAll(dom)) {
+    if (!ids.empty())
+      ids += ' ';
+    ids += element->getAttr("id");
+  }
+  return ids;
+}
+
+} // namespace
+
+
+HI_TEST(simple_selectors) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  CHECK_EQ(s_select(dom, "li"), std::string("a b c"));
+  CHECK_EQ(s_select(dom, "#b"), std::string("b"));
+  CHECK_EQ(s_select(dom, ".item.last"), std::string("c"));
+  CHECK_EQ(s_select(dom, "x-card"), std::string("x"));
+  CHECK_EQ(s_select(dom, "p, span"), std::string("p1 s1 p2"));
+  CHECK_EQ(s_select(dom, "li.missing"), std::string());
+  CHECK_EQ(s_select(dom, "#nothing"), std::string());
+  CHECK_EQ(s_select(dom, "table"), std::string());
+}
+
+HI_TEST(attribute_selectors) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  CHECK_EQ(s_select(dom, "[lang]"), std::string("b"));
+  CHECK_EQ(s_select(dom, "[id=p2]"), std::string("p2"));
+  CHECK_EQ(s_select(dom, "[data-x~=two]"), std::string("c"));
+  CHECK_EQ(s_select(dom, "[data-x~=on]"), std::string());
+  CHECK_EQ(s_select(dom, "[lang|=en]"), std::string("b"));
+  CHECK_EQ(s_select(dom, "[lang|=e]"), std::string());
+  CHECK_EQ(s_select(dom, "a[href^='/docs']"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "a[href$='.png']"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "a[href*=\"x.p\"]"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "a[href^=docs]"), std::string());
+}
+
+HI_TEST(combinators) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  CHECK_EQ(s_select(dom, "nav a"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "nav > a"), std::string());
+  CHECK_EQ(s_select(dom, "ul > li > a"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "p + span"), std::string("s1"));
+  CHECK_EQ(s_select(dom, "span + p"), std::string("p2"));
+  CHECK_EQ(s_select(dom, "p ~ p"), std::string("p2"));
+  CHECK_EQ(s_select(dom, "#p1 ~ *"), std::string("s1 p2 x"));
+  CHECK_EQ(s_select(dom, "main li"), std::string());
+}
+
+HI_TEST(structural_pseudo_classes) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  CHECK_EQ(s_select(dom, "li:first-child"), std::string("a"));
+  CHECK_EQ(s_select(dom, "li:last-child"), std::string("c"));
+  CHECK_EQ(s_select(dom, "a:only-child"), std::string("l1"));
+  CHECK_EQ(s_select(dom, "li:nth-child(2n+1)"), std::string("a c"));
+  CHECK_EQ(s_select(dom, "li:nth-child(even)"), std::string("b"));
+  CHECK_EQ(s_select(dom, "main > :nth-last-child(2)"), std::string("p2"));
+}
+
+HI_TEST(matches_a_single_element) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const Tag item = *dom.getElementById("b");
+  CHECK(Selector("ul li.item").matches(item));
+  CHECK(!Selector("ol li").matches(item));
+  CHECK(Selector("nav li, span").matches(item));
+}
+
+HI_TEST(invalid_selectors_throw) {
+  CHECK_THROWS(Selector(""), exception::InvalidSelector);
+  CHECK_THROWS(Selector("a >"), exception::InvalidSelector);
+  CHECK_THROWS(Selector("[href"), exception::InvalidSelector);
+  CHECK_THROWS(Selector("li:hover"), exception::InvalidSelector);
+}
+
+HI_TEST(custom_names_need_the_registry_of_the_document) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  CHECK_THROWS(Selector("x-card").querySelectorAll(dom), exception::InvalidSelector);
+  CHECK_EQ(Selector("li").querySelectorAll(dom).size(), std::size_t(3));
+}
@@ -0,0 +1,76 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/selector.h"
+
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kPage =
+  "<nav id=n class=menu><ul><li class=item><a id=l>x</a></li></ul></nav>"
+  "<main id=m><section class=card><span id=s></span></section></main>";
+
+} // namespace
+
+
+HI_TEST(rejects_selectors_whose_ancestors_are_missing) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const Selector::Element& link = *Selector("a").querySelector(dom.body);
+  SelectorFilter filter;
+  filter.setParentsOf(link);
+  CHECK(filter.getParent() == link.getParent());
+
+  const Selector rejected("table a, #m a, .card a, main a");
+  for (std::size_t i = 0; i < rejected.getComplexes().size(); ++i)
+    CHECK(rejected.fastRejects(i, filter));
+  CHECK(!rejected.matches(link, filter));
+
+  const Selector kept("nav a, #n a, .menu a, ul > li > a, a");
+  for (std::size_t i = 0; i < kept.getComplexes().size(); ++i) {
+    CHECK(!kept.fastRejects(i, filter));
+    CHECK(kept.matches(i, link, filter));
+  }
+}
+
+HI_TEST(a_walk_keeping_the_filter_matches_like_one_without) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const std::vector<Selector> selectors = {
+    Selector("nav a"), Selector("main span"), Selector("main a"), Selector("section > span"),
+    Selector(".menu li"), Selector("#m .card span"), Selector("ul a, main *"), Selector("body li"),
+  };
+  SelectorFilter filter;
+  std::size_t checked = 0;
+  for (const Tag& root : {dom.head, dom.body}) {
+    for (const auto& element : root.depthFirst()) {
+      filter.setParentsOf(element);
+      for (const Selector& selector : selectors) {
+        CHECK_EQ(selector.matches(element, filter), selector.matches(element));
+        ++checked;
+      }
+      if (!element.getChildren().empty())
+        filter.pushParent(element);
+    }
+  }
+  CHECK_EQ(checked, selectors.size() * 10);
+}
+
+HI_TEST(popped_parents_leave_the_filter) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const Selector::Element& span = *Selector("span").querySelector(dom.body);
+  const Selector selector("section span");
+  SelectorFilter filter;
+  filter.setParentsOf(span);
+  CHECK(!selector.fastRejects(0, filter));
+  filter.popParent();
+  CHECK(selector.fastRejects(0, filter));
+  filter.clear();
+  CHECK(filter.getParent() == nullptr);
+  CHECK(selector.fastRejects(0, filter));
+}
@@ -0,0 +1,356 @@
+#include "test.h"
+#include "hi.parser/html5.h"
+#include "hi.parser/serializer.h"
+#include "hi.parser/thread_pool.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace hi;
+
+namespace
+{
+
+std::string s_write(const DOM& dom) {
+  std::string out;
+  StringSink sink(out);
+  Serializer serializer(sink);
+  serializer.write(dom);
+  serializer.flush();
+  return out;
+}
+
+// <nav> is cacheable and holds a cacheable <ul>; the page is written once
+// so that both have cached bytes.
+struct CachedPage {
+  DOM dom;
+  Tag nav = dom.createElement("nav");
+  Tag list = dom.createElement("ul");
+  Tag item = dom.createElement("li");
+  Tag text = dom.createText("home");
+
+  CachedPage() {
+    item << text;
+    list << item;
+    nav << list;
+    dom.body << nav;
+    list.setCacheable();
+    nav.setCacheable();
+    s_write(dom);
+  }
+};
+
+// A page of `items` list items, each with a few dozen bytes of markup.
+DOM s_page(int items) {
+  DOM dom;
+  Tag list = dom.createElement("ul");
+  for (int i = 0; i < items; ++i) {
+    Tag item = dom.createElement("li");
+    item.setAttr("class", "item");
+    item.addText("item " + std::to_string(i));
+    list << item;
+  }
+  dom.body << list;
+  return dom;
+}
+
+#ifndef _WIN32
+// Writes with `write` on a thread of its own while this one drains the
+// pipe, and returns what came out of it.
+template <typename Write>
+std::string s_throughPipe(Write&& write, bool interrupt = false) {
+  int fds[2];
+  if (::pipe(fds) != 0)
+    return "pipe failed";
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    FdSink sink(fds[1]);
+    write(sink);
+    done = true;
+    ::close(fds[1]);
+  });
+  std::string out;
+  char buffer[4096];
+  for (;;) {
+    // Signals while the writer blocks on a full pipe cut its writes short.
+    if (interrupt && !done)
+      ::pthread_kill(writer.native_handle(), SIGUSR1);
+    const auto n = ::read(fds[0], buffer, interrupt ? 1000 : sizeof(buffer));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    out.append(buffer, static_cast<std::size_t>(n));
+  }
+  writer.join();
+  ::close(fds[0]);
+  return out;
+}
+#endif
+
+} // namespace
+
+
+HI_TEST(string_sink_appends_writes_and_parts) {
+  std::string out = "<!-- kept -->";
+  StringSink sink(out);
+  CHECK(sink.canGather());
+  sink.write("<p>");
+  const std::string_view parts[] = {"one", "", " two", " three"};
+  sink.writeParts(parts);
+  sink.write("</p>");
+  CHECK_EQ(out, std::string("<!-- kept --><p>one two three</p>"));
+}
+
+HI_TEST(callback_sink_gets_whole_chunks_then_the_rest) {
+  const DOM dom = s_page(100);
+  std::vector<std::string> chunks;
+  CallbackSink sink([&chunks](std::string_view bytes) { chunks.emplace_back(bytes); });
+  Serializer serializer(sink, 64);
+  CHECK_EQ(serializer.getChunkSize(), std::size_t(64));
+  serializer.write(dom);
+  serializer.flush();
+  CHECK(chunks.size() > 2);
+  std::string joined;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    if (i + 1 < chunks.size())
+      CHECK_EQ(chunks[i].size(), std::size_t(64));
+    else
+      CHECK(!chunks[i].empty() && chunks[i].size() <= 64);
+    joined += chunks[i];
+  }
+  CHECK_EQ(joined, s_write(dom));
+}
+
+// Output reaches the sink on flush() or when the chunk fills up, in the
+// order it was written; whatever is still staged when the serializer dies
+// is dropped.
+HI_TEST(flush_hands_over_staged_output_in_order) {
+  std::vector<std::string> chunks;
+  CallbackSink sink([&chunks](std::string_view bytes) { chunks.emplace_back(bytes); });
+  {
+    Serializer serializer(sink);
+    serializer.write(Tag("p"), {"", ""});
+    serializer.write(Tag("br"), {"", ""});
+    CHECK(chunks.empty());
+    serializer.flush();
+    CHECK_EQ(chunks.size(), std::size_t(1));
+    CHECK_EQ(chunks[0], std::string("<p></p><br>"));
+    serializer.flush();
+    CHECK_EQ(chunks.size(), std::size_t(1));
+    serializer.write(Tag("hr"), {"", ""});
+  }
+  CHECK_EQ(chunks.size(), std::size_t(1));
+
+  std::string out;
+  StringSink string_sink(out);
+  {
+    Serializer serializer(string_sink, 4);
+    serializer.write(Tag("em"), {"", ""});
+    CHECK_EQ(out, std::string("<em></em"));
+  }
+  CHECK_EQ(out, std::string("<em></em"));
+}
+
+#ifndef _WIN32
+HI_TEST(fd_sink_writes_a_page_through_a_pipe) {
+  const DOM dom = s_page(20000);
+  const std::string expected = s_write(dom);
+  CHECK(expected.size() > 256 * 1024);
+  CHECK_EQ(s_throughPipe([&dom](FdSink& sink) {
+    Serializer serializer(sink);
+    serializer.write(dom);
+    serializer.flush();
+  }), expected);
+}
+
+// More parts than one writev takes, larger than the pipe holds at once.
+HI_TEST(fd_sink_gathers_parts) {
+  std::vector<std::string> pieces;
+  std::string expected;
+  for (int i = 0; i < 3000; ++i) {
+    pieces.push_back(std::string(static_cast<std::size_t>(i % 97), char('a' + i % 26)) + std::to_string(i));
+    expected += pieces.back();
+  }
+  const std::vector<std::string_view> parts(pieces.begin(), pieces.end());
+  CHECK_EQ(s_throughPipe([&parts](FdSink& sink) {
+    CHECK(sink.canGather());
+    sink.writeParts(parts);
+  }), expected);
+}
+
+// Signals without SA_RESTART make blocked writes return early, with part
+// of the bytes or with EINTR; both are retried until everything is out.
+HI_TEST(fd_sink_finishes_interrupted_writes) {
+  struct sigaction action = {}, previous = {};
+  action.sa_handler = [](int) {};
+  sigemptyset(&action.sa_mask);
+  ::sigaction(SIGUSR1, &action, &previous);
+
+  const std::string payload = s_write(s_page(5000));
+  CHECK_EQ(s_throughPipe([&payload](FdSink& sink) { sink.write(payload); }, true), payload);
+
+  std::vector<std::string_view> parts;
+  for (std::size_t i = 0; i < payload.size(); i += 1000)
+    parts.push_back(std::string_view(payload).substr(i, 1000));
+  CHECK_EQ(s_throughPipe([&parts](FdSink& sink) { sink.writeParts(parts); }, true), payload);
+
+  ::sigaction(SIGUSR1, &previous, nullptr);
+}
+
+HI_TEST(fd_sink_throws_when_the_write_fails) {
+  int fds[2];
+  CHECK_EQ(::pipe(fds), 0);
+  // The read end of a pipe cannot be written to.
+  FdSink read_end(fds[0]);
+  CHECK_THROWS(read_end.write("<p>"), exception::IOError);
+  const std::string_view parts[] = {"<p>", "</p>"};
+  CHECK_THROWS(read_end.writeParts(parts), exception::IOError);
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  FdSink closed(fds[1]);
+  CHECK_THROWS(closed.write("<p>"), exception::IOError);
+  {
+    Serializer serializer(closed);
+    serializer.write(Tag("p"));
+    CHECK_THROWS(serializer.flush(), exception::IOError);
+  }
+}
+#endif
+
+// Cards cached at level 0 are stale inside the page. The sections around
+// them are small enough to be written by tasks, which must write around
+// the stale entries instead of replacing them.
+HI_TEST(parallel_write_over_stale_nested_caches) {
+  DOM dom;
+  std::vector<Tag> cards;
+  for (int s = 0; s < 32; ++s) {
+    Tag section = dom.createElement("section");
+    for (int a = 0; a < 4; ++a) {
+      Tag article = dom.createElement("article");
+      for (int c = 0; c < 8; ++c) {
+        Tag card = dom.createElement("div");
+        card.setAttr("class", "card");
+        card << dom.createElement("span").addText("card " + std::to_string(c));
+        card.setCacheable();
+        article << card;
+        cards.push_back(card);
+      }
+      section << article;
+    }
+    dom.body << section;
+  }
+  for (const Tag& card : cards) {
+    std::string out;
+    StringSink sink(out);
+    Serializer serializer(sink);
+    serializer.write(card);
+    serializer.flush();
+  }
+
+  ThreadPool pool(4);
+  std::string parallel;
+  {
+    StringSink sink(parallel);
+    Serializer serializer(sink);
+    serializer.write(dom, pool);
+    serializer.flush();
+  }
+  CHECK_EQ(parallel, s_write(dom));
+  CHECK_EQ(s_write(dom), parallel);
+}
+
+HI_TEST(attribute_changes_below_a_cache_invalidate_it) {
+  CachedPage page;
+  page.item.setAttr("class", "active");
+  CHECK(s_write(page.dom).find("<li class=\"active\">") != std::string::npos);
+  page.item.removeAttr("class");
+  CHECK(s_write(page.dom).find("<li>") != std::string::npos);
+  page.nav.setAttr("id", "top");
+  CHECK(s_write(page.dom).find("<nav id=\"top\">") != std::string::npos);
+}
+
+HI_TEST(child_changes_below_a_cache_invalidate_it) {
+  CachedPage page;
+  Tag second = page.dom.createElement("li");
+  second.addText("about");
+  page.list << second;
+  CHECK(s_write(page.dom).find("about") != std::string::npos);
+  page.list.removeChild(second);
+  CHECK(s_write(page.dom).find("about") == std::string::npos);
+  page.list.insertChild(second, 0);
+  const std::string html = s_write(page.dom);
+  CHECK(html.find("about") < html.find("home"));
+}
+
+HI_TEST(text_changes_below_a_cache_invalidate_it) {
+  CachedPage page;
+  page.text.appendText(" page");
+  CHECK(s_write(page.dom).find("home page") != std::string::npos);
+  page.text.setText(std::string(200, 'x'));
+  CHECK(s_write(page.dom).find(std::string(200, 'x')) != std::string::npos);
+  page.text.eraseText(0, 199);
+  const std::string html = s_write(page.dom);
+  CHECK(html.find("xx") == std::string::npos);
+  CHECK(html.find("x") != std::string::npos);
+}
+
+// The first change drops both entries; once they are cached again, a
+// second change has to reach them as well.
+HI_TEST(caches_written_again_are_invalidated_again) {
+  CachedPage page;
+  for (int i = 0; i < 3; ++i) {
+    const std::string label = "item " + std::to_string(i);
+    page.text.setText(label);
+    const std::string html = s_write(page.dom);
+    CHECK(html.find(label) != std::string::npos);
+  }
+  // Writing the inner list alone caches it at another level; the change
+  // must still reach the nav.
+  page.list.toString();
+  page.item.setAttr("id", "last");
+  CHECK(s_write(page.dom).find("<li id=\"last\">") != std::string::npos);
+}
+
+// Threads writing the same page find the caches stale and store new bytes
+// while others replay them.
+HI_TEST(threads_write_a_cached_page_at_once) {
+  CachedPage page;
+  for (int i = 0; i < 50; ++i) {
+    Tag item = page.dom.createElement("li");
+    item.setCacheable();
+    item.addText("item " + std::to_string(i));
+    page.list << item;
+  }
+  const std::string expected = s_write(page.dom);
+  std::vector<std::string> outputs(4);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < outputs.size(); ++t) {
+    threads.emplace_back([&page, &outputs, t] {
+      for (int i = 0; i < 20; ++i) {
+        std::string out;
+        StringSink sink(out);
+        Serializer serializer(sink);
+        // Every other pass at another indent, which makes the caches stale.
+        serializer.write(page.dom, {i % 2 == 0 ? "  " : "\t"});
+        serializer.flush();
+        if (i % 2 == 0)
+          outputs[t] = out;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  for (const std::string& output : outputs)
+    CHECK_EQ(output, expected);
+}
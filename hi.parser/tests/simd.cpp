@@ -0,0 +1,34 @@
+#include "test.h"
+#include "hi.parser/simd.h"
+
+#include <string>
+
+using namespace hi::detail::simd;
+
+
+HI_TEST(every_level_finds_the_same_needle) {
+  constexpr CharScanner scanner{'<', '&', '>'};
+  const Level detected = detectLevel();
+  for (std::size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+    for (std::size_t at = 0; at <= length; ++at) {
+      std::string text(length, 'a');
+      if (at < length)
+        text[at] = '&';
+      const char* begin = text.data();
+      const char* end = begin + text.size();
+      for (auto level : {Level::Scalar, Level::SSE42, Level::AVX2}) {
+        setLevel(level);
+        CHECK_EQ(static_cast<std::size_t>(scanner.find(begin, end) - begin), at);
+        CHECK_EQ(static_cast<std::size_t>(scanner.findNear(begin, end) - begin), at);
+      }
+    }
+  }
+  setLevel(detected);
+}
+
+HI_TEST(bytes_above_0x7f_are_not_needles) {
+  constexpr CharScanner scanner{'<'};
+  const std::string text = std::string(40, '\xBC') + "<";
+  CHECK_EQ(static_cast<std::size_t>(scanner.find(text.data(), text.data() + text.size()) - text.data()), std::size_t(40));
+  CHECK_EQ(static_cast<std::size_t>(scanner.findNear(text.data(), text.data() + text.size()) - text.data()), std::size_t(40));
+}
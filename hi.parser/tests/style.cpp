@@ -0,0 +1,100 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/style.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace hi;
+
+namespace
+{
+
+const char* const kSheet =
+  "div { color: black; margin: 1px }\n"
+  ".warn { color: orange }\n"
+  "#top .warn { color: red }\n"
+  "span { color: blue !important }\n"
+  "em { margin: inherit; color: inherit }\n"
+  "li { padding: 2px }\n"
+  "li:nth-child(2n) { padding: 4px }\n"
+  "@media print { div { color: white } }";
+
+const char* const kPage =
+  "<div id=top><div id=w class=warn><em id=e></em></div><span id=s class=warn></span>"
+  "<div id=i style=\"color: green; margin: 3px\"></div></div>"
+  "<ul id=u><li class=a></li><li class=a></li><li class=a></li><li class=b></li></ul>";
+
+std::optional<std::string_view> s_get(const Styles& styles, const DOM& dom, std::string_view id, std::string_view property) {
+  return styles.get(*dom.getElementById(id))->get(property);
+}
+
+} // namespace
+
+
+HI_TEST(cascade_order_and_inheritance) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const hiweb::CSS sheet(kSheet);
+  StyleResolver resolver;
+  resolver.addStylesheet(sheet);
+  const Styles styles = resolver.resolve(dom);
+
+  CHECK_EQ(s_get(styles, dom, "top", "color"), std::optional<std::string_view>("black"));
+  CHECK_EQ(s_get(styles, dom, "w", "color"), std::optional<std::string_view>("red"));
+  CHECK_EQ(s_get(styles, dom, "w", "margin"), std::optional<std::string_view>("1px"));
+  CHECK_EQ(s_get(styles, dom, "s", "color"), std::optional<std::string_view>("blue"));
+  CHECK_EQ(s_get(styles, dom, "e", "color"), std::optional<std::string_view>("red"));
+  CHECK_EQ(s_get(styles, dom, "e", "margin"), std::optional<std::string_view>("1px"));
+  CHECK_EQ(s_get(styles, dom, "i", "color"), std::optional<std::string_view>("green"));
+  CHECK_EQ(s_get(styles, dom, "i", "margin"), std::optional<std::string_view>("3px"));
+  // margin is not inherited, padding only set on list items.
+  CHECK(!s_get(styles, dom, "u", "margin").has_value());
+  CHECK(!s_get(styles, dom, "top", "padding").has_value());
+}
+
+HI_TEST(siblings_that_cascade_alike_share_a_style) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const hiweb::CSS sheet(kSheet);
+  StyleResolver resolver;
+  resolver.addStylesheet(sheet);
+  const Styles styles = resolver.resolve(dom);
+
+  // Rules test ids, so only elements without one can share.
+  const auto items = dom.getElementById("u")->getChildren();
+  const auto style = [&](std::size_t i) { return styles.get(*items[i]); };
+  CHECK(style(0) == style(2));
+  CHECK(style(0) != style(1));
+  CHECK(style(1) != style(3));
+  CHECK_EQ(style(0)->get("padding"), std::optional<std::string_view>("2px"));
+  CHECK_EQ(style(1)->get("padding"), std::optional<std::string_view>("4px"));
+  CHECK_EQ(style(3)->get("padding"), std::optional<std::string_view>("4px"));
+  CHECK(styles.getSharedCount() > 0);
+  CHECK(styles.getStyleCount() < styles.size());
+}
+
+HI_TEST(sharing_does_not_change_any_style) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kPage);
+  const hiweb::CSS sheet(kSheet);
+  StyleResolver resolver;
+  resolver.addStylesheet(sheet);
+  const Styles shared = resolver.resolve(dom);
+  const Styles own = resolver.resolve(dom, {false});
+  CHECK_EQ(own.getSharedCount(), std::size_t(0));
+  CHECK_EQ(own.size(), shared.size());
+  for (const Tag& root : {dom.head, dom.body}) {
+    for (const auto& element : root.depthFirst()) {
+      const ComputedStyle* left = shared.get(element);
+      const ComputedStyle* right = own.get(element);
+      CHECK_EQ(left == nullptr, right == nullptr);
+      if (left == nullptr || right == nullptr)
+        continue;
+      CHECK_EQ(left->getProperties().size(), right->getProperties().size());
+      for (const auto& property : left->getProperties())
+        CHECK_EQ(right->get(property.id), std::optional<std::string_view>(property.value));
+    }
+  }
+}
@@ -0,0 +1,124 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/serializer.h"
+#include "hi.parser/template.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+// The page with the holes filled in before parsing, as rendering must write it.
+std::string s_parsed(std::string_view html) {
+  HTML5Parser parser;
+  return parser.parse(html).toString();
+}
+
+} // namespace
+
+
+HI_TEST(holes_are_numbered_by_first_use) {
+  const Template page = Template::s_parse("<title>{{title}}</title><p class=\"{{kind}}\">{{title}} {{{body}}}</p>");
+  CHECK_EQ(page.getHoleCount(), std::size_t(3));
+  CHECK_EQ(page.getHoleName(0), std::string("title"));
+  CHECK_EQ(page.getHoleName(1), std::string("kind"));
+  CHECK_EQ(page.getHoleName(2), std::string("body"));
+  CHECK_EQ(page.findHole("body"), std::optional<std::size_t>(2));
+  CHECK(!page.findHole("missing").has_value());
+  CHECK_THROWS(page.getHoleName(3), std::out_of_range);
+}
+
+HI_TEST(render_fills_holes_like_a_parsed_page) {
+  const Template page = Template::s_parse("<title>{{title}}</title><p class=\"{{kind}}\">{{title}} {{{body}}}</p>");
+  const std::string_view values[] = {"A & B <c>", "note \"quoted\"", "bold"};
+  CHECK_EQ(page.render(values),
+           s_parsed("<title>A &amp; B &lt;c&gt;</title><p class=\"note &quot;quoted&quot;\">A &amp; B &lt;c&gt; bold</p>"));
+
+  // Markup is written as is, without the layout the serializer gives elements.
+  const std::string_view markup[] = {"t", "k", "<b>bold</b>"};
+  CHECK(page.render(markup).find("t <b>bold</b>\n") != std::string::npos);
+
+  // Empty values still leave their text node in place.
+  const std::string_view empty[] = {"", "", ""};
+  CHECK(page.render(empty).find("<p class=\"\">\n     \n  </p>") != std::string::npos);
+}
+
+HI_TEST(raw_text_elements_take_values_as_is) {
+  const Template page = Template::s_parse("<script>var x = {{value}};</script><style>a { color: {{color}}; }</style>");
+  CHECK_EQ(page.getProgram()[0].type, Template::HoleType::Raw);
+  const std::string_view values[] = {"1 < 2 && 3", "red"};
+  CHECK_EQ(page.render(values), s_parsed("<script>var x = 1 < 2 && 3;</script><style>a { color: red; }</style>"));
+  const std::string_view other_end_tags[] = {"'</div></style>'", "</scrip"};
+  CHECK_EQ(page.render(other_end_tags), s_parsed("<script>var x = '</div></style>';</script><style>a { color: </scrip; }</style>"));
+}
+
+// A value that ends its element would turn the rest of it into markup, as
+// "</script><img src=x onerror=alert(1)>" would.
+HI_TEST(raw_text_values_that_end_their_element_are_refused) {
+  const Template page = Template::s_parse("<script>var x = {{value}};</script><style>a { color: {{color}}; }</style>");
+  const std::string_view script[] = {"</script><img src=x onerror=alert(1)>", "red"};
+  CHECK_THROWS(page.render(script), exception::InvalidTemplate);
+  const std::string_view upper[] = {"1; </SCRIPT", "red"};
+  CHECK_THROWS(page.render(upper), exception::InvalidTemplate);
+  const std::string_view style[] = {"0", "red }</sTyLe><b>"};
+  CHECK_THROWS(page.render(style), exception::InvalidTemplate);
+  std::string out;
+  StringSink sink(out);
+  Serializer serializer(sink);
+  CHECK_THROWS(serializer.write(page, script), exception::InvalidTemplate);
+
+  // The end tag may also be finished by the bytes around the value.
+  const Template split = Template::s_parse("<script>a = '<{{x}}';</script><style>{{y}}{{z}}</style>");
+  const std::string_view harmless[] = {"", "<", "/p>"};
+  CHECK_EQ(split.render(harmless), s_parsed("<script>a = '<';</script><style></p></style>"));
+  const std::string_view tail[] = {"/script>", "", ""};
+  CHECK_THROWS(split.render(tail), exception::InvalidTemplate);
+  const std::string_view across[] = {"", "<", "/style>"};
+  CHECK_THROWS(split.render(across), exception::InvalidTemplate);
+}
+
+HI_TEST(comments_and_unterminated_braces_stay) {
+  const Template page = Template::s_parse("<p>{{ok}} {{open</p><!-- {{note}} -->");
+  CHECK_EQ(page.getHoleCount(), std::size_t(1));
+  const std::string_view values[] = {"x"};
+  CHECK_EQ(page.render(values), s_parsed("<p>x {{open</p><!-- {{note}} -->"));
+}
+
+HI_TEST(templates_from_trees_and_sinks) {
+  Tag list("ul");
+  Tag item = list.createElement("li");
+  item.setAttr("data-id", "{{id}}");
+  item.addText("{{label}}");
+  list << item;
+  const Template page(list);
+  CHECK_EQ(page.getHoleCount(), std::size_t(2));
+  CHECK_EQ(page.getProgram()[0].type, Template::HoleType::Attribute);
+  CHECK_EQ(page.getProgram()[1].type, Template::HoleType::Text);
+
+  const std::string_view values[] = {"7", "a<b"};
+  std::string rendered;
+  page.render(values, rendered);
+  item.setAttr("data-id", "7");
+  item.setText("a<b");
+  CHECK_EQ(rendered, list.toString());
+
+  std::string out;
+  StringSink sink(out);
+  Serializer serializer(sink);
+  serializer.write(page, values);
+  serializer.flush();
+  CHECK_EQ(out, rendered);
+}
+
+HI_TEST(too_few_values_throw) {
+  const Template page = Template::s_parse("<p>{{a}}{{b}}</p>");
+  const std::string_view values[] = {"only one"};
+  CHECK_THROWS(page.render(values), exception::InvalidTemplate);
+  std::string out = "kept";
+  CHECK_THROWS(page.render(values, out), exception::InvalidTemplate);
+  CHECK_EQ(out, std::string("kept"));
+}
@@ -0,0 +1,69 @@
+#ifndef HI_TEST_H
+#define HI_TEST_H
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace hi {
+namespace test {
+
+
+using TestFn = void (*)();
+
+// Counts a failed check and prints where it failed.
+void fail(const char* file, int line, const std::string& message);
+bool registerTest(const char* name, const char* file, TestFn fn);
+
+template <typename T>
+std::string show(const T& value) {
+  std::ostringstream text;
+  if constexpr (std::is_convertible_v<const T&, std::string_view>)
+    text << '"' << std::string_view(value) << '"';
+  else if constexpr (requires { text << value; })
+    text << value;
+  else
+    text << "?";
+  return text.str();
+}
+
+} // namespace test
+} // namespace hi
+
+
+// A test case; the file it is in names the suite it belongs to, which is
+// what ctest runs (see tests/main.cpp).
+#define HI_TEST(name)                                                            \
+  static void hi_test_##name();                                                  \
+  static const bool hi_test_registered_##name =                                  \
+    ::hi::test::registerTest(#name, __FILE__, &hi_test_##name);                  \
+  static void hi_test_##name()
+
+#define CHECK(condition)                                                         \
+  do {                                                                           \
+    if (!(condition))                                                            \
+      ::hi::test::fail(__FILE__, __LINE__, #condition);                          \
+  } while (0)
+
+// Copies both operands, so a check of `*opt()` or of a member of a temporary
+// never compares through a dangling reference.
+#define CHECK_EQ(actual, expected)                                               \
+  do {                                                                           \
+    const auto hi_actual_ = (actual);                                            \
+    const auto hi_expected_ = (expected);                                        \
+    if (!(hi_actual_ == hi_expected_))                                           \
+      ::hi::test::fail(__FILE__, __LINE__, #actual " == " #expected ": " +      \
+        ::hi::test::show(hi_actual_) + " != " + ::hi::test::show(hi_expected_)); \
+  } while (0)
+
+#define CHECK_THROWS(expression, exception)                                      \
+  do {                                                                           \
+    bool hi_thrown_ = false;                                                     \
+    try { (void)(expression); } catch (const exception&) { hi_thrown_ = true; } \
+    if (!hi_thrown_)                                                             \
+      ::hi::test::fail(__FILE__, __LINE__, #expression " throws " #exception);  \
+  } while (0)
+
+#endif // HI_TEST_H
@@ -0,0 +1,233 @@
+#include "test.h"
+#include "hi.parser/frozen.h"
+#include "hi.parser/html5.h"
+#include "hi.parser/parser.h"
+#include "hi.parser/rope.h"
+#include "hi.parser/serializer.h"
+#include "hi.parser/template.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace hi;
+
+
+HI_TEST(rope_edits_match_a_string) {
+  detail::Rope rope;
+  std::string model;
+  uint32_t seed = 12345;
+  const auto next = [&seed] { return seed = seed * 1664525u + 1013904223u; };
+  for (int step = 0; step < 2000; ++step) {
+    const std::size_t position = model.empty() ? 0 : next() % (model.size() + 1);
+    const std::string text(next() % 300, static_cast<char>('a' + step % 26));
+    switch (next() % 3) {
+    case 0:
+      rope.append(text);
+      model += text;
+      break;
+    case 1:
+      rope.insert(position, text);
+      model.insert(position, text);
+      break;
+    default: {
+      const std::size_t count = next() % 400;
+      rope.erase(position, count);
+      model.erase(position, count);
+    }
+    }
+    CHECK_EQ(rope.size(), model.size());
+  }
+  CHECK_EQ(rope.toString(), model);
+  std::string chunks;
+  rope.forEachChunk([&](std::string_view chunk) {
+    CHECK(chunk.size() <= detail::Rope::kChunkSize);
+    chunks += chunk;
+  });
+  CHECK_EQ(chunks, model);
+
+  const detail::Rope copy = rope;
+  rope.clear();
+  CHECK(rope.empty());
+  CHECK_EQ(copy.toString(), model);
+}
+
+HI_TEST(rope_clamps_positions_past_the_end) {
+  detail::Rope rope("abc");
+  rope.insert(100, "def");
+  CHECK_EQ(rope.toString(), std::string("abcdef"));
+  rope.erase(4, 100);
+  CHECK_EQ(rope.toString(), std::string("abcd"));
+  rope.erase(100, 1);
+  CHECK_EQ(rope.toString(), std::string("abcd"));
+}
+
+HI_TEST(short_text_edits_stay_views) {
+  Tag div("div");
+  div.addText("hello");
+  Tag text = div.createText("x");
+  div << text;
+  text.appendText("yz");
+  text.insertText(0, "w");
+  text.eraseText(1, 1);
+  CHECK_EQ(text.getText(), std::string("wyz"));
+  CHECK_EQ(div.getText(), std::string("hellowyz"));
+  CHECK(div.getChildren()[1]->getTextSize() == 3);
+}
+
+HI_TEST(long_text_edits_move_to_a_rope) {
+  HTML5Parser parser;
+  DOM dom = parser.parse("<div>start</div>");
+  Tag& body = dom.body;
+  Tag text = body.createText("");
+  body << text;
+  std::string model;
+  for (int i = 0; i < 500; ++i) {
+    const std::string line = "line " + std::to_string(i) + " <&>\n";
+    text.appendText(line);
+    model += line;
+  }
+  text.insertText(0, "[");
+  model = "[" + model;
+  text.eraseText(10, 100);
+  model.erase(10, 100);
+  text.insertText(model.size() / 2, "middle");
+  model.insert(model.size() / 2, "middle");
+  CHECK_EQ(text.getText(), model);
+  CHECK_EQ(body.getText(), "start" + model);
+
+  // The serializer escapes the stored text.
+  const std::string html = dom.toString();
+  CHECK(html.find("line 400 &lt;&amp;&gt;") != std::string::npos);
+  CHECK(html.find("line 400 <&>") == std::string::npos);
+
+  text.setText("short");
+  CHECK_EQ(text.getText(), std::string("short"));
+}
+
+HI_TEST(comments_edit_like_text) {
+  Tag div("div");
+  Tag comment = div.createComment("a");
+  div << comment;
+  CHECK(comment.isComment());
+  comment.appendText(std::string(200, 'b'));
+  comment.eraseText(1, 199);
+  CHECK_EQ(comment.getText(), std::string("ab"));
+  CHECK_EQ(div.getText(), std::string(""));
+}
+
+// Comment text set through the API cannot close the comment: a '>' that
+// would is written as "&gt;", also when an edit puts the pieces together.
+HI_TEST(comment_text_cannot_end_the_comment) {
+  Tag div("div");
+  Tag comment = div.createComment("x--><script>alert(1)</script><!--");
+  div << comment;
+  CHECK_EQ(div.toString("", true, true), std::string("<div>\n<!--x--&gt;<script>alert(1)</script><!---->\n</div>\n"));
+
+  comment.setText("a--!>b");
+  CHECK(div.toString().find("<!--a--!&gt;b-->") != std::string::npos);
+  comment.setText(">a");
+  CHECK(div.toString().find("<!--&gt;a-->") != std::string::npos);
+  comment.setText("->a");
+  CHECK(div.toString().find("<!---&gt;a-->") != std::string::npos);
+  comment.setText("a > b -> c");
+  CHECK(div.toString().find("<!--a > b -> c-->") != std::string::npos);
+
+  // Split across a rope: the dashes and the '>' end up in different chunks.
+  comment.setText(std::string(300, 'a'));
+  comment.appendText("--");
+  comment.appendText(std::string(detail::Rope::kChunkSize, 'b'));
+  comment.eraseText(302, detail::Rope::kChunkSize);
+  comment.appendText("><p>");
+  const std::string html = div.toString("");
+  CHECK(html.find("--&gt;<p>-->") != std::string::npos);
+  CHECK(html.find("--><p>") == std::string::npos);
+  CHECK_EQ(comment.getText(), std::string(300, 'a') + "--><p>");
+
+  HTML5Parser parser;
+  const DOM dom = parser.parse(html);
+  CHECK(dom.getElementsByTagName("p").empty());
+
+  DOM page;
+  page.body << page.createComment("x--><p>");
+  std::string frozen_html;
+  StringSink sink(frozen_html);
+  Serializer serializer(sink);
+  serializer.write(FrozenDOM(page));
+  serializer.flush();
+  CHECK(frozen_html.find("<!--x--&gt;<p>-->") != std::string::npos);
+}
+
+// Text of a script or style set through the API cannot end the element:
+// "</script" in any case is written as "<\/script", also when it is spread
+// over adjacent text nodes, and the page parses back to the same tree.
+HI_TEST(raw_text_cannot_end_its_element) {
+  const SerializeOptions compact{"", ""};
+  const auto s_compact = [&compact](const auto& tree) {
+    std::string html;
+    StringSink sink(html);
+    Serializer serializer(sink);
+    serializer.write(tree, compact);
+    serializer.flush();
+    return html;
+  };
+  HTML5Parser parser;
+  const auto s_reparsed = [&parser](const std::string& page, const char* name) {
+    const DOM dom = parser.parse(page);
+    CHECK(dom.getElementsByTagName("p").empty());
+    const auto elements = dom.getElementsByTagName(name);
+    CHECK_EQ(elements.size(), std::size_t(1));
+    return elements.empty() ? std::string() : elements[0].getText();
+  };
+
+  Tag div("div");
+  Tag script("script");
+  div << script;
+  script.setText("a = '</script><p>x</p>'; b = '</SCRIPT '; c = '</div></style>';");
+  std::string html = s_compact(div);
+  CHECK_EQ(html, std::string("<div><script>a = '<\\/script><p>x</p>'; b = '<\\/SCRIPT '; c = '</div></style>';</script></div>"));
+  CHECK_EQ(s_reparsed(html, "script"), std::string("a = '<\\/script><p>x</p>'; b = '<\\/SCRIPT '; c = '</div></style>';"));
+
+  Tag style("style");
+  style << style.createText("a::after { content: '<") << style.createText("/sty") << style.createText("le><p>'; }");
+  html = s_compact(style);
+  CHECK(html.find("<\\/style>") != std::string::npos);
+  CHECK_EQ(s_reparsed(html, "style"), std::string("a::after { content: '<\\/style><p>'; }"));
+
+  DOM page;
+  Tag inline_script = page.createElement("script");
+  page.body << inline_script;
+  inline_script.setText("</script><p>");
+  CHECK_EQ(s_reparsed(s_compact(FrozenDOM(page)), "script"), std::string("<\\/script><p>"));
+
+  script.setText("</script>{{x}}");
+  const std::string_view values[] = {"<p>"};
+  CHECK_EQ(s_reparsed(Template(script, compact).render(values), "script"), std::string("<\\/script><p>"));
+}
+
+HI_TEST(elements_refuse_text_edits) {
+  Tag div("div");
+  div.setText("replaced");
+  CHECK_EQ(div.getText(), std::string("replaced"));
+  CHECK_EQ(div.getChildren().size(), std::size_t(1));
+  CHECK_THROWS(div.appendText("x"), exception::InvalidTag);
+  CHECK_THROWS(div.insertText(0, "x"), exception::InvalidTag);
+  CHECK_THROWS(div.eraseText(0, 1), exception::InvalidTag);
+}
+
+// A lookup in the page hands out the page's handle to an element of
+// another document; text added through it must live with the element.
+HI_TEST(text_added_through_a_grafted_element_lives_with_it) {
+  Tag div("div");
+  div.setAttr("id", "a");
+  {
+    DOM page;
+    page.body << div;
+    page.getElementById("a")->addText("added");
+    Tag found = *page.getElementById("a");
+    found.setText("replaced");
+  }
+  const auto children = div.getChildren();
+  CHECK_EQ(children.size(), std::size_t(1));
+  CHECK(children[0]->getDocument() == children[0]->getParent()->getDocument());
+  CHECK_EQ(div.toString(""), std::string("<div id=\"a\">\nreplaced\n</div>\n"));
+}
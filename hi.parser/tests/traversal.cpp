@@ -0,0 +1,72 @@
+#include "test.h"
+#include "hi.parser/parser.h"
+
+#include <string>
+#include <vector>
+
+using namespace hi;
+
+namespace
+{
+
+template <typename Range>
+std::string s_names(Range range) {
+  std::string names;
+  for (const auto& element : range)
+    names += element.getAttr("id");
+  return names;
+}
+
+const char* const kTree =
+  "<div id=\"a\"><div id=\"b\"><i id=\"d\"></i><i id=\"e\"></i></div><div id=\"c\"><i id=\"f\"><b id=\"g\"></b></i></div></div>";
+
+} // namespace
+
+
+HI_TEST(depth_first_visits_in_document_order) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kTree);
+  CHECK_EQ(s_names(dom.getElementById("a")->depthFirst()), std::string("abdecfg"));
+  CHECK_EQ(s_names(dom.getElementById("c")->depthFirst()), std::string("cfg"));
+}
+
+HI_TEST(breadth_first_visits_level_by_level) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kTree);
+  CHECK_EQ(s_names(dom.getElementById("a")->breadthFirst()), std::string("abcdefg"));
+  CHECK_EQ(s_names(dom.getElementById("b")->breadthFirst()), std::string("bde"));
+  CHECK_EQ(s_names(dom.getElementById("g")->breadthFirst()), std::string("g"));
+}
+
+HI_TEST(breadth_first_reports_depth) {
+  HTML5Parser parser;
+  const DOM dom = parser.parse(kTree);
+  std::vector<std::size_t> depths;
+  auto range = dom.getElementById("a")->breadthFirst();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    depths.push_back(it.getDepth());
+  CHECK_EQ(depths.size(), std::size_t(7));
+  CHECK_EQ(depths[0], std::size_t(0));
+  CHECK_EQ(depths[2], std::size_t(1));
+  CHECK_EQ(depths[5], std::size_t(2));
+  CHECK_EQ(depths[6], std::size_t(3));
+}
+
+HI_TEST(breadth_first_over_a_deep_chain) {
+  DOM dom;
+  Tag node = dom.body;
+  for (int i = 0; i < 20000; ++i) {
+    Tag child = dom.createElement("div");
+    node << child;
+    node = child;
+  }
+  std::size_t count = 0;
+  std::size_t depth = 0;
+  auto range = dom.body.breadthFirst();
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    ++count;
+    depth = it.getDepth();
+  }
+  CHECK_EQ(count, std::size_t(20001));
+  CHECK_EQ(depth, std::size_t(20000));
+}